@@ -0,0 +1,44 @@
+// aec.h
+#ifndef AEC_H
+#define AEC_H
+
+// Hoparlör yankısını mikrofondan çıkaran NLMS süzgeci ve Geigel çift konuşma
+// algılayıcısı. Tamamen sabit noktalıdır, Arduino'ya bağlı değildir;
+// masaüstünde de derlenir.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define AEC_TAPS          256    // 16 kHz'de 16 ms yankı yolu
+#define AEC_GEIGEL_MARGIN 2      // |d| > 2 * ||w||1 * max|x| ise yakın konuşma var
+#define AEC_DT_HANGOVER   480    // çift konuşmadan sonra 30 ms uyarlama durur
+#define AEC_CONVERGE      8000   // ilk 0.5 s'de algılayıcı kapalı, süzgeç yakınsar
+#define AEC_DELTA         ((int64_t)AEC_TAPS * 512 * 512)  // sessiz referansta adımı sınırlar
+
+struct AecState {
+  int32_t w[AEC_TAPS];          // katsayılar, Q30
+  int16_t x[2 * AEC_TAPS];      // referans geçmişi; x[pos..pos+AEC_TAPS) en yeniden eskiye
+  int pos;
+  int64_t x_energy;             // penceredeki referansın kareler toplamı
+  int32_t mu_q15;
+  int32_t max_x;                // penceredeki en büyük |x|, Geigel için
+  int32_t w_norm_q12;           // ||w||1
+  int32_t dt_hold;              // kalan çift konuşma beklemesi (örnek)
+  int32_t converge_left;
+  uint32_t since_scan;
+  // ERLE ve çift konuşma oranı, referans varken
+  uint64_t sum_d2;
+  uint64_t sum_e2;
+  uint32_t active_samples;
+  uint32_t dt_samples;
+};
+
+void aec_init(AecState* st, float mu);
+void aec_clear_history(AecState* st);   // katsayılar korunur, referans geçmişi sıfırlanır
+// mic yerinde yankısı çıkarılmış sinyalle değiştirilir
+void aec_process(AecState* st, int16_t* mic, const int16_t* ref, size_t n);
+float aec_erle_db(const AecState* st);
+float aec_double_talk_ratio(const AecState* st);
+void aec_reset_stats(AecState* st);
+
+#endif
@@ -0,0 +1,33 @@
+// audio_capture.h
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include "config.h"
+
+// Mikrofon bir görevde sürekli okunur, ön işlenmiş 16 bit PCM halkaya yazılır.
+// Oturumlar I2S'i yeniden kurmadan halkadan okur ve açıldıkları andan
+// önceki sesi de (ön kayıt) alabilir.
+
+// Okuyucunun konumu, açılıştan beri yazılan örneklerin mutlak sırasıdır
+struct CaptureReader {
+  uint32_t pos;
+  uint32_t dropped;   // okuyucu halkanın gerisinde kaldığı için atlanan örnek
+};
+
+bool capture_start();
+void capture_pause();                 // boşta I2S durdurulur
+void capture_resume();                // önceki ses geçersiz sayılır, ön kayıt buraya uzanmaz
+void capture_mark_boundary();         // ör. hoparlör sustuğunda: ön kayıt bu noktadan geriye gitmez
+void capture_hold_gain(bool hold);    // hoparlör çalarken AGC sabitlenir
+uint32_t capture_position();          // halkaya yazılan toplam örnek
+// Hoparlöre giden 16 kHz mono ses; play_us ilk örneğin DAC'tan çıkacağı an
+// (esp_timer_get_time). Yankı giderici bunu mikrofon örnekleriyle hizalar.
+void capture_push_reference(const int16_t* pcm, size_t n, int64_t play_us);
+
+void capture_open(CaptureReader* r, uint32_t preroll_ms);
+void capture_rewind(CaptureReader* r, uint32_t ms);
+void capture_seek(CaptureReader* r, uint32_t pos);
+// En fazla max_samples örnek kopyalar; veri yoksa timeout_ms kadar bekler
+size_t capture_read(CaptureReader* r, int16_t* dst, size_t max_samples, uint32_t timeout_ms);
+
+#endif
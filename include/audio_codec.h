@@ -0,0 +1,23 @@
+// audio_codec.h
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Her blok bağımsız çözülebilir: 4 bayt başlık (int16 öngörü, uint8 adım
+// indeksi, 0) ve ardından örnek başına 4 bit, düşük nibble önce
+#define ADPCM_BLOCK_HEADER 4
+#define ADPCM_BLOCK_BYTES(samples) (ADPCM_BLOCK_HEADER + ((samples) + 1) / 2)
+
+struct AdpcmState {
+  int16_t predictor;
+  uint8_t index;
+};
+
+void adpcm_reset(AdpcmState* st);
+size_t adpcm_encode_block(AdpcmState* st, const int16_t* in, size_t samples, uint8_t* out);
+
+const char* uplink_codec_name(int codec);
+
+#endif
@@ -11,15 +11,35 @@
 //#include "AudioFileSourceHTTPStream.h"
 
 // Voice Assistant Variables
-uint8_t chunk_buffer[CHUNK_SIZE + WAV_HEADER_SIZE];  // Chunk + WAV header için buffer
-AudioFileSourceHTTPStream *file;
-AudioOutputI2S *out;
-AudioGeneratorWAV *wav;
+// WAV header + sunucuya giden 16 bit PCM parçası; audio_buffers_init() PSRAM'den ayırır.
+extern uint8_t* chunk_buffer;
 
+// DMA olay kuyruğundan sayılan kayıp/boşluk istatistikleri
+struct I2sStats {
+  uint32_t rx_done;        // dolan kayıt tamponu
+  uint32_t rx_overflow;    // okunmadan üzerine yazılan tampon, her biri rx_buf_frames örnek kayıp
+  uint32_t tx_done;        // çalınan tampon
+  uint32_t tx_underflow;   // zamanında doldurulamayan tampon, yerine sessizlik çalınır
+  uint16_t rx_buf_count, rx_buf_frames;
+  uint16_t tx_buf_count, tx_buf_frames;
+};
+
+void audio_buffers_init();
 void i2s_record_init();
-void i2s_play_init();
+void i2s_play_init(int sample_rate = SAMPLE_RATE);
+void i2s_release(i2s_port_t port);                       // olay görevini ayırıp sürücüyü kaldırır
+esp_err_t i2s_mic_read(void* dst, size_t len, size_t* bytes_read);  // MIC_I2S_PORT'tan i2s_read + kayıp sayımı
+void i2s_get_stats(I2sStats* out);
+void i2s_print_stats();
 void create_wav_header(uint8_t* h, size_t pcm_size, int sr);
 String send_audio_to_server(uint8_t* data, size_t len);
-void play_wav_from_url(const String& url);
+String request_tts_url(const String& text);   // metni REPLY_FORMAT'ta sese çevirtir, URL (ya da ws: adresi) döner
+void play_audio_from_url(const String& url);  // WAV ya da MP3, uzantıya göre; http:// ya da ws:, bitene kadar bekler
+
+// Çalma görevi: başlatılır, istenirse kesilir (bkz. barge_in.h)
+bool playback_start(const String& url);
+void playback_cancel();
+bool playback_active();
+float playback_ref_energy(uint32_t window_ms);  // son pencerede hoparlöre giden en yüksek çerçeve enerjisi
 
 #endif
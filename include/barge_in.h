@@ -0,0 +1,26 @@
+// barge_in.h
+#ifndef BARGE_IN_H
+#define BARGE_IN_H
+
+#include "config.h"
+
+// Yanıt çalınırken mikrofon ve tuş takımı izlenir. Konuşma, hoparlöre giden
+// sinyalden beklenen yankı seviyesiyle karşılaştırılarak ayırt edilir.
+enum barge_in_t {
+  BARGE_IN_NONE,    // çalma sonuna kadar sürdü
+  BARGE_IN_VOICE,   // kullanıcı konuştu, çalma kesildi
+  BARGE_IN_KEY      // tuşa basıldı, çalma kesildi
+};
+
+struct BargeInResult {
+  barge_in_t reason;
+  uint32_t onset;   // BARGE_IN_VOICE: konuşmanın başladığı halka konumu (bkz. audio_capture.h)
+};
+
+typedef char (*barge_in_key_fn)();
+
+void barge_in_set_key_source(barge_in_key_fn read_key);
+BargeInResult play_interruptible(const String& url);
+char barge_in_take_key();   // çalmayı kesen tuş, bir kez döner
+
+#endif
@@ -0,0 +1,35 @@
+// blackbox.h
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include "config.h"
+
+// Saha arızaları için kara kutu: son günlük satırları ve metrik özetleri.
+// Kayıt önce RTC yavaş belleğindeki halkaya yazılır (panik, watchdog ve
+// brownout resetinden sağ çıkar), blackbox görevi bunları toplu halde
+// "blackbox" flash bölümündeki döngüsel sektörlere aktarır (güç kesintisinden
+// de sağ çıkar). Sektörler sırayla silinir, her biri halka başına bir kez
+// aşınır; silme yalnızca cihaz boştayken (mikrofon kapalı) yapılır.
+// Açılışta RTC'de kalan, flash'a geçmemiş kayıtlar önce flash'a yazılır.
+// Günlük satırları kayıt anında (log_detail::push) ham olarak RTC'ye girer;
+// günlük halkasında bekleyen son satırlar da panikten sağ çıkar. Metne
+// çevirme flash'a aktarırken yapılır; başka bir yazılımın ham kayıtları
+// çözülemeyeceğinden imaj değişince RTC halkası atılır.
+// İçerik METRICS_HTTP_PORT'taki /blackbox'tan eskiden yeniye düz metin okunur.
+
+enum BlackboxType : uint8_t {
+  BLACKBOX_LOG = 1,        // günlük satırı; level LOG_LEVEL_*
+  BLACKBOX_METRICS = 2,    // metrics_summary() satırı
+  BLACKBOX_BOOT = 3,       // açılış ve önceki resetin nedeni
+  BLACKBOX_LOG_RAW = 4,    // yalnızca RTC'de: log.h ikili kaydı, flash'a BLACKBOX_LOG olarak geçer
+};
+
+void blackbox_begin();
+// Kopyalanır; bölüm yoksa ya da başlatılmadıysa yok sayılır. Kilit kısa bir
+// kritik bölümdür, flash'a dokunmaz; metin hazırlamak gerektiğinden sıcak yoldan çağrılmaz.
+void blackbox_append(BlackboxType type, uint8_t level, const char* text, size_t len);
+// log_detail::push'tan; biçimlendirmeden kopyalar, kritik bölüm kaydın boyu kadar sürer
+void blackbox_append_record(const uint8_t* rec, size_t len);
+size_t blackbox_dump(Print& out);
+
+#endif
@@ -1,17 +1,24 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Masaüstü testleri (test/host) yalnızca aşağıdaki sabitleri kullanır
+#ifdef ARDUINO
 #include <Arduino.h>
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include "driver/i2s.h"
 #include "AudioFileSourceHTTPStream.h"
+#include "AudioFileSourceBuffer.h"
 #include "AudioGeneratorWAV.h"
+#include "AudioGeneratorMP3.h"
 #include "AudioOutputI2S.h"
-#include <time.h>
 #include <ArduinoJson.h>
 #include <Keypad.h>
 #include <ESP32Servo.h>
+#endif
+#include <time.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #define WIFI_SSID    "Menes"
 #define WIFI_PASS    "deneme123"
@@ -20,14 +27,143 @@
 #define SERVER_URL   "http://" SERVER_IP ":" SERVER_PORT
 #define UPLOAD_URL   SERVER_URL "/upload"
 #define LOG_URL      SERVER_URL "/log_access"
+#define CAPS_URL     SERVER_URL "/capabilities"
 
-#define SAMPLE_RATE     16000
+// Son bağlantının BSSID/kanal/IP bilgisi RTC ve NVS'de saklanır, tekrar
+// bağlanırken tarama atlanır; DHCP varsayılan olarak yine çalışır
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 1500   // hızlı bağlantı bu sürede olmazsa tam taramaya dönülür
+#define WIFI_CONNECT_TIMEOUT_MS      10000
+#define WIFI_RETRY_MAX_MS            30000
+// Önbellekteki DHCP adresini statik olarak kullanır (DHCP atlanır). Kira süresi
+// dolmuş ya da adres başkasına verilmişse IP çakışır ve ağ bunu bilemez;
+// yalnızca adresin DHCP sunucusunda rezerve edildiği ağlarda açın
+#define WIFI_REUSE_LEASE             0
+// Sabit IP için açın (WIFI_REUSE_LEASE yerine geçer)
+//#define WIFI_STATIC_IP      "172.20.10.5"
+//#define WIFI_STATIC_GATEWAY "172.20.10.1"
+//#define WIFI_STATIC_NETMASK "255.255.255.240"
+//#define WIFI_STATIC_DNS     "172.20.10.1"
+
+#define NTP_SERVER          "pool.ntp.org"
+#define GMT_OFFSET_SEC      10800   // UTC+3 for Turkey
+#define DAYLIGHT_OFFSET_SEC 0
+#define TIME_PERSIST_SEC    60      // saat bu aralıkla RTC belleğine yazılır
+
+#define SAMPLE_RATE     16000   // halka, AEC ve oturumların iç örnekleme hızı
+#define MIC_I2S_RATE    48000   // mikrofonun I2S saat hızı; SAMPLE_RATE'e cihazda dönüştürülür
 #define SAMPLE_BITS     I2S_BITS_PER_SAMPLE_16BIT
 #define CHANNEL_FORMAT  I2S_CHANNEL_FMT_ONLY_LEFT
 #define RECORD_TIME_SEC 10
-#define CHUNK_SIZE      4096
+#define CHUNK_SIZE      4096   // sunucuya giden 16 bit PCM parça boyutu
 #define WAV_HEADER_SIZE 44
 
+// Mikrofon ön işleme: 32 bit okuma -> DC engelleme -> yüksek geçiren -> AGC/sınırlayıcı -> 16 bit
+#define MIC_SAMPLE_BITS    I2S_BITS_PER_SAMPLE_32BIT  // INMP441 24 bit veriyi 32 bit yuvada verir
+#define MIC_HPF_HZ         100     // konuşma bandının altı kesilir
+#define MIC_AGC_TARGET_RMS 3000    // 16 bit ölçekte hedef seviye (~-21 dBFS)
+#define MIC_AGC_MAX_GAIN   64      // en fazla +36 dB
+#define MIC_AGC_NOISE_RMS  40      // bunun altındaki bloklar sessizlik sayılır, kazanç büyütülmez
+#define MIC_LIMIT_PEAK     30000   // sınırlayıcı tepe değeri
+
+// I2S DMA geometrisi gecikme bütçesinden türetilir:
+// tampon uzunluğu = I2S_DMA_BUF_MS, tampon sayısı = bütçe / I2S_DMA_BUF_MS
+#define I2S_DMA_BUF_MS     16      // bir DMA tamponunun süresi (okuma/yazma gecikmesi)
+#define I2S_RX_BUDGET_MS   64      // yakalama görevinin kayıpsız gecikebileceği süre; ağ beklemesini halka karşılar
+#define I2S_TX_BUDGET_MS   128     // çözücünün ağdan okurken çalmayı kesmeden bekleyebileceği süre
+#define I2S_EVENT_QUEUE_LEN 8
+
+// Mikrofon sürekli açıktır ve PSRAM'deki halkaya yazar (bkz. audio_capture.h)
+#define MIC_I2S_PORT       I2S_NUM_1
+#define DAC_I2S_PORT       I2S_NUM_0
+#define CAPTURE_RING_LOG2  17      // 2^17 örnek = ~8 s; PSRAM yoksa ~0.5 s'ye düşer
+#define CAPTURE_PREROLL_MS 500     // oturum, açıldığı andan bu kadar önceki sesle başlar
+
+// Barge-in: yanıt çalarken kullanıcı konuşursa çalma kesilir
+#define BARGE_IN_MIN_RMS      600    // bunun altı konuşma sayılmaz (16 bit, AGC sonrası)
+#define BARGE_IN_ECHO_MARGIN  4.0f   // mikrofon enerjisi beklenen yankının bu katını aşmalı (~6 dB)
+#define BARGE_IN_ECHO_WINDOW_MS 250  // DAC DMA gecikmesi + akustik yol için referans penceresi
+#define BARGE_IN_LEARN_MS     300    // çalmanın başında yankı kuplajı öğrenilir
+#define BARGE_IN_LEARN_MIN_FRAMES 4   // ortanca için en az bu kadar sessiz (yakın uç VAD kapalı) çerçeve
+#define BARGE_IN_COUPLING_MIN 0.001f  // öğrenilen kuplaj (enerji oranı) bu aralığa kırpılır: -30 dB ..
+#define BARGE_IN_COUPLING_MAX 1.0f    // .. 0 dB; üst sınır eşiğin hiç aşılamayacak kadar şişmesini önler
+#define BARGE_IN_HOLD_MS      160    // bu kadar süren konuşma araya girme sayılır
+
+// Yankı giderme: DAC'a giden ses referans alınıp mikrofondan çıkarılır (bkz. aec.h)
+#define AEC_ENABLED        1
+#define AEC_MU             0.3f   // NLMS adımı; büyüdükçe hızlı yakınsar, gürültüde dalgalanır
+#define AEC_REF_LEAD       64     // referans 4 ms erken verilir; zaman damgası hatası süzgecin içinde kalır
+#define AEC_REF_RING_LOG2  12     // 4096 örnek = 256 ms; DAC DMA derinliğinden uzun olmalı
+#define AEC_REF_RESYNC     256    // referans zamanı bundan fazla kayarsa yeniden hizalanır (16 ms)
+
+// Sunucuya giden ses kodlaması
+#define CODEC_PCM       0   // 16 bit PCM, 32 KB/s
+#define CODEC_IMA_ADPCM 1   // 4 bit IMA-ADPCM, 8 KB/s
+#define UPLINK_CODEC    CODEC_IMA_ADPCM
+// Yükleme taşıması: HTTP parça POST'ları, düşük gecikmeli UDP datagramları ya da
+// kalıcı WebSocket oturumu (bkz. uplink.h, ws_session.h)
+#define TRANSPORT_HTTP  0
+#define TRANSPORT_UDP   1
+#define TRANSPORT_WS    2
+#define UPLINK_TRANSPORT TRANSPORT_WS
+#define UDP_AUDIO_PORT  5005     // llm_server.py UDP_PORT
+#define UDP_LOCAL_PORT  5006     // sunucunun ACK/yanıt datagramları buraya gelir
+#define UDP_FRAME_MS    20       // datagram başına ses
+#define UDP_FEC_GROUP   4        // bu kadar pakette bir XOR eşlik paketi; 0 kapatır (+%25 trafik)
+#define UDP_END_RETRY_MS 100     // bitiş paketi onaylanana kadar yineleme aralığı
+#define UDP_REPLY_TIMEOUT_MS 120000
+#define WS_PATH          "/ws"
+#define WS_RECONNECT_MS  2000     // bağlantı koparsa yeniden deneme aralığı
+#define WS_CONNECT_WAIT_MS 1000   // oturum başında bağlantı bu kadar beklenir, yoksa HTTP'ye düşülür
+#define WS_CALL_TIMEOUT_MS 10000  // kullanıcı işlemlerinin (check_user, tts...) yanıt süresi
+#define WS_REPLY_TIMEOUT_MS 120000
+#define WS_DOWNLINK_BYTES  32768  // yanıt sesi için PSRAM halkası
+#define WS_DOWNLINK_FRAME  4096   // llm_server.py WS_AUDIO_FRAME; halkada bu kadar yer yoksa okuma durur
+#define WS_DOWNLINK_STALL_MS 3000 // yanıt bu kadar okunmazsa bırakılır
+
+// Yükleme hızı tercihi (8000 ya da 16000); sunucu /capabilities'de desteklemezse SAMPLE_RATE
+#define UPLINK_SAMPLE_RATE 16000
+
+#define DSP_BENCHMARK_ON_BOOT 0   // 1: açılışta DSP çekirdeklerinin çevrim ölçümü yazılır
+
+// Bellek yerleşimi (bkz. mem_policy.h)
+#define MEM_EXTMEM_THRESHOLD      2048    // bundan büyük malloc'lar PSRAM'e gider
+#define MEM_INTERNAL_FALLBACK_MAX 16384   // PSRAM yoksa dahili RAM'e düşülebilecek en büyük tampon
+#define REPLY_BUFFER_BYTES        32768   // yanıt sesi için PSRAM jitter tamponu (~8 s mp3)
+
+// Sunucudan istenen yanıt sesi formatı: "mp3" (gTTS çıktısı, ~8x daha küçük) ya da "wav"
+#define REPLY_FORMAT    "mp3"
+
+// İçerik adresli yanıt sesleri (tts-<anahtar>.<format>) LittleFS'te tutulur, bkz. reply_cache.h
+#define REPLY_CACHE_ENABLED     1
+#define REPLY_CACHE_MAX_BYTES   (512 * 1024)
+#define REPLY_CACHE_MAX_ENTRIES 48
+#define REPLY_CACHE_FILE_MAX    65536   // daha büyük yanıt önbelleğe alınmaz (PSRAM tamponu)
+
+// Telemetri (bkz. metrics.h)
+#define METRICS_ENABLED      1
+#define METRICS_HTTP_PORT    9100     // Prometheus: http://<cihaz>:9100/metrics
+#define METRICS_POLL_MS      50       // gelen isteklere bakma aralığı
+#define METRICS_PUSH_MS      0        // >0: metin bu aralıkla METRICS_PUSH_URL'e de gönderilir
+#define METRICS_PUSH_URL     SERVER_URL "/metrics"
+#define METRICS_PUSH_TOKEN   ""       // boş değilse Authorization: Bearer olarak gönderilir (sunucuda METRICS_TOKEN)
+#define METRICS_RENDER_BYTES 12288    // PSRAM; dışa aktarılan metnin en büyük boyu
+
+// Günlük (bkz. log.h): LOG_LEVEL_ERROR, _WARN, _INFO, _DEBUG, _TRACE; üstündekiler derlenmez
+#define LOG_LEVEL       LOG_LEVEL_INFO
+#define LOG_RING_BYTES  8192     // PSRAM; biçimlendirilmeyi bekleyen kayıtlar
+#define LOG_RECORD_MAX  160      // tek kaydın ikili boyu (yığında kodlanır)
+#define LOG_STR_MAX     96       // %s argümanının kopyalanan en büyük boyu
+#define LOG_LINE_MAX    256
+
+// Kara kutu (bkz. blackbox.h); partitions.csv'deki "blackbox" bölümünü kullanır
+#define BLACKBOX_ENABLED      1
+#define BLACKBOX_LEVEL        LOG_LEVEL_INFO  // bu düzeye kadarki günlük satırları saklanır
+#define BLACKBOX_RTC_BYTES    2048     // RTC yavaş belleği, 2'nin kuvveti; flash'a geçmeyi bekleyenler
+#define BLACKBOX_TEXT_MAX     160      // kayıt başına metin, uzunu kesilir
+#define BLACKBOX_BATCH_BYTES  1024     // tek flash yazımı; halkada bu kadar birikince aktarılır
+#define BLACKBOX_FLUSH_MS     10000    // daha az birikmişse en geç bu aralıkla aktarılır
+#define BLACKBOX_SNAPSHOT_MS  60000    // metrik özeti aralığı
+
 #define I2S0_BCK 14
 #define I2S0_WS  13
 #define I2S0_SD  15
@@ -38,13 +174,35 @@
 
 #define RECORD_BUTTON 4
 
+#define POWER_IDLE_TIMEOUT_MS  30000  // bu kadar işlem olmazsa hafif uykuya geçilir
+#define POWER_SLEEP_SLICE_MS   300    // uyku dilimi; WiFi DTIM aralığıyla uyumlu tutulur
+#define POWER_POLL_MS          50
+#define POWER_PM_MIN_MHZ       80     // otomatik hafif uykuda en düşük CPU frekansı; APB 80 MHz'de kalır
+#define POWER_WIFI_LISTEN_INTERVAL 3  // beacon aralığı cinsinden; AP uyuyan istasyon için bu kadar tamponlar
+// Çekirdek tickless idle'sız derlendiyse (hazır PlatformIO Arduino) otomatik hafif uyku
+// yoktur; boşta WiFi modem uykusunda bağlı kalır, yalnızca CPU yavaşlatılır. 1: bunun
+// yerine WiFi kapatılıp elle hafif uyku; ws oturumu ve :9100 boştayken erişilemez,
+// her uyanış yeniden bağlanma bekler
+#define POWER_RADIO_OFF_SLEEP  0
+
 #define WAKEWORD_TIME_SEC 3
 #define WAKEWORD_PHRASE "uyan"
 
+// B menüsü komutları önce cihazda tanınır (bkz. local_commands.h); 0: hep sunucu
+#define LOCAL_COMMANDS_ENABLED   1
+#define LOCAL_COMMAND_TEMPLATES  2      // komut başına LittleFS'te (/kws) tutulan şablon
+#define LOCAL_COMMAND_MAX        8      // şablonu tutulabilecek en çok komut
+#define LOCAL_COMMAND_LISTEN_MS  3000   // konuşma bitmezse yerel dinleme bu kadar sürer
+
 #define SERVO_PIN 18
 #define SERVO_OPEN 90
 #define SERVO_CLOSED 0
+#define SERVO_SETTLE_MS 600   // kapı konumuna oturduktan sonra PWM kesilir
+#define SERVO_MOVE_MS   800   // açma/kapama hareketinin süresi (S-eğrisi, donanım fade)
+#define SERVO_HOLD_MS   2000  // kapı açıldıktan sonra kapanmaya başlamadan önce açık kalma süresi
 
+#ifdef ARDUINO
 const String correctPassword = "1234";
+#endif
 
 #endif
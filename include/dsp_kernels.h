@@ -0,0 +1,72 @@
+// dsp_kernels.h
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+// I2S bloklarında çalışan küçük DSP çekirdekleri. Arduino'ya bağlı değildir,
+// masaüstünde de derlenir. ESP32-S3'te esp-dsp bulunursa vektör (PIE)
+// yolları kullanılır; *_ref sürümleri her hedefte derlenen taşınabilir
+// karşılıklarıdır. Tamsayı çekirdekleri ve dönüşümler ref ile bit bit aynıdır,
+// float toplamalar yalnızca toplama sırası kadar farklıdır (bkz. test/host).
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hedef makroları (CONFIG_IDF_TARGET_*) sdkconfig.h'tadır; masaüstünde yoktur
+#if defined(__has_include)
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+#endif
+
+#if !defined(DSP_HAS_ESP_DSP) && defined(CONFIG_IDF_TARGET_ESP32S3) && defined(__has_include)
+#if __has_include("esp_dsp.h")
+#define DSP_HAS_ESP_DSP 1
+#endif
+#endif
+#ifndef DSP_HAS_ESP_DSP
+#define DSP_HAS_ESP_DSP 0
+#endif
+
+#define DSP_FFT_MAX 1024   // dsp_rfft_f32 için en büyük gerçel uzunluk
+
+// Birinci dereceden DC engelleyici: y[n] = x[n] - x[n-1] + R * y[n-1]
+struct DspDcBlock {
+  int32_t x1;
+  int32_t y1;       // 12 bit kesirli
+  int32_t r_q15;
+};
+
+// Kazanç Q12 (4096 = 1.0), sonuç int16 aralığına kırpılır
+void dsp_gain_clip_s16(int16_t* data, size_t n, int32_t gain_q12);
+void dsp_gain_clip_s16_ref(int16_t* data, size_t n, int32_t gain_q12);
+
+void dsp_dc_block_init(DspDcBlock* st, float pole);
+// Özyinelemeli, tek sürümü vardır (esp-dsp'nin biquad'ı float'tır, sonucu değiştirir)
+void dsp_dc_block_s16(DspDcBlock* st, int16_t* data, size_t n);
+
+// Kareler toplamı ve RMS (tam ölçek 32768)
+uint64_t dsp_energy_s16(const int16_t* x, size_t n);
+uint64_t dsp_energy_s16_ref(const int16_t* x, size_t n);
+float dsp_rms_s16(const int16_t* x, size_t n);
+float dsp_rms_f32(const float* x, size_t n);
+float dsp_rms_f32_ref(const float* x, size_t n);
+
+// int16 <-> float, float aralığı [-1, 1); geri dönüşte kırpar ve yuvarlar
+void dsp_s16_to_f32(const int16_t* in, float* out, size_t n);
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t n);
+void dsp_s16_to_f32_ref(const int16_t* in, float* out, size_t n);
+void dsp_f32_to_s16_ref(const float* in, int16_t* out, size_t n);
+
+// Yerinde gerçel FFT, n ikinin kuvveti ve <= DSP_FFT_MAX.
+// Çıktı: data[0] = X[0], data[1] = X[n/2], k = 1..n/2-1 için
+// data[2k] = Re X[k], data[2k+1] = Im X[k]
+bool dsp_rfft_init(size_t n);
+void dsp_rfft_f32(float* data, size_t n);
+void dsp_rfft_f32_ref(float* data, size_t n);
+
+#ifdef ARDUINO
+// Her çekirdeği 1024 örnekte iki yoldan çalıştırır; çevrim ve en büyük farkı yazar
+void dsp_run_benchmark();
+#endif
+
+#endif
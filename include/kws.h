@@ -0,0 +1,55 @@
+// kws.h
+#ifndef KWS_H
+#define KWS_H
+
+// Kapalı sözlüklü komut tanıyıcı: log-mel kepstrum öznitelikleri üzerinde
+// şablon eşleme (DTW). Her komut için kullanıcının kendi sesinden birkaç şablon
+// tutulur; söylenen ifade en yakın şablona, ikinci en yakın komutla arasında
+// yeterli fark varsa atanır. Emin olunmayan sonuçlar sunucuya (Whisper) bırakılır.
+// Arduino'ya bağlı değildir, masaüstünde de derlenir; tek görevden çağrılır.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define KWS_FRAME_MS       25
+#define KWS_HOP_MS         10
+#define KWS_FFT            512     // 16 kHz'de 25 ms'lik çerçeve sıfırla doldurulur
+#define KWS_MEL_BANDS      24
+#define KWS_CEPS           12      // c1..c12; c0 (enerji) ses düzeyine bağlı olduğu için atılır
+#define KWS_MAX_FRAMES     150     // 1.5 s; daha uzun ifadenin sonu kesilir
+#define KWS_MAX_INPUT_MS   3000    // kws_extract'ın bakacağı en uzun giriş
+#define KWS_TRIM_DB        35.0f   // en güçlü çerçevenin bu kadar altı baştan/sondan kırpılır
+#define KWS_MIN_FRAMES     20      // daha kısa ifade (200 ms) tanınmaz
+#define KWS_Q_SCALE        8.0f    // kepstrum -> int8
+#define KWS_DTW_BAND       20      // köşegenden en fazla bu kadar çerçeve sapılır
+#define KWS_MAX_LEN_RATIO  2.0f    // uzunlukları bundan fazla farklı şablonlar eşlenmez
+#define KWS_ACCEPT_DIST    10.0f   // katsayı başına ortalama DTW uzaklığı (int8 birimi); üstü reddedilir
+#define KWS_MARGIN         0.80f   // en iyi uzaklık ikinci komutunkinin en fazla bu katı olabilir
+#define KWS_FEATURE_VERSION 1      // öznitelik ayarları değişince saklı şablonlar geçersizleşir
+
+struct KwsFeatures {
+  uint16_t frames;
+  int8_t c[KWS_MAX_FRAMES][KWS_CEPS];   // ortalaması çıkarılmış kepstrum
+};
+
+struct KwsTemplate {
+  int label;                 // çağıranın komut indeksi
+  const KwsFeatures* feat;
+};
+
+struct KwsResult {
+  int label;                 // en yakın komut; şablon yoksa -1
+  float best;                // en yakın komutun uzaklığı
+  float second;              // ikinci en yakın komutun uzaklığı; yoksa 0
+  bool confident;            // KWS_ACCEPT_DIST ve KWS_MARGIN'i geçti
+};
+
+bool kws_init(uint32_t sample_rate);
+// Sessiz baş ve son kırpılır; konuşma KWS_MIN_FRAMES'ten kısaysa false
+bool kws_extract(const int16_t* pcm, size_t n, KwsFeatures* out);
+// Çerçeve başına ortalama uzaklık; eşlenemiyorsa negatif
+float kws_distance(const KwsFeatures* a, const KwsFeatures* b);
+// En az iki farklı komutun şablonu yoksa sonuç hiçbir zaman emin sayılmaz
+KwsResult kws_match(const KwsFeatures* x, const KwsTemplate* templates, size_t count);
+
+#endif
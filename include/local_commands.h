@@ -0,0 +1,28 @@
+// local_commands.h
+#ifndef LOCAL_COMMANDS_H
+#define LOCAL_COMMANDS_H
+
+#include "config.h"
+#include "audio_capture.h"
+
+// B menüsü komutlarını sunucuya gitmeden tanır (bkz. kws.h). Şablonlar LittleFS'te
+// (/kws) durur ve kendiliğinden öğrenilir: yerel tanıyıcı emin olmadığında ses
+// Whisper'a gider, Whisper'ın bulduğu komut o sesi şablon olarak alır. Komutlar
+// metinlerinin özetiyle saklanır; menü listesinin sırası değişse de şablonlar geçerlidir.
+
+struct LocalCommandResult {
+  int index;             // commands içindeki komut; emin değilse -1
+  bool heard;            // konuşma bulundu; sunucu komutu tanırsa öğrenilebilir
+  uint32_t listen_ms;    // halkadan okunan ses
+  uint32_t compute_us;   // öznitelik + eşleme
+};
+
+void local_commands_begin();
+// reader'dan en fazla max_ms okur; VAD konuşmanın bittiğini görünce erken durur
+LocalCommandResult local_command_listen(CaptureReader* reader, const char* const* commands, uint32_t max_ms);
+// Son dinlenen ses transcript'te geçen komutun şablonu olur; komutun şablonları
+// doluysa en eskisinin yerine yazılır
+void local_command_learn(const char* const* commands, const String& transcript);
+void local_commands_print_stats();
+
+#endif
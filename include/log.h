@@ -0,0 +1,136 @@
+// log.h
+#ifndef LOG_H
+#define LOG_H
+
+#include "config.h"
+#include <type_traits>
+
+// Düzeyli günlük. LOG_LEVEL'in üstündeki çağrılar derleme sırasında atılır,
+// argümanları bile hesaplanmaz. Açık düzeylerde kayıt yığında ikili olarak
+// kodlanır (biçim dizgesinin adresi + etiketli argümanlar) ve beklemeden bir
+// halkaya bırakılır; biçimlendirme ve Serial'e yazma düşük öncelikli günlük
+// görevinde yapılır. Halka doluysa kayıt atılır ve sayılır, çağıran hiç beklemez.
+//
+// Biçim dizgesi sabit olmalıdır (adresi saklanır) ve satır sonu içermez.
+// %s argümanları kayıt anında LOG_STR_MAX bayta kadar kopyalanır; String için
+// c_str() verilir. log_begin()'den önceki kayıtlar doğrudan yazılır.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_E(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#define LOG_W(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_I(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_D(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_T(fmt, ...) LOG_AT(LOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+
+// Biçim denetimi yalnızca derleyici içindir; çağrı hiç üretilmez
+#define LOG_AT(level, fmt, ...)                                   \
+  do {                                                            \
+    if constexpr ((level) <= LOG_LEVEL) {                         \
+      if (0) log_detail::check_format(fmt, ##__VA_ARGS__);        \
+      log_detail::write(level, fmt, ##__VA_ARGS__);               \
+    }                                                             \
+  } while (0)
+
+void log_begin();
+// Halkada bekleyen kayıtlar yazılana kadar (en çok timeout_ms) bekler; uykudan ve yeniden başlatmadan önce
+void log_flush(uint32_t timeout_ms);
+uint32_t log_dropped();
+// Ham kaydı metne çevirir (satır sonu eklenmez), yazılan uzunluğu döner
+size_t log_format(const uint8_t* rec, size_t rec_len, char* out, size_t out_len);
+
+namespace log_detail {
+
+enum : uint8_t { ARG_I32, ARG_I64, ARG_F64, ARG_STR, ARG_PTR };
+
+struct RecordHeader {
+  uint32_t ms;
+  const char* fmt;
+  uint8_t level;
+  uint8_t nargs;   // sığmayan argümanlar atılır; biçimlendirici yerlerine "?" yazar
+};
+
+struct Writer {
+  uint8_t* p;
+  uint8_t* end;
+  uint8_t nargs;
+  bool full;
+};
+
+void push(const uint8_t* rec, size_t len);
+
+__attribute__((format(printf, 1, 2))) inline void check_format(const char*, ...) {}
+
+inline void put(Writer& w, uint8_t tag, const void* v, size_t n) {
+  if (w.full || w.end - w.p < (ptrdiff_t)(1 + n)) {
+    w.full = true;
+    return;
+  }
+  *w.p++ = tag;
+  memcpy(w.p, v, n);
+  w.p += n;
+  w.nargs++;
+}
+
+inline void put_str(Writer& w, const char* s) {
+  if (s == NULL) s = "(null)";
+  size_t n = strnlen(s, LOG_STR_MAX);
+  if (w.full || w.end - w.p < 2) {
+    w.full = true;
+    return;
+  }
+  // Yer kalmadıysa dizge kısaltılır
+  if ((size_t)(w.end - w.p) < 2 + n) n = w.end - w.p - 2;
+  *w.p++ = ARG_STR;
+  *w.p++ = (uint8_t)n;
+  memcpy(w.p, s, n);
+  w.p += n;
+  w.nargs++;
+}
+
+template <typename T>
+inline void encode(Writer& w, T v) {
+  if constexpr (std::is_floating_point<T>::value) {
+    double d = v;
+    put(w, ARG_F64, &d, sizeof(d));
+  } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+    // İşaret biçim belirtecinden geri kazanılır
+    if constexpr (sizeof(T) > 4) {
+      int64_t x = (int64_t)v;
+      put(w, ARG_I64, &x, sizeof(x));
+    } else {
+      uint32_t x = (uint32_t)v;
+      put(w, ARG_I32, &x, sizeof(x));
+    }
+  } else if constexpr (std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value) {
+    put_str(w, v);
+  } else if constexpr (std::is_pointer<T>::value) {
+    uintptr_t x = (uintptr_t)v;
+    put(w, ARG_PTR, &x, sizeof(x));
+  } else {
+    static_assert(std::is_pointer<T>::value, "günlük argümanı sayı, işaretçi ya da C dizgesi olmalı");
+  }
+}
+
+template <typename... Args>
+inline void write(uint8_t level, const char* fmt, Args... args) {
+  uint8_t rec[LOG_RECORD_MAX];
+  Writer w = {rec + sizeof(RecordHeader), rec + sizeof(rec), 0, false};
+  (encode(w, args), ...);
+  RecordHeader h = {(uint32_t)millis(), fmt, level, w.nargs};
+  memcpy(rec, &h, sizeof(h));
+  push(rec, w.p - rec);
+}
+
+}  // namespace log_detail
+
+#endif
@@ -0,0 +1,43 @@
+// mem_policy.h
+#ifndef MEM_POLICY_H
+#define MEM_POLICY_H
+
+#include "config.h"
+
+// Büyük tamponların nereye yerleşeceği burada açıkça seçilir. Dahili SRAM
+// WiFi/lwIP ve I2S sürücüsünün DMA tanımlayıcıları için boş bırakılır;
+// uzun kayıt halkaları, önbellekler ve yanıt tamponları PSRAM'e gider.
+enum mem_pool_t {
+  MEM_POOL_DMA,        // dahili, DMA erişimli (I2S sürücüsü kendi ayırır, burada yalnızca raporlanır)
+  MEM_POOL_INTERNAL,   // dahili SRAM: sıcak, küçük çalışma tamponları
+  MEM_POOL_PSRAM,      // harici PSRAM: dakikalarca ses tutabilecek büyük tamponlar
+  MEM_POOL_COUNT
+};
+
+struct MemPoolStats {
+  size_t total;
+  size_t free;
+  size_t min_free;        // açılıştan beri en düşük boş miktar
+  size_t largest_block;
+  size_t policy_bytes;    // mem_alloc ile bu havuzdan alınan
+  uint16_t policy_blocks;
+};
+
+void mem_policy_init();
+bool mem_psram_available();
+// PSRAM yoksa en çok MEM_INTERNAL_FALLBACK_MAX bayta kadar dahili RAM'e düşülür,
+// daha büyük istekler NULL döner
+void* mem_alloc(size_t size, mem_pool_t pool, const char* tag);
+void mem_free(void* ptr);
+void mem_get_stats(mem_pool_t pool, MemPoolStats* out);
+void mem_print_report();
+
+// ArduinoJson belgeleri için PSRAM ayırıcısı; PSRAM yoksa malloc kullanılır
+struct PsramJsonAllocator {
+  void* allocate(size_t size);
+  void deallocate(void* ptr);
+  void* reallocate(void* ptr, size_t new_size);
+};
+typedef BasicJsonDocument<PsramJsonAllocator> PsramJsonDocument;
+
+#endif
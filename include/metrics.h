@@ -0,0 +1,45 @@
+// metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "config.h"
+
+// Cihaz telemetrisi. Sayaçlar ve histogramlar sabit boyutlu statik dizilerdir;
+// kayıt tek bir atomik toplamadır (histogramda önce kova aranır), kilit ve bellek
+// ayırma yoktur, her görevden çağrılabilir. Yığın, görev yığınları, I2S ve WiFi
+// değerleri ayrıca tutulmaz, dışa aktarırken ilgili modülden okunur.
+// Prometheus metin biçiminde METRICS_HTTP_PORT'taki /metrics'ten sunulur;
+// METRICS_PUSH_MS > 0 ise aynı metin düzenli olarak METRICS_PUSH_URL'e gönderilir.
+
+enum MetricCounter {
+  METRIC_KEYPAD_EVENTS,
+  METRIC_SERVO_CYCLES,
+  METRIC_WIFI_RECONNECTS,
+  METRIC_WS_RECONNECTS,
+  METRIC_COUNTER_COUNT
+};
+
+// Sunucu istekleri; WebSocket üzerinden giden işlemler de aynı uç noktaya yazılır
+enum MetricEndpoint {
+  METRIC_EP_UPLOAD,          // ses parçası POST'u
+  METRIC_EP_CAPABILITIES,
+  METRIC_EP_REGISTER_USER,
+  METRIC_EP_CHECK_USER,
+  METRIC_EP_VERIFY_USER,
+  METRIC_EP_LAST_LOGIN,
+  METRIC_EP_TTS,
+  METRIC_EP_OTHER,
+  METRIC_EP_COUNT
+};
+
+void metrics_begin();
+void metrics_inc(MetricCounter c);
+// Süre ms; code <= 0 (bağlantı hatası) ya da >= 400 hata sayılır
+void metrics_observe_http(MetricEndpoint ep, uint32_t ms, int code);
+MetricEndpoint metrics_endpoint_for(const char* op);
+// Prometheus metnini buf'a yazar, yazılan uzunluğu döner; sığmazsa satır sınırında kesilir
+size_t metrics_render(char* buf, size_t len);
+// Kara kutu için tek satırlık özet: yığın, I2S kayıpları, bağlantı ve HTTP hataları/istekleri
+size_t metrics_summary(char* buf, size_t len);
+
+#endif
@@ -0,0 +1,29 @@
+// mic_frontend.h
+#ifndef MIC_FRONTEND_H
+#define MIC_FRONTEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// INMP441'in 32 bit yuvadaki 24 bit örneklerini yüklemeye hazır 16 bit
+// PCM'e çevirir. Blok başına maliyet sabittir, bellek ayırmaz.
+struct MicFrontend {
+  // DC engelleyici, 24 bit ölçekte
+  int32_t dc_x1;
+  int32_t dc_y1;
+  int32_t dc_r_q15;
+  // 2. derece Butterworth yüksek geçiren (transpoze Direct Form II)
+  float hpf_b0, hpf_b1, hpf_b2, hpf_a1, hpf_a2;
+  float hpf_z1, hpf_z2;
+  // AGC kazancı, 24 bit girişten 16 bit çıkışa, Q16
+  int32_t gain_q16;
+  bool hold;        // true iken AGC uyarlanmaz (hoparlör çalarken yankıya göre kısılmasın)
+};
+
+void mic_frontend_init(MicFrontend* fe, int sample_rate);
+
+// raw: samples adet 32 bit I2S örneği. Sonuç aynı tamponun başına int16
+// olarak yazılır; dönen değer yazılan bayt sayısıdır.
+size_t mic_frontend_process(MicFrontend* fe, int32_t* raw, size_t samples);
+
+#endif
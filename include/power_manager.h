@@ -0,0 +1,26 @@
+// power_manager.h
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "config.h"
+
+// Her durumda geçirilen toplam süre; tasarrufu ölçmek için
+struct PowerStats {
+  uint64_t active_us;        // menü dışındaki işler ve son tuştan sonraki bekleme süresi
+  uint64_t idle_awake_us;    // boşta ama uyumadan geçen süre (hafif uyku yoksa tüm boşta süre)
+  uint64_t light_sleep_us;   // hafif uykuda ya da uykuya izin verilerek geçen süre
+  uint32_t sleep_count;
+  uint32_t wake_by_gpio;
+  uint32_t wake_by_timer;
+  uint32_t wifi_resumes;     // WiFi kapatılarak uyunduysa uyanıştaki yeniden bağlanmalar
+  uint32_t wifi_resume_ms;   // bu bağlanmaların toplam süresi
+};
+
+void power_init(const byte* row_pins, byte rows, const byte* col_pins, byte cols);
+void power_note_activity();             // tuş, buton ya da sesli oturum
+void power_idle_poll();                 // menüde tuş beklerken delay() yerine çağrılır
+bool power_is_idle();                   // boşta: mikrofon kapalı, radyo modem uykusunda (POWER_RADIO_OFF_SLEEP ile kapalı)
+void power_get_stats(PowerStats* out);
+void power_print_stats();
+
+#endif
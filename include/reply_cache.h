@@ -0,0 +1,23 @@
+// reply_cache.h
+#ifndef REPLY_CACHE_H
+#define REPLY_CACHE_H
+
+#include "config.h"
+
+// Sunucunun yanıt sesleri içerik adreslidir: tts-<anahtar>.<format>, anahtar
+// metin + dil + formatın özeti. Sonuna kadar çalınan yanıt LittleFS'e yazılır;
+// aynı adres bir daha indirilmez. WebSocket oturumunda eldeki anahtarlar
+// sunucuya bildirilir, sunucu bu yanıtları akıtmaz (not_modified).
+// Yer dolunca en uzun süredir çalınmayan yanıt silinir.
+
+void reply_cache_begin();
+// Önbellekteki kopya; yoksa ya da adres içerik adresli değilse NULL
+AudioFileSource* reply_cache_open(const String& url);
+// Çalınan kaynağı sarar: okunan baytlar PSRAM'de biriktirilir, yanıt sonuna
+// kadar okunduysa kapanırken dosyaya yazılır. Önbelleğe uygun değilse src döner;
+// sarmalayıcı src'den önce silinir.
+AudioFileSource* reply_cache_wrap(const String& url, AudioFileSource* src);
+// {"type":"cache","keys":[...]}; WebSocket oturumu açılınca ve her yeni kayıtta gider
+String reply_cache_announcement();
+
+#endif
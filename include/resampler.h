@@ -0,0 +1,39 @@
+// resampler.h
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+// Kaiser pencereli sinc ile çok fazlı (polyphase) örnekleme hızı dönüştürücü.
+// Katsayılar Q15, toplama 32 bit; alt fazlar arası doğrusal aradeğerleme ile
+// herhangi bir oran (22050 -> 16000 gibi) sabit boyutlu tabloyla çalışır.
+// Geçiş bandı düşük tarafın 0.40'ında biter, durdurma bandı çıkış Nyquist'inde
+// (0.50) başlar; geçiş aralığı Hz olarak sabit kalsın diye süzgeç boyu
+// giriş/düşük hız oranıyla büyür. Arduino'ya bağlı değildir, masaüstünde de derlenir.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RESAMPLER_TAPS_PER_RATIO 52    // oran 1'de faz başına katsayı (Kaiser, -80 dB, 0.1 geçiş)
+#define RESAMPLER_TAPS_MAX       160   // 3:1 düşürmeye (48k -> 16k) yeter; tablo ~10 KB
+#define RESAMPLER_PHASES 32    // alt faz sayısı (tabloda +1 satır)
+#define RESAMPLER_BETA   8.0f  // Kaiser penceresi, ~-80 dB yan lob; Q15 katsayılarla ~-70 dB
+
+struct Resampler {
+  int16_t h[(RESAMPLER_PHASES + 1) * RESAMPLER_TAPS_MAX];   // satır boyu taps
+  int16_t x[2 * RESAMPLER_TAPS_MAX];   // giriş geçmişi; x[pos..pos+taps) en yeniden eskiye
+  int taps;                            // faz başına katsayı; gecikme taps/2 giriş örneği
+  int pos;
+  uint32_t in_rate;
+  uint32_t out_rate;
+  int32_t next;                    // sonraki çıkışın en yeni girişe uzaklığı, 1/out_rate örnek biriminde
+};
+
+// Süzgeç RESAMPLER_TAPS_MAX'a sığmazsa (3 kattan fazla düşürme) false döner;
+// hızlar eşitse süzgeç yine uygulanır
+bool resampler_init(Resampler* rs, uint32_t in_rate, uint32_t out_rate);
+void resampler_reset(Resampler* rs);   // geçmiş silinir, katsayılar korunur
+// n_in giriş için üretilecek en fazla çıkış
+size_t resampler_max_out(const Resampler* rs, size_t n_in);
+// Üretilen çıkış sayısını döner. Hız düşürülürken out == in (yerinde) kullanılabilir.
+size_t resampler_process(Resampler* rs, const int16_t* in, size_t n_in, int16_t* out);
+
+#endif
@@ -0,0 +1,50 @@
+// uplink.h
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include "config.h"
+
+// Kodlanmış ses parçalarını sunucuya taşıyan katman. HTTP her parçayı bir POST
+// ile gönderir; UDP her UDP_FRAME_MS'i ayrı bir datagramla yollar, kaybı
+// beklemeden sürer ve sonda yanıtı ayrı bir datagramla alır; WebSocket parçaları
+// kalıcı oturumun ikili çerçeveleri olarak yollar, yanıt sesi de oradan gelir.
+// HTTP ve WebSocket cihazdaki VAD'ın bulduğu bölüt sınırlarını da taşır; UDP taşımaz.
+// Oturum kimliği esp_random'dan 128 bittir (32 onaltılık hane); sunucu başka
+// biçimdeki kimliği reddeder. UDP başlığında yer yalnızca ilk 32 bitine yeter.
+#define UPLINK_SESSION_ID_LEN 32
+
+struct UplinkSession {
+  char id[UPLINK_SESSION_ID_LEN + 1];
+  uint32_t short_id;       // id'nin ilk 32 biti (UDP)
+  uint32_t sample_rate;    // yükleme hızı (X-Sample-Rate)
+  bool wake_check;
+};
+
+// Yeni kimlik üretir
+void uplink_session_init(UplinkSession* s, uint32_t sample_rate, bool wake_check);
+
+class Uplink {
+ public:
+  virtual ~Uplink() {}
+  virtual const char* name() const = 0;
+  virtual size_t chunk_samples() const = 0;     // gönderim başına halkadan okunacak örnek (SAMPLE_RATE)
+  virtual bool begin(const UplinkSession& s) = 0;
+  // timestamp: parçanın ilk örneğinin oturumdaki sırası (yükleme hızında)
+  virtual bool send(const uint8_t* data, size_t len, size_t samples, uint32_t timestamp, bool last) = 0;
+  // VAD duraklaması: sıradaki send() bir bölütü kapatır, sunucu onu hemen çözümleyebilir
+  virtual void end_segment() {}
+  // Son sınırdan sonra konuşma yoksa sunucu kalan sesi çözümlemez; son send()'den önce çağrılır
+  virtual void set_tail_speech(bool speech) {}
+  // Kayıt sürerken kapanan bölütlerin o ana kadarki metni; yalnızca WebSocket iletir
+  virtual bool poll_partial(String* text) { return false; }
+  // Son parçadan sonra sunucunun yanıtı: yanıt sesinin adresi (http://... ya da ws:<id>/<dosya>.<format>)
+  // veya wake word metni
+  virtual String finish() = 0;
+  // Oturumu kapatır; finish() çağrılmadıysa sunucuya kaydın bırakıldığı bildirilir
+  virtual void end() = 0;
+};
+
+// UPLINK_TRANSPORT'a göre seçilen taşıma; WebSocket oturumu kopuksa HTTP
+Uplink* uplink_get();
+
+#endif
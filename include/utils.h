@@ -3,12 +3,18 @@
 #define UTILS_H
 
 #include <Arduino.h>
+#include "esp_timer.h"
 
-const char* ntpServer = "pool.ntp.org";
-const long  gmtOffset_sec = 10800;  // UTC+3 for Turkey
-const int   daylightOffset_sec = 0;
+void initTime();           // RTC'den saati geri yükler, SNTP'yi arka planda başlatır
+bool timeIsSynced();       // bu açılışta SNTP ile en az bir kez eşitlendi mi
+bool timeIsValid();        // eşitlenmiş ya da RTC'den geri yüklenmiş saat var mı
 
-void initTime();
+// Sıcak yol için: monoton zaman damgası, biçimlendirme yok
+inline int64_t timeMonoUs() { return esp_timer_get_time(); }
+int64_t timeEpochMs(int64_t mono_us);   // monoton damgayı Unix ms'ye çevirir (0: saat bilinmiyor)
+
+// Biçimlendirme yalnızca dışa aktarımda
+String formatTimestamp(int64_t epoch_ms);
 String getCurrentTime();
 
 #endif
@@ -0,0 +1,41 @@
+// vad.h
+#ifndef VAD_H
+#define VAD_H
+
+// Enerji tabanlı konuşma algılayıcı. Gürültü tabanı sessiz çerçevelerden
+// izlenir; tabanın VAD_SNR katını aşan çerçeveler konuşmadır. Konuşmadan sonra
+// VAD_HANGOVER_MS süren sessizlik bir bölüt sınırıdır: sunucu o ana kadarki sesi
+// kayıt sürerken çözümleyebilir. Arduino'ya bağlı değildir, masaüstünde de derlenir.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define VAD_FRAME_MS        20
+#define VAD_SNR             6.0f    // enerji oranı, ~8 dB
+#define VAD_MIN_RMS         200     // bunun altı gürültü tabanı ne olursa olsun sessizlik (16 bit)
+#define VAD_ONSET_FRAMES    3       // konuşma bu kadar ardışık çerçeveyle başlar (60 ms)
+#define VAD_HANGOVER_MS     300     // konuşmadan sonra bu kadar sessizlik bölütü kapatır
+#define VAD_MAX_SEGMENT_MS  6000    // daha uzun bölüt ilk sessiz çerçevede kesilir
+
+struct VadState {
+  uint32_t frame_len;        // örnek
+  uint32_t fill;
+  uint64_t acc;              // yarım çerçevenin kareler toplamı
+  float noise;               // gürültü tabanı, çerçeve başına ortalama kare
+  bool noise_valid;
+  bool speech;               // bölüt açık
+  uint32_t onset_run;
+  uint32_t silence_frames;
+  uint32_t segment_frames;
+  uint32_t hangover_frames;
+  uint32_t max_segment_frames;
+  bool speech_since_cut;     // son sınırdan sonra konuşma duyuldu mu
+  uint32_t segments;
+};
+
+void vad_init(VadState* st, uint32_t sample_rate);
+// Blok içinde bir bölüt kapandıysa true döner
+bool vad_process(VadState* st, const int16_t* x, size_t n);
+inline bool vad_in_speech(const VadState* st) { return st->speech; }
+
+#endif
@@ -8,6 +8,8 @@
 void handleVoiceAssistant();
 bool checkWakeWord();
 String getNameByVoice();
-String getCommandByVoice();
+// commands: NULL ile biten küçük harfli ifadeler; önce cihazda tanınmaya çalışılır
+// (LOCAL_COMMANDS_ENABLED), sunucuya gidilirse ara metinde biri duyulunca kayıt erken biter
+String getCommandByVoice(const char* const* commands = NULL);
 
 #endif
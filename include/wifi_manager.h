@@ -6,7 +6,25 @@
 //#include <HTTPClient.h>
 #include "config.h"
 
-void wifi_connect();
+typedef enum {
+  WIFI_LINK_DOWN,
+  WIFI_LINK_CONNECTING,
+  WIFI_LINK_UP
+} wifi_link_state_t;
+
+// Bağlantı durumu değiştiğinde WiFi olay görevinden çağrılır
+typedef void (*wifi_link_cb_t)(wifi_link_state_t state);
+
+void wifi_connect();                          // arka planda bağlanır, hemen döner
+void wifi_reconnect();                        // bağlantı yoksa yeni deneme başlatır, bloklamaz
+bool wifi_wait_connected(uint32_t timeout_ms);
+bool wifi_is_connected();
+wifi_link_state_t wifi_link_state();
+void wifi_on_link_change(wifi_link_cb_t cb);
+void wifi_suspend();                          // radyoyu kapatır; wifi_resume()'a kadar yeniden denenmez
+void wifi_resume();                           // radyoyu açar, önbellekle hızlı bağlantıyı başlatır
+// wifi_resume() sonrası bağlantının geri gelmesi: sayı ve toplam süre
+void wifi_resume_stats(uint32_t* count, uint32_t* total_ms);
 bool check_server_connection();
 
 #endif
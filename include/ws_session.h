@@ -0,0 +1,40 @@
+// ws_session.h
+#ifndef WS_SESSION_H
+#define WS_SESSION_H
+
+#include "config.h"
+
+// Cihaz başına tek, kalıcı WebSocket oturumu (llm_server.py /ws). Yükleme sesi
+// ikili çerçevelerle gider; metinler, kontrol iletileri ve yanıt sesi aynı
+// bağlantıdan döner. Bağlantı ve yeniden bağlanma kendi görevinde sürer.
+//
+// Yanıt sesi "ws:<id>/<dosya>.<format>" adresiyle anılır; sunucu sentezi bitirir
+// bitirmez akıtır, cihaz PSRAM halkasına alır ve çalma görevi oradan okur.
+// Cihazın önbelleğindeki yanıtlar (bkz. reply_cache.h) akıtılmaz.
+
+void ws_session_begin();
+bool ws_session_connected();
+bool ws_session_wait_connected(uint32_t timeout_ms);
+
+bool ws_session_send_text(const String& msg);
+bool ws_session_send_binary(const uint8_t* data, size_t len);
+
+// Sunucudan gelen JSON kontrol iletileri sırayla alınır (transcript, result,
+// reply_start, error). Okunmayan eski iletiler yeni bir istekten önce atılır.
+void ws_session_flush_messages();
+bool ws_session_next_message(JsonDocument& doc, uint32_t timeout_ms);
+
+// Sunucu işlemleri (register_user, check_user, verify_user, last_login, tts).
+// Oturum açıksa WebSocket üzerinden, değilse aynı adlı HTTP uç noktasına gider;
+// args boşsa GET yapılır. Dönüş HTTP durum kodudur, body yanıt gövdesidir.
+int server_call(const char* op, const String& args_json, String* body);
+
+// "ws:" adresli yanıtın sesi; çalma bitince silinir. Yanıt yoksa NULL.
+AudioFileSource* ws_session_open_reply(const String& url);
+// Ses önbellekten çalınırken sunucunun akıttığı kopya durdurulur
+void ws_session_cancel_reply(const String& url);
+// Okuyucu kapanmadan önce sorulur: reply_end geldi, yanıt bırakılmadı ve
+// halkada bayt kaybolmadı. Önbellek yalnızca eksiksiz yanıtı yazar.
+bool ws_session_reply_intact(const String& url);
+
+#endif
@@ -7,6 +7,8 @@
 
 #include <ESP32PWM.h>
 #include "esp32-hal-ledc.h"
+#include "driver/ledc.h"
+#include "soc/soc_caps.h"
 
 // initialize the class variable ServoCount
 int ESP32PWM::PWMCount = -1;              // the total number of attached servos
@@ -139,7 +141,8 @@ int ESP32PWM::allocatenext(double freq) {
 void ESP32PWM::deallocate() {
 	if (pwmChannel < 0)
 		return;
-	ESP_LOGE(TAG, "PWM deallocating LEDc #%d",pwmChannel);
+	// runs on every idle park of a servo, not an error
+	ESP_LOGV(TAG, "PWM deallocating LEDc #%d",pwmChannel);
 	timerCount[getTimer()]--;
 	if (timerCount[getTimer()] == 0) {
 		timerFreqSet[getTimer()] = -1; // last pwn closed out
@@ -209,6 +212,86 @@ void ESP32PWM::write(uint32_t duty) {
 	ledcWrite(getChannel(), duty);
 #endif
 }
+/**
+ * fade
+ * @param duty the raw duty cycle to end on
+ * @param durationMs how long the hardware should take to get there
+ * Starts a linear ramp from the last written duty, executed by the ledc fade
+ * engine so the CPU is free for the whole ramp. Returns immediately.
+ */
+bool ESP32PWM::fade(uint32_t duty, int durationMs) {
+	if (!attached())
+		return false;
+	if (durationMs <= 0) {
+		write(duty);
+		return true;
+	}
+	uint32_t from = myDuty;
+	myDuty = duty;
+	fadeStarted = true;
+#ifdef ESP_ARDUINO_VERSION_MAJOR
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+	return ledcFade(getPin(), from, duty, durationMs);
+#else
+	(void) from;
+	static bool fadeInstalled = false;
+	if (!fadeInstalled) {
+		// ESP_ERR_INVALID_STATE only means another user installed it first
+		ledc_fade_func_install(0);
+		fadeInstalled = true;
+	}
+	ledc_mode_t group = (ledc_mode_t) (getChannel() / 8);
+	ledc_channel_t channel = (ledc_channel_t) (getChannel() % 8);
+	if (ledc_set_fade_with_time(group, channel, duty, durationMs) != ESP_OK)
+		return false;
+	return ledc_fade_start(group, channel, LEDC_FADE_NO_WAIT) == ESP_OK;
+#endif
+#else
+	(void) from;
+	static bool fadeInstalled = false;
+	if (!fadeInstalled) {
+		ledc_fade_func_install(0);
+		fadeInstalled = true;
+	}
+	ledc_mode_t group = (ledc_mode_t) (getChannel() / 8);
+	ledc_channel_t channel = (ledc_channel_t) (getChannel() % 8);
+	if (ledc_set_fade_with_time(group, channel, duty, durationMs) != ESP_OK)
+		return false;
+	return ledc_fade_start(group, channel, LEDC_FADE_NO_WAIT) == ESP_OK;
+#endif
+}
+/**
+ * stopFade
+ * @param duty the raw duty cycle to hold
+ * A plain write() does not stop a fade started by fade(): the fade engine
+ * keeps stepping the duty and overwrites it. Stops the engine where the core
+ * can, otherwise replaces the running fade with a 1 ms one ending on duty.
+ */
+void ESP32PWM::stopFade(uint32_t duty) {
+	if (!fadeStarted || !attached()) {
+		write(duty);
+		return;
+	}
+	fadeStarted = false;
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(3, 0, 0)
+	// the core owns the channel number; a flat fade replaces the running one
+	myDuty = duty;
+	if (!ledcFade(getPin(), duty, duty, 1))
+		ledcWrite(getPin(), duty);
+#else
+	ledc_mode_t group = (ledc_mode_t) (getChannel() / 8);
+	ledc_channel_t channel = (ledc_channel_t) (getChannel() % 8);
+#if SOC_LEDC_SUPPORT_FADE_STOP
+	ledc_fade_stop(group, channel);
+	write(duty);
+#else
+	myDuty = duty;
+	if (ledc_set_fade_with_time(group, channel, duty, 1) != ESP_OK
+			|| ledc_fade_start(group, channel, LEDC_FADE_NO_WAIT) != ESP_OK)
+		write(duty);
+#endif
+#endif
+}
 void ESP32PWM::adjustFrequencyLocal(double freq, double dutyScaled) {
 	timerFreqSet[getTimer()] = (long) freq;
 	myFreq = freq;
@@ -335,7 +418,7 @@ void ESP32PWM::attachPin(uint8_t pin, double freq, uint8_t resolution_bits) {
 
 	if (hasPwm(pin)){
 		int ret=setup(freq, resolution_bits);
-		ESP_LOGW(TAG, "Pin Setup %d with code %d",pin,ret);
+		ESP_LOGV(TAG, "Pin Setup %d with code %d",pin,ret);
 	}
 	else
 		ESP_LOGE(TAG, "ERROR Pin Failed %d ",pin);
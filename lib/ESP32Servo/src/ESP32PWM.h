@@ -71,6 +71,10 @@ public:
 	void write(uint32_t duty);
 	// Write a duty cycle to the PWM using a unit vector from 0.0-1.0
 	void writeScaled(double duty);
+	// Ramp linearly from the current duty to the given one in the ledc fade engine, non-blocking
+	bool fade(uint32_t duty, int durationMs);
+	// End a running fade at the given duty, so it cannot overwrite it; a plain write() otherwise
+	void stopFade(uint32_t duty);
 	//Adjust frequency
 	double writeTone(double freq);
 	double writeNote(note_t note, uint8_t octave);
@@ -96,6 +100,7 @@ public:
 	}
 	int timerNum = -1;
 	uint32_t myDuty = 0;
+	bool fadeStarted = false;   // the fade engine may still be driving this channel
 	int getChannel();
 	static int PWMCount;              // the total number of attached pwm
 	static int timerCount[4];
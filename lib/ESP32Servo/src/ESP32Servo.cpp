@@ -68,6 +68,23 @@ Servo::Servo()
 	this->timer_width_ticks = pow(2,this->timer_width);
 
 }
+
+Servo::~Servo()
+{
+    if (this->settleTimer != NULL)
+    {
+        esp_timer_stop(this->settleTimer);
+        esp_timer_delete(this->settleTimer);
+    }
+    if (this->moveTimer != NULL)
+    {
+        esp_timer_stop(this->moveTimer);
+        esp_timer_delete(this->moveTimer);
+    }
+    if (this->settleLock != NULL)
+        vSemaphoreDelete(this->settleLock);
+}
+
 ESP32PWM * Servo::getPwm(){
 
 	return &pwm;
@@ -131,6 +148,7 @@ if(
         // if you want anything other than default timer width, you must call setTimerWidth() before attach
 
         pwm.attachPin(this->pinNumber,REFRESH_CPS, this->timer_width );   // GPIO pin assigned to channel
+        this->parked = false;
         ESP_LOGW(TAG, "Success to Attach servo : %d on PWM %d",pin,pwm.getChannel());
 
         return pwm.getChannel();
@@ -138,16 +156,57 @@ if(
 
 void Servo::detach()
 {
+    if (this->settleTimer != NULL)
+        esp_timer_stop(this->settleTimer);
+    if (this->moveTimer != NULL)
+        esp_timer_stop(this->moveTimer);
+    this->moveActive = false;
     if (this->attached())
     {
         //keep track of detached servos channels so we can reuse them if needed
-        pwm.detachPin(this->pinNumber);
+        if (pwm.attached())
+            pwm.detachPin(this->pinNumber);
 
+        this->parked = false;
         this->pinNumber = -1;
     }
 }
 
 void Servo::write(int value)
+{
+    this->writeMicroseconds(toMicroseconds(value));
+}
+
+void Servo::writeMicroseconds(int value)
+{
+    writeTicks(usToTicks(value));  // convert to ticks
+}
+
+void Servo::writeTicks(int value)
+{
+    // calculate and store the values for the given channel
+    if (this->attached())   // ensure channel is valid
+    {
+        this->ticks = clampTicks(value);
+        if (this->settleLock != NULL)
+            xSemaphoreTake(this->settleLock, portMAX_DELAY);
+        // a direct write wins over a profiled move in progress
+        if (this->moveActive)
+        {
+            esp_timer_stop(this->moveTimer);
+            this->moveActive = false;
+        }
+        reassert();
+        // do the actual write; the ledc fade of an interrupted segment must not overwrite it
+        pwm.stopFade(this->ticks);
+        this->lastWriteUs = esp_timer_get_time();
+        if (this->settleLock != NULL)
+            xSemaphoreGive(this->settleLock);
+        armSettleTimer();
+    }
+}
+
+int Servo::toMicroseconds(int value)
 {
     // treat values less than MIN_PULSE_WIDTH (500) as angles in degrees (valid values in microseconds are handled as microseconds)
     if (value < MIN_PULSE_WIDTH)
@@ -159,27 +218,32 @@ void Servo::write(int value)
 
         value = map(value, 0, 180, this->min, this->max);
     }
-    this->writeMicroseconds(value);
+    return value;
 }
 
-void Servo::writeMicroseconds(int value)
+int Servo::clampTicks(int value)
 {
-    writeTicks(usToTicks(value));  // convert to ticks
+    if (value < usToTicks(this->min))      // ensure ticks are in range
+        value = usToTicks(this->min);
+    else if (value > usToTicks(this->max))
+        value = usToTicks(this->max);
+    return value;
 }
 
-void Servo::writeTicks(int value)
+bool Servo::reassert()
 {
-    // calculate and store the values for the given channel
-    if (this->attached())   // ensure channel is valid
-    {
-        if (value < usToTicks(this->min))      // ensure ticks are in range
-            value = usToTicks(this->min);
-        else if (value > usToTicks(this->max))
-            value = usToTicks(this->max);
-        this->ticks = value;
-        // do the actual write
-        pwm.write( this->ticks);
-    }
+    // re-attach a servo parked by its idle mode; the caller writes the pulse
+    bool wasParked = this->parked;
+    if (this->parked && !pwm.attached())
+        pwm.attachPin(this->pinNumber, REFRESH_CPS, this->timer_width);
+    this->parked = false;
+    return wasParked;
+}
+
+void Servo::ensureLock()
+{
+    if (this->settleLock == NULL)
+        this->settleLock = xSemaphoreCreateMutex();
 }
 
 void Servo::release()
@@ -215,7 +279,8 @@ int Servo::readTicks()
 
 bool Servo::attached()
 {
-    return (pwm.attached());
+    // a parked servo still owns its pin; the next write re-attaches it
+    return (pwm.attached() || this->parked);
 }
 
 void Servo::setTimerWidth(int value)
@@ -243,8 +308,8 @@ void Servo::setTimerWidth(int value)
     this->timer_width = value;
     this->timer_width_ticks = pow(2,this->timer_width);
     
-    // If this is an attached servo, clean up
-    if (this->attached())
+    // If this is an attached servo, clean up (a parked servo picks up the width on its next write)
+    if (pwm.attached())
     {
         // detach, setup and attach again to reflect new timer width
     	pwm.detachPin(this->pinNumber);
@@ -257,6 +322,218 @@ int Servo::readTimerWidth()
     return (this->timer_width);
 }
 
+void Servo::setIdleMode(servo_idle_mode_t mode, int settleMs)
+{
+    if (settleMs < 0)
+        settleMs = 0;
+    ensureLock();
+    if (this->settleTimer == NULL && mode != SERVO_IDLE_HOLD)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback = &Servo::settleTimerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "servo_settle";
+        if (esp_timer_create(&args, &this->settleTimer) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Could not create settle timer, servo will hold its pulse");
+            this->settleTimer = NULL;
+            return;
+        }
+    }
+    this->idleMode = mode;
+    this->settleMs = settleMs;
+    if (mode == SERVO_IDLE_HOLD)
+    {
+        if (this->settleTimer != NULL)
+            esp_timer_stop(this->settleTimer);
+        // a servo parked under the previous mode resumes pulsing
+        if (this->parked)
+            writeTicks(this->ticks);
+        return;
+    }
+    // apply the new mode to the position that is already being driven
+    if (pwm.attached())
+        armSettleTimer();
+}
+
+servo_idle_mode_t Servo::readIdleMode()
+{
+    return this->idleMode;
+}
+
+bool Servo::idle()
+{
+    return this->parked;
+}
+
+void Servo::armSettleTimer()
+{
+    if (this->idleMode == SERVO_IDLE_HOLD || this->settleTimer == NULL)
+        return;
+    // restart the settle window; only the latest write counts
+    esp_timer_stop(this->settleTimer);
+    esp_timer_start_once(this->settleTimer, (uint64_t)this->settleMs * 1000ULL);
+}
+
+void Servo::park()
+{
+    if (!pwm.attached())
+        return;
+    if (this->idleMode == SERVO_IDLE_RELEASE)
+    {
+        pwm.write(0);
+    }
+    else if (this->idleMode == SERVO_IDLE_DETACH)
+    {
+        // frees the ledc channel, and the timer once no other channel uses it
+        pwm.detachPin(this->pinNumber);
+    }
+    else
+    {
+        return;
+    }
+    // silent: this runs on the esp_timer task after every move
+    this->parked = true;
+}
+
+void Servo::settleTimerCallback(void *arg)
+{
+    Servo *servo = (Servo *)arg;
+    xSemaphoreTake(servo->settleLock, portMAX_DELAY);
+    // a write that raced this callback has re-armed the timer; leave it pulsing
+    int64_t sinceWrite = esp_timer_get_time() - servo->lastWriteUs;
+    if (servo->pinNumber >= 0 && !servo->moveActive && sinceWrite >= (int64_t)servo->settleMs * 1000LL)
+        servo->park();
+    xSemaphoreGive(servo->settleLock);
+}
+
+bool Servo::moveTo(int value, int durationMs, servo_move_cb_t callback, void *arg, servo_profile_t profile)
+{
+    if (!this->attached())
+        return false;
+    int target = clampTicks(usToTicks(toMicroseconds(value)));
+    int segments = (profile == SERVO_PROFILE_LINEAR) ? 1 : SERVO_MOVE_SEGMENTS;
+    // the servo samples one pulse per refresh period, shorter segments buy nothing
+    if (durationMs / segments < 1000 / REFRESH_CPS)
+    {
+        writeTicks(target);
+        if (callback != NULL)
+            callback(this, arg);
+        return true;
+    }
+    ensureLock();
+    if (this->moveTimer == NULL)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback = &Servo::moveTimerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "servo_move";
+        if (esp_timer_create(&args, &this->moveTimer) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Could not create move timer, writing target directly");
+            this->moveTimer = NULL;
+            writeTicks(target);
+            if (callback != NULL)
+                callback(this, arg);
+            return false;
+        }
+    }
+
+    xSemaphoreTake(this->settleLock, portMAX_DELAY);
+    esp_timer_stop(this->moveTimer);
+    if (this->settleTimer != NULL)
+        esp_timer_stop(this->settleTimer);
+    // ramps start from the pulse actually on the pin, also after a release or detach
+    reassert();
+    pwm.stopFade(this->ticks);
+    this->moveStartTicks = this->ticks;
+    this->moveTargetTicks = target;
+    this->moveSegments = segments;
+    this->moveSegment = 0;
+    this->moveSegmentMs = durationMs / segments;
+    this->moveProfile = profile;
+    this->moveCallback = callback;
+    this->moveArg = arg;
+    this->moveActive = true;
+    startMoveSegment();
+    xSemaphoreGive(this->settleLock);
+    return true;
+}
+
+bool Servo::moving()
+{
+    return this->moveActive;
+}
+
+bool Servo::startMoveSegment()
+{
+    if (this->moveSegment >= this->moveSegments)
+        return false;
+    this->moveSegment++;
+    float position = profilePosition(this->moveProfile, (float)this->moveSegment / (float)this->moveSegments);
+    int segmentTicks = this->moveStartTicks + (int)lroundf(position * (float)(this->moveTargetTicks - this->moveStartTicks));
+    this->ticks = segmentTicks;
+    this->lastWriteUs = esp_timer_get_time();
+    // the fade engine interpolates inside the segment; a plain step if it is unavailable
+    if (!pwm.fade(segmentTicks, this->moveSegmentMs))
+        pwm.write(segmentTicks);
+    esp_timer_start_once(this->moveTimer, (uint64_t)this->moveSegmentMs * 1000ULL);
+    return true;
+}
+
+void Servo::moveTimerCallback(void *arg)
+{
+    Servo *servo = (Servo *)arg;
+    servo_move_cb_t done = NULL;
+    void *doneArg = NULL;
+    bool finished = false;
+    xSemaphoreTake(servo->settleLock, portMAX_DELAY);
+    // a write() that raced this callback has already cancelled the move
+    if (servo->moveActive && !servo->startMoveSegment())
+    {
+        servo->moveActive = false;
+        done = servo->moveCallback;
+        doneArg = servo->moveArg;
+        finished = true;
+    }
+    xSemaphoreGive(servo->settleLock);
+    if (finished)
+    {
+        servo->armSettleTimer();
+        if (done != NULL)
+            done(servo, doneArg);
+    }
+}
+
+float Servo::profilePosition(servo_profile_t profile, float t)
+{
+    // normalized position (0..1) reached at normalized time t (0..1)
+    if (t <= 0.0f)
+        return 0.0f;
+    if (t >= 1.0f)
+        return 1.0f;
+    switch (profile)
+    {
+    case SERVO_PROFILE_TRAPEZOID:
+    {
+        const float accel = 0.25f;                 // fraction of the move spent accelerating
+        const float vmax = 1.0f / (1.0f - accel);  // cruise speed that still ends at 1.0
+        if (t < accel)
+            return 0.5f * vmax / accel * t * t;
+        if (t <= 1.0f - accel)
+            return 0.5f * vmax * accel + vmax * (t - accel);
+        return 1.0f - 0.5f * vmax / accel * (1.0f - t) * (1.0f - t);
+    }
+    case SERVO_PROFILE_SCURVE:
+        return t * t * (3.0f - 2.0f * t);
+    case SERVO_PROFILE_LINEAR:
+    default:
+        return t;
+    }
+}
+
 int Servo::usToTicks(int usec)
 {
     return (int)((double)usec / ((double)REFRESH_USEC / (double)this->timer_width_ticks)*(((double)REFRESH_CPS)/50.0));
@@ -60,12 +60,26 @@
  setTimerWidth(value) - Sets the PWM timer width (must be 16-20) (ESP32 ONLY);
  as a side effect, the pulse width is recomputed.
  int readTimerWidth() - Gets the PWM timer width (ESP32 ONLY)
+ setIdleMode(mode, settleMs) - After each write the pulse is driven for settleMs,
+ then the servo either keeps pulsing (SERVO_IDLE_HOLD, the default), has its
+ duty zeroed (SERVO_IDLE_RELEASE) or has its pin and ledc channel freed
+ (SERVO_IDLE_DETACH). The next write re-asserts the pulse automatically.
+ bool idle() - Returns true while the servo is parked by its idle mode.
+ bool moveTo(value, durationMs, callback, arg, profile) - Moves to value (same
+ semantics as write()) over durationMs without blocking. The move is split
+ into SERVO_MOVE_SEGMENTS linear ramps run by the ledc fade engine, shaped as
+ a linear, trapezoidal or S-curve profile. callback(servo, arg) runs from the
+ esp_timer task when the move ends; a write() cancels the move.
+ bool moving() - Returns true while a moveTo() is in progress.
  */
 
 #ifndef ESP32_Servo_h
 #define ESP32_Servo_h
 //#include "analogWrite.h"
 #include "ESP32PWM.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 //#include "ESP32Tone.h"
 //Enforce only using PWM pins on the ESP32
 #define ENFORCE_PINS
@@ -103,6 +117,27 @@
 
 #define MAX_SERVOS              16     // no. of PWM channels in ESP32
 
+#define DEFAULT_SETTLE_MS      500     // time a written pulse is driven before the idle mode applies
+
+#define SERVO_MOVE_SEGMENTS      8     // linear fade segments a moveTo() profile is split into
+
+// Velocity shape of a moveTo()
+typedef enum {
+	SERVO_PROFILE_LINEAR,    // constant speed, a single hardware fade
+	SERVO_PROFILE_TRAPEZOID, // constant acceleration over the first and last quarter
+	SERVO_PROFILE_SCURVE     // smoothstep, no jerk at either end
+} servo_profile_t;
+
+class Servo;
+typedef void (*servo_move_cb_t)(Servo *servo, void *arg);
+
+// What the servo does once a written position has had time to settle
+typedef enum {
+	SERVO_IDLE_HOLD,    // keep pulsing at the refresh rate (Arduino semantics)
+	SERVO_IDLE_RELEASE, // zero the duty, keep the ledc channel allocated
+	SERVO_IDLE_DETACH   // detach the pin and free the ledc channel and timer
+} servo_idle_mode_t;
+
 /*
  * This group/channel/timmer mapping is for information only;
  * the details are handled by lower-level code
@@ -130,6 +165,7 @@ class Servo {
 
 public:
 	Servo();
+	~Servo();
 	// Arduino Servo Library calls
 	int attach(int pin); // attach the given pin to the next free channel, returns channel number or 0 if failure
 	int attach(int pin, int min, int max); // as above but also sets min and max values for writes.
@@ -150,9 +186,25 @@ public:
 		REFRESH_CPS=hertz;
 		setTimerWidth(this->timer_width);
 	}
+	void setIdleMode(servo_idle_mode_t mode, int settleMs = DEFAULT_SETTLE_MS); // stop pulsing settleMs after each write (ESP32 ONLY)
+	servo_idle_mode_t readIdleMode();  // get the idle mode (ESP32 ONLY)
+	bool idle();                       // true while parked by the idle mode (ESP32 ONLY)
+	bool moveTo(int value, int durationMs, servo_move_cb_t callback = NULL, void *arg = NULL,
+			servo_profile_t profile = SERVO_PROFILE_SCURVE); // non-blocking profiled move (ESP32 ONLY)
+	bool moving();                     // true while a moveTo() is in progress (ESP32 ONLY)
 private:
 	int usToTicks(int usec);
 	int ticksToUs(int ticks);
+	int toMicroseconds(int value);
+	int clampTicks(int value);
+	bool reassert();
+	void ensureLock();
+	void armSettleTimer();
+	void park();
+	static void settleTimerCallback(void *arg);
+	bool startMoveSegment();
+	static void moveTimerCallback(void *arg);
+	static float profilePosition(servo_profile_t profile, float t);
 //   static int ServoCount;                             // the total number of attached servos
 //   static int ChannelUsed[];                          // used to track whether a channel is in service
 //   int servoChannel = 0;                              // channel number for this servo
@@ -167,5 +219,23 @@ private:
 	ESP32PWM pwm;
 	int REFRESH_CPS = 50;
 
+	servo_idle_mode_t idleMode = SERVO_IDLE_HOLD;
+	int settleMs = DEFAULT_SETTLE_MS;
+	bool parked = false;                      // pulse stopped by the idle mode, pin still owned
+	int64_t lastWriteUs = 0;                  // esp_timer time of the last pulse update
+	esp_timer_handle_t settleTimer = NULL;
+	SemaphoreHandle_t settleLock = NULL;      // serializes write() against the settle and move timers
+
+	bool moveActive = false;
+	int moveStartTicks = 0;
+	int moveTargetTicks = 0;
+	int moveSegments = 0;                     // 1 for a linear move, SERVO_MOVE_SEGMENTS otherwise
+	int moveSegment = 0;                      // segments started so far
+	int moveSegmentMs = 0;
+	servo_profile_t moveProfile = SERVO_PROFILE_SCURVE;
+	servo_move_cb_t moveCallback = NULL;
+	void *moveArg = NULL;
+	esp_timer_handle_t moveTimer = NULL;
+
 };
 #endif
@@ -1,4 +1,8 @@
 from flask import Flask, request, send_from_directory, make_response, jsonify
+try:
+    from flask_sock import Sock
+except ImportError:   # /ws isteğe bağlı; yoksa cihaz HTTP uç noktalarına düşer
+    Sock = None
 from gtts import gTTS
 from pydub import AudioSegment
 import wave, os, uuid, requests
@@ -6,8 +10,10 @@ import pandas as pd
 from datetime import datetime
 import json
 import io
+import socket, struct, threading, time, itertools, queue, hashlib, hmac, re, tempfile, contextlib
 
 app = Flask(__name__)
+sock = Sock(app) if Sock else None
 UPLOAD_FOLDER = "audios"
 LOG_FILE = "access_logs.csv"
 os.makedirs(UPLOAD_FOLDER, exist_ok=True)
@@ -15,14 +21,190 @@ os.makedirs(UPLOAD_FOLDER, exist_ok=True)
 # Server Configuration
 SERVER_IP = "192.168.137.44"
 SERVER_PORT = 5000
+UDP_PORT = 5005      # cihazın UDP ses taşıması (config.h: UDP_AUDIO_PORT)
+DEBUG = True
 
 # API Configuration
 GROQ_API_KEY = "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"
 WHISPER_MODEL = "whisper-large-v3"
 CHAT_MODEL = "llama3-8b-8192"
 
-# Aktif kayıtları tutmak için sözlük
-active_recordings = {}
+# Cihazın X-Audio-Codec başlığıyla bildirdiği yükleme kodlamaları
+ADPCM_BLOCK_HEADER = 4
+IMA_STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+]
+IMA_INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+def ima_adpcm_decode_block(block):
+    """Cihazın tek bir IMA-ADPCM bloğunu 16 bit PCM'e çözer (src/audio_codec.cpp ile aynı düzen)."""
+    if len(block) < ADPCM_BLOCK_HEADER:
+        return b""
+    predictor = int.from_bytes(block[0:2], "little", signed=True)
+    index = min(max(block[2], 0), 88)
+    out = bytearray()
+    for byte in block[ADPCM_BLOCK_HEADER:]:
+        for code in (byte & 0x0F, byte >> 4):
+            step = IMA_STEP_TABLE[index]
+            delta = step >> 3
+            if code & 4:
+                delta += step
+            if code & 2:
+                delta += step >> 1
+            if code & 1:
+                delta += step >> 2
+            predictor = predictor - delta if code & 8 else predictor + delta
+            predictor = min(max(predictor, -32768), 32767)
+            index = min(max(index + IMA_INDEX_TABLE[code], 0), 88)
+            out += predictor.to_bytes(2, "little", signed=True)
+    return bytes(out)
+
+def decode_upload_chunk(data, codec):
+    """Bir yükleme parçasını ham PCM'e çevirir; PCM parçaları olduğu gibi döner."""
+    if codec == "ima-adpcm":
+        return ima_adpcm_decode_block(data)
+    return data
+
+def pcm_to_wav(pcm, sample_rate=16000):
+    buf = io.BytesIO()
+    with wave.open(buf, "wb") as wf:
+        wf.setnchannels(1)
+        wf.setsampwidth(2)
+        wf.setframerate(sample_rate)
+        wf.writeframes(pcm)
+    return buf.getvalue()
+
+# Cihazın çözebildiği yanıt ses formatları; wav her zaman desteklenir
+REPLY_FORMATS = ("wav", "mp3")
+
+# Cihazın X-Sample-Rate ile bildirebileceği yükleme hızları; cihaz /capabilities'den okur
+UPLOAD_RATES = (16000, 8000)
+
+def upload_sample_rate():
+    """Yüklemenin örnekleme hızı; başlık yoksa ya da tanınmıyorsa eski cihazların 16 kHz'i."""
+    try:
+        rate = int(request.headers.get("X-Sample-Rate", 16000))
+    except ValueError:
+        return 16000
+    return rate if rate in UPLOAD_RATES else 16000
+
+def requested_reply_format(json_data=None):
+    """Cihazın X-Reply-Format başlığı, JSON 'format' alanı ya da ?format= ile istediği yanıt formatı."""
+    fmt = None
+    if json_data:
+        fmt = json_data.get("format")
+    fmt = fmt or request.headers.get("X-Reply-Format") or request.args.get("format") or "wav"
+    fmt = fmt.lower()
+    return fmt if fmt in REPLY_FORMATS else "wav"
+
+# --- Yanıt sesi önbelleği ---
+# Sentezlenen her ses metin + dil + formatın özetiyle adlandırılır (tts-<anahtar>.<format>).
+# Aynı ifade bir daha gTTS'e gitmez; adres içeriği belirlediği için cihaz da elindeki
+# kopyayı indirmeden çalar. /audios bu dosyalar için anahtarı ETag olarak verir ve
+# If-None-Match'e 304 döner; WebSocket'te cihaz elindeki anahtarları "cache"
+# iletisiyle bildirir, sunucu o yanıtları akıtmaz.
+TTS_CACHE_VERSION = 1                    # sentez ayarları değişirse artırılır, eski dosyalar kullanılmaz
+TTS_CACHE_PREFIX = "tts-"
+TTS_CACHE_MAX_BYTES = 256 * 1024 * 1024  # aşılınca en uzun süredir kullanılmayanlar silinir
+tts_locks = {}   # anahtar -> [kilit, kullanan sayısı]; son çıkan girdiyi siler
+tts_locks_guard = threading.Lock()
+
+def tts_cache_key(text, lang, fmt):
+    raw = f"{TTS_CACHE_VERSION}\0{lang}\0{fmt}\0{text}".encode("utf-8")
+    return hashlib.sha256(raw).hexdigest()[:32]
+
+def tts_etag(filename):
+    """Önbellekteki yanıt dosyasının anahtarı; önbellek dışı dosyalar için None."""
+    if not filename.startswith(TTS_CACHE_PREFIX):
+        return None
+    return os.path.splitext(filename)[0][len(TTS_CACHE_PREFIX):]
+
+@contextlib.contextmanager
+def tts_lock(key):
+    # Aynı ifadeyi aynı anda isteyen kapılar tek sentezi bekler. Anahtar başına
+    # kilit yalnızca sentez sürerken tutulur; sözlük eşzamanlı ifade kadar büyür.
+    # wav sentezi mp3 anahtarını da kilitlediğinden ortak kilit dizisi kilitlenebilirdi
+    with tts_locks_guard:
+        entry = tts_locks.setdefault(key, [threading.Lock(), 0])
+        entry[1] += 1
+    try:
+        with entry[0]:
+            yield
+    finally:
+        with tts_locks_guard:
+            entry[1] -= 1
+            if entry[1] == 0:
+                del tts_locks[key]
+
+def tts_cache_evict(keep):
+    entries = []
+    for name in os.listdir(UPLOAD_FOLDER):
+        if name.startswith(TTS_CACHE_PREFIX) and name != keep:
+            st = os.stat(os.path.join(UPLOAD_FOLDER, name))
+            entries.append((st.st_mtime, st.st_size, name))
+    total = sum(size for _, size, _ in entries) + os.path.getsize(os.path.join(UPLOAD_FOLDER, keep))
+    for _, size, name in sorted(entries):
+        if total <= TTS_CACHE_MAX_BYTES:
+            break
+        os.remove(os.path.join(UPLOAD_FOLDER, name))
+        total -= size
+        print(f"🗑️ TTS önbelleğinden çıkarıldı: {name}")
+
+def synthesize_reply(text, lang="tr", fmt="wav"):
+    """gTTS ile yanıt sesini üretir, audios/ altındaki dosya adını döndürür.
+
+    mp3 istendiğinde gTTS çıktısı olduğu gibi sunulur; wav için mono 16 bit
+    PCM'e çözülür. Örnekleme hızı korunur (gTTS: 24 kHz), cihaz kendi
+    dönüştürür. Daha önce üretilmiş ses yeniden sentezlenmez; wav da aynı
+    metnin önbellekteki mp3'ünden çözülür.
+    """
+    key = tts_cache_key(text, lang, fmt)
+    filename = f"{TTS_CACHE_PREFIX}{key}.{fmt}"
+    path = os.path.join(UPLOAD_FOLDER, filename)
+    with tts_lock(key):
+        if os.path.exists(path):
+            os.utime(path)   # en son kullanılma, çıkarma sırası için
+            print(f"♻️ TTS önbellekten: {filename}")
+            return filename
+
+        # Yarım dosya önbelleğe girmesin: geçici addan tek adımda taşınır
+        tmp_path = os.path.join(UPLOAD_FOLDER, f".{key}.{uuid.uuid4().hex}.tmp")
+        try:
+            tts_render(text, lang, fmt, tmp_path)
+            os.replace(tmp_path, path)
+        finally:
+            if os.path.exists(tmp_path):
+                os.remove(tmp_path)
+    print(f"✅ Yanıt sesi kaydedildi: {filename} ({os.path.getsize(path)} bytes)")
+    tts_cache_evict(filename)
+    return filename
+
+def tts_render(text, lang, fmt, out_path):
+    if fmt == "mp3":
+        print("gTTS ile MP3 oluşturuluyor...")
+        gTTS(text, lang=lang).save(out_path)
+        return
+    # pydub ile MP3'ü decode edip raw PCM veriye dönüştür
+    mp3_path = os.path.join(UPLOAD_FOLDER, synthesize_reply(text, lang, "mp3"))
+    print("MP3'ten WAV'a dönüştürülüyor...")
+    audio = AudioSegment.from_mp3(mp3_path)
+    audio = audio.set_channels(1).set_sample_width(2)
+    # wave modülü ile baştan oluşturulan header + PCM
+    with wave.open(out_path, "wb") as wf:
+        wf.setnchannels(1)                # mono
+        wf.setsampwidth(2)                # 16 bit = 2 byte
+        wf.setframerate(audio.frame_rate)
+        wf.writeframes(audio.raw_data)
+
+def audio_url(filename, host=None):
+    host = host or request.host_url.rstrip('/')
+    return f"{host}/audios/{filename}"
 
 def get_log_context():
     try:
@@ -93,6 +275,796 @@ def is_log_related_query(text):
     
     return (has_primary and has_secondary) or has_exact_match, None
 
+def transcribe(wav_data):
+    """Whisper ile konuşmayı metne çevirir."""
+    # Geçici dosyaya kaydet
+    file_id = str(uuid.uuid4())
+    wav_path = os.path.join(UPLOAD_FOLDER, f"{file_id}.wav")
+
+    print(f"💾 WAV dosyası kaydediliyor: {wav_path}")
+    with open(wav_path, "wb") as f:
+        f.write(wav_data)
+
+    print(f"WAV dosyası kaydedildi: {os.path.getsize(wav_path)} bytes")
+
+    # Whisper API'ye gönder
+    print("🎯 Whisper API'ye gönderiliyor...")
+    headers = {"Authorization": f"Bearer {GROQ_API_KEY}"}
+
+    with open(wav_path, "rb") as af:
+        try:
+            print("Whisper API isteği yapılıyor...")
+            asr_res = requests.post(
+                "https://api.groq.com/openai/v1/audio/transcriptions",
+                headers=headers,
+                files={"file": (os.path.basename(wav_path), af, "audio/wav")},
+                data={
+                    "model": WHISPER_MODEL,
+                    "language": "tr",
+                    "response_format": "json"
+                }
+            )
+            print(f"Whisper API yanıt kodu: {asr_res.status_code}")
+            asr_res.raise_for_status()
+            text = asr_res.json().get("text", "").strip()
+            print(f"🗣️ Algılanan metin: {text}")
+            return text
+        except Exception as e:
+            print(f"❌ Whisper API hatası: {str(e)}")
+            print(f"Yanıt: {asr_res.text if 'asr_res' in locals() else 'Yanıt yok'}")
+            raise
+
+def answer(text):
+    """Sorunun türüne göre kayıtlardan ya da LLM'den yanıt metni üretir."""
+    headers = {"Authorization": f"Bearer {GROQ_API_KEY}"}
+
+    print("📝 Sorgu tipi belirleniyor...")
+    is_log_query, id_match = is_log_related_query(text)
+
+    if is_log_query:
+        print("📊 Log ile ilgili soru tespit edildi")
+
+        # ID sorgusu ise direkt bilgiyi al
+        if id_match:
+            print(f"🔍 ID sorgusu tespit edildi: {id_match}")
+            user_info = get_user_info_by_id(id_match)
+            reply = user_info
+            print(f"💡 Kullanıcı bilgisi: {reply}")
+        else:
+            context = get_log_context()
+            system_prompt = """Sen bir akıllı asistansın. Sana verilen giriş-çıkış kayıtlarını kullanarak soruları yanıtlayacaksın.
+            Yanıtlarını her zaman Türkçe ve doğal bir dille ver. Teknik detaylardan kaçın, sade ve anlaşılır ol.
+            Eğer soruyu anlamadıysan veya kayıtlarda yeterli bilgi yoksa, bunu nazikçe belirt."""
+            messages = [
+                {"role": "system", "content": system_prompt},
+                {"role": "user", "content": context},
+                {"role": "user", "content": text}
+            ]
+
+            print("🤖 LLM API'ye gönderiliyor...")
+            try:
+                chat_res = requests.post(
+                    "https://api.groq.com/openai/v1/chat/completions",
+                    headers=headers,
+                    json={
+                        "model": CHAT_MODEL,
+                        "messages": messages,
+                        "temperature": 0.7
+                    }
+                )
+                print(f"LLM API yanıt kodu: {chat_res.status_code}")
+                chat_res.raise_for_status()
+                reply = chat_res.json()["choices"][0]["message"]["content"].strip()
+                print(f"💡 LLM yanıtı: {reply}")
+            except Exception as e:
+                print(f"❌ LLM API hatası: {str(e)}")
+                print(f"Yanıt: {chat_res.text if 'chat_res' in locals() else 'Yanıt yok'}")
+                raise
+    else:
+        print("💭 Genel bir soru tespit edildi")
+        system_prompt = """Sen yardımcı bir asistansın. Kullanıcıların her türlü sorusuna yardımcı olabilirsin.
+        Yanıtlarını her zaman Türkçe ve doğal bir dille ver. Bilmediğin konularda dürüst ol.
+        Güncel olaylar, hava durumu, genel bilgi ve benzeri her konuda yardımcı olmaya çalış."""
+        messages = [
+            {"role": "system", "content": system_prompt},
+            {"role": "user", "content": text}
+        ]
+
+        print("🤖 LLM API'ye gönderiliyor...")
+        try:
+            chat_res = requests.post(
+                "https://api.groq.com/openai/v1/chat/completions",
+                headers=headers,
+                json={
+                    "model": CHAT_MODEL,
+                    "messages": messages,
+                    "temperature": 0.7
+                }
+            )
+            print(f"LLM API yanıt kodu: {chat_res.status_code}")
+            chat_res.raise_for_status()
+            reply = chat_res.json()["choices"][0]["message"]["content"].strip()
+            print(f"💡 LLM yanıtı: {reply}")
+        except Exception as e:
+            print(f"❌ LLM API hatası: {str(e)}")
+            print(f"Yanıt: {chat_res.text if 'chat_res' in locals() else 'Yanıt yok'}")
+            raise
+
+    print(f"🗣️ Kullanıcı sorusu: {text}")
+    return reply
+
+def process_utterance(wav_data, is_wake_check, reply_fmt, host=None):
+    """Whisper -> LLM -> gTTS. Wake word kontrolünde algılanan metni, aksi halde
+    yanıt sesinin URL'ini döndürür. UDP yüklemeleri bunu kullanır."""
+    return process_text(transcribe(wav_data), is_wake_check, reply_fmt, host)
+
+def process_text(text, is_wake_check, reply_fmt, host=None):
+    """Çözümlenmiş metinden sonrası: LLM -> gTTS."""
+    # Wake word kontrolü ise sadece metni döndür
+    if is_wake_check:
+        print("Wake word kontrolü yapılıyor...")
+        return text
+
+    reply = answer(text)
+
+    # gTTS → MP3 (→ PCM WAV, cihaz mp3 istemediyse)
+    print("🔊 Ses sentezleniyor...")
+    try:
+        filename = synthesize_reply(reply, "tr", reply_fmt)
+    except Exception as e:
+        print(f"❌ Ses sentezleme hatası: {str(e)}")
+        raise
+
+    url = audio_url(filename, host)
+    print(f"🔗 Dönülen URL: {url}")
+    return url
+
+# --- Yük testi taklitleri ---
+# LLM_SERVER_MOCK=1 ile Whisper, LLM ve gTTS çağrılmaz; yerlerine sabit süre
+# bekleyen taklitler çalışır (tools/load_bench.py). Taşıma, oturum tablosu ve
+# yanıt önbelleği gerçek kodla ölçülür. Süreler ortamdan ms olarak okunur.
+# MOCK_REPLIES farklı yanıt metni sayısıdır; 0 ise her yanıt yeniden sentezlenir.
+MOCK = os.environ.get("LLM_SERVER_MOCK") == "1"
+
+if MOCK:
+    MOCK_ASR_MS = int(os.environ.get("MOCK_ASR_MS", "300"))
+    MOCK_LLM_MS = int(os.environ.get("MOCK_LLM_MS", "500"))
+    MOCK_TTS_MS = int(os.environ.get("MOCK_TTS_MS", "400"))
+    MOCK_REPLIES = int(os.environ.get("MOCK_REPLIES", "0"))
+    MOCK_REPLY_SECONDS = 2
+    mock_reply_ids = itertools.count(1)
+
+    def transcribe(wav_data):
+        time.sleep(MOCK_ASR_MS / 1000)
+        return "kapıyı aç"
+
+    def answer(text):
+        time.sleep(MOCK_LLM_MS / 1000)
+        n = next(mock_reply_ids)
+        return f"Taklit yanıt {n % MOCK_REPLIES if MOCK_REPLIES else n}: {text}"
+
+    def tts_render(text, lang, fmt, out_path):
+        # Biçimden bağımsız olarak sessiz bir WAV; yük aracı sesi çözmez, yalnızca indirir
+        time.sleep(MOCK_TTS_MS / 1000)
+        with wave.open(out_path, "wb") as wf:
+            wf.setnchannels(1)
+            wf.setsampwidth(2)
+            wf.setframerate(16000)
+            wf.writeframes(b"\0" * (16000 * 2 * MOCK_REPLY_SECONDS))
+
+    print(f"🧪 Taklit mod: ASR {MOCK_ASR_MS} ms, LLM {MOCK_LLM_MS} ms, TTS {MOCK_TTS_MS} ms")
+
+# --- Bölütlü çözümleme ---
+# Cihaz konuşmadaki duraklamaları kendi VAD'ıyla bulur ve bölüt sınırı olarak
+# bildirir (HTTP: X-Segment-End, WebSocket: segment iletisi). Kapanan her bölüt
+# kayıt sürerken Whisper'a gider; oturum bittiğinde yalnızca son bölüt beklenir.
+# Cihaz son sınırdan sonra konuşma duymadıysa (X-Tail-Speech: false) o kısım
+# hiç çözümlenmez; sessiz wake word pencereleri Whisper'a gitmez.
+SEGMENT_MIN_MS = 200   # bundan kısa bölüt bir sonrakine eklenir
+WAV_HEADER_SIZE = 44
+
+class SegmentPipeline:
+    def __init__(self, rate, on_partial=None):
+        self.rate = rate
+        self.on_partial = on_partial   # o ana kadarki metinle işçi iş parçacığından çağrılır
+        self.pcm = PcmSpool()
+        self.cut_at = 0                # son bölüt sınırı (bayt)
+        self.texts = []
+        self.segments = 0
+        self.error = None
+        self.jobs = None
+        self.worker = None
+
+    def write(self, pcm):
+        self.pcm.append(pcm)
+
+    def samples(self):
+        return len(self.pcm) // 2
+
+    def cut(self):
+        """Son sınırdan bu yana gelen sesi ayrı bir bölüt olarak çözümlemeye gönderir."""
+        if len(self.pcm) - self.cut_at < self.rate * 2 * SEGMENT_MIN_MS // 1000:
+            return
+        if self.worker is None:
+            # Bölütler sırayla çözülür; metinlerin sırası sesin sırasıdır
+            self.jobs = queue.Queue()
+            self.worker = threading.Thread(target=self.run, daemon=True)
+            self.worker.start()
+        self.jobs.put(self.pcm.read(self.cut_at))
+        self.cut_at = len(self.pcm)
+        self.segments += 1
+
+    def run(self):
+        while True:
+            segment = self.jobs.get()
+            if segment is None:
+                return
+            if self.error is not None:
+                continue
+            try:
+                text = transcribe(pcm_to_wav(segment, self.rate))
+            except Exception as e:
+                self.error = e
+                continue
+            if text:
+                self.texts.append(text)
+                if self.on_partial:
+                    self.on_partial(" ".join(self.texts))
+
+    def finish(self, tail=True):
+        """Son bölütü (tail=False ise atarak) bekler, tüm metni döndürür."""
+        try:
+            if self.worker is None:
+                # Sınır bildirilmediyse eskisi gibi tek seferde
+                return transcribe(pcm_to_wav(self.pcm.read(), self.rate)) if tail else ""
+            if tail:
+                self.cut()
+            self.jobs.put(None)
+            self.worker.join()
+            print(f"🧩 {self.segments} bölüt, {self.samples() / self.rate:.1f} s ses")
+            if self.error is not None:
+                raise self.error
+            return " ".join(self.texts)
+        finally:
+            self.pcm.close()
+
+    def close(self):
+        """Sonucu beklemeden bırakır."""
+        if self.worker is not None:
+            self.jobs.put(None)
+        self.pcm.close()
+
+# --- Kayıt oturumları ---
+# HTTP ve WebSocket yüklemelerinin sesi bu tabloda durur. Oturum kimliği cihazın
+# esp_random ile ürettiği 128 bitlik sayıdır (32 onaltılık hane); tahmin edilemez,
+# başka bir cihazın oturumuna ses eklenemez. Oturum ilk parçayla / start iletisiyle
+# açılır; son parçayla / end iletisiyle ya da cihaz kaydı yarıda bıraktığında
+# açıkça (DELETE /upload/<id>, abort iletisi) kapanır. Kapatılmadan unutulan
+# oturum SESSION_TTL_S sonra atılır. Her oturumun sesi SESSION_SPOOL_BYTES'a
+# kadar bellekte, sonrası geçici dosyada tutulur; bellekteki toplam
+# SESSION_MEMORY_CAP'i aşarsa en büyük oturumlar diske taşınır.
+SESSION_ID_RE = re.compile(r"^[0-9a-f]{32}$")
+SESSION_MAX = 64                       # dolunca yeni oturum 503 alır
+SESSION_TTL_S = 30                     # bu kadar ses gelmeyen oturum atılır
+SESSION_SPOOL_BYTES = 256 * 1024       # oturum başına bellekte tutulan ses (8 s @ 16 kHz)
+SESSION_MEMORY_CAP = 16 * 1024 * 1024  # tüm oturumların bellekteki sesi
+
+class PcmSpool:
+    """Sonuna eklenen PCM; SESSION_SPOOL_BYTES'ı aşınca geçici dosyaya taşar."""
+    def __init__(self):
+        self.lock = threading.Lock()   # bellek sınırı başka bir isteğin iş parçacığından taşıyabilir
+        self.file = tempfile.SpooledTemporaryFile(max_size=SESSION_SPOOL_BYTES)
+        self.size = 0
+        self.on_disk = False
+        self.closed = False
+
+    def __len__(self):
+        return self.size
+
+    def append(self, data):
+        with self.lock:
+            self.file.seek(0, io.SEEK_END)
+            self.file.write(data)
+            self.size += len(data)
+            self.on_disk = self.on_disk or self.size > SESSION_SPOOL_BYTES
+
+    def read(self, start=0, end=None):
+        with self.lock:
+            end = self.size if end is None else end
+            self.file.seek(start)
+            return self.file.read(end - start)
+
+    def memory_bytes(self):
+        return 0 if self.on_disk or self.closed else self.size
+
+    def rollover(self):
+        with self.lock:
+            if not self.closed:
+                self.file.rollover()
+                self.on_disk = True
+
+    def close(self):
+        with self.lock:
+            if not self.closed:
+                self.closed = True
+                self.file.close()
+
+class SessionTable:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.sessions = {}   # kimlik -> [SegmentPipeline, son ses zamanı]
+        self.expired = 0
+        self.rejected = 0
+        self.spilled = 0
+
+    def open(self, session_id, pipeline):
+        """Oturumu açar; tablo doluysa False. Aynı kimlikle açık oturum yeniden başlar."""
+        with self.lock:
+            dropped = self._take_expired()
+            old = self.sessions.pop(session_id, None)
+            if old is not None:
+                dropped.append(old[0])
+            ok = len(self.sessions) < SESSION_MAX
+            if ok:
+                self.sessions[session_id] = [pipeline, time.monotonic()]
+            else:
+                self.rejected += 1
+        for p in dropped:
+            p.close()
+        if not ok:
+            pipeline.close()
+        return ok
+
+    def get(self, session_id):
+        with self.lock:
+            entry = self.sessions.get(session_id)
+            if entry is None:
+                return None
+            entry[1] = time.monotonic()
+            return entry[0]
+
+    def close(self, session_id):
+        """Oturumu tablodan çıkarır; sesi çağıran bitirir (finish) ya da bırakır (close)."""
+        with self.lock:
+            entry = self.sessions.pop(session_id, None)
+        return None if entry is None else entry[0]
+
+    def account(self):
+        """Ses yazıldıktan sonra çağrılır: bellek sınırı aşıldıysa en büyük oturumlar diske taşınır."""
+        with self.lock:
+            spools = [e[0].pcm for e in self.sessions.values()]
+        in_memory = sum(s.memory_bytes() for s in spools)
+        if in_memory <= SESSION_MEMORY_CAP:
+            return
+        for spool in sorted(spools, key=lambda s: s.memory_bytes(), reverse=True):
+            if in_memory <= SESSION_MEMORY_CAP:
+                break
+            in_memory -= spool.memory_bytes()
+            spool.rollover()
+            self.spilled += 1
+
+    def reap(self):
+        with self.lock:
+            dropped = self._take_expired()
+        for p in dropped:
+            p.close()
+        return len(dropped)
+
+    def _take_expired(self):
+        now = time.monotonic()
+        stale = [k for k, e in self.sessions.items() if now - e[1] > SESSION_TTL_S]
+        self.expired += len(stale)
+        return [self.sessions.pop(k)[0] for k in stale]
+
+    def stats(self):
+        with self.lock:
+            spools = [e[0].pcm for e in self.sessions.values()]
+        return {
+            "sessions": len(spools),
+            "memory_bytes": sum(s.memory_bytes() for s in spools),
+            "disk_bytes": sum(len(s) for s in spools if s.on_disk),
+            "expired": self.expired,
+            "rejected": self.rejected,
+            "spilled": self.spilled,
+        }
+
+sessions = SessionTable()
+
+def session_reaper():
+    while True:
+        time.sleep(SESSION_TTL_S / 3)
+        n = sessions.reap()
+        if n:
+            print(f"🧹 {n} terk edilmiş kayıt oturumu atıldı: {sessions.stats()}")
+
+def start_session_reaper():
+    threading.Thread(target=session_reaper, name="session_reaper", daemon=True).start()
+
+# --- UDP ses taşıması ---
+# Cihaz her UDP_FRAME_MS'lik parçayı ayrı bir datagramla yollar (src/uplink.cpp ile
+# aynı düzen). Kayıp paketler XOR eşlik paketinden kurtarılır, kurtarılamayanların
+# yeri zaman damgasına göre sessizlikle doldurulur; TCP'deki gibi bir kayıp
+# sonraki sesi bekletmez.
+UDP_HEADER = struct.Struct("<2sBBBBHIIHBB")   # 20 bayt, little endian
+UDP_MAGIC = b"VA"
+UDP_VERSION = 1
+UDP_DATA, UDP_FEC, UDP_END, UDP_ACK, UDP_REPLY = range(5)
+UDP_FLAG_WAKE, UDP_FLAG_MP3, UDP_FLAG_DRY = 0x01, 0x02, 0x04
+UDP_CODECS = {0: "pcm", 1: "ima-adpcm"}
+UDP_MAX_REPLY = 1400
+UDP_SESSION_TTL = 60
+UDP_REORDER_S = 0.08   # END'den sonra geç gelen veri/eşlik paketleri için bekleme (Wi-Fi titreşimi)
+UDP_RCVBUF = 1 << 20   # birden çok kapının eşzamanlı patlamaları; çekirdek rmem_max ile sınırlar
+
+udp_sessions = {}
+udp_lock = threading.Lock()
+
+def xor_bytes(a, b):
+    n = max(len(a), len(b))
+    a = a.ljust(n, b"\0")
+    b = b.ljust(n, b"\0")
+    return bytes(x ^ y for x, y in zip(a, b))
+
+class UdpUtterance:
+    def __init__(self, codec, rate, flags):
+        self.codec = UDP_CODECS.get(codec, "pcm")
+        self.rate = rate
+        self.flags = flags
+        self.packets = {}    # seq -> (timestamp, payload)
+        self.parity = {}     # ilk seq -> (kapsadığı paket sayısı, eşlik yükü)
+        self.state = "receiving"   # receiving -> closing (END alındı, geç paketler kabul) -> processing -> done
+        self.late = 0        # END'den sonra gelen paketler
+        self.result = None
+        self.updated = time.time()
+
+    def unrecoverable(self, total_packets):
+        """Eşlikle de geri kurulamayacak eksik paket sayısı; paketlere dokunmaz."""
+        missing = {seq for seq in range(total_packets) if seq not in self.packets}
+        for base, (count, _) in self.parity.items():
+            group = [seq for seq in range(base, base + count) if seq in missing]
+            if len(group) == 1:
+                missing.discard(group[0])
+        return len(missing)
+
+    def recover(self, total_packets):
+        """Grubunda tek paket eksikse eşlik paketinden geri kurar; kurtarılan sayısını döner."""
+        recovered = 0
+        for base, (count, parity) in self.parity.items():
+            group = [base + i for i in range(count) if base + i < total_packets]
+            missing = [seq for seq in group if seq not in self.packets]
+            if len(missing) != 1:
+                continue
+            acc = parity
+            for seq in group:
+                if seq in self.packets:
+                    ts, payload = self.packets[seq]
+                    acc = xor_bytes(acc, struct.pack("<HI", len(payload), ts) + payload)
+            length, ts = struct.unpack_from("<HI", acc)
+            self.packets[missing[0]] = (ts, acc[6:6 + length])
+            recovered += 1
+        return recovered
+
+    def assemble(self, total_packets, total_samples):
+        """Paketleri zaman damgalarına yerleştirir; (pcm, kayıp paket, kurtarılan) döner."""
+        recovered = self.recover(total_packets)
+        pcm = bytearray(total_samples * 2)
+        for seq, (ts, payload) in self.packets.items():
+            if seq >= total_packets:
+                continue
+            samples = decode_upload_chunk(payload, self.codec)
+            start = ts * 2
+            if start >= len(pcm):
+                continue
+            end = min(start + len(samples), len(pcm))
+            pcm[start:end] = samples[:end - start]
+        lost = sum(1 for seq in range(total_packets) if seq not in self.packets)
+        return bytes(pcm), lost, recovered
+
+def udp_send(sock, addr, kind, session, seq, payload=b""):
+    header = UDP_HEADER.pack(UDP_MAGIC, UDP_VERSION, kind, 0, 0, seq, session, 0, 0, 0, 0)
+    sock.sendto(header + payload, addr)
+
+def udp_host_for(addr):
+    """Cihazın ulaştığı yerel adres; yanıt URL'i bununla kurulur."""
+    probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        probe.connect(addr)
+        return f"http://{probe.getsockname()[0]}:{SERVER_PORT}"
+    finally:
+        probe.close()
+
+def udp_finish(sock, addr, session, utt, total_packets, total_samples):
+    # END, son grupların veri ve eşlik paketlerini geçebilir; hepsi gelene ya da
+    # eşlikle kurtarılabilir olana kadar en çok UDP_REORDER_S beklenir
+    deadline = time.time() + UDP_REORDER_S
+    while True:
+        with udp_lock:
+            if utt.unrecoverable(total_packets) == 0 or time.time() >= deadline:
+                utt.state = "processing"
+                break
+        time.sleep(0.005)
+    try:
+        pcm, lost, recovered = utt.assemble(total_packets, total_samples)
+        print(f"📦 UDP oturumu {session:08x}: {total_packets} paket, {lost} kayıp, "
+              f"{recovered} kurtarıldı, {utt.late} geç, {total_samples} örnek @ {utt.rate} Hz")
+        if utt.flags & UDP_FLAG_DRY:
+            result = f"DRY {total_samples} {lost} {recovered}"
+        else:
+            fmt = "mp3" if utt.flags & UDP_FLAG_MP3 else "wav"
+            result = process_utterance(pcm_to_wav(pcm, utt.rate), bool(utt.flags & UDP_FLAG_WAKE),
+                                       fmt, udp_host_for(addr))
+    except Exception as e:
+        print(f"❌ UDP oturumu {session:08x} işlenemedi: {str(e)}")
+        result = ""
+    with udp_lock:
+        utt.result = result.encode("utf-8")[:UDP_MAX_REPLY]
+        utt.state = "done"
+        utt.updated = time.time()
+    udp_send(sock, addr, UDP_REPLY, session, 0, utt.result)
+
+def udp_receiver():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, UDP_RCVBUF)
+    sock.bind(("0.0.0.0", UDP_PORT))
+    print(f"UDP ses alıcısı: 0.0.0.0:{UDP_PORT}")
+    while True:
+        data, addr = sock.recvfrom(2048)
+        if len(data) < UDP_HEADER.size:
+            continue
+        magic, version, kind, flags, codec, seq, session, ts, rate, count, _ = UDP_HEADER.unpack_from(data)
+        if magic != UDP_MAGIC or version != UDP_VERSION:
+            continue
+        payload = data[UDP_HEADER.size:]
+        now = time.time()
+        with udp_lock:
+            for sid in [k for k, u in udp_sessions.items() if now - u.updated > UDP_SESSION_TTL]:
+                del udp_sessions[sid]
+            utt = udp_sessions.get(session)
+            if utt is None:
+                if len(udp_sessions) >= SESSION_MAX:
+                    # Biten oturumlar yalnızca yanıtı yinelemek için tutulur; yer açmak için en eskisi atılır
+                    done = [k for k, u in udp_sessions.items() if u.state == "done"]
+                    if not done:
+                        continue
+                    del udp_sessions[min(done, key=lambda k: udp_sessions[k].updated)]
+                utt = udp_sessions[session] = UdpUtterance(codec, rate, flags)
+            utt.updated = now
+            # END'den sonra da geç paketler bekleme süresince alınır; birleştirme
+            # başladıktan sonra paketleri artık udp_finish kullanır
+            if kind in (UDP_DATA, UDP_FEC):
+                if utt.state in ("receiving", "closing"):
+                    if utt.state == "closing":
+                        utt.late += 1
+                    if kind == UDP_DATA:
+                        utt.packets[seq] = (ts, payload)
+                    else:
+                        utt.parity[seq] = (count, payload)
+                continue
+            if kind != UDP_END:
+                continue
+            # END yinelenebilir: işleniyorsa yeniden onaylanır, bittiyse yanıt tekrar gönderilir
+            state = utt.state
+            if state == "receiving":
+                utt.state = "closing"
+        if state == "done":
+            udp_send(sock, addr, UDP_REPLY, session, 0, utt.result)
+            continue
+        udp_send(sock, addr, UDP_ACK, session, seq)
+        if state == "receiving":
+            # END'de seq gönderilen veri paketi, zaman damgası toplam örnek sayısıdır
+            threading.Thread(target=udp_finish, args=(sock, addr, session, utt, seq, ts), daemon=True).start()
+
+def start_udp_receiver():
+    threading.Thread(target=udp_receiver, name="udp_audio", daemon=True).start()
+
+# --- WebSocket oturumu ---
+# Cihaz açılışta tek bir /ws bağlantısı kurar ve hep açık tutar (src/ws_session.cpp).
+# Metin çerçeveleri JSON kontrol iletileridir, ikili çerçeveler sestir:
+#   cihaz -> sunucu: start {session, codec, rate, wake, format, dry}, ses çerçeveleri,
+#                    segment {session}, end {session, tail}, abort {session}
+#                    call {id, op, args}, cancel {id}
+#   sunucu -> cihaz: transcript {session, text, final}; final=false olanlar kayıt sürerken
+#                    kapanan bölütlerin o ana kadarki metnidir. error {session, message}
+#                    result {id, code, body}
+#                    reply_start {id, format, bytes[, session]}, ses çerçeveleri, reply_end {id}
+# Yanıt sesi ayrı bir GET beklemeden sentezlenir sentezlenmez aynı bağlantıdan akar.
+WS_AUDIO_FRAME = 4096   # yanıt sesi çerçevesi (config.h: WS_DOWNLINK_FRAME)
+
+class WsSession:
+    def __init__(self, ws):
+        self.ws = ws
+        self.send_lock = threading.Lock()
+        self.utterance = None
+        self.reply_ids = itertools.count(1)   # next() GIL altında atomiktir
+        self.cancelled = set()
+        self.device_cache = set()             # cihazın elinde tuttuğu yanıt anahtarları
+
+    def send_json(self, **msg):
+        with self.send_lock:
+            self.ws.send(json.dumps(msg, ensure_ascii=False))
+
+    def send_audio(self, data):
+        with self.send_lock:
+            self.ws.send(data)
+
+    def reply_url(self, fmt, pending):
+        """Sesi bu bağlantıdan akıtılacak bir yanıt adresi üretir: ws:<id>/<dosya>.
+        Dosya adı cihazın önbellek anahtarını taşır."""
+        def url_for(filename):
+            reply_id = next(self.reply_ids)
+            pending.append((reply_id, filename))
+            return f"ws:{reply_id}/{filename}"
+        return url_for
+
+    def stream_reply(self, reply_id, filename, session=None):
+        path = os.path.join(UPLOAD_FOLDER, filename)
+        fmt = os.path.splitext(filename)[1].lstrip(".")
+        size = os.path.getsize(path)
+        start = {"type": "reply_start", "id": reply_id, "format": fmt, "bytes": size, "name": filename}
+        if session:
+            start["session"] = session
+        if tts_etag(filename) in self.device_cache:
+            # HTTP'deki 304'ün karşılığı: cihaz sesi kendi önbelleğinden çalar
+            self.send_json(**start, not_modified=True)
+            self.send_json(type="reply_end", id=reply_id, bytes=0)
+            print(f"🔈 WS yanıtı {reply_id}: cihazın önbelleğinde ({filename})")
+            return
+        self.send_json(**start)
+        sent = 0
+        t0 = time.monotonic()
+        with open(path, "rb") as f:
+            while reply_id not in self.cancelled:
+                data = f.read(WS_AUDIO_FRAME)
+                if not data:
+                    break
+                self.send_audio(data)
+                sent += len(data)
+        self.send_json(type="reply_end", id=reply_id, bytes=sent)
+        print(f"🔈 WS yanıtı {reply_id}: {sent}/{size} bytes, {1000 * (time.monotonic() - t0):.0f} ms")
+
+    def on_start(self, msg):
+        self.drop_utterance()
+        session = str(msg.get("session", "")).lower()
+        if not SESSION_ID_RE.match(session):
+            self.send_json(type="error", session=session, message="Geçersiz oturum kimliği")
+            return
+        self.utterance = {
+            "session": session,
+            "codec": msg.get("codec", "pcm").lower(),
+            "rate": msg.get("rate", 16000) if msg.get("rate") in UPLOAD_RATES else 16000,
+            "wake": bool(msg.get("wake")),
+            "format": msg.get("format") if msg.get("format") in REPLY_FORMATS else "wav",
+            "dry": bool(msg.get("dry")),
+            "started": time.monotonic(),
+        }
+        pipeline = SegmentPipeline(
+            self.utterance["rate"],
+            None if self.utterance["dry"] else
+            lambda text: self.send_json(type="transcript", session=session, text=text, final=False))
+        if not sessions.open(session, pipeline):
+            self.utterance = None
+            self.send_json(type="error", session=session, message="Sunucu meşgul")
+            return
+        self.utterance["pipeline"] = pipeline
+        print(f"🆕 WS konuşması {session}: {self.utterance['codec']} @ {self.utterance['rate']} Hz")
+
+    def on_audio(self, data):
+        if self.utterance is None:
+            return
+        # Oturum zaman aşımıyla atıldıysa sonraki ses sessizce düşer, end hata alır
+        pipeline = sessions.get(self.utterance["session"])
+        if pipeline is not self.utterance["pipeline"]:
+            self.utterance = None
+            return
+        pipeline.write(decode_upload_chunk(data, self.utterance["codec"]))
+        sessions.account()
+
+    def on_segment(self, msg):
+        if self.utterance is not None and self.utterance["session"] == msg.get("session", ""):
+            self.utterance["pipeline"].cut()
+
+    def on_end(self, msg):
+        utt, self.utterance = self.utterance, None
+        if utt is None or utt["session"] != msg.get("session", "") or \
+                sessions.close(utt["session"]) is not utt["pipeline"]:
+            self.send_json(type="error", session=msg.get("session", ""), message="Aktif konuşma yok")
+            return
+        threading.Thread(target=self.finish_utterance, args=(utt, msg.get("tail", True)), daemon=True).start()
+
+    def on_abort(self, msg):
+        if self.utterance is not None and self.utterance["session"] == msg.get("session", ""):
+            print(f"🛑 WS konuşması {self.utterance['session']} cihaz tarafından bırakıldı")
+            self.drop_utterance()
+
+    def drop_utterance(self):
+        """Bitmemiş konuşmayı sonucunu beklemeden kapatır (abort, yeni start, bağlantı kopması)."""
+        utt, self.utterance = self.utterance, None
+        if utt is not None and sessions.close(utt["session"]) is utt["pipeline"]:
+            utt["pipeline"].close()
+
+    def finish_utterance(self, utt, tail):
+        session = utt["session"]
+        pipeline = utt["pipeline"]
+        try:
+            if utt["dry"]:
+                # Taşıma ölçümü (tools/uplink_bench.py): ASR/LLM çağrılmaz
+                pipeline.close()
+                self.send_json(type="transcript", session=session, text=f"DRY {pipeline.samples()} 0 0", final=True)
+                return
+            text = pipeline.finish(tail)
+            # Metin yanıt hazırlanmadan gider; cihaz komutlara hemen geçebilir
+            self.send_json(type="transcript", session=session, text=text, final=True)
+            if utt["wake"]:
+                return
+            reply = answer(text)
+            print("🔊 Ses sentezleniyor...")
+            filename = synthesize_reply(reply, "tr", utt["format"])
+            self.stream_reply(next(self.reply_ids), filename, session)
+        except Exception as e:
+            print(f"❌ WS konuşması {session} işlenemedi: {str(e)}")
+            self.send_json(type="error", session=session, message=str(e))
+
+    def on_call(self, msg):
+        """HTTP uç noktalarının karşılıkları; ses üretenlerin sesi sonuçtan hemen sonra akar."""
+        op = msg.get("op", "")
+        args = msg.get("args") or {}
+        fmt = args.get("format") if args.get("format") in REPLY_FORMATS else "wav"
+        args["format"] = fmt
+        pending = []
+        url_for = self.reply_url(fmt, pending)
+        try:
+            if op == "register_user":
+                body, code = register_user_op(args)
+            elif op == "check_user":
+                body, code = check_user_op(args)
+            elif op == "verify_user":
+                body, code = verify_user_op(args)
+            elif op == "last_login":
+                body, code = last_login_op(fmt, url_for)
+            elif op == "tts":
+                body, code = tts_op(args, url_for)
+            else:
+                body, code = {"error": f"Bilinmeyen işlem: {op}"}, 404
+        except Exception as e:
+            body, code = {"error": str(e)}, 500
+        self.send_json(type="result", id=msg.get("id", 0), code=code, body=body)
+        for reply_id, filename in pending:
+            self.stream_reply(reply_id, filename)
+
+def ws_session(ws):
+    print(f"🔌 WS oturumu açıldı: {request.remote_addr}")
+    s = WsSession(ws)
+    try:
+        while True:
+            data = ws.receive()
+            if data is None:
+                break
+            if isinstance(data, bytes):
+                s.on_audio(data)
+                continue
+            msg = json.loads(data)
+            kind = msg.get("type")
+            if kind == "start":
+                s.on_start(msg)
+            elif kind == "segment":
+                s.on_segment(msg)
+            elif kind == "end":
+                s.on_end(msg)
+            elif kind == "abort":
+                s.on_abort(msg)
+            elif kind == "call":
+                threading.Thread(target=s.on_call, args=(msg,), daemon=True).start()
+            elif kind == "cancel":
+                s.cancelled.add(msg.get("id"))
+            elif kind == "cache":
+                s.device_cache = set(msg.get("keys") or [])
+    finally:
+        s.drop_utterance()
+        print(f"🔌 WS oturumu kapandı: {request.remote_addr}")
+
+if sock is not None:
+    sock.route("/ws")(ws_session)
+
 @app.route("/upload", methods=["POST"])
 def upload():
     try:
@@ -105,211 +1077,64 @@ def upload():
         is_first_chunk = request.headers.get('X-First-Chunk', 'false').lower() == 'true'
         is_last_chunk = request.headers.get('X-Last-Chunk', 'false').lower() == 'true'
         is_wake_check = request.headers.get('X-Wake-Check', 'false').lower() == 'true'
-        session_id = request.headers.get('X-Session-ID', str(uuid.uuid4()))
+        is_segment_end = request.headers.get('X-Segment-End', 'false').lower() == 'true'
+        has_tail = request.headers.get('X-Tail-Speech', 'true').lower() == 'true'
+        session_id = request.headers.get('X-Session-ID', '').lower()
+        codec = request.headers.get('X-Audio-Codec', 'pcm').lower()
+        sample_rate = upload_sample_rate()
         
         print(f"Session ID: {session_id}")
         print(f"First Chunk: {is_first_chunk}")
         print(f"Last Chunk: {is_last_chunk}")
         print(f"Wake Check: {is_wake_check}")
+        print(f"Codec: {codec} @ {sample_rate} Hz")
         
         # Eğer JSON olarak sadece text geldiyse, TTS-only mod
         if request.is_json:
             data = request.get_json()
-            text = data.get("text", "").strip()
-            lang = data.get("lang", "tr")  # Varsayılan olarak Türkçe
-            if text:
-                file_id = str(uuid.uuid4())
-                mp3_path = os.path.join(UPLOAD_FOLDER, f"{file_id}.mp3")
-                wav_reply_path = os.path.join(UPLOAD_FOLDER, f"{file_id}_reply.wav")
-                try:
-                    gTTS(text, lang=lang).save(mp3_path)
-                    audio = AudioSegment.from_mp3(mp3_path)
-                    audio = audio.set_frame_rate(16000).set_channels(1).set_sample_width(2)
-                    raw_pcm = audio.raw_data
-                    with wave.open(wav_reply_path, "wb") as wf:
-                        wf.setnchannels(1)
-                        wf.setsampwidth(2)
-                        wf.setframerate(16000)
-                        wf.writeframes(raw_pcm)
-                    host = request.host_url.rstrip('/')
-                    url = f"{host}/audios/{os.path.basename(wav_reply_path)}"
-                    resp = make_response(url, 200)
-                    resp.headers["Content-Type"] = "text/plain"
-                    return resp
-                except Exception as e:
-                    return jsonify({"error": str(e)}), 500
+            if data.get("text", "").strip():
+                return http_result(*tts_op(data, audio_url))
         
+        if not SESSION_ID_RE.match(session_id):
+            return jsonify({"error": "Geçersiz oturum ID'si", "details": "X-Session-ID 32 onaltılık hane olmalı"}), 400
+
         # Yeni kayıt oturumu başlat
         if is_first_chunk:
+            if not sessions.open(session_id, SegmentPipeline(sample_rate)):
+                print(f"❌ Oturum tablosu dolu: {sessions.stats()}")
+                resp = jsonify({"error": "Sunucu meşgul", "details": f"En fazla {SESSION_MAX} kayıt oturumu"})
+                resp.status_code = 503
+                resp.headers["Retry-After"] = "1"
+                return resp
             print(f"🆕 Yeni kayıt oturumu başlatıldı: {session_id}")
-            active_recordings[session_id] = io.BytesIO()
-        
-        # Veriyi geçici bellekte biriktir
-        if session_id in active_recordings:
-            active_recordings[session_id].write(request.data)
-            current_size = active_recordings[session_id].tell()
-            print(f"📝 Chunk alındı. Toplam boyut: {current_size} bytes")
+
+        # Ses SESSION_SPOOL_BYTES'a kadar bellekte, sonrası geçici dosyada birikir
+        pipeline = sessions.get(session_id)
+        if pipeline is not None:
+            pcm = decode_upload_chunk(request.data, codec)
+            # PCM yüklemede ilk parça WAV başlığıyla gelir; başlık çözümlemede yeniden kurulur
+            if is_first_chunk and codec == "pcm" and pcm[:4] == b"RIFF":
+                pcm = pcm[WAV_HEADER_SIZE:]
+            pipeline.write(pcm)
+            sessions.account()
+            if is_segment_end:
+                pipeline.cut()
+            print(f"📝 Chunk alındı. Toplam boyut: {len(pipeline.pcm)} bytes")
             
             # Son chunk ise ses işlemeyi başlat
             if is_last_chunk:
                 print("🔄 Son chunk alındı, ses işleme başlıyor...")
-                wav_data = active_recordings[session_id].getvalue()
                 
-                # Geçici dosyaya kaydet
-                file_id = str(uuid.uuid4())
-                wav_path = os.path.join(UPLOAD_FOLDER, f"{file_id}.wav")
-                
-                print(f"💾 WAV dosyası kaydediliyor: {wav_path}")
-                with open(wav_path, "wb") as f:
-                    f.write(wav_data)
-                
-                print(f"WAV dosyası kaydedildi: {os.path.getsize(wav_path)} bytes")
-                
-                # Whisper API'ye gönder
-                print("🎯 Whisper API'ye gönderiliyor...")
-                headers = {"Authorization": f"Bearer {GROQ_API_KEY}"}
-                
-                with open(wav_path, "rb") as af:
-                    try:
-                        print("Whisper API isteği yapılıyor...")
-                        asr_res = requests.post(
-                            "https://api.groq.com/openai/v1/audio/transcriptions",
-                            headers=headers,
-                            files={"file": (os.path.basename(wav_path), af, "audio/wav")},
-                            data={
-                                "model": WHISPER_MODEL,
-                                "language": "tr",
-                                "response_format": "json"
-                            }
-                        )
-                        print(f"Whisper API yanıt kodu: {asr_res.status_code}")
-                        asr_res.raise_for_status()
-                        text = asr_res.json().get("text", "").strip()
-                        print(f"🗣️ Algılanan metin: {text}")
-                        
-                        # Wake word kontrolü ise sadece metni döndür
-                        if is_wake_check:
-                            print("Wake word kontrolü yapılıyor...")
-                            resp = make_response(text, 200)
-                            resp.headers["Content-Type"] = "text/plain"
-                            return resp
-                            
-                        # Normal asistan işlemine devam et
-                        print("📝 Sorgu tipi belirleniyor...")
-                        is_log_query, id_match = is_log_related_query(text)
-                        
-                        if is_log_query:
-                            print("📊 Log ile ilgili soru tespit edildi")
-                            
-                            # ID sorgusu ise direkt bilgiyi al
-                            if id_match:
-                                print(f"🔍 ID sorgusu tespit edildi: {id_match}")
-                                user_info = get_user_info_by_id(id_match)
-                                reply = user_info
-                                print(f"💡 Kullanıcı bilgisi: {reply}")
-                            else:
-                                context = get_log_context()
-                                system_prompt = """Sen bir akıllı asistansın. Sana verilen giriş-çıkış kayıtlarını kullanarak soruları yanıtlayacaksın.
-                                Yanıtlarını her zaman Türkçe ve doğal bir dille ver. Teknik detaylardan kaçın, sade ve anlaşılır ol.
-                                Eğer soruyu anlamadıysan veya kayıtlarda yeterli bilgi yoksa, bunu nazikçe belirt."""
-                                messages = [
-                                    {"role": "system", "content": system_prompt},
-                                    {"role": "user", "content": context},
-                                    {"role": "user", "content": text}
-                                ]
-                                
-                                print("🤖 LLM API'ye gönderiliyor...")
-                                try:
-                                    chat_res = requests.post(
-                                        "https://api.groq.com/openai/v1/chat/completions",
-                                        headers=headers,
-                                        json={
-                                            "model": CHAT_MODEL,
-                                            "messages": messages,
-                                            "temperature": 0.7
-                                        }
-                                    )
-                                    print(f"LLM API yanıt kodu: {chat_res.status_code}")
-                                    chat_res.raise_for_status()
-                                    reply = chat_res.json()["choices"][0]["message"]["content"].strip()
-                                    print(f"💡 LLM yanıtı: {reply}")
-                                except Exception as e:
-                                    print(f"❌ LLM API hatası: {str(e)}")
-                                    print(f"Yanıt: {chat_res.text if 'chat_res' in locals() else 'Yanıt yok'}")
-                                    raise
-                        else:
-                            print("💭 Genel bir soru tespit edildi")
-                            system_prompt = """Sen yardımcı bir asistansın. Kullanıcıların her türlü sorusuna yardımcı olabilirsin.
-                            Yanıtlarını her zaman Türkçe ve doğal bir dille ver. Bilmediğin konularda dürüst ol.
-                            Güncel olaylar, hava durumu, genel bilgi ve benzeri her konuda yardımcı olmaya çalış."""
-                            messages = [
-                                {"role": "system", "content": system_prompt},
-                                {"role": "user", "content": text}
-                            ]
-                            
-                            print("🤖 LLM API'ye gönderiliyor...")
-                            try:
-                                chat_res = requests.post(
-                                    "https://api.groq.com/openai/v1/chat/completions",
-                                    headers=headers,
-                                    json={
-                                        "model": CHAT_MODEL,
-                                        "messages": messages,
-                                        "temperature": 0.7
-                                    }
-                                )
-                                print(f"LLM API yanıt kodu: {chat_res.status_code}")
-                                chat_res.raise_for_status()
-                                reply = chat_res.json()["choices"][0]["message"]["content"].strip()
-                                print(f"💡 LLM yanıtı: {reply}")
-                            except Exception as e:
-                                print(f"❌ LLM API hatası: {str(e)}")
-                                print(f"Yanıt: {chat_res.text if 'chat_res' in locals() else 'Yanıt yok'}")
-                                raise
-
-                        print(f"🗣️ Kullanıcı sorusu: {text}")
-                    except Exception as e:
-                        print(f"❌ Whisper API hatası: {str(e)}")
-                        print(f"Yanıt: {asr_res.text if 'asr_res' in locals() else 'Yanıt yok'}")
-                        raise
-
-                # gTTS → MP3 → kesin PCM WAV
-                print("🔊 Ses sentezleniyor...")
-                mp3_path = os.path.join(UPLOAD_FOLDER, f"{file_id}.mp3")
-                wav_reply_path = os.path.join(UPLOAD_FOLDER, f"{file_id}_reply.wav")
-                
-                try:
-                    print("gTTS ile MP3 oluşturuluyor...")
-                    gTTS(reply, lang="tr").save(mp3_path)
-                    print(f"MP3 kaydedildi: {mp3_path}")
-
-                    # pydub ile MP3'ü decode edip raw PCM veriye dönüştür
-                    print("MP3'ten WAV'a dönüştürülüyor...")
-                    audio = AudioSegment.from_mp3(mp3_path)
-                    audio = audio.set_frame_rate(16000).set_channels(1).set_sample_width(2)
-                    raw_pcm = audio.raw_data
-
-                    # wave modülü ile baştan oluşturulan header + PCM
-                    with wave.open(wav_reply_path, "wb") as wf:
-                        wf.setnchannels(1)         # mono
-                        wf.setsampwidth(2)         # 16 bit = 2 byte
-                        wf.setframerate(16000)     # 16 kHz
-                        wf.writeframes(raw_pcm)
-
-                    print(f"✅ Yanıt WAV kaydedildi: {wav_reply_path}")
-                    print(f"WAV boyutu: {os.path.getsize(wav_reply_path)} bytes")
-                except Exception as e:
-                    print(f"❌ Ses sentezleme hatası: {str(e)}")
-                    raise
-
                 # Oturum verilerini temizle
-                del active_recordings[session_id]
-                
-                # URL'i dön
-                host = request.host_url.rstrip('/')
-                url = f"{host}/audios/{os.path.basename(wav_reply_path)}"
-                print(f"🔗 Dönülen URL: {url}")
-                resp = make_response(url, 200)
+                sessions.close(session_id)
+
+                if request.headers.get('X-Dry-Run', 'false').lower() == 'true':
+                    # Taşıma ölçümü (tools/uplink_bench.py): ASR/LLM çağrılmaz
+                    pipeline.close()
+                    result = f"DRY {pipeline.samples()} 0 0"
+                else:
+                    result = process_text(pipeline.finish(has_tail), is_wake_check, requested_reply_format())
+                resp = make_response(result, 200)
                 resp.headers["Content-Type"] = "text/plain"
                 return resp
             
@@ -330,31 +1155,116 @@ def upload():
         print(f"Stack trace:\n{traceback.format_exc()}")
         
         # Hata durumunda oturum verilerini temizle
-        if 'session_id' in locals() and session_id in active_recordings:
-            del active_recordings[session_id]
+        if 'session_id' in locals():
+            pipeline = sessions.close(session_id)
+            if pipeline is not None:
+                pipeline.close()
             
         return jsonify({
             "error": "İşlem sırasında bir hata oluştu",
             "details": str(e)
         }), 500
 
+# Cihaz kaydı son parçayı göndermeden bıraktığında oturumu açıkça kapatır
+@app.route("/upload/<session_id>", methods=["DELETE"])
+def abort_upload(session_id):
+    pipeline = sessions.close(session_id.lower())
+    if pipeline is None:
+        return make_response("", 404)
+    pipeline.close()
+    print(f"🛑 Kayıt oturumu cihaz tarafından bırakıldı: {session_id}")
+    return make_response("", 204)
+
+# --- Cihaz metrikleri ---
+# Kapılar METRICS_PUSH_MS ayarlıysa Prometheus metnini buraya POST eder
+# (include/metrics.h); GET /metrics hepsini door etiketiyle tek metinde sunar.
+# Son gönderimden METRICS_STALE_S sonra kapı listeden düşer. Kapılar
+# X-Door-ID (MAC) ile ayrılır; METRICS_TOKEN ortam değişkeni verilmişse
+# gönderim aynı değeri Authorization: Bearer ile taşımalıdır (config.h: METRICS_PUSH_TOKEN).
+METRICS_STALE_S = 300
+METRICS_TOKEN = os.environ.get("METRICS_TOKEN", "")
+DOOR_ID_RE = re.compile(r"^[0-9A-Za-z_-]{1,32}$")   # etiket değerine kaçışsız yazılır
+door_metrics = {}   # kapı kimliği -> (zaman, metin)
+door_metrics_lock = threading.Lock()
+
+def merge_door_metrics(doors):
+    """Aynı adın satırları bir arada kalacak şekilde kapıların metnini birleştirir."""
+    families = {}   # TYPE satırı -> örnek satırları; ekleme sırası korunur
+    for door, text in doors:
+        family = None
+        for line in text.splitlines():
+            if line.startswith("# TYPE "):
+                family = families.setdefault(line, [])
+                continue
+            if not line or line.startswith("#") or family is None:
+                continue
+            name, _, value = line.rpartition(" ")
+            name = name[:-1] + f',door="{door}"}}' if name.endswith("}") else name + f'{{door="{door}"}}'
+            family.append(f"{name} {value}")
+    out = []
+    for type_line, samples in families.items():
+        out.append(type_line)
+        out.extend(samples)
+    return "\n".join(out) + "\n"
+
+@app.route("/metrics", methods=["GET", "POST"])
+def metrics():
+    now = time.time()
+    if request.method == "POST":
+        auth = request.headers.get("Authorization", "")
+        if METRICS_TOKEN and not hmac.compare_digest(auth, f"Bearer {METRICS_TOKEN}"):
+            return make_response("", 401)
+        door = request.headers.get("X-Door-ID", "")
+        if not DOOR_ID_RE.match(door):
+            return make_response("X-Door-ID eksik veya geçersiz", 400)
+        text = request.get_data(as_text=True)
+        with door_metrics_lock:
+            door_metrics[door] = (now, text)
+        return make_response("", 204)
+    with door_metrics_lock:
+        for door in [d for d, (t, _) in door_metrics.items() if now - t > METRICS_STALE_S]:
+            del door_metrics[door]
+        doors = [(d, text) for d, (_, text) in sorted(door_metrics.items())]
+    resp = make_response(merge_door_metrics(doors), 200)
+    resp.headers["Content-Type"] = "text/plain; version=0.0.4"
+    return resp
+
+@app.route("/capabilities", methods=["GET"])
+def capabilities():
+    return jsonify({
+        "upload_rates": list(UPLOAD_RATES),
+        "reply_formats": list(REPLY_FORMATS),
+        "reply_rate": "native",   # wav yanıtlar gTTS'in kendi hızında
+        "reply_cache": TTS_CACHE_VERSION,   # yanıt adları tts-<anahtar>.<format>
+    }), 200
+
 @app.route("/audios/<filename>")
 def serve_audio(filename):
-    return send_from_directory(UPLOAD_FOLDER, filename)
+    # Flask göreli dizini uygulamanın kök dizinine göre çözer; dosyalar çalışma dizinine yazılıyor
+    folder = os.path.abspath(UPLOAD_FOLDER)
+    key = tts_etag(filename)
+    if key is None:
+        return send_from_directory(folder, filename)
+    # İçerik adresli: değişmez, ETag anahtarın kendisi; eşleşen If-None-Match 304 alır
+    resp = send_from_directory(folder, filename, etag=key, max_age=365 * 24 * 3600)
+    resp.cache_control.immutable = True
+    return resp
 
 
 
-@app.route("/register_user", methods=["POST"])
-def register_user():
+# --- Kullanıcı işlemleri ---
+# HTTP uç noktaları ve WebSocket "call" iletileri aynı işlevleri kullanır. Her biri
+# (gövde, durum kodu) döndürür; ses üretenler yanıtın adresini reply_url ile kurar.
+
+def register_user_op(data):
     try:
-        data = request.get_json()
         print(f"[DEBUG] Gelen kayıt isteği: {data}")  # 🔍 debug log
 
         name = data.get("name", "").strip()
         password = data.get("password", "").strip()
 
         if not name or not password:
-            return jsonify({"status": "error", "message": "İsim ve şifre zorunlu."}), 400
+            return {"status": "error", "message": "İsim ve şifre zorunlu."}, 400
 
         users_file = "users.csv"
 
@@ -379,16 +1289,13 @@ def register_user():
         # Güncellenmiş CSV'yi kaydet
         df.to_csv(users_file, index=False)
 
-        return jsonify({"status": "success", "message": message, "name": name}), 200
+        return {"status": "success", "message": message, "name": name}, 200
 
     except Exception as e:
-        return jsonify({"status": "error", "message": str(e)}), 500
+        return {"status": "error", "message": str(e)}, 500
 
-
-@app.route("/check_user", methods=["POST"])
-def check_user():
+def check_user_op(data):
     try:
-        data = request.get_json()
         name = data.get("name", "").strip()
         users_file = "users.csv"
         if not name or not os.path.exists(users_file):
@@ -401,17 +1308,15 @@ def check_user():
     except Exception as e:
         return "NOT_FOUND", 200
 
-@app.route("/verify_user", methods=["POST"])
-def verify_user():
+def verify_user_op(data):
     try:
-        data = request.get_json()
         name = data.get("name", "").strip()
         password = data.get("password", "").strip()
         if not name or not password:
-            return jsonify({"status": "error", "message": "İsim ve şifre zorunlu."}), 400
+            return {"status": "error", "message": "İsim ve şifre zorunlu."}, 400
         users_file = "users.csv"
         if not os.path.exists(users_file):
-            return jsonify({"status": "error", "message": "Kullanıcı bulunamadı."}), 400
+            return {"status": "error", "message": "Kullanıcı bulunamadı."}, 400
         df = pd.read_csv(users_file)
         df["Password"] = df["Password"].astype(str).str.strip()
         match = df[(df["Name"] == name) & (df["Password"] == password)]
@@ -424,52 +1329,76 @@ def verify_user():
                 log_df.to_csv(log_file, index=False)
             else:
                 log_df.to_csv(log_file, mode='a', header=False, index=False)
-            return jsonify({"status": "success", "message": "Giriş başarılı.", "name": name}), 200
+            return {"status": "success", "message": "Giriş başarılı.", "name": name}, 200
         else:
-            return jsonify({"status": "error", "message": "Şifre yanlış veya kullanıcı yok."}), 401
+            return {"status": "error", "message": "Şifre yanlış veya kullanıcı yok."}, 401
     except Exception as e:
-        return jsonify({"status": "error", "message": str(e)}), 500
+        return {"status": "error", "message": str(e)}, 500
 
-@app.route("/last_login", methods=["GET"])
-def last_login():
+def last_login_op(fmt, reply_url):
     log_file = "access_logs.csv"
     if not os.path.exists(log_file):
-        return jsonify({"message": "Kayıt yok"}), 200
+        return {"message": "Kayıt yok"}, 200
     try:
         df = pd.read_csv(log_file)
         if df.empty:
-            return jsonify({"message": "Kayıt yok"}), 200
+            return {"message": "Kayıt yok"}, 200
 
         last_name = df.iloc[-1]["Name"]
         tts_text = f"Son giriş yapan kişi: {last_name}"
 
         # Sesli yanıt üret
-        file_id = str(uuid.uuid4())
-        mp3_path = os.path.join(UPLOAD_FOLDER, f"{file_id}.mp3")
-        wav_path = os.path.join(UPLOAD_FOLDER, f"{file_id}_reply.wav")
         try:
-            gTTS(tts_text, lang="tr").save(mp3_path)
-            audio = AudioSegment.from_mp3(mp3_path)
-            audio = audio.set_frame_rate(16000).set_channels(1).set_sample_width(2)
-            with wave.open(wav_path, "wb") as wf:
-                wf.setnchannels(1)
-                wf.setsampwidth(2)
-                wf.setframerate(16000)
-                wf.writeframes(audio.raw_data)
-            host = request.host_url.rstrip('/')
-            url = f"{host}/audios/{os.path.basename(wav_path)}"
-
-            return jsonify({
+            filename = synthesize_reply(tts_text, "tr", fmt)
+            return {
                 "name": last_name,
-                "url": url
-            }), 200
+                "url": reply_url(filename)
+            }, 200
         except Exception as e:
             print(f"Ses sentezleme hatası: {str(e)}")
-            return jsonify({"name": last_name}), 200
+            return {"name": last_name}, 200
+    except Exception as e:
+        return {"message": f"Hata: {str(e)}"}, 500
+
+def tts_op(data, reply_url):
+    text = data.get("text", "").strip()
+    lang = data.get("lang", "tr")  # Varsayılan olarak Türkçe
+    try:
+        filename = synthesize_reply(text, lang, requested_reply_format(data))
+        return reply_url(filename), 200
     except Exception as e:
-        return jsonify({"message": f"Hata: {str(e)}"}), 500
+        return {"error": str(e)}, 500
+
+def http_result(body, code):
+    if isinstance(body, dict):
+        return jsonify(body), code
+    resp = make_response(body, code)
+    resp.headers["Content-Type"] = "text/plain"
+    return resp
+
+@app.route("/register_user", methods=["POST"])
+def register_user():
+    return http_result(*register_user_op(request.get_json()))
+
+@app.route("/check_user", methods=["POST"])
+def check_user():
+    return http_result(*check_user_op(request.get_json()))
+
+@app.route("/verify_user", methods=["POST"])
+def verify_user():
+    return http_result(*verify_user_op(request.get_json()))
+
+@app.route("/last_login", methods=["GET"])
+def last_login():
+    return http_result(*last_login_op(requested_reply_format(), audio_url))
 
     
 if __name__ == "__main__":
     print(f"Server starting on http://{SERVER_IP}:{SERVER_PORT}")
-    app.run(host="0.0.0.0", port=SERVER_PORT, debug=True)
\ No newline at end of file
+    if sock is None:
+        print("⚠️ flask-sock kurulu değil: /ws kapalı, cihazlar HTTP kullanır (pip install -r requirements.txt)")
+    # Hata ayıklama modunda yeniden yükleyici sunucuyu alt süreçte çalıştırır; UDP yalnızca orada açılır
+    if not DEBUG or os.environ.get("WERKZEUG_RUN_MAIN") == "true":
+        start_udp_receiver()
+        start_session_reaper()
+    app.run(host="0.0.0.0", port=SERVER_PORT, debug=DEBUG)
\ No newline at end of file
@@ -0,0 +1,114 @@
+// aec.cpp
+#include "aec.h"
+#include <math.h>
+#include <string.h>
+
+static inline int16_t sat16(int32_t v) {
+  if (v > 32767) return 32767;
+  if (v < -32768) return -32768;
+  return (int16_t)v;
+}
+
+void aec_init(AecState* st, float mu) {
+  memset(st, 0, sizeof(*st));
+  st->mu_q15 = (int32_t)lroundf(mu * 32768.0f);
+  st->converge_left = AEC_CONVERGE;
+}
+
+void aec_clear_history(AecState* st) {
+  memset(st->x, 0, sizeof(st->x));
+  st->pos = 0;
+  st->x_energy = 0;
+  st->max_x = 0;
+}
+
+void aec_reset_stats(AecState* st) {
+  st->sum_d2 = 0;
+  st->sum_e2 = 0;
+  st->active_samples = 0;
+  st->dt_samples = 0;
+}
+
+// Pencere başına bir tarama yerine 16 örnekte bir: örnek başına ~32 işlem
+static void scan_window(AecState* st) {
+  const int16_t* xv = st->x + st->pos;
+  int32_t max_x = 0;
+  int64_t norm = 0;
+  for (int k = 0; k < AEC_TAPS; k++) {
+    int32_t a = xv[k] < 0 ? -xv[k] : xv[k];
+    if (a > max_x) max_x = a;
+    norm += st->w[k] < 0 ? -(int64_t)st->w[k] : st->w[k];
+  }
+  st->max_x = max_x;
+  st->w_norm_q12 = (int32_t)(norm >> 18);
+}
+
+void aec_process(AecState* st, int16_t* mic, const int16_t* ref, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    // Referans geçmişi iki kez yazılır; pencere her zaman bitişik kalır
+    int32_t old = st->x[st->pos + AEC_TAPS - 1];
+    st->pos = st->pos == 0 ? AEC_TAPS - 1 : st->pos - 1;
+    st->x[st->pos] = ref[i];
+    st->x[st->pos + AEC_TAPS] = ref[i];
+    st->x_energy += (int64_t)ref[i] * ref[i] - (int64_t)old * old;
+    int32_t ar = ref[i] < 0 ? -ref[i] : ref[i];
+    if (ar > st->max_x) st->max_x = ar;
+    if (++st->since_scan >= 16) {
+      st->since_scan = 0;
+      scan_window(st);
+    }
+
+    const int16_t* xv = st->x + st->pos;
+
+    // Süzgeç Q15 katsayılarla 32 bitte; ara toplamlar taşsa da sonuç
+    // (|y| < 2^16) modüler aritmetikte doğrudur
+    uint32_t acc = 0;
+    for (int k = 0; k < AEC_TAPS; k++) {
+      acc += (uint32_t)((st->w[k] >> 15) * (int32_t)xv[k]);
+    }
+    int32_t y = (int32_t)acc >> 15;
+    int32_t d = mic[i];
+    int32_t e = d - y;
+    mic[i] = sat16(e);
+
+    if (st->x_energy <= 0) continue;   // referans yok: ne uyarlama ne istatistik
+
+    // Geigel: yakın konuşma, yankı yolunun izin verdiğinden güçlü mikrofon sinyalidir
+    int32_t ad = d < 0 ? -d : d;
+    if (st->converge_left > 0) {
+      st->converge_left--;
+    } else {
+      int64_t bound = ((int64_t)st->max_x * st->w_norm_q12 * AEC_GEIGEL_MARGIN) >> 12;
+      if (ad > bound) st->dt_hold = AEC_DT_HANGOVER;
+    }
+
+    st->active_samples++;
+    if (st->dt_hold > 0) {
+      st->dt_hold--;
+      st->dt_samples++;
+      continue;
+    }
+    // ERLE yalnızca yankının tek başına olduğu örneklerde ölçülür
+    st->sum_d2 += (uint64_t)((int64_t)d * d);
+    st->sum_e2 += (uint64_t)((int64_t)e * e);
+
+    // NLMS: w += mu * e * x / (|x|^2 + delta), adım Q30'da; |g * x| 32 bite sığsın diye sınırlı
+    int64_t g = ((int64_t)st->mu_q15 * e * 32768) / (st->x_energy + AEC_DELTA);
+    if (g > 65535) g = 65535;
+    if (g < -65535) g = -65535;
+    int32_t g32 = (int32_t)g;
+    for (int k = 0; k < AEC_TAPS; k++) {
+      st->w[k] += g32 * xv[k];
+    }
+  }
+}
+
+float aec_erle_db(const AecState* st) {
+  if (st->sum_e2 == 0 || st->sum_d2 == 0) return 0.0f;
+  return 10.0f * log10f((float)st->sum_d2 / (float)st->sum_e2);
+}
+
+float aec_double_talk_ratio(const AecState* st) {
+  if (st->active_samples == 0) return 0.0f;
+  return (float)st->dt_samples / (float)st->active_samples;
+}
@@ -0,0 +1,252 @@
+// audio_capture.cpp
+#include "audio_capture.h"
+#include "audio_handler.h"
+#include "mic_frontend.h"
+#include "mem_policy.h"
+#include "aec.h"
+#include "resampler.h"
+#include "esp_timer.h"
+#include "log.h"
+
+// Görev her seferinde bir DMA tamponu okur; blok SAMPLE_RATE'e dönüştürülünce
+// bir örnek fazla çıkabilir
+#define CAPTURE_RAW_FRAMES   (MIC_I2S_RATE * I2S_DMA_BUF_MS / 1000)
+#define CAPTURE_BLOCK_FRAMES (SAMPLE_RATE * I2S_DMA_BUF_MS / 1000 + 1)
+
+static int16_t* ring = NULL;
+static uint32_t ring_samples = 0;
+static uint32_t ring_mask = 0;
+static volatile uint32_t write_pos = 0;
+static volatile uint32_t valid_from = 0;   // bundan eski örnekler okuyuculara verilmez
+static volatile bool paused = false;
+static TaskHandle_t capture_task = NULL;
+static MicFrontend fe;
+static int32_t raw_block[CAPTURE_RAW_FRAMES];
+static Resampler mic_rs;
+
+// Hoparlör referansı, mikrofon örnek sırasıyla aynı eksende tutulur: ref_ring'de
+// i konumundaki örnek, mikrofonun i. örneğiyle aynı anda DAC'tan çıkmıştır.
+// Eşleme, her okumadan sonra kaydedilen (örnek sırası, zaman) çiftiyle yapılır.
+#define AEC_REF_RING  (1u << AEC_REF_RING_LOG2)
+#define AEC_REF_MASK  (AEC_REF_RING - 1)
+
+static int16_t ref_ring[AEC_REF_RING];
+static uint32_t ref_write_pos = 0;     // bir sonraki referans örneğinin mikrofon sırası
+static uint32_t ref_valid_from = 0;
+static bool ref_synced = false;
+static uint32_t anchor_pos = 0;        // son okunan bloğun sonu
+static int64_t anchor_us = 0;          // ve o bloğun DMA'dan alındığı an
+static portMUX_TYPE ref_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static AecState aec;
+static bool aec_running = false;
+static int16_t ref_block[CAPTURE_BLOCK_FRAMES];
+
+static int16_t ref_at(uint32_t idx, uint32_t from, uint32_t rw) {
+  if ((int32_t)(idx - from) < 0 || (int32_t)(idx - rw) >= 0) return 0;
+  if ((int32_t)(rw - idx) > (int32_t)AEC_REF_RING) return 0;
+  return ref_ring[idx & AEC_REF_MASK];
+}
+
+// Referans yalnızca hoparlör çalarken vardır; çalma bitince ERLE hata ayıklama
+// düzeyinde kaydedilir (LOG_* halkaya yazar, yakalama görevi beklemez)
+static void echo_cancel(int16_t* pcm, size_t n, uint32_t w) {
+  portENTER_CRITICAL(&ref_mux);
+  uint32_t from = ref_valid_from;
+  uint32_t rw = ref_write_pos;
+  bool live = ref_synced && (int32_t)(rw - (w - AEC_TAPS)) > 0;
+  portEXIT_CRITICAL(&ref_mux);
+
+  if (!live) {
+    if (aec_running) {
+      aec_running = false;
+      LOG_D("🔇 Yankı giderme: ERLE %.1f dB, çift konuşma %%%.0f",
+            aec_erle_db(&aec), aec_double_talk_ratio(&aec) * 100.0f);
+      portENTER_CRITICAL(&ref_mux);
+      ref_synced = false;
+      portEXIT_CRITICAL(&ref_mux);
+    }
+    return;
+  }
+  if (!aec_running) {
+    // Katsayılar yanıtlar arasında korunur; hoparlör-mikrofon yolu değişmez
+    aec_running = true;
+    aec_clear_history(&aec);
+    aec_reset_stats(&aec);
+  }
+  for (size_t i = 0; i < n; i++) {
+    ref_block[i] = ref_at(w + i + AEC_REF_LEAD, from, rw);
+  }
+  aec_process(&aec, pcm, ref_block, n);
+}
+
+static void capture_loop(void* arg) {
+  for (;;) {
+    size_t bytes_read = 0;
+    if (i2s_mic_read(raw_block, sizeof(raw_block), &bytes_read) != ESP_OK || bytes_read == 0) continue;
+    int64_t now_us = esp_timer_get_time();
+    // 32 bit ham örnekler aynı tamponda 16 bit PCM'e sıkıştırılır, sonra yerinde SAMPLE_RATE'e indirilir
+    size_t n = mic_frontend_process(&fe, raw_block, bytes_read / 4) / 2;
+    int16_t* pcm = (int16_t*)raw_block;
+#if MIC_I2S_RATE != SAMPLE_RATE
+    n = resampler_process(&mic_rs, pcm, n, pcm);
+#endif
+
+    uint32_t w = write_pos;
+    portENTER_CRITICAL(&ref_mux);
+    anchor_pos = w + n;
+    anchor_us = now_us;
+    portEXIT_CRITICAL(&ref_mux);
+#if AEC_ENABLED
+    echo_cancel(pcm, n, w);
+#endif
+
+    uint32_t off = w & ring_mask;
+    size_t first = n < ring_samples - off ? n : ring_samples - off;
+    memcpy(ring + off, pcm, first * 2);
+    if (n > first) memcpy(ring, pcm + first, (n - first) * 2);
+    __atomic_store_n(&write_pos, w + n, __ATOMIC_RELEASE);
+
+    // Sınır halkanın gerisinde kalırsa öne çekilir; sayaç taşsa da karşılaştırmalar doğru kalır
+    uint32_t v = valid_from;
+    uint32_t floor = w + n - ring_samples;
+    if ((int32_t)(v - floor) < 0 && w + n >= ring_samples) {
+      __atomic_compare_exchange_n(&valid_from, &v, floor, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+bool capture_start() {
+  if (capture_task != NULL) return true;
+
+  ring_samples = 1u << CAPTURE_RING_LOG2;
+  ring = (int16_t*)mem_alloc(ring_samples * sizeof(int16_t), MEM_POOL_PSRAM, "capture_ring");
+  if (ring == NULL) {
+    // PSRAM yoksa dahili RAM'e sığan en büyük halka; ön kayıt için yine yeterli
+    while (ring_samples * sizeof(int16_t) > MEM_INTERNAL_FALLBACK_MAX) ring_samples >>= 1;
+    ring = (int16_t*)mem_alloc(ring_samples * sizeof(int16_t), MEM_POOL_INTERNAL, "capture_ring");
+  }
+  if (ring == NULL) return false;
+  ring_mask = ring_samples - 1;
+
+  mic_frontend_init(&fe, MIC_I2S_RATE);
+#if MIC_I2S_RATE != SAMPLE_RATE
+  resampler_init(&mic_rs, MIC_I2S_RATE, SAMPLE_RATE);
+#endif
+  aec_init(&aec, AEC_MU);
+  i2s_record_init();
+  xTaskCreate(capture_loop, "mic_cap", 4096, nullptr, configMAX_PRIORITIES - 3, &capture_task);
+  LOG_I("🎙️ Sürekli kayıt: %u ms halka, %u ms ön kayıt",
+        (unsigned)(ring_samples * 1000ULL / SAMPLE_RATE), CAPTURE_PREROLL_MS);
+  return true;
+}
+
+void capture_pause() {
+  if (capture_task == NULL || paused) return;
+  paused = true;
+  i2s_stop(MIC_I2S_PORT);
+}
+
+void capture_resume() {
+  if (capture_task == NULL || !paused) return;
+  i2s_start(MIC_I2S_PORT);
+  // DMA kuyruğunda durmadan önceki bloklar kalmış olabilir; onlar da atlanır
+  I2sStats s;
+  i2s_get_stats(&s);
+  valid_from = write_pos + (uint32_t)((uint64_t)s.rx_buf_count * s.rx_buf_frames * SAMPLE_RATE / MIC_I2S_RATE);
+  paused = false;
+}
+
+void capture_mark_boundary() {
+  valid_from = write_pos;
+}
+
+void capture_hold_gain(bool hold) {
+  fe.hold = hold;
+}
+
+uint32_t capture_position() {
+  return __atomic_load_n(&write_pos, __ATOMIC_ACQUIRE);
+}
+
+// Yazıcının o an üzerine yazdığı blok da okunmaz
+static uint32_t oldest_valid(uint32_t w) {
+  uint32_t oldest = w - (ring_samples - CAPTURE_BLOCK_FRAMES);
+  uint32_t v = valid_from;
+  return (int32_t)(v - oldest) > 0 ? v : oldest;
+}
+
+static void clamp_reader(CaptureReader* r, uint32_t w) {
+  uint32_t oldest = oldest_valid(w);
+  if ((int32_t)(r->pos - oldest) < 0) {
+    r->dropped += oldest - r->pos;
+    r->pos = oldest;
+  }
+}
+
+void capture_open(CaptureReader* r, uint32_t preroll_ms) {
+  uint32_t w = capture_position();
+  r->pos = w - (uint32_t)((uint64_t)SAMPLE_RATE * preroll_ms / 1000);
+  r->dropped = 0;
+  uint32_t oldest = oldest_valid(w);
+  if ((int32_t)(r->pos - oldest) < 0) r->pos = oldest;
+}
+
+void capture_rewind(CaptureReader* r, uint32_t ms) {
+  uint32_t w = capture_position();
+  r->pos -= (uint32_t)((uint64_t)SAMPLE_RATE * ms / 1000);
+  uint32_t oldest = oldest_valid(w);
+  if ((int32_t)(r->pos - oldest) < 0) r->pos = oldest;
+}
+
+void capture_seek(CaptureReader* r, uint32_t pos) {
+  uint32_t w = capture_position();
+  r->pos = pos;
+  if ((int32_t)(r->pos - w) > 0) r->pos = w;
+  uint32_t oldest = oldest_valid(w);
+  if ((int32_t)(r->pos - oldest) < 0) r->pos = oldest;
+}
+
+size_t capture_read(CaptureReader* r, int16_t* dst, size_t max_samples, uint32_t timeout_ms) {
+  uint32_t start = millis();
+  for (;;) {
+    uint32_t w = capture_position();
+    clamp_reader(r, w);
+    int32_t avail = (int32_t)(w - r->pos);
+    if (avail > 0) {
+      size_t n = (size_t)avail < max_samples ? (size_t)avail : max_samples;
+      uint32_t off = r->pos & ring_mask;
+      size_t first = n < ring_samples - off ? n : ring_samples - off;
+      memcpy(dst, ring + off, first * 2);
+      if (n > first) memcpy(dst + first, ring, (n - first) * 2);
+      r->pos += n;
+      return n;
+    }
+    if (millis() - start >= timeout_ms) return 0;
+    vTaskDelay(pdMS_TO_TICKS(I2S_DMA_BUF_MS / 2));
+  }
+}
+
+// Çalma görevi her blok için DAC'tan çıkacağı anı verir. Küçük saat
+// dalgalanmaları yok sayılır ki referans kesintisiz kalsın; kayma
+// AEC_REF_RESYNC'i aşarsa (ilk blok, DMA boşluğu) yeniden hizalanır.
+void capture_push_reference(const int16_t* pcm, size_t n, int64_t play_us) {
+  if (capture_task == NULL || n == 0) return;
+  portENTER_CRITICAL(&ref_mux);
+  int64_t delta = (play_us - anchor_us) * SAMPLE_RATE / 1000000;
+  uint32_t target = anchor_pos + (uint32_t)(int32_t)delta;
+  uint32_t rw = ref_write_pos;
+  int32_t drift = (int32_t)(target - rw);
+  if (!ref_synced || drift > AEC_REF_RESYNC || drift < -AEC_REF_RESYNC) {
+    rw = target;
+    ref_valid_from = target;
+    ref_synced = true;
+  } else if (drift > 0) {
+    // Küçük boşlukta hoparlör sessizdi
+    for (int32_t i = 0; i < drift; i++) ref_ring[(rw + i) & AEC_REF_MASK] = 0;
+    rw += drift;
+  }
+  for (size_t i = 0; i < n; i++) ref_ring[(rw + i) & AEC_REF_MASK] = pcm[i];
+  ref_write_pos = rw + n;
+  portEXIT_CRITICAL(&ref_mux);
+}
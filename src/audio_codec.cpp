@@ -0,0 +1,75 @@
+// audio_codec.cpp
+#include "audio_codec.h"
+#include "config.h"
+
+static const int16_t step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static const int8_t index_table[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+void adpcm_reset(AdpcmState* st) {
+  st->predictor = 0;
+  st->index = 0;
+}
+
+static inline uint8_t adpcm_encode_sample(AdpcmState* st, int16_t sample) {
+  int step = step_table[st->index];
+  int diff = sample - st->predictor;
+  uint8_t code = 0;
+  if (diff < 0) {
+    code = 8;
+    diff = -diff;
+  }
+  // Çözücüyle aynı yuvarlamayı kullan, yoksa öngörü kayar
+  int delta = step >> 3;
+  if (diff >= step) { code |= 4; diff -= step; delta += step; }
+  step >>= 1;
+  if (diff >= step) { code |= 2; diff -= step; delta += step; }
+  step >>= 1;
+  if (diff >= step) { code |= 1; delta += step; }
+
+  int predictor = st->predictor + ((code & 8) ? -delta : delta);
+  if (predictor > 32767) predictor = 32767;
+  else if (predictor < -32768) predictor = -32768;
+  st->predictor = predictor;
+
+  int index = st->index + index_table[code];
+  if (index < 0) index = 0;
+  else if (index > 88) index = 88;
+  st->index = index;
+  return code;
+}
+
+size_t adpcm_encode_block(AdpcmState* st, const int16_t* in, size_t samples, uint8_t* out) {
+  out[0] = st->predictor & 0xFF;
+  out[1] = (st->predictor >> 8) & 0xFF;
+  out[2] = st->index;
+  out[3] = 0;
+  uint8_t* p = out + ADPCM_BLOCK_HEADER;
+  for (size_t i = 0; i + 1 < samples; i += 2) {
+    uint8_t lo = adpcm_encode_sample(st, in[i]);
+    uint8_t hi = adpcm_encode_sample(st, in[i + 1]);
+    *p++ = lo | (hi << 4);
+  }
+  if (samples & 1) {
+    *p++ = adpcm_encode_sample(st, in[samples - 1]);
+  }
+  return p - out;
+}
+
+const char* uplink_codec_name(int codec) {
+  switch (codec) {
+    case CODEC_IMA_ADPCM: return "ima-adpcm";
+    case CODEC_PCM:
+    default:              return "pcm";
+  }
+}
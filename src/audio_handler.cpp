@@ -1,16 +1,123 @@
 #include "audio_handler.h"
+#include "mem_policy.h"
+#include "audio_capture.h"
+#include "esp_timer.h"
+#include "resampler.h"
+#include "ws_session.h"
+#include "reply_cache.h"
+#include "log.h"
 
+uint8_t* chunk_buffer = NULL;
+static uint8_t* reply_buffer = NULL;
+
+void audio_buffers_init() {
+  chunk_buffer = (uint8_t*)mem_alloc(WAV_HEADER_SIZE + CHUNK_SIZE, MEM_POOL_PSRAM, "chunk_buffer");
+  // Yanıt tamponu yalnızca PSRAM'de tutulur; yoksa akış doğrudan çalınır
+  if (mem_psram_available()) {
+    reply_buffer = (uint8_t*)mem_alloc(REPLY_BUFFER_BYTES, MEM_POOL_PSRAM, "reply_buffer");
+  }
+}
+
+
+// Sürücü sınırları: tampon başına en çok 1024 örnek ve 4092 bayt, en az 2 tampon
+#define DMA_MAX_FRAMES 1024
+#define DMA_MAX_BYTES  4092
+#define DMA_MAX_COUNT  128
+
+struct DmaGeometry {
+  int count;
+  int frames;
+};
+
+static DmaGeometry dma_geometry(int sample_rate, uint32_t budget_ms, int bytes_per_frame) {
+  DmaGeometry g;
+  g.frames = sample_rate * I2S_DMA_BUF_MS / 1000;
+  if (g.frames > DMA_MAX_FRAMES) g.frames = DMA_MAX_FRAMES;
+  if (g.frames * bytes_per_frame > DMA_MAX_BYTES) g.frames = DMA_MAX_BYTES / bytes_per_frame;
+  if (g.frames < 8) g.frames = 8;
+  uint32_t budget_frames = (uint32_t)sample_rate * budget_ms / 1000;
+  g.count = (budget_frames + g.frames - 1) / g.frames;
+  if (g.count < 2) g.count = 2;
+  if (g.count > DMA_MAX_COUNT) g.count = DMA_MAX_COUNT;
+  return g;
+}
+
+// Sürücülerin olay kuyrukları ayrı bir görevde boşaltılır. Kuyruk kısa tutulur ve
+// her tamponda RX_DONE/TX_DONE olayı geldiği için, taşma olayları başka türlü
+// kuyruktan düşerdi. Mikrofon ve DAC ayrı portlarda aynı anda açık olabilir.
+#define I2S_PORTS 2
+
+static I2sStats stats = {};
+static TaskHandle_t event_task = NULL;
+static SemaphoreHandle_t detach_ack = NULL;
+static volatile QueueHandle_t event_queues[I2S_PORTS] = {};
+static volatile int detach_port = -1;
+static volatile bool rx_armed = false;   // ilk okumadan önceki taşmalar kayıp sayılmaz
+static volatile bool tx_armed = false;   // ilk yazmadan önceki boşluklar sayılmaz
+
+static void count_event(const i2s_event_t& evt) {
+  switch (evt.type) {
+    case I2S_EVENT_RX_DONE:  stats.rx_done++; break;
+    case I2S_EVENT_RX_Q_OVF: if (rx_armed) stats.rx_overflow++; break;
+    case I2S_EVENT_TX_DONE:  stats.tx_done++; break;
+    case I2S_EVENT_TX_Q_OVF: if (tx_armed) stats.tx_underflow++; break;
+    default: break;
+  }
+}
+
+static void i2s_event_task(void* arg) {
+  i2s_event_t evt;
+  for (;;) {
+    if (detach_port >= 0) {
+      event_queues[detach_port] = NULL;
+      detach_port = -1;
+      xSemaphoreGive(detach_ack);
+    }
+    bool any = false;
+    for (int p = 0; p < I2S_PORTS; p++) {
+      QueueHandle_t q = event_queues[p];
+      if (q == NULL) continue;
+      any = true;
+      while (xQueueReceive(q, &evt, 0) == pdTRUE) count_event(evt);
+    }
+    // Kuyruk I2S_EVENT_QUEUE_LEN tampon süresini tutar; her tamponda bir kez boşaltmak yeter
+    if (any) vTaskDelay(pdMS_TO_TICKS(I2S_DMA_BUF_MS));
+    else ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+static void i2s_events_attach(i2s_port_t port, QueueHandle_t q) {
+  if (event_task == NULL) {
+    detach_ack = xSemaphoreCreateBinary();
+    xTaskCreate(i2s_event_task, "i2s_evt", 2048, nullptr, configMAX_PRIORITIES - 2, &event_task);
+  }
+  event_queues[port] = q;
+  xTaskNotifyGive(event_task);
+}
+
+void i2s_release(i2s_port_t port) {
+  // Sürücü kuyruğu silmeden önce görevin kuyruğu bıraktığı beklenir
+  if (event_task != NULL && event_queues[port] != NULL) {
+    detach_port = port;
+    xTaskNotifyGive(event_task);
+    xSemaphoreTake(detach_ack, portMAX_DELAY);
+  }
+  if (port == MIC_I2S_PORT) rx_armed = false;
+  if (port == DAC_I2S_PORT) tx_armed = false;
+  i2s_driver_uninstall(port);
+}
 
 void i2s_record_init() {
-  i2s_driver_uninstall(I2S_NUM_0);
+  i2s_release(MIC_I2S_PORT);
+  DmaGeometry g = dma_geometry(MIC_I2S_RATE, I2S_RX_BUDGET_MS, MIC_SAMPLE_BITS / 8);
   i2s_config_t cfg = {
     .mode              = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-    .sample_rate       = SAMPLE_RATE,
-    .bits_per_sample   = SAMPLE_BITS,
+    .sample_rate       = MIC_I2S_RATE,
+    .bits_per_sample   = MIC_SAMPLE_BITS,
     .channel_format    = CHANNEL_FORMAT,
     .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-    .dma_buf_count     = 4,
-    .dma_buf_len       = 1024
+    .dma_buf_count     = g.count,
+    .dma_buf_len       = g.frames
   };
   i2s_pin_config_t pins = {
     .bck_io_num    = I2S0_BCK,
@@ -18,22 +125,29 @@ void i2s_record_init() {
     .data_out_num  = -1,
     .data_in_num   = I2S0_SD
   };
-  i2s_driver_install(I2S_NUM_0, &cfg, 0, NULL);
-  i2s_set_pin(I2S_NUM_0, &pins);
-  i2s_zero_dma_buffer(I2S_NUM_0);
+  QueueHandle_t q = NULL;
+  i2s_driver_install(MIC_I2S_PORT, &cfg, I2S_EVENT_QUEUE_LEN, &q);
+  i2s_set_pin(MIC_I2S_PORT, &pins);
+  i2s_zero_dma_buffer(MIC_I2S_PORT);
+  stats.rx_buf_count = g.count;
+  stats.rx_buf_frames = g.frames;
+  if (q != NULL) i2s_events_attach(MIC_I2S_PORT, q);
 }
 
-void i2s_play_init() {
-  i2s_driver_uninstall(I2S_NUM_0);
+void i2s_play_init(int sample_rate) {
+  i2s_release(DAC_I2S_PORT);
+  // PCM5102A stereo 16 bit; tampon başına 4 bayt
+  DmaGeometry g = dma_geometry(sample_rate, I2S_TX_BUDGET_MS, 4);
   i2s_config_t cfg = {
     .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-    .sample_rate = SAMPLE_RATE,
+    .sample_rate = (uint32_t)sample_rate,
     .bits_per_sample = SAMPLE_BITS,
-    .channel_format = CHANNEL_FORMAT,
+    .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
     .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-    .dma_buf_count = 4,
-    .dma_buf_len = 1024,
-    .use_apll = true
+    .dma_buf_count = g.count,
+    .dma_buf_len = g.frames,
+    .use_apll = true,
+    .tx_desc_auto_clear = true   // boşlukta son tampon tekrar edilmez, sessizlik çalınır
   };
   i2s_pin_config_t pins = {
     .bck_io_num = DAC_BCK,
@@ -41,11 +155,154 @@ void i2s_play_init() {
     .data_out_num = DAC_DIN,
     .data_in_num = -1
   };
-  i2s_driver_install(I2S_NUM_0, &cfg, 0, NULL);
-  i2s_set_pin(I2S_NUM_0, &pins);
-  i2s_set_clk(I2S_NUM_0, SAMPLE_RATE, SAMPLE_BITS, I2S_CHANNEL_MONO);
+  QueueHandle_t q = NULL;
+  i2s_driver_install(DAC_I2S_PORT, &cfg, I2S_EVENT_QUEUE_LEN, &q);
+  i2s_set_pin(DAC_I2S_PORT, &pins);
+  i2s_zero_dma_buffer(DAC_I2S_PORT);
+  stats.tx_buf_count = g.count;
+  stats.tx_buf_frames = g.frames;
+  if (q != NULL) i2s_events_attach(DAC_I2S_PORT, q);
+}
+
+esp_err_t i2s_mic_read(void* dst, size_t len, size_t* bytes_read) {
+  esp_err_t result = i2s_read(MIC_I2S_PORT, dst, len, bytes_read, portMAX_DELAY);
+  rx_armed = true;
+  return result;
+}
+
+void i2s_get_stats(I2sStats* out) {
+  *out = stats;
+}
+
+void i2s_print_stats() {
+  I2sStats s;
+  i2s_get_stats(&s);
+  Serial.printf("🎚️ I2S kayıt: %ux%u örnek, %u tampon, %u taşma | çalma: %ux%u örnek, %u tampon, %u boşluk\n",
+                s.rx_buf_count, s.rx_buf_frames, s.rx_done, s.rx_overflow,
+                s.tx_buf_count, s.tx_buf_frames, s.tx_done, s.tx_underflow);
+}
+
+// Hoparlöre gönderilen sinyalin I2S_DMA_BUF_MS'lik çerçeve enerjileri. Barge-in
+// izleyicisi mikrofondaki yankıyı bunlarla karşılaştırır.
+#define REF_FRAMES 32
+
+static float ref_energy[REF_FRAMES];
+static uint32_t ref_time_ms[REF_FRAMES];
+static volatile uint32_t ref_head = 0;
+
+static void push_ref_energy(float mean_sq) {
+  uint32_t h = ref_head;
+  ref_energy[h % REF_FRAMES] = mean_sq;
+  ref_time_ms[h % REF_FRAMES] = millis();
+  ref_head = h + 1;
 }
 
+float playback_ref_energy(uint32_t window_ms) {
+  uint32_t now = millis();
+  uint32_t h = ref_head;
+  float peak = 0.0f;
+  for (uint32_t i = 0; i < REF_FRAMES && i < h; i++) {
+    uint32_t k = (h - 1 - i) % REF_FRAMES;
+    if (now - ref_time_ms[k] > window_ms) break;
+    if (ref_energy[k] > peak) peak = ref_energy[k];
+  }
+  return peak;
+}
+
+// Yankı gidericiye giden referans, çalma hızında bu boyda bloklarla dönüştürülür
+#define AEC_REF_BLOCK 128
+
+// AudioOutputI2S sürücüyü olay kuyruğu olmadan ve sabit tamponlarla kurar;
+// bu çıkış aynı PCM5102A yolunu i2s_play_init() üzerinden sürer.
+class AudioOutputDac : public AudioOutput {
+ public:
+  bool begin() override {
+    i2s_play_init(hertz);
+    I2sStats s;
+    i2s_get_stats(&s);
+    tx_depth_frames = (uint32_t)s.tx_buf_count * s.tx_buf_frames;
+    set_ref_rate(hertz);
+    started = true;
+    return true;
+  }
+
+  bool SetRate(int hz) override {
+    // WAV çözücü oranı begin()'den önce, MP3 çözücü ilk çerçevede bildirir
+    hertz = hz;
+    set_ref_rate(hz);
+    if (started) i2s_set_sample_rates(DAC_I2S_PORT, hz);
+    return true;
+  }
+
+  bool ConsumeSample(int16_t sample[2]) override {
+    int16_t ms[2] = {sample[LEFTCHANNEL], sample[RIGHTCHANNEL]};
+    MakeSampleStereo16(ms);
+    int16_t l = Amplify(ms[LEFTCHANNEL]);
+    int16_t r = Amplify(ms[RIGHTCHANNEL]);
+    uint32_t frame = ((uint32_t)(uint16_t)r << 16) | (uint16_t)l;
+    size_t written = 0;
+    i2s_write(DAC_I2S_PORT, &frame, sizeof(frame), &written, 0);
+    if (written == 0) return false;
+    tx_armed = true;
+
+    float mono = ((float)l + (float)r) * 0.5f;
+    ref_acc += mono * mono;
+    if (++ref_count >= ref_frame) {
+      push_ref_energy(ref_acc / (float)ref_count);
+      ref_acc = 0.0f;
+      ref_count = 0;
+    }
+#if AEC_ENABLED
+    push_aec_ref((int16_t)(((int32_t)l + r) >> 1));
+#endif
+    return true;
+  }
+
+  bool stop() override {
+    if (!started) return true;
+    i2s_zero_dma_buffer(DAC_I2S_PORT);
+    i2s_release(DAC_I2S_PORT);
+    started = false;
+    return true;
+  }
+
+ private:
+  void set_ref_rate(int hz) {
+    ref_frame = hz * I2S_DMA_BUF_MS / 1000;
+    if (ref_rate != hz) {
+      ref_rate = hz;
+      // ref_out 8 kHz'e kadar olan çalma hızlarına göre boyutlanmıştır
+      ref_ok = hz >= 8000 && resampler_init(&ref_rs, hz, SAMPLE_RATE);
+      ref_fill = 0;
+    }
+  }
+
+  // Referans mikrofon hızına (SAMPLE_RATE) çok fazlı süzgeçle indirilir
+  void push_aec_ref(int16_t mono) {
+    if (!ref_ok) return;
+    ref_in[ref_fill++] = mono;
+    if (ref_fill < AEC_REF_BLOCK) return;
+    ref_fill = 0;
+    size_t n = resampler_process(&ref_rs, ref_in, AEC_REF_BLOCK, ref_out);
+    // Son örnek, DMA kuyruğundaki her şey çalındıktan sonra çıkar; bloğun başı bir blok öncedir
+    int64_t play_us = esp_timer_get_time()
+                    + ((int64_t)tx_depth_frames - AEC_REF_BLOCK) * 1000000 / hertz;
+    capture_push_reference(ref_out, n, play_us);
+  }
+
+  bool started = false;
+  uint32_t ref_frame = SAMPLE_RATE * I2S_DMA_BUF_MS / 1000;
+  uint32_t ref_count = 0;
+  float ref_acc = 0.0f;
+  uint32_t tx_depth_frames = 0;
+  int ref_rate = 0;
+  bool ref_ok = false;
+  Resampler ref_rs;
+  int16_t ref_in[AEC_REF_BLOCK];
+  int16_t ref_out[AEC_REF_BLOCK * SAMPLE_RATE / 8000 + 1];
+  size_t ref_fill = 0;
+};
+
 void create_wav_header(uint8_t* h, size_t pcm_size, int sr) {
   int byte_rate   = sr * 2;
   int block_align = 2;
@@ -81,33 +338,152 @@ String send_audio_to_server(uint8_t* data, size_t len) {
   String resp = "";
   if (code == HTTP_CODE_OK) {
     resp = http.getString();
-    Serial.printf("📨 Sunucudan gelen URL (%d bytes): %s\n", resp.length(), resp.c_str());
+    LOG_D("📨 Sunucudan gelen URL (%d bytes): %s", (int)resp.length(), resp.c_str());
   } else {
-    Serial.printf("🚫 HTTP hatası: %d %s\n",
-                  code,
-                  http.errorToString(code).c_str());
+    LOG_E("🚫 HTTP hatası: %d %s",
+          code,
+          http.errorToString(code).c_str());
   }
 
   http.end();
   return resp;
 }
 
-void play_wav_from_url(const String &url) {
-  Serial.println("▶️ Playback başlıyor…");
+String request_tts_url(const String& text) {
+  String json = String("{\"text\":\"") + text + "\",\"lang\":\"tr\",\"format\":\"" REPLY_FORMAT "\"}";
+  String url;
+  if (server_call("tts", json, &url) != HTTP_CODE_OK) return "";
+  return url.startsWith("http") || url.startsWith("ws:") ? url : String("");
+}
+
+// Çalma kendi görevinde yürür; ana görev bu sırada tuşları ve mikrofonu izler
+static TaskHandle_t playback_task = NULL;
+static volatile bool playback_running = false;
+static volatile bool playback_cancel_req = false;
 
-  // ➊ no manual i2s_play_init();
-  file = new AudioFileSourceHTTPStream(url.c_str());
-  out  = new AudioOutputI2S();  
-  out->SetPinout(DAC_BCK, DAC_WS, DAC_DIN);  
+static void play_stream(const String &url) {
+  LOG_I("▶️ Playback başlıyor…");
+
+  AudioFileSource *stream = NULL;
+  AudioFileSource *file;
+  AudioFileSource *buffer = NULL;
+#if REPLY_CACHE_ENABLED
+  // Aynı yanıt daha önce çalındıysa ağdan hiç okunmaz
+  stream = reply_cache_open(url);
+  // Sunucu önbellekteki anahtarı henüz bilmiyorsa sesi akıtmaya başlamış olabilir
+  if (stream != NULL && url.startsWith("ws:")) ws_session_cancel_reply(url);
+#endif
+  bool cached = stream != NULL;
+  if (cached) {
+    file = stream;
+  } else if (url.startsWith("ws:")) {
+    // Yanıt WebSocket oturumundan akar; PSRAM'deki halkası tampon görevi görür
+    stream = ws_session_open_reply(url);
+    if (stream == NULL) {
+      LOG_E("❌ WS yanıtı açılamadı!");
+      return;
+    }
+    file = stream;
+  } else {
+    stream = new AudioFileSourceHTTPStream(url.c_str());
+    file = stream;
+    if (reply_buffer != NULL) {
+      // Ağ duraksamalarını PSRAM'deki tampon karşılar; I2S_TX_BUDGET_MS yalnızca çözme süresini kapsar
+      buffer = new AudioFileSourceBuffer(stream, reply_buffer, REPLY_BUFFER_BYTES);
+      file = buffer;
+    }
+  }
+#if REPLY_CACHE_ENABLED
+  if (!cached) file = reply_cache_wrap(url, file);
+#endif
+  AudioOutputDac *out = new AudioOutputDac();
   out->SetGain(2.0);                // try a higher gain  
-  wav = new AudioGeneratorWAV();
+  AudioGenerator *gen;
+  if (url.endsWith(".mp3")) {
+    gen = new AudioGeneratorMP3();
+  } else {
+    gen = new AudioGeneratorWAV();
+  }
+
+  I2sStats before;
+  i2s_get_stats(&before);
+
+  if (!gen->begin(file, out)) {
+    LOG_E("❌ Ses çözücü başlatılamadı!");
+  } else {
+    // Döngüde geçen süre çözme + ağdan okuma yüküdür; I2S yazımı bloklamaz
+    uint32_t busy_us = 0;
+    uint32_t start_us = micros();
+    while (gen->isRunning()) {
+      if (playback_cancel_req) {
+        gen->stop();
+        LOG_I("⏹️ Çalma kesildi");
+        break;
+      }
+      uint32_t t0 = micros();
+      if (!gen->loop()) {
+        gen->stop();
+      }
+      busy_us += micros() - t0;
+      delay(1);
+    }
+    uint32_t total_us = micros() - start_us;
+    I2sStats after;
+    i2s_get_stats(&after);
+    if (total_us > 0) {
+      LOG_I("⏱️ Çalma %u ms, çözme yükü %%%u (%s), %u DMA boşluğu",
+            total_us / 1000,
+            (uint32_t)((uint64_t)busy_us * 100 / total_us),
+            url.endsWith(".mp3") ? "mp3" : "wav",
+            after.tx_underflow - before.tx_underflow);
+    }
+  }
+
+  delete gen;
+  delete out;
+  if (file != buffer && file != stream) delete file;
+  delete buffer;
+  delete stream;
+}
 
-  if (!wav->begin(file, out)) {
-    Serial.println("❌ wav.begin() başarısız!");
-    return;
+static void playback_loop(void* arg) {
+  String* url = (String*)arg;
+  // Yankı AGC'yi kısmasın; barge-in eşiği sabit kazançla ölçülür
+  capture_hold_gain(true);
+  play_stream(*url);
+  capture_hold_gain(false);
+  delete url;
+  playback_task = NULL;
+  playback_running = false;
+  vTaskDelete(NULL);
+}
+
+bool playback_start(const String &url) {
+  if (playback_running) return false;
+  playback_cancel_req = false;
+  playback_running = true;
+  String* arg = new String(url);
+  if (xTaskCreate(playback_loop, "playback", 8192, arg, 3, &playback_task) != pdPASS) {
+    delete arg;
+    playback_running = false;
+    return false;
   }
-  // optional: block until done
-  while (wav->isRunning()) {
-    wav->loop();
+  return true;
+}
+
+void playback_cancel() {
+  playback_cancel_req = true;
+}
+
+bool playback_active() {
+  return playback_running;
+}
+
+void play_audio_from_url(const String &url) {
+  if (!playback_start(url)) return;
+  while (playback_active()) {
+    delay(10);
   }
-}
\ No newline at end of file
+  // Sonraki oturumun ön kaydı hoparlörden gelen yankıyı içermesin
+  capture_mark_boundary();
+}
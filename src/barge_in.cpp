@@ -0,0 +1,121 @@
+// barge_in.cpp
+#include "barge_in.h"
+#include "audio_handler.h"
+#include "audio_capture.h"
+#include "dsp_kernels.h"
+#include "vad.h"
+#include "log.h"
+#include <algorithm>
+
+#define BARGE_FRAME (SAMPLE_RATE * I2S_DMA_BUF_MS / 1000)
+#define BARGE_LEARN_MAX (BARGE_IN_LEARN_MS * 4 / I2S_DMA_BUF_MS)
+
+static barge_in_key_fn key_source = NULL;
+static char pending_key = 0;
+
+void barge_in_set_key_source(barge_in_key_fn read_key) {
+  key_source = read_key;
+}
+
+char barge_in_take_key() {
+  char key = pending_key;
+  pending_key = 0;
+  return key;
+}
+
+// Yankı kuplajı (mikrofon / hoparlör enerji oranı) çalmanın başında öğrenilir:
+// yakın uç VAD'ının sustuğu çerçevelerin oranlarının ortancası, sınırlara
+// kırpılmış. Kullanıcı bu sırada konuşsa da tek tük çerçeveler tahmini
+// şişirmez. Sonrasında eşik, son BARGE_IN_ECHO_WINDOW_MS içinde hoparlöre
+// giden en yüksek enerjinin bu oranla ölçeklenmiş halidir.
+BargeInResult play_interruptible(const String& url) {
+  BargeInResult res = {BARGE_IN_NONE, 0};
+  CaptureReader reader;
+  capture_open(&reader, 0);
+  if (!playback_start(url)) return res;
+
+  static int16_t frame[BARGE_FRAME];
+  size_t filled = 0;
+  float coupling = 0.0f;
+  static float ratios[BARGE_LEARN_MAX];
+  size_t ratio_count = 0;
+  bool learned = false;
+  // Yankı tabanı ilk çerçevelerden öğrenilir; yakın uç konuşması onun üstünde kalır
+  static VadState near_vad;
+  vad_init(&near_vad, SAMPLE_RATE);
+  uint32_t learn_until = 0;
+  uint32_t speech_ms = 0;
+  uint32_t onset = 0;
+  const float min_energy = (float)BARGE_IN_MIN_RMS * BARGE_IN_MIN_RMS;
+
+  while (playback_active()) {
+    if (key_source != NULL) {
+      char key = key_source();
+      if (key) {
+        pending_key = key;
+        res.reason = BARGE_IN_KEY;
+        break;
+      }
+    }
+
+    size_t n = capture_read(&reader, frame + filled, BARGE_FRAME - filled, I2S_DMA_BUF_MS);
+    filled += n;
+    if (filled < BARGE_FRAME) continue;
+    filled = 0;
+
+    float mic = (float)dsp_energy_s16(frame, BARGE_FRAME) / (float)BARGE_FRAME;
+    float ref = playback_ref_energy(BARGE_IN_ECHO_WINDOW_MS);
+    if (ref <= 0.0f) continue;   // çözücü henüz ses üretmedi
+
+    if (!learned) {
+      uint32_t now = millis();
+      if (learn_until == 0) learn_until = now + BARGE_IN_LEARN_MS;
+      vad_process(&near_vad, frame, BARGE_FRAME);
+      bool near_quiet = !vad_in_speech(&near_vad) && near_vad.onset_run == 0;
+      if (near_quiet && ratio_count < BARGE_LEARN_MAX) ratios[ratio_count++] = mic / ref;
+      // Süre dolunca yeterli sessiz çerçeve yoksa pencere (en çok 4 katına) uzar
+      bool window_done = (int32_t)(now - learn_until) >= 0;
+      if (!window_done || (ratio_count < BARGE_IN_LEARN_MIN_FRAMES && ratio_count < BARGE_LEARN_MAX &&
+                           (int32_t)(now - learn_until) < 3 * BARGE_IN_LEARN_MS)) {
+        continue;
+      }
+      if (ratio_count > 0) {
+        std::nth_element(ratios, ratios + ratio_count / 2, ratios + ratio_count);
+        coupling = ratios[ratio_count / 2];
+      } else {
+        coupling = BARGE_IN_COUPLING_MAX;   // hep konuşuldu: en temkinli eşik
+      }
+      coupling = std::min(std::max(coupling, BARGE_IN_COUPLING_MIN), BARGE_IN_COUPLING_MAX);
+      learned = true;
+      LOG_D("Yankı kuplajı %.4f (%u çerçeve)", coupling, (unsigned)ratio_count);
+      continue;
+    }
+
+    float threshold = coupling * ref * BARGE_IN_ECHO_MARGIN;
+    if (threshold < min_energy) threshold = min_energy;
+    if (mic > threshold) {
+      if (speech_ms == 0) onset = reader.pos - BARGE_FRAME;
+      speech_ms += I2S_DMA_BUF_MS;
+      if (speech_ms >= BARGE_IN_HOLD_MS) {
+        res.reason = BARGE_IN_VOICE;
+        res.onset = onset;
+        break;
+      }
+    } else {
+      speech_ms = 0;
+    }
+  }
+
+  if (res.reason != BARGE_IN_NONE) {
+    playback_cancel();
+    while (playback_active()) {
+      delay(5);
+    }
+    LOG_I("🗣️ Araya girildi (%s)", res.reason == BARGE_IN_VOICE ? "ses" : "tuş");
+  }
+  // Sesle kesildiyse konuşmanın başı yeni oturuma girer; yoksa yankı ön kayda karışmasın
+  if (res.reason != BARGE_IN_VOICE) {
+    capture_mark_boundary();
+  }
+  return res;
+}
@@ -0,0 +1,443 @@
+// blackbox.cpp
+#include "blackbox.h"
+#include "metrics.h"
+#include "power_manager.h"
+#include "log.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include <Preferences.h>
+
+#define BB_MAGIC     0x58424B42   // "BKBX"
+#define BB_SECTOR    4096
+#define BB_ENTRY_MAX (sizeof(EntryHeader) + ((BLACKBOX_TEXT_MAX + 3) & ~3))
+
+#if BLACKBOX_RTC_BYTES & (BLACKBOX_RTC_BYTES - 1)
+#error "BLACKBOX_RTC_BYTES 2'nin kuvveti olmalı"
+#endif
+#if LOG_RECORD_MAX > BLACKBOX_TEXT_MAX
+#error "ham günlük kaydı (LOG_RECORD_MAX) bir kara kutu kaydına sığmalı"
+#endif
+
+// RTC halkasında ve flash'ta aynı biçim; metin NUL içermez, 4 bayta dolgulanır
+struct EntryHeader {
+  uint16_t len;      // başlık ve dolgu dahil; 0xFFFF: sektörün yazılmamış kısmı
+  uint8_t type;
+  uint8_t level;
+  uint32_t boot;
+  uint32_t ms;       // açılıştan beri
+};
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t seq;      // her yeni sektörde bir artar; en büyüğü yazılmakta olandır
+};
+
+// Panik, watchdog ve brownout resetinde korunur; güç kesilince geçersiz sayılır
+struct RtcRing {
+  uint32_t magic;
+  uint32_t head;      // yazılan toplam bayt; konum = head % BLACKBOX_RTC_BYTES
+  uint32_t flushed;   // flash'a aktarılan ya da yer açmak için atılan
+  uint32_t lost;
+  uint32_t image;     // yazan imajın ELF özetinin ilk baytları; ham kayıtlar yalnızca onunla çözülür
+  uint8_t data[BLACKBOX_RTC_BYTES];
+};
+
+RTC_NOINIT_ATTR static RtcRing rtc;
+
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t flash_mutex = NULL;   // flash durumu: görev ve /blackbox dökümü
+static TaskHandle_t blackbox_task_handle = NULL;
+static const esp_partition_t* part = NULL;
+static int sector_count = 0;
+static int cur_sector = 0;
+static uint32_t cur_seq = 0;
+static uint32_t write_off = 0;      // geçerli sektörde sıradaki boş bayt
+static bool next_ready = false;     // sıradaki sektör silinmiş ve başlığı yazılmış
+static uint32_t boot_id = 0;
+static bool ready = false;
+static uint8_t batch[BLACKBOX_BATCH_BYTES];
+static uint8_t staging[BLACKBOX_BATCH_BYTES];   // RTC'den kilit altında kopyalanan, henüz çevrilmemiş
+
+static inline uint32_t align4(uint32_t n) {
+  return (n + 3) & ~3u;
+}
+
+static bool entry_valid(const EntryHeader& h) {
+  return h.len >= sizeof(EntryHeader) && h.len <= BB_ENTRY_MAX && (h.len & 3) == 0 &&
+         h.type >= BLACKBOX_LOG && h.type <= BLACKBOX_LOG_RAW;
+}
+
+static void ring_read(uint32_t pos, void* dst, size_t n) {
+  uint32_t off = pos % BLACKBOX_RTC_BYTES;
+  size_t first = n < BLACKBOX_RTC_BYTES - off ? n : BLACKBOX_RTC_BYTES - off;
+  memcpy(dst, rtc.data + off, first);
+  memcpy((uint8_t*)dst + first, rtc.data, n - first);
+}
+
+static void ring_write(uint32_t pos, const void* src, size_t n) {
+  uint32_t off = pos % BLACKBOX_RTC_BYTES;
+  size_t first = n < BLACKBOX_RTC_BYTES - off ? n : BLACKBOX_RTC_BYTES - off;
+  memcpy(rtc.data + off, src, first);
+  memcpy(rtc.data, (const uint8_t*)src + first, n - first);
+}
+
+// ring_mux altında; bozuk kayıtta halkanın geri kalanı atılır
+static bool ring_peek(uint32_t pos, EntryHeader* h) {
+  if (rtc.head - pos < sizeof(EntryHeader)) return false;
+  ring_read(pos, h, sizeof(*h));
+  if (!entry_valid(*h) || rtc.head - pos < h->len) {
+    rtc.lost++;
+    rtc.flushed = rtc.head;
+    return false;
+  }
+  return true;
+}
+
+static void ring_append(EntryHeader h, const void* body, size_t len) {
+  static const uint8_t pad[3] = {0, 0, 0};
+  h.len = (uint16_t)align4(sizeof(h) + len);
+  uint32_t pending;
+  portENTER_CRITICAL(&ring_mux);
+  // Flash geride kaldıysa en eski kayıtlar feda edilir
+  while (rtc.head + h.len - rtc.flushed > BLACKBOX_RTC_BYTES) {
+    EntryHeader old;
+    if (!ring_peek(rtc.flushed, &old)) break;
+    rtc.flushed += old.len;
+    rtc.lost++;
+  }
+  ring_write(rtc.head, &h, sizeof(h));
+  ring_write(rtc.head + sizeof(h), body, len);
+  ring_write(rtc.head + sizeof(h) + len, pad, h.len - sizeof(h) - len);
+  rtc.head += h.len;
+  pending = rtc.head - rtc.flushed;
+  portEXIT_CRITICAL(&ring_mux);
+  if (pending >= BLACKBOX_BATCH_BYTES && blackbox_task_handle != NULL) xTaskNotifyGive(blackbox_task_handle);
+}
+
+void blackbox_append(BlackboxType type, uint8_t level, const char* text, size_t len) {
+  if (!ready) return;
+  if (len > BLACKBOX_TEXT_MAX) len = BLACKBOX_TEXT_MAX;
+  ring_append({0, type, level, boot_id, millis()}, text, len);
+}
+
+void blackbox_append_record(const uint8_t* rec, size_t len) {
+  if (!ready || len < sizeof(log_detail::RecordHeader) || len > LOG_RECORD_MAX) return;
+  log_detail::RecordHeader r;
+  memcpy(&r, rec, sizeof(r));
+  ring_append({0, BLACKBOX_LOG_RAW, r.level, boot_id, r.ms}, rec, len);
+}
+
+// Ham kayıt BLACKBOX_LOG metnine çevrilir, diğerleri olduğu gibi kopyalanır.
+// dst en az BB_ENTRY_MAX + 1 bayt (log_format'ın NUL'u); dönen değer yeni len.
+static uint16_t to_flash_entry(const uint8_t* src, uint8_t* dst) {
+  EntryHeader h;
+  memcpy(&h, src, sizeof(h));
+  if (h.type != BLACKBOX_LOG_RAW) {
+    memcpy(dst, src, h.len);
+    return h.len;
+  }
+  // Dolgu baytları kaydın nargs'ından sonra kalır, biçimlendirici onlara bakmaz
+  size_t n = log_format(src + sizeof(h), h.len - sizeof(h), (char*)dst + sizeof(h), BLACKBOX_TEXT_MAX + 1);
+  h.type = BLACKBOX_LOG;
+  h.len = (uint16_t)align4(sizeof(h) + n);
+  memset(dst + sizeof(h) + n, 0, h.len - sizeof(h) - n);
+  memcpy(dst, &h, sizeof(h));
+  return h.len;
+}
+
+static uint32_t sector_addr(int s) {
+  return (uint32_t)s * BB_SECTOR;
+}
+
+// Silme tek başına onlarca ms sürebilir ve önbelleği kapatır; yalnızca açılışta ve boştayken
+static bool prepare_next() {
+  int next = (cur_sector + 1) % sector_count;
+  if (esp_partition_erase_range(part, sector_addr(next), BB_SECTOR) != ESP_OK) return false;
+  SectorHeader sh = {BB_MAGIC, cur_seq + 1};
+  if (esp_partition_write(part, sector_addr(next), &sh, sizeof(sh)) != ESP_OK) return false;
+  next_ready = true;
+  return true;
+}
+
+static bool advance_sector(bool may_erase) {
+  if (!next_ready && !(may_erase && prepare_next())) return false;
+  cur_sector = (cur_sector + 1) % sector_count;
+  cur_seq++;
+  write_off = sizeof(SectorHeader);
+  next_ready = false;
+  return true;
+}
+
+// RTC halkasında bekleyenleri sektöre sığdığı kadar toplu yazar; flash_mutex altında.
+// Kilit altında yalnızca kopyalanır, ham günlük kayıtları kilit dışında metne çevrilir.
+static void flush_pending(bool may_erase) {
+  uint8_t entry[BB_ENTRY_MAX + 1];
+  for (;;) {
+    uint32_t pos, end;
+    size_t staged = 0, n = 0;
+    bool sector_full = false;
+    portENTER_CRITICAL(&ring_mux);
+    pos = rtc.flushed;
+    EntryHeader h;
+    while (ring_peek(pos + staged, &h) && staged + h.len <= sizeof(staging)) {
+      ring_read(pos + staged, staging + staged, h.len);
+      staged += h.len;
+    }
+    if (rtc.flushed != pos) staged = 0;   // ring_peek bozuk kayıt gördü
+    portEXIT_CRITICAL(&ring_mux);
+
+    end = pos;
+    for (size_t off = 0; off < staged;) {
+      EntryHeader raw;
+      memcpy(&raw, staging + off, sizeof(raw));
+      uint16_t len = to_flash_entry(staging + off, entry);
+      if (n + len > sizeof(batch)) break;
+      if (write_off + n + len > BB_SECTOR) {
+        sector_full = true;
+        break;
+      }
+      memcpy(batch + n, entry, len);
+      n += len;
+      off += raw.len;
+      end += raw.len;
+    }
+
+    if (n > 0) {
+      if (esp_partition_write(part, sector_addr(cur_sector) + write_off, batch, n) != ESP_OK) return;
+      write_off += n;
+      portENTER_CRITICAL(&ring_mux);
+      // Bu arada yer açmak için atılanlar yazılanı geçmiş olabilir
+      if ((int32_t)(end - rtc.flushed) > 0) rtc.flushed = end;
+      portEXIT_CRITICAL(&ring_mux);
+    }
+    if (sector_full) {
+      if (!advance_sector(may_erase)) return;
+    } else if (n == 0) {
+      return;
+    }
+  }
+}
+
+// Yazılmakta olan sektör en büyük sıra numaralısıdır; boş yeri kayıtlar yürünerek bulunur
+static void scan_flash() {
+  bool found = false;
+  for (int s = 0; s < sector_count; s++) {
+    SectorHeader sh;
+    if (esp_partition_read(part, sector_addr(s), &sh, sizeof(sh)) != ESP_OK || sh.magic != BB_MAGIC) continue;
+    if (!found || (int32_t)(sh.seq - cur_seq) > 0) {
+      cur_sector = s;
+      cur_seq = sh.seq;
+      found = true;
+    }
+  }
+  if (!found) {
+    // İlk açılış: sıfırıncı sektör hazırlanır
+    cur_sector = sector_count - 1;
+    cur_seq = 0;
+    next_ready = false;
+    advance_sector(true);
+    return;
+  }
+  write_off = sizeof(SectorHeader);
+  while (write_off + sizeof(EntryHeader) <= BB_SECTOR) {
+    EntryHeader h;
+    esp_partition_read(part, sector_addr(cur_sector) + write_off, &h, sizeof(h));
+    if (h.len == 0xFFFF) break;
+    // Yarım kalmış yazım: sektörün kalanı kullanılmaz
+    if (!entry_valid(h) || write_off + h.len > BB_SECTOR) {
+      write_off = BB_SECTOR;
+      break;
+    }
+    write_off += h.len;
+  }
+  SectorHeader next;
+  esp_partition_read(part, sector_addr((cur_sector + 1) % sector_count), &next, sizeof(next));
+  next_ready = next.magic == BB_MAGIC && next.seq == cur_seq + 1;
+}
+
+static const char* reset_reason_name(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_POWERON: return "güç verildi";
+    case ESP_RST_EXT: return "harici reset";
+    case ESP_RST_SW: return "yazılım reseti";
+    case ESP_RST_PANIC: return "panik";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT: return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "derin uyku";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default: return "bilinmiyor";
+  }
+}
+
+static void blackbox_loop(void* arg) {
+  uint32_t last_snapshot = millis();
+  char line[BLACKBOX_TEXT_MAX + 1];
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BLACKBOX_FLUSH_MS));
+    if (millis() - last_snapshot >= BLACKBOX_SNAPSHOT_MS) {
+      last_snapshot = millis();
+      size_t n = metrics_summary(line, sizeof(line));
+      blackbox_append(BLACKBOX_METRICS, 0, line, n);
+    }
+    // Mikrofon açıkken yalnızca sayfa yazılır; sektör silme boşta beklenir
+    bool idle = power_is_idle();
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+    flush_pending(idle);
+    if (idle && !next_ready) prepare_next();
+    xSemaphoreGive(flash_mutex);
+  }
+}
+
+void blackbox_begin() {
+  if (ready) return;
+  part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "blackbox");
+  if (part == NULL || part->size < 2 * BB_SECTOR) {
+    LOG_W("⚠️ blackbox bölümü yok, kara kutu kapalı (partitions.csv)");
+    return;
+  }
+  sector_count = part->size / BB_SECTOR;
+  flash_mutex = xSemaphoreCreateMutex();
+
+  Preferences prefs;
+  prefs.begin("blackbox", false);
+  boot_id = prefs.getUInt("boot", 0) + 1;
+  prefs.putUInt("boot", boot_id);
+  prefs.end();
+
+  // Güç kesildiyse RTC içeriği rastgeledir; tutarsız konumlar halkayı sıfırlar.
+  // Yeni yazılım yüklendiyse ham kayıtlardaki biçim dizgesi adresleri geçersizdir.
+  uint32_t image = 0;
+  memcpy(&image, esp_ota_get_app_description()->app_elf_sha256, sizeof(image));
+  if (rtc.magic != BB_MAGIC || rtc.image != image || rtc.head - rtc.flushed > BLACKBOX_RTC_BYTES) {
+    rtc.magic = BB_MAGIC;
+    rtc.image = image;
+    rtc.head = rtc.flushed = 0;
+    rtc.lost = 0;
+  }
+
+  // Önceki çalışmanın flash'a geçmemiş son kayıtları; sıcak yol henüz çalışmıyor, silme serbest
+  scan_flash();
+  flush_pending(true);
+  if (!next_ready) prepare_next();
+  ready = true;
+
+  esp_reset_reason_t reason = esp_reset_reason();
+  char text[64];
+  int n = snprintf(text, sizeof(text), "açılış, önceki reset: %s", reset_reason_name(reason));
+  blackbox_append(BLACKBOX_BOOT, 0, text, n);
+  if (reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT ||
+      reason == ESP_RST_WDT || reason == ESP_RST_BROWNOUT) {
+    LOG_W("⚠️ Önceki çalışma %s ile bitti; son kayıtlar :%d/blackbox'ta", reset_reason_name(reason), METRICS_HTTP_PORT);
+  }
+  LOG_I("🗃️ Kara kutu: açılış #%u, %d sektör, RTC'de %u kayıt kaybı", boot_id, sector_count, rtc.lost);
+  xTaskCreate(blackbox_loop, "blackbox", 3072, nullptr, 1, &blackbox_task_handle);
+}
+
+static size_t print_entry(Print& out, const EntryHeader& h, const char* text, size_t len) {
+  static const char level_tags[] = "-EWIDT";
+  char tag = h.type == BLACKBOX_METRICS ? 'M' : h.type == BLACKBOX_BOOT ? 'B' : h.level < 6 ? level_tags[h.level] : '?';
+  char prefix[40];
+  int n = snprintf(prefix, sizeof(prefix), "#%u %u.%03u %c ", h.boot, h.ms / 1000, h.ms % 1000, tag);
+  size_t w = out.write((const uint8_t*)prefix, n);
+  w += out.write((const uint8_t*)text, len);
+  w += out.write((const uint8_t*)"\n", 1);
+  return w;
+}
+
+// Dolgu baytları metinden atılır
+static size_t text_len(const uint8_t* p, size_t n) {
+  while (n > 0 && p[n - 1] == 0) n--;
+  return n;
+}
+
+// Toplu kopyadaki flash kayıtları
+static size_t print_chunk(Print& out, const uint8_t* buf, size_t n) {
+  size_t total = 0;
+  for (size_t off = 0; off < n;) {
+    EntryHeader h;
+    memcpy(&h, buf + off, sizeof(h));
+    total += print_entry(out, h, (const char*)buf + off + sizeof(h), text_len(buf + off + sizeof(h), h.len - sizeof(h)));
+    off += h.len;
+  }
+  return total;
+}
+
+// Sıra numarası seq olan sektörün yeri; flash_mutex altında
+static int sector_of(uint32_t seq) {
+  int s = (cur_sector + (int32_t)(seq - cur_seq)) % sector_count;
+  return s < 0 ? s + sector_count : s;
+}
+
+// İstemciye yazmak ağ hızında sürer; flash_mutex yalnızca bir parça kopyalanırken
+// tutulur, blackbox görevi aralarda aktarıma ve sektör silmeye devam eder.
+size_t blackbox_dump(Print& out) {
+  if (!ready) return 0;
+  static uint8_t chunk[BLACKBOX_BATCH_BYTES];   // tek çağıran metrik görevi
+  uint8_t entry[BB_ENTRY_MAX];
+  uint8_t text[BB_ENTRY_MAX + 1];   // RTC'deki ham günlük kaydının metni
+  size_t total = 0;
+
+  // Sektörler eskiden yeniye, sıra numarasıyla izlenir: aradaki ilerlemede en eski
+  // sektör silinip yeniden kullanılmışsa başlığındaki numara tutmaz ve atlanır
+  xSemaphoreTake(flash_mutex, portMAX_DELAY);
+  uint32_t seq = cur_seq - (sector_count - 1);
+  uint32_t off = sizeof(SectorHeader);
+  uint32_t pos;
+  for (;;) {
+    int s = sector_of(seq);
+    uint32_t end = seq == cur_seq ? write_off : BB_SECTOR;
+    SectorHeader sh;
+    esp_partition_read(part, sector_addr(s), &sh, sizeof(sh));
+    bool sector_done = sh.magic != BB_MAGIC || sh.seq != seq;
+    size_t n = 0;
+    while (!sector_done) {
+      EntryHeader h;
+      if (off + sizeof(EntryHeader) > end) {
+        sector_done = true;
+        break;
+      }
+      esp_partition_read(part, sector_addr(s) + off, &h, sizeof(h));
+      if (!entry_valid(h) || off + h.len > end) {
+        sector_done = true;
+        break;
+      }
+      if (n + h.len > sizeof(chunk)) break;
+      esp_partition_read(part, sector_addr(s) + off, chunk + n, h.len);
+      n += h.len;
+      off += h.len;
+    }
+    bool last = sector_done && seq == cur_seq;
+    if (last) {
+      // Flash'a geçmemişlerin başı aynı kilit altında: kayıt iki kez ya da hiç görünmez
+      portENTER_CRITICAL(&ring_mux);
+      pos = rtc.flushed;
+      portEXIT_CRITICAL(&ring_mux);
+    } else if (sector_done) {
+      seq++;
+      off = sizeof(SectorHeader);
+    }
+    xSemaphoreGive(flash_mutex);
+    total += print_chunk(out, chunk, n);
+    if (last) break;
+    xSemaphoreTake(flash_mutex, portMAX_DELAY);
+  }
+
+  // Henüz flash'a geçmemiş en yeni kayıtlar. Bu arada aktarılanlar da halkada
+  // yerinde durur; yalnızca üzerine yazılmışsa halkanın geçerli başına atlanır.
+  for (;;) {
+    EntryHeader h;
+    bool ok;
+    portENTER_CRITICAL(&ring_mux);
+    if (rtc.head - pos > BLACKBOX_RTC_BYTES) pos = rtc.flushed;
+    ok = ring_peek(pos, &h);
+    if (ok) ring_read(pos, entry, h.len);
+    portEXIT_CRITICAL(&ring_mux);
+    if (!ok) break;
+    pos += h.len;
+    h.len = to_flash_entry(entry, text);
+    memcpy(&h, text, sizeof(h));
+    total += print_entry(out, h, (const char*)text + sizeof(h), text_len(text + sizeof(h), h.len - sizeof(h)));
+  }
+  return total;
+}
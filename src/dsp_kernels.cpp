@@ -0,0 +1,396 @@
+// dsp_kernels.cpp
+#include "dsp_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#if DSP_HAS_ESP_DSP
+#include "esp_dsp.h"
+#endif
+
+static inline int16_t sat16(int32_t v) {
+  if (v > 32767) return 32767;
+  if (v < -32768) return -32768;
+  return (int16_t)v;
+}
+
+void dsp_gain_clip_s16_ref(int16_t* data, size_t n, int32_t gain_q12) {
+  for (size_t i = 0; i < n; i++) {
+    data[i] = sat16((data[i] * gain_q12 + 2048) >> 12);
+  }
+}
+
+void dsp_gain_clip_s16(int16_t* data, size_t n, int32_t gain_q12) {
+  size_t i = 0;
+  // esp-dsp'de doyuran Q12 çarpım yok (dsps_mulc_s16 Q15'tir, kırpmadan keser);
+  // Xtensa'da döngü ek yükünü azaltmak için 4'lü açılmış
+  for (; i + 4 <= n; i += 4) {
+    data[i]     = sat16((data[i]     * gain_q12 + 2048) >> 12);
+    data[i + 1] = sat16((data[i + 1] * gain_q12 + 2048) >> 12);
+    data[i + 2] = sat16((data[i + 2] * gain_q12 + 2048) >> 12);
+    data[i + 3] = sat16((data[i + 3] * gain_q12 + 2048) >> 12);
+  }
+  for (; i < n; i++) {
+    data[i] = sat16((data[i] * gain_q12 + 2048) >> 12);
+  }
+}
+
+void dsp_dc_block_init(DspDcBlock* st, float pole) {
+  st->x1 = 0;
+  st->y1 = 0;
+  st->r_q15 = (int32_t)lroundf(pole * 32768.0f);
+}
+
+void dsp_dc_block_s16(DspDcBlock* st, int16_t* data, size_t n) {
+  // Özyinelemeli olduğu için vektörleştirilemez; çıkış durumu 12 bit kesirle
+  // tutulur (|y| < 2^17 olduğundan 32 bite sığar)
+  int32_t x1 = st->x1;
+  int32_t y1 = st->y1;
+  const int32_t r = st->r_q15;
+  for (size_t i = 0; i < n; i++) {
+    int32_t x = data[i];
+    int32_t y = ((x - x1) << 12) + (int32_t)(((int64_t)r * y1) >> 15);
+    x1 = x;
+    y1 = y;
+    data[i] = sat16((y + (1 << 11)) >> 12);
+  }
+  st->x1 = x1;
+  st->y1 = y1;
+}
+
+uint64_t dsp_energy_s16_ref(const int16_t* x, size_t n) {
+  uint64_t acc = 0;
+  for (size_t i = 0; i < n; i++) {
+    acc += (uint64_t)((int32_t)x[i] * x[i]);
+  }
+  return acc;
+}
+
+uint64_t dsp_energy_s16(const int16_t* x, size_t n) {
+  uint64_t acc = 0;
+  size_t i = 0;
+  // dsps_dotprod_s16 sonucu int16'ya kaydırır, enerji için kayıplı.
+  // İki karenin toplamı (<= 2^31) 32 bite sığar; 64 bit toplama dörtte bir sıklıkta
+  for (; i + 4 <= n; i += 4) {
+    uint32_t a = (uint32_t)(x[i] * x[i]) + (uint32_t)(x[i + 1] * x[i + 1]);
+    uint32_t b = (uint32_t)(x[i + 2] * x[i + 2]) + (uint32_t)(x[i + 3] * x[i + 3]);
+    acc += (uint64_t)a + b;
+  }
+  for (; i < n; i++) {
+    acc += (uint32_t)(x[i] * x[i]);
+  }
+  return acc;
+}
+
+float dsp_rms_s16(const int16_t* x, size_t n) {
+  if (n == 0) return 0.0f;
+  return sqrtf((float)dsp_energy_s16(x, n) / (float)n);
+}
+
+float dsp_rms_f32_ref(const float* x, size_t n) {
+  if (n == 0) return 0.0f;
+  float acc = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    acc += x[i] * x[i];
+  }
+  return sqrtf(acc / (float)n);
+}
+
+float dsp_rms_f32(const float* x, size_t n) {
+#if DSP_HAS_ESP_DSP
+  if (n == 0) return 0.0f;
+  float acc = 0.0f;
+  dsps_dotprod_f32(x, x, &acc, n);
+  return sqrtf(acc / (float)n);
+#else
+  return dsp_rms_f32_ref(x, n);
+#endif
+}
+
+void dsp_s16_to_f32_ref(const int16_t* in, float* out, size_t n) {
+  const float scale = 1.0f / 32768.0f;
+  for (size_t i = 0; i < n; i++) {
+    out[i] = (float)in[i] * scale;
+  }
+}
+
+void dsp_s16_to_f32(const int16_t* in, float* out, size_t n) {
+#if DSP_HAS_ESP_DSP
+  // Ölçekleme vektör çarpımında; her eleman yine tek çarpımdır, sonuç ref ile aynı
+  for (size_t i = 0; i < n; i++) {
+    out[i] = (float)in[i];
+  }
+  dsps_mulc_f32(out, out, (int)n, 1.0f / 32768.0f, 1, 1);
+#else
+  dsp_s16_to_f32_ref(in, out, n);
+#endif
+}
+
+void dsp_f32_to_s16_ref(const float* in, int16_t* out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = sat16((int32_t)lrintf(in[i] * 32768.0f));
+  }
+}
+
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t n) {
+#if DSP_HAS_ESP_DSP
+  // Giriş sabittir; ölçeklenmiş değerler yığındaki küçük bir tamponda yuvarlanır
+  float tmp[64];
+  for (size_t off = 0; off < n; off += 64) {
+    size_t m = n - off < 64 ? n - off : 64;
+    dsps_mulc_f32(in + off, tmp, (int)m, 32768.0f, 1, 1);
+    for (size_t i = 0; i < m; i++) {
+      out[off + i] = sat16((int32_t)lrintf(tmp[i]));
+    }
+  }
+#else
+  dsp_f32_to_s16_ref(in, out, n);
+#endif
+}
+
+// --- Gerçel FFT ---------------------------------------------------------
+// n/2 noktalı karmaşık FFT ve ardından gerçel ayrıştırma adımı.
+
+static float twiddle[DSP_FFT_MAX];   // e^{-2πik/DSP_FFT_MAX}, k < DSP_FFT_MAX/2, (cos, sin) çiftleri
+static bool twiddle_ready = false;
+
+static void init_twiddle() {
+  for (size_t k = 0; k < DSP_FFT_MAX / 2; k++) {
+    double a = -2.0 * M_PI * (double)k / (double)DSP_FFT_MAX;
+    twiddle[2 * k] = (float)cos(a);
+    twiddle[2 * k + 1] = (float)sin(a);
+  }
+  twiddle_ready = true;
+}
+
+bool dsp_rfft_init(size_t n) {
+  if (n < 4 || n > DSP_FFT_MAX || (n & (n - 1)) != 0) return false;
+  if (!twiddle_ready) init_twiddle();
+#if DSP_HAS_ESP_DSP
+  static bool esp_dsp_ready = false;
+  if (!esp_dsp_ready) {
+    if (dsps_fft2r_init_fc32(NULL, DSP_FFT_MAX / 2) != ESP_OK) return false;
+    esp_dsp_ready = true;
+  }
+#endif
+  return true;
+}
+
+// e^{-2πik/n}, DSP_FFT_MAX tablosundan
+static inline void twiddle_at(size_t k, size_t n, float* re, float* im) {
+  size_t idx = k * (DSP_FFT_MAX / n);
+  *re = twiddle[2 * idx];
+  *im = twiddle[2 * idx + 1];
+}
+
+static void cfft_ref(float* z, size_t m) {
+  // bit ters sıralama
+  for (size_t i = 1, j = 0; i < m; i++) {
+    size_t bit = m >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float tr = z[2 * i], ti = z[2 * i + 1];
+      z[2 * i] = z[2 * j]; z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = tr; z[2 * j + 1] = ti;
+    }
+  }
+  for (size_t len = 2; len <= m; len <<= 1) {
+    size_t half = len >> 1;
+    for (size_t i = 0; i < m; i += len) {
+      for (size_t k = 0; k < half; k++) {
+        float wr, wi;
+        twiddle_at(k, len, &wr, &wi);
+        float* a = z + 2 * (i + k);
+        float* b = z + 2 * (i + k + half);
+        float br = b[0] * wr - b[1] * wi;
+        float bi = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - br; b[1] = a[1] - bi;
+        a[0] += br;       a[1] += bi;
+      }
+    }
+  }
+}
+
+// m = n/2 noktalı karmaşık spektrumdan n noktalı gerçel spektrum
+static void real_split(float* z, size_t n) {
+  size_t m = n / 2;
+  float r0 = z[0], i0 = z[1];
+  z[0] = r0 + i0;   // X[0]
+  z[1] = r0 - i0;   // X[n/2]
+  for (size_t k = 1; k <= m / 2; k++) {
+    size_t j = m - k;
+    float ar = z[2 * k], ai = z[2 * k + 1];
+    float br = z[2 * j], bi = z[2 * j + 1];
+    // çift ve tek parçalar
+    float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+    float orr = 0.5f * (ai + bi), oi = -0.5f * (ar - br);
+    float wr, wi;
+    twiddle_at(k, n, &wr, &wi);
+    float tr = orr * wr - oi * wi;
+    float ti = orr * wi + oi * wr;
+    z[2 * k] = er + tr;
+    z[2 * k + 1] = ei + ti;
+    if (j != k) {
+      twiddle_at(j, n, &wr, &wi);
+      // X[m-k] = conj(E[k]) + W^{m-k} conj(O[k])
+      float tr2 = orr * wr + oi * wi;
+      float ti2 = orr * wi - oi * wr;
+      z[2 * j] = er + tr2;
+      z[2 * j + 1] = -ei + ti2;
+    }
+  }
+}
+
+void dsp_rfft_f32_ref(float* data, size_t n) {
+  cfft_ref(data, n / 2);
+  real_split(data, n);
+}
+
+void dsp_rfft_f32(float* data, size_t n) {
+#if DSP_HAS_ESP_DSP
+  // O(n log n) kısım esp-dsp'nin S3 vektör FFT'sinde
+  dsps_fft2r_fc32(data, n / 2);
+  dsps_bit_rev_fc32(data, n / 2);
+  real_split(data, n);
+#else
+  dsp_rfft_f32_ref(data, n);
+#endif
+}
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "resampler.h"
+#include "kws.h"
+
+#define BENCH_N 1024
+
+static float bench_a[BENCH_N];
+static float bench_b[BENCH_N];
+static int16_t bench_s[BENCH_N];
+
+static void fill_bench_signal() {
+  for (size_t i = 0; i < BENCH_N; i++) {
+    float v = 0.4f * sinf(0.07f * i) + 0.2f * sinf(0.9f * i) + 0.05f;
+    bench_a[i] = v;
+    bench_s[i] = (int16_t)(v * 32767.0f);
+  }
+}
+
+void dsp_run_benchmark() {
+  Serial.printf("\n=== DSP çekirdekleri (%u örnek, esp-dsp: %s) ===\n", BENCH_N, DSP_HAS_ESP_DSP ? "var" : "yok");
+  uint32_t t0, c_ref, c_opt;
+  static int16_t bench_r[BENCH_N];
+  static float bench_f[BENCH_N];
+
+  // Tamsayı çekirdekleri ve dönüşümler: ref ile bit bit aynı olmalı
+  fill_bench_signal();
+  memcpy(bench_r, bench_s, sizeof(bench_s));
+  t0 = ESP.getCycleCount();
+  dsp_gain_clip_s16_ref(bench_r, BENCH_N, 3 * 4096);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  dsp_gain_clip_s16(bench_s, BENCH_N, 3 * 4096);
+  c_opt = ESP.getCycleCount() - t0;
+  Serial.printf("gain/clip s16:  %u / %u çevrim (ref/opt), %s\n", c_ref, c_opt,
+                memcmp(bench_r, bench_s, sizeof(bench_s)) == 0 ? "aynı" : "FARKLI");
+
+  DspDcBlock dc;
+  dsp_dc_block_init(&dc, 0.995f);
+  t0 = ESP.getCycleCount();
+  dsp_dc_block_s16(&dc, bench_s, BENCH_N);
+  Serial.printf("dc-block s16:   %u çevrim\n", ESP.getCycleCount() - t0);
+
+  t0 = ESP.getCycleCount();
+  uint64_t e_ref = dsp_energy_s16_ref(bench_s, BENCH_N);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  uint64_t e_opt = dsp_energy_s16(bench_s, BENCH_N);
+  c_opt = ESP.getCycleCount() - t0;
+  Serial.printf("energy s16:     %u / %u çevrim (ref/opt), %s\n", c_ref, c_opt, e_ref == e_opt ? "aynı" : "FARKLI");
+
+  t0 = ESP.getCycleCount();
+  dsp_s16_to_f32_ref(bench_s, bench_f, BENCH_N);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  dsp_s16_to_f32(bench_s, bench_b, BENCH_N);
+  c_opt = ESP.getCycleCount() - t0;
+  Serial.printf("s16 -> f32:     %u / %u çevrim (ref/opt), %s\n", c_ref, c_opt,
+                memcmp(bench_f, bench_b, sizeof(bench_b)) == 0 ? "aynı" : "FARKLI");
+
+  t0 = ESP.getCycleCount();
+  dsp_f32_to_s16_ref(bench_b, bench_r, BENCH_N);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  dsp_f32_to_s16(bench_b, bench_s, BENCH_N);
+  c_opt = ESP.getCycleCount() - t0;
+  Serial.printf("f32 -> s16:     %u / %u çevrim (ref/opt), %s\n", c_ref, c_opt,
+                memcmp(bench_r, bench_s, sizeof(bench_s)) == 0 ? "aynı" : "FARKLI");
+
+  // Mikrofon (48k) ve gTTS yanıtı (24k / 22.05k) yolları; çıkış yerinde yazılır
+  static Resampler rs;
+  static const uint32_t rs_rates[][2] = {{48000, 16000}, {24000, 16000}, {22050, 16000}, {16000, 8000}};
+  for (auto& r : rs_rates) {
+    fill_bench_signal();
+    resampler_init(&rs, r[0], r[1]);
+    t0 = ESP.getCycleCount();
+    size_t n_out = resampler_process(&rs, bench_s, BENCH_N, bench_s);
+    Serial.printf("resample %5u -> %5u: %u çevrim, %u çıkış\n",
+                  r[0], r[1], ESP.getCycleCount() - t0, (unsigned)n_out);
+  }
+
+  fill_bench_signal();
+  t0 = ESP.getCycleCount();
+  float rms_ref = dsp_rms_f32_ref(bench_a, BENCH_N);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  volatile float rms = dsp_rms_f32(bench_a, BENCH_N);
+  c_opt = ESP.getCycleCount() - t0;
+  Serial.printf("rms f32:        %u / %u çevrim (ref/opt), fark %g\n", c_ref, c_opt, fabsf(rms - rms_ref));
+
+  if (!dsp_rfft_init(BENCH_N)) {
+    Serial.println("rfft: başlatılamadı");
+    return;
+  }
+  memcpy(bench_b, bench_a, sizeof(bench_a));
+  t0 = ESP.getCycleCount();
+  dsp_rfft_f32_ref(bench_a, BENCH_N);
+  c_ref = ESP.getCycleCount() - t0;
+  t0 = ESP.getCycleCount();
+  dsp_rfft_f32(bench_b, BENCH_N);
+  c_opt = ESP.getCycleCount() - t0;
+  float max_diff = 0.0f;
+  for (size_t i = 0; i < BENCH_N; i++) {
+    max_diff = fmaxf(max_diff, fabsf(bench_a[i] - bench_b[i]));
+  }
+  Serial.printf("rfft f32:       %u / %u çevrim (ref/opt), en büyük fark %g\n", c_ref, c_opt, max_diff);
+
+  // Yerel komut tanıyıcı: 1 s'lik sesin öznitelikleri ve aynı uzunlukta bir şablonla DTW.
+  // Tamponlar yalnızca ölçüm sürerken tutulur (MEM_EXTMEM_THRESHOLD'dan büyük, PSRAM'e düşer)
+  const size_t kws_n = 16000;
+  int16_t* kws_pcm = (int16_t*)malloc(kws_n * sizeof(int16_t));
+  KwsFeatures* kws_a = (KwsFeatures*)malloc(sizeof(KwsFeatures));
+  KwsFeatures* kws_b = (KwsFeatures*)malloc(sizeof(KwsFeatures));
+  if (kws_pcm == NULL || kws_a == NULL || kws_b == NULL || !kws_init(16000)) {
+    Serial.println("kws: başlatılamadı");
+    free(kws_pcm);
+    free(kws_a);
+    free(kws_b);
+    return;
+  }
+  for (size_t i = 0; i < kws_n; i++) {
+    kws_pcm[i] = (int16_t)(8000.0f * sinf(0.07f * i + 0.00002f * i * i) * (0.6f + 0.4f * sinf(0.0015f * i)));
+  }
+  t0 = ESP.getCycleCount();
+  bool kws_ok = kws_extract(kws_pcm, kws_n, kws_a);
+  uint32_t c_feat = ESP.getCycleCount() - t0;
+  memcpy(kws_b, kws_a, sizeof(KwsFeatures));
+  t0 = ESP.getCycleCount();
+  float kws_d = kws_distance(kws_a, kws_b);
+  uint32_t c_dtw = ESP.getCycleCount() - t0;
+  Serial.printf("kws 1 s:        %u çevrim öznitelik (%u çerçeve, %s), %u çevrim DTW (%g)\n",
+                c_feat, kws_a->frames, kws_ok ? "ok" : "konuşma yok", c_dtw, kws_d);
+  free(kws_pcm);
+  free(kws_a);
+  free(kws_b);
+}
+#endif
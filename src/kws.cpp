@@ -0,0 +1,205 @@
+// kws.cpp
+#include "kws.h"
+#include "dsp_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#define KWS_PREEMPH   0.97f
+#define KWS_MEL_LO_HZ 60.0f
+#define KWS_MEL_HI_HZ 7600.0f
+#define KWS_MIN_RMS   100     // en güçlü çerçeve bunun altındaysa konuşma yok sayılır
+#define KWS_INF       0x3fffffff
+#define KWS_MAX_INPUT_FRAMES (KWS_MAX_INPUT_MS / KWS_HOP_MS)
+
+static uint32_t frame_len = 0;
+static uint32_t hop_len = 0;
+static float window[KWS_FFT];
+static float fft_buf[KWS_FFT];
+// Her FFT kutusu en fazla iki üçgene düşer: bin_band'in yükselen, bir öncekinin inen kenarı
+static int8_t bin_band[KWS_FFT / 2 + 1];
+static float bin_weight[KWS_FFT / 2 + 1];
+static float dct[KWS_CEPS][KWS_MEL_BANDS];
+
+// Tek görevden çağrıldığı için çalışma alanları paylaşılır
+static float frame_db[KWS_MAX_INPUT_FRAMES];
+static float ceps[KWS_MAX_FRAMES][KWS_CEPS];
+static int32_t dtw_prev[KWS_MAX_FRAMES];
+static int32_t dtw_cur[KWS_MAX_FRAMES];
+
+static float hz_to_mel(float hz) { return 2595.0f * log10f(1.0f + hz / 700.0f); }
+
+bool kws_init(uint32_t sample_rate) {
+  frame_len = sample_rate * KWS_FRAME_MS / 1000;
+  hop_len = sample_rate * KWS_HOP_MS / 1000;
+  if (frame_len > KWS_FFT || hop_len == 0 || !dsp_rfft_init(KWS_FFT)) return false;
+
+  for (uint32_t i = 0; i < frame_len; i++) {
+    window[i] = 0.54f - 0.46f * cosf(2.0f * (float)M_PI * i / (frame_len - 1));
+  }
+
+  float hi = fminf(KWS_MEL_HI_HZ, sample_rate / 2.0f);
+  float mel_lo = hz_to_mel(KWS_MEL_LO_HZ);
+  float mel_step = (hz_to_mel(hi) - mel_lo) / (KWS_MEL_BANDS + 1);
+  for (int k = 0; k <= KWS_FFT / 2; k++) {
+    float mel = hz_to_mel((float)k * sample_rate / KWS_FFT);
+    float pos = (mel - mel_lo) / mel_step;   // üçgen köşeleri tam sayılarda
+    if (pos < 0.0f || pos >= KWS_MEL_BANDS + 1) {
+      bin_band[k] = -1;
+      continue;
+    }
+    int j = (int)pos;
+    bin_band[k] = (int8_t)j;
+    bin_weight[k] = pos - j;
+  }
+
+  for (int i = 0; i < KWS_CEPS; i++) {
+    for (int b = 0; b < KWS_MEL_BANDS; b++) {
+      dct[i][b] = sqrtf(2.0f / KWS_MEL_BANDS) * cosf((float)M_PI * (i + 1) * (b + 0.5f) / KWS_MEL_BANDS);
+    }
+  }
+  return true;
+}
+
+static void frame_ceps(const int16_t* x, bool has_prev, float* out) {
+  float prev = has_prev ? x[-1] / 32768.0f : 0.0f;
+  for (uint32_t i = 0; i < frame_len; i++) {
+    float v = x[i] / 32768.0f;
+    fft_buf[i] = (v - KWS_PREEMPH * prev) * window[i];
+    prev = v;
+  }
+  memset(fft_buf + frame_len, 0, (KWS_FFT - frame_len) * sizeof(float));
+  dsp_rfft_f32(fft_buf, KWS_FFT);
+
+  float mel[KWS_MEL_BANDS] = {};
+  for (int k = 0; k <= KWS_FFT / 2; k++) {
+    int j = bin_band[k];
+    if (j < 0) continue;
+    float p;
+    if (k == 0) {
+      p = fft_buf[0] * fft_buf[0];
+    } else if (k == KWS_FFT / 2) {
+      p = fft_buf[1] * fft_buf[1];
+    } else {
+      p = fft_buf[2 * k] * fft_buf[2 * k] + fft_buf[2 * k + 1] * fft_buf[2 * k + 1];
+    }
+    if (j < KWS_MEL_BANDS) mel[j] += bin_weight[k] * p;
+    if (j > 0) mel[j - 1] += (1.0f - bin_weight[k]) * p;
+  }
+  for (int b = 0; b < KWS_MEL_BANDS; b++) {
+    mel[b] = logf(mel[b] + 1e-9f);
+  }
+  for (int i = 0; i < KWS_CEPS; i++) {
+    float acc = 0.0f;
+    for (int b = 0; b < KWS_MEL_BANDS; b++) {
+      acc += dct[i][b] * mel[b];
+    }
+    out[i] = acc;
+  }
+}
+
+bool kws_extract(const int16_t* pcm, size_t n, KwsFeatures* out) {
+  out->frames = 0;
+  if (frame_len == 0 || n < frame_len) return false;
+  size_t total = (n - frame_len) / hop_len + 1;
+  if (total > KWS_MAX_INPUT_FRAMES) total = KWS_MAX_INPUT_FRAMES;
+
+  // Sessiz baş ve son: en güçlü çerçeveye göre
+  float max_db = -1000.0f;
+  for (size_t f = 0; f < total; f++) {
+    float e = (float)dsp_energy_s16(pcm + f * hop_len, frame_len) / frame_len;
+    frame_db[f] = 10.0f * log10f(e + 1.0f);
+    if (frame_db[f] > max_db) max_db = frame_db[f];
+  }
+  if (max_db < 20.0f * log10f((float)KWS_MIN_RMS)) return false;
+  float floor_db = max_db - KWS_TRIM_DB;
+  size_t first = 0, last = total - 1;
+  while (first < last && frame_db[first] < floor_db) first++;
+  while (last > first && frame_db[last] < floor_db) last--;
+  size_t frames = last - first + 1;
+  if (frames > KWS_MAX_FRAMES) frames = KWS_MAX_FRAMES;
+  if (frames < KWS_MIN_FRAMES) return false;
+
+  // Kepstral ortalama çıkarma mikrofonun ve odanın sabit renklenmesini siler
+  float mean[KWS_CEPS] = {};
+  for (size_t f = 0; f < frames; f++) {
+    size_t at = (first + f) * hop_len;
+    frame_ceps(pcm + at, at > 0, ceps[f]);
+    for (int i = 0; i < KWS_CEPS; i++) mean[i] += ceps[f][i];
+  }
+  for (int i = 0; i < KWS_CEPS; i++) mean[i] /= frames;
+  for (size_t f = 0; f < frames; f++) {
+    for (int i = 0; i < KWS_CEPS; i++) {
+      float q = roundf((ceps[f][i] - mean[i]) * KWS_Q_SCALE);
+      out->c[f][i] = (int8_t)fmaxf(-127.0f, fminf(127.0f, q));
+    }
+  }
+  out->frames = (uint16_t)frames;
+  return true;
+}
+
+static inline int32_t frame_cost(const int8_t* a, const int8_t* b) {
+  int32_t d = 0;
+  for (int i = 0; i < KWS_CEPS; i++) {
+    int32_t v = a[i] - b[i];
+    d += v < 0 ? -v : v;
+  }
+  return d;
+}
+
+// Simetrik DTW, köşegen adımı iki kat sayılır; toplam n + m'ye bölünür.
+// Bant, uzunluk farkına göre eğilmiş köşegenin iki yanıdır.
+float kws_distance(const KwsFeatures* a, const KwsFeatures* b) {
+  int n = a->frames, m = b->frames;
+  if (n == 0 || m == 0) return -1.0f;
+  if (n > m * KWS_MAX_LEN_RATIO || m > n * KWS_MAX_LEN_RATIO) return -1.0f;
+
+  for (int j = 0; j < m; j++) dtw_prev[j] = KWS_INF;
+  for (int i = 0; i < n; i++) {
+    int centre = (n > 1) ? i * (m - 1) / (n - 1) : 0;
+    int lo = centre - KWS_DTW_BAND < 0 ? 0 : centre - KWS_DTW_BAND;
+    int hi = centre + KWS_DTW_BAND >= m ? m - 1 : centre + KWS_DTW_BAND;
+    for (int j = 0; j < m; j++) dtw_cur[j] = KWS_INF;
+    for (int j = lo; j <= hi; j++) {
+      int32_t d = frame_cost(a->c[i], b->c[j]);
+      int32_t best;
+      if (i == 0 && j == 0) {
+        best = 2 * d;
+      } else {
+        best = KWS_INF;
+        if (i > 0 && dtw_prev[j] < best - d) best = dtw_prev[j] + d;
+        if (j > 0 && dtw_cur[j - 1] < best - d) best = dtw_cur[j - 1] + d;
+        if (i > 0 && j > 0 && dtw_prev[j - 1] < best - 2 * d) best = dtw_prev[j - 1] + 2 * d;
+      }
+      dtw_cur[j] = best;
+    }
+    memcpy(dtw_prev, dtw_cur, m * sizeof(int32_t));
+  }
+  if (dtw_prev[m - 1] >= KWS_INF) return -1.0f;
+  return (float)dtw_prev[m - 1] / (float)(n + m) / KWS_CEPS;
+}
+
+KwsResult kws_match(const KwsFeatures* x, const KwsTemplate* templates, size_t count) {
+  KwsResult r = {-1, 0.0f, 0.0f, false};
+  int second_label = -1;
+  for (size_t t = 0; t < count; t++) {
+    float d = kws_distance(x, templates[t].feat);
+    if (d < 0.0f) continue;
+    int label = templates[t].label;
+    if (label == r.label) {
+      if (d < r.best) r.best = d;
+    } else if (r.label < 0 || d < r.best) {
+      if (r.label >= 0) {
+        second_label = r.label;
+        r.second = r.best;
+      }
+      r.label = label;
+      r.best = d;
+    } else if (second_label < 0 || d < r.second) {
+      second_label = label;
+      r.second = d;
+    }
+  }
+  r.confident = r.label >= 0 && second_label >= 0 &&
+                r.best <= KWS_ACCEPT_DIST && r.best <= KWS_MARGIN * r.second;
+  return r;
+}
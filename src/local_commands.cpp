@@ -0,0 +1,238 @@
+// local_commands.cpp
+#include "local_commands.h"
+#include "kws.h"
+#include "vad.h"
+#include "mem_policy.h"
+#include "log.h"
+#include <LittleFS.h>
+#include <Preferences.h>
+#include <stddef.h>
+
+#define SLOT_COUNT   (LOCAL_COMMAND_MAX * LOCAL_COMMAND_TEMPLATES)
+#define LISTEN_BLOCK (SAMPLE_RATE * VAD_FRAME_MS / 1000)
+#define KWS_DIR      "/kws"
+
+// Dosyaya yalnızca kullanılan çerçeveler yazılır. Şablon başına ~1.8 KB; hepsi
+// NVS bölümüne (20 KB, WiFi sürücüsüyle ortak) sığmaz, yanıt önbelleğinin
+// LittleFS'inde durur
+struct TemplateSlot {
+  uint8_t version;     // KWS_FEATURE_VERSION; 0: boş
+  uint32_t hash;       // komut metninin FNV-1a özeti
+  uint32_t seq;        // öğrenme sırası; komutun şablonları doluysa en küçüğü değişir
+  KwsFeatures feat;
+};
+
+static TemplateSlot* slots = NULL;     // PSRAM, SLOT_COUNT + son dinleme
+static int16_t* listen_pcm = NULL;     // PSRAM, KWS_MAX_INPUT_MS
+static bool ready = false;
+static bool last_valid = false;        // slots[SLOT_COUNT] öğrenilmeyi bekliyor
+static uint32_t next_seq = 1;
+static uint32_t stat_local = 0;
+static uint32_t stat_fallback = 0;
+static uint32_t stat_learned = 0;
+
+static uint32_t phrase_hash(const char* s) {
+  uint32_t h = 2166136261u;
+  for (; *s; s++) {
+    h = (h ^ (uint8_t)*s) * 16777619u;
+  }
+  return h;
+}
+
+static bool slot_valid(int i) {
+  return slots[i].version == KWS_FEATURE_VERSION && slots[i].feat.frames >= KWS_MIN_FRAMES;
+}
+
+static size_t slot_bytes(const TemplateSlot* s) {
+  return offsetof(TemplateSlot, feat) + offsetof(KwsFeatures, c) + (size_t)s->feat.frames * KWS_CEPS;
+}
+
+static String slot_path(int i) {
+  return String(KWS_DIR "/t") + i + ".bin";
+}
+
+// Uzunluğu tutmayan ya da eski sürümlü şablon boş sayılır
+static bool slot_check(int i, size_t len) {
+  if (len < offsetof(TemplateSlot, feat) + offsetof(KwsFeatures, c) || !slot_valid(i) || len != slot_bytes(&slots[i])) {
+    slots[i].version = 0;
+    return false;
+  }
+  if (slots[i].seq >= next_seq) next_seq = slots[i].seq + 1;
+  return true;
+}
+
+static size_t load_slot(int i) {
+  File f = LittleFS.open(slot_path(i), "r");
+  if (!f) return 0;
+  size_t len = f.read((uint8_t*)&slots[i], sizeof(TemplateSlot));
+  f.close();
+  return len;
+}
+
+// Geçici addan taşınır; güç kesilirse eski şablon kalır
+static bool save_slot(int i) {
+  String tmp = String(KWS_DIR "/t") + i + ".tmp";
+  size_t len = slot_bytes(&slots[i]);
+  File f = LittleFS.open(tmp, "w");
+  bool ok = f && f.write((const uint8_t*)&slots[i], len) == len;
+  if (f) f.close();
+  ok = ok && LittleFS.rename(tmp, slot_path(i));
+  if (!ok) LittleFS.remove(tmp);
+  return ok;
+}
+
+static int slot_count() {
+  int n = 0;
+  for (int i = 0; i < SLOT_COUNT; i++) {
+    if (slot_valid(i)) n++;
+  }
+  return n;
+}
+
+void local_commands_begin() {
+  if (ready) return;
+  slots = (TemplateSlot*)mem_alloc(sizeof(TemplateSlot) * (SLOT_COUNT + 1), MEM_POOL_PSRAM, "kws_templates");
+  listen_pcm = (int16_t*)mem_alloc((size_t)SAMPLE_RATE * KWS_MAX_INPUT_MS / 1000 * 2, MEM_POOL_PSRAM, "kws_listen");
+  if (slots == NULL || listen_pcm == NULL || !kws_init(SAMPLE_RATE)) {
+    LOG_E("❌ Yerel komut tanıyıcı başlatılamadı, komutlar sunucuya gidecek");
+    return;
+  }
+  memset(slots, 0, sizeof(TemplateSlot) * (SLOT_COUNT + 1));
+  // reply_cache_begin() de bağlar; hangisi önce çağrılırsa
+  if (!LittleFS.begin(true)) {
+    LOG_E("❌ LittleFS açılamadı, yerel komut tanıyıcı kapalı");
+    return;
+  }
+  if (!LittleFS.exists(KWS_DIR)) LittleFS.mkdir(KWS_DIR);
+  for (int i = 0; i < SLOT_COUNT; i++) slot_check(i, load_slot(i));
+
+  // Eski sürümler şablonları NVS'te ("kws") tutuyordu; bir kez taşınır, NVS boşaltılır
+  Preferences prefs;
+  if (prefs.begin("kws", false)) {
+    int legacy = 0, moved = 0, failed = 0;
+    for (int i = 0; i < SLOT_COUNT; i++) {
+      char key[8];
+      snprintf(key, sizeof(key), "t%d", i);
+      if (!prefs.isKey(key)) continue;
+      legacy++;
+      if (slot_valid(i)) continue;
+      if (!slot_check(i, prefs.getBytes(key, &slots[i], sizeof(TemplateSlot)))) continue;
+      if (save_slot(i)) moved++;
+      else failed++;
+    }
+    // Yazılamayan varsa NVS'teki kopya bir sonraki açılışa kalır
+    if (legacy > 0 && failed == 0) prefs.clear();
+    prefs.end();
+    if (moved > 0) LOG_I("🗣️ %d komut şablonu NVS'ten LittleFS'e taşındı", moved);
+  }
+  ready = true;
+  LOG_I("🗣️ Yerel komut tanıyıcı hazır: %d şablon", slot_count());
+}
+
+LocalCommandResult local_command_listen(CaptureReader* reader, const char* const* commands, uint32_t max_ms) {
+  LocalCommandResult res = {-1, false, 0, 0};
+  last_valid = false;
+  if (!ready) return res;
+
+  // Yalnızca bu listedeki komutların şablonları yarışır; etiket listedeki sıradır
+  static KwsTemplate tpl[SLOT_COUNT];
+  size_t count = 0;
+  for (int k = 0; commands[k] != NULL; k++) {
+    uint32_t h = phrase_hash(commands[k]);
+    for (int i = 0; i < SLOT_COUNT; i++) {
+      if (slot_valid(i) && slots[i].hash == h) tpl[count++] = {k, &slots[i].feat};
+    }
+  }
+
+  // Şablon olmasa da dinlenir: sunucu komutu tanırsa bu ses ilk şablon olur
+  if (max_ms > KWS_MAX_INPUT_MS) max_ms = KWS_MAX_INPUT_MS;
+  size_t max_samples = (size_t)SAMPLE_RATE * max_ms / 1000;
+  VadState vad;
+  vad_init(&vad, SAMPLE_RATE);
+  size_t got = 0;
+  while (got < max_samples) {
+    size_t want = max_samples - got < LISTEN_BLOCK ? max_samples - got : LISTEN_BLOCK;
+    size_t n = capture_read(reader, listen_pcm + got, want, 1000);
+    if (n == 0) break;
+    bool cut = vad_process(&vad, listen_pcm + got, n);
+    got += n;
+    if (cut) break;   // konuşma VAD_HANGOVER_MS önce bitti
+  }
+  res.listen_ms = got * 1000 / SAMPLE_RATE;
+
+  uint32_t t0 = micros();
+  KwsFeatures* feat = &slots[SLOT_COUNT].feat;
+  if (vad.segments > 0 || vad_in_speech(&vad)) last_valid = kws_extract(listen_pcm, got, feat);
+  res.heard = last_valid;
+  KwsResult r = {-1, 0.0f, 0.0f, false};
+  if (last_valid && count > 0) {
+    r = kws_match(feat, tpl, count);
+    if (r.confident) res.index = r.label;
+  }
+  res.compute_us = micros() - t0;
+
+  if (res.index >= 0) {
+    stat_local++;
+    LOG_I("🗣️ Yerel komut: '%s' (uzaklık %.1f / %.1f, %u ms ses, %u us)",
+          commands[res.index], r.best, r.second, res.listen_ms, res.compute_us);
+  } else {
+    stat_fallback++;
+    if (r.label >= 0) {
+      LOG_I("🗣️ Yerel tanıma emin değil ('%s', %.1f / %.1f), sunucuya soruluyor",
+            commands[r.label], r.best, r.second);
+    } else {
+      LOG_I("🗣️ Yerel tanıma yok (%u şablon, konuşma %s), sunucuya soruluyor",
+            (unsigned)count, res.heard ? "var" : "yok");
+    }
+  }
+  return res;
+}
+
+void local_command_learn(const char* const* commands, const String& transcript) {
+  if (!ready || !last_valid) return;
+  last_valid = false;   // aynı ses bir kez öğrenilir
+
+  String text = transcript;
+  text.toLowerCase();
+  int k = 0;
+  for (; commands[k] != NULL; k++) {
+    if (text.indexOf(commands[k]) != -1) break;
+  }
+  if (commands[k] == NULL) return;
+
+  uint32_t h = phrase_hash(commands[k]);
+  int own = 0, oldest = -1, empty = -1;
+  for (int i = 0; i < SLOT_COUNT; i++) {
+    if (!slot_valid(i)) {
+      if (empty < 0) empty = i;
+    } else if (slots[i].hash == h) {
+      own++;
+      if (oldest < 0 || slots[i].seq < slots[oldest].seq) oldest = i;
+    }
+  }
+  int target = own >= LOCAL_COMMAND_TEMPLATES ? oldest : empty;
+  if (target < 0) {
+    LOG_W("⚠️ Yerel komut şablonları dolu (LOCAL_COMMAND_MAX)");
+    return;
+  }
+
+  TemplateSlot* s = &slots[target];
+  const KwsFeatures* feat = &slots[SLOT_COUNT].feat;
+  s->version = KWS_FEATURE_VERSION;
+  s->hash = h;
+  s->seq = next_seq++;
+  s->feat.frames = feat->frames;
+  memcpy(s->feat.c, feat->c, (size_t)feat->frames * KWS_CEPS);
+
+  if (!save_slot(target)) LOG_W("⚠️ Komut şablonu LittleFS'e yazılamadı, yalnızca bu açılışta geçerli");
+  stat_learned++;
+  LOG_I("🧠 '%s' için şablon öğrenildi (%d/%d)",
+        commands[k], own < LOCAL_COMMAND_TEMPLATES ? own + 1 : own, LOCAL_COMMAND_TEMPLATES);
+}
+
+void local_commands_print_stats() {
+  if (!ready) return;
+  uint32_t total = stat_local + stat_fallback;
+  Serial.printf("🗣️ Yerel komut: %u/%u cihazda tanındı, %u şablon öğrenildi, %d şablon kayıtlı\n",
+                stat_local, total, stat_learned, slot_count());
+}
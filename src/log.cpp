@@ -0,0 +1,203 @@
+// log.cpp
+#include "log.h"
+#include "mem_policy.h"
+#include "blackbox.h"
+#include "freertos/ringbuf.h"
+
+using namespace log_detail;
+
+static RingbufHandle_t ring = NULL;
+static StaticRingbuffer_t ring_struct;
+static uint32_t dropped = 0;
+static TaskHandle_t log_task_handle = NULL;
+
+struct Arg {
+  uint8_t tag;
+  const uint8_t* data;
+  uint8_t len;   // yalnızca ARG_STR
+};
+
+static bool next_arg(const uint8_t** p, const uint8_t* end, Arg* a) {
+  if (*p >= end) return false;
+  a->tag = *(*p)++;
+  a->len = 0;
+  size_t n;
+  switch (a->tag) {
+    case ARG_I32: n = 4; break;
+    case ARG_I64:
+    case ARG_F64: n = 8; break;
+    case ARG_PTR: n = sizeof(uintptr_t); break;
+    case ARG_STR:
+      if (*p >= end) return false;
+      a->len = *(*p)++;
+      n = a->len;
+      break;
+    default: return false;
+  }
+  if ((size_t)(end - *p) < n) return false;
+  a->data = *p;
+  *p += n;
+  return true;
+}
+
+// Tek belirteci etiketli argümanla yazar. Uzunluk belirteçleri (l, ll, z, h…)
+// atılır; tamsayılar long long, kesirliler double olarak verilir.
+static int format_one(char* out, size_t len, const char* flags, size_t flags_len, char conv, const Arg& a) {
+  char spec[24];
+  if (flags_len > sizeof(spec) - 5) flags_len = sizeof(spec) - 5;
+  spec[0] = '%';
+  memcpy(spec + 1, flags, flags_len);
+  char* s = spec + 1 + flags_len;
+
+  if (strchr("diuxXoc", conv) != NULL && (a.tag == ARG_I32 || a.tag == ARG_I64)) {
+    bool is_signed = conv == 'd' || conv == 'i';
+    long long v;
+    if (a.tag == ARG_I64) {
+      int64_t x;
+      memcpy(&x, a.data, 8);
+      v = x;
+    } else {
+      uint32_t x;
+      memcpy(&x, a.data, 4);
+      v = is_signed ? (long long)(int32_t)x : (long long)x;
+    }
+    if (conv == 'c') {
+      *s++ = 'c';
+      *s = '\0';
+      return snprintf(out, len, spec, (int)v);
+    }
+    *s++ = 'l';
+    *s++ = 'l';
+    *s++ = conv;
+    *s = '\0';
+    return is_signed ? snprintf(out, len, spec, v) : snprintf(out, len, spec, (unsigned long long)v);
+  }
+  if (strchr("fFeEgGaA", conv) != NULL && a.tag == ARG_F64) {
+    double d;
+    memcpy(&d, a.data, 8);
+    *s++ = conv;
+    *s = '\0';
+    return snprintf(out, len, spec, d);
+  }
+  if (conv == 's' && a.tag == ARG_STR) {
+    char str[LOG_STR_MAX + 1];
+    memcpy(str, a.data, a.len);
+    str[a.len] = '\0';
+    *s++ = 's';
+    *s = '\0';
+    return snprintf(out, len, spec, str);
+  }
+  if (conv == 'p' && a.tag == ARG_PTR) {
+    uintptr_t x;
+    memcpy(&x, a.data, sizeof(x));
+    return snprintf(out, len, "%p", (void*)x);
+  }
+  return snprintf(out, len, "?");
+}
+
+size_t log_format(const uint8_t* rec, size_t rec_len, char* out, size_t out_len) {
+  if (out_len == 0) return 0;
+  out[0] = '\0';
+  if (rec_len < sizeof(RecordHeader)) return 0;
+  RecordHeader h;
+  memcpy(&h, rec, sizeof(h));
+  const uint8_t* p = rec + sizeof(h);
+  const uint8_t* end = rec + rec_len;
+  uint8_t used = 0;
+  size_t pos = 0;
+
+  for (const char* f = h.fmt; *f != '\0' && pos < out_len - 1; f++) {
+    if (*f != '%') {
+      out[pos++] = *f;
+      continue;
+    }
+    if (f[1] == '%') {
+      out[pos++] = '%';
+      f++;
+      continue;
+    }
+    const char* flags = ++f;
+    while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL) f++;
+    size_t flags_len = f - flags;
+    while (*f != '\0' && strchr("hlLzjt", *f) != NULL) f++;
+    if (*f == '\0') break;
+
+    Arg a;
+    int n;
+    if (used < h.nargs && next_arg(&p, end, &a)) {
+      used++;
+      n = format_one(out + pos, out_len - pos, flags, flags_len, *f, a);
+    } else {
+      n = snprintf(out + pos, out_len - pos, "?");
+    }
+    if (n < 0) break;
+    pos += (size_t)n;
+  }
+  if (pos >= out_len) pos = out_len - 1;
+  out[pos] = '\0';
+  return pos;
+}
+
+static void emit(const uint8_t* rec, size_t len) {
+  char line[LOG_LINE_MAX];
+  size_t n = log_format(rec, len, line, sizeof(line) - 1);
+  line[n++] = '\n';
+  Serial.write((const uint8_t*)line, n);
+}
+
+void log_detail::push(const uint8_t* rec, size_t len) {
+#if BLACKBOX_ENABLED
+  // Kara kutuya biçimlendirmeden, kayıt anında: halkada bekleyen satırlar da
+  // panik ve watchdog resetinden sağ çıkar. Flash'a blackbox görevi yazar.
+  if (rec[offsetof(RecordHeader, level)] <= BLACKBOX_LEVEL) blackbox_append_record(rec, len);
+#endif
+  if (ring == NULL) {
+    emit(rec, len);
+    return;
+  }
+  if (xRingbufferSend(ring, rec, len, 0) != pdTRUE) __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+}
+
+uint32_t log_dropped() {
+  return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+static void log_loop(void* arg) {
+  uint32_t reported = 0;
+  for (;;) {
+    size_t len;
+    uint8_t* rec = (uint8_t*)xRingbufferReceive(ring, &len, pdMS_TO_TICKS(1000));
+    if (rec != NULL) {
+      emit(rec, len);
+      vRingbufferReturnItem(ring, rec);
+    }
+    uint32_t d = log_dropped();
+    if (d != reported && (rec == NULL || d - reported >= 16)) {
+      Serial.printf("⚠️ Günlük halkası doldu: %u kayıt atıldı\n", d - reported);
+      reported = d;
+    }
+  }
+}
+
+void log_flush(uint32_t timeout_ms) {
+  if (ring == NULL) return;
+  uint32_t start = millis();
+  UBaseType_t waiting;
+  vRingbufferGetInfo(ring, NULL, NULL, NULL, NULL, &waiting);
+  while (waiting > 0 && millis() - start < timeout_ms) {
+    delay(2);
+    vRingbufferGetInfo(ring, NULL, NULL, NULL, NULL, &waiting);
+  }
+  Serial.flush();
+}
+
+void log_begin() {
+  if (log_task_handle != NULL) return;
+  uint8_t* storage = (uint8_t*)mem_alloc(LOG_RING_BYTES, MEM_POOL_PSRAM, "log");
+  if (storage == NULL) {
+    Serial.println("❌ Günlük halkası ayrılamadı, günlük doğrudan yazılacak");
+    return;
+  }
+  ring = xRingbufferCreateStatic(LOG_RING_BYTES, RINGBUF_TYPE_NOSPLIT, storage, &ring_struct);
+  xTaskCreate(log_loop, "log", 4096, nullptr, 1, &log_task_handle);
+}
@@ -7,6 +7,17 @@
 #include "user_auth.h"
 #include "utils.h"
 #include "audio_handler.h"
+#include "power_manager.h"
+#include "dsp_kernels.h"
+#include "mem_policy.h"
+#include "audio_capture.h"
+#include "barge_in.h"
+#include "ws_session.h"
+#include "local_commands.h"
+#include "reply_cache.h"
+#include "metrics.h"
+#include "log.h"
+#include "blackbox.h"
 Servo doorServo;
 
 // Keypad setup
@@ -22,37 +33,128 @@ byte rowPins[ROWS] = {4, 5, 6, 7};
 byte colPins[COLS] = {8, 9, 10, 11}; 
 Keypad keypad = Keypad(makeKeymap(keys), rowPins, colPins, ROWS, COLS);
 
+// Yanıt çalarken basılan tuş çalmayı keser ve buradan ilk tuş olarak okunur
+static char readKeypad() {
+  return keypad.getKey();
+}
+
+static char nextKey() {
+  char key = barge_in_take_key();
+  if (!key) key = keypad.getKey();
+#if METRICS_ENABLED
+  if (key) metrics_inc(METRIC_KEYPAD_EVENTS);
+#endif
+  return key;
+}
+
+// Giriş menüsünün sesli komutları; biri ara metinde duyulunca kayıt beklenmeden biter
+static const char* const MENU_COMMANDS[] = {"yeni kullanıcı", "ana menü", "giriş yap", "en son kim girmiş", NULL};
+
+static esp_timer_handle_t doorHoldTimer = NULL;
+
+// Kapanma hareketi bittiğinde esp_timer görevinden çağrılır; günlük kaydı beklemeden halkaya bırakılır
+static void onDoorClosed(Servo *servo, void *arg) {
+  LOG_I("Kapı kapandı.");
+}
+
+// Açık kalma süresi dolunca kapı kapanır (esp_timer görevi)
+static void onDoorHoldElapsed(void *arg) {
+  doorServo.moveTo(SERVO_CLOSED, SERVO_MOVE_MS, onDoorClosed);
+}
+
+// Açılma hareketi bitince bekleme zamanlayıcısı kurulur; ana döngü bu sırada karşılama sesine geçer
+static void onDoorOpened(Servo *servo, void *arg) {
+  if (doorHoldTimer == NULL) {
+    onDoorHoldElapsed(NULL);
+    return;
+  }
+  esp_timer_stop(doorHoldTimer);
+  esp_timer_start_once(doorHoldTimer, (uint64_t)SERVO_HOLD_MS * 1000ULL);
+}
+
 void setup() {
   Serial.begin(115200);
   
+  // Büyük tamponlar WiFi başlamadan ayrılır, dahili RAM parçalanmaz
+  mem_policy_init();
+  // Sonraki modüllerin günlüğü kendi görevinden yazılır
+  log_begin();
+#if BLACKBOX_ENABLED
+  // Önceki çalışmanın RTC'de kalan kayıtları mikrofon açılmadan flash'a yazılır
+  blackbox_begin();
+#endif
+  audio_buffers_init();
+  
+  // Mikrofon hep açık; oturumlar halkadan okur
+  if (!capture_start()) {
+    Serial.println("❌ Kayıt halkası ayrılamadı!");
+  }
+  
+#if LOCAL_COMMANDS_ENABLED
+  local_commands_begin();
+#endif
+#if REPLY_CACHE_ENABLED
+  // WebSocket oturumu açılırken eldeki yanıtlar sunucuya bildirilir
+  reply_cache_begin();
+#endif
+  
   // Kayıt butonu için pin ayarı
   pinMode(RECORD_BUTTON, INPUT_PULLUP);
   
   wifi_connect();
+#if METRICS_ENABLED
+  // Bağlantı kurulunca /metrics dinlenmeye başlar
+  metrics_begin();
+#endif
+#if UPLINK_TRANSPORT == TRANSPORT_WS
+  // Sunucuyla tek kalıcı oturum; ses, metin ve yanıtlar bundan geçer
+  ws_session_begin();
+#endif
   
   // Initialize components
   initTime();
   
+  power_init(rowPins, ROWS, colPins, COLS);
+  barge_in_set_key_source(readKeypad);
+  
   // Servo başlat
   doorServo.attach(SERVO_PIN);
+  // Kapı beklerken servo sürülmez, bir sonraki write() PWM'i yeniden başlatır
+  doorServo.setIdleMode(SERVO_IDLE_DETACH, SERVO_SETTLE_MS);
   doorServo.write(SERVO_CLOSED);
+  esp_timer_create_args_t holdArgs = {};
+  holdArgs.callback = onDoorHoldElapsed;
+  holdArgs.dispatch_method = ESP_TIMER_TASK;
+  holdArgs.name = "door_hold";
+  if (esp_timer_create(&holdArgs, &doorHoldTimer) != ESP_OK) {
+    LOG_E("Kapı zamanlayıcısı kurulamadı, kapı açılınca hemen kapanacak");
+    doorHoldTimer = NULL;
+  }
+  
+#if DSP_BENCHMARK_ON_BOOT
+  dsp_run_benchmark();
+#endif
   
+  mem_print_report();
   Serial.println("\n=== Sistem Hazır ===");
 }
 
 void loop() {
+  // Bir işlemden dönmek de etkinlik sayılır; boşta sayacı menüden başlar
+  power_note_activity();
   Serial.println("\n=== Ana Menü ===");
   Serial.println("[A] Sesli Asistan");
   Serial.println("[B] Giriş İşlemleri");
   Serial.println("Seçiminizi yapın (A/B):");
   char choice = 0;
   while (true) {
-    char key = keypad.getKey();
+    char key = nextKey();
+    if (key) power_note_activity();
     if (key == 'A' || key == 'B') {
       choice = key;
       break;
     }
-    delay(50);
+    power_idle_poll();
   }
   switch (choice) {
     case 'A':
@@ -62,7 +164,7 @@ void loop() {
       while (true) {
         Serial.println("\n=== Giriş İşlemleri (sesli komut ile) ===");
         Serial.println("Lütfen yapmak istediğiniz işlemi sesli olarak söyleyin: 'yeni kullanıcı kaydı' veya 'ana menüye dön'");
-        String command = getCommandByVoice();
+        String command = getCommandByVoice(MENU_COMMANDS);
         command.toLowerCase();
         command.trim();
         Serial.print("Algılanan komut: "); Serial.println(command);
@@ -77,7 +179,7 @@ void loop() {
           while (passwordAttempts < 3) {  // 3 deneme hakkı kontrolü
             String password = "";
             while (true) {
-              char key = keypad.getKey();
+              char key = nextKey();
               if (key) {
                 if (key == '#') break;
                 if (key >= '0' && key <= '9' && password.length() < 4) {
@@ -95,23 +197,21 @@ void loop() {
             }
             
             // Sunucuya gönder
-            WiFiClient client;
-            HTTPClient http;
-            http.begin(client, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/register_user");
-            http.addHeader("Content-Type", "application/json");
             String json = String("{\"name\":\"") + name + "\",\"password\":\"" + password + "\"}";
-            int httpCode = http.POST(json);
+            String response;
+            int httpCode = server_call("register_user", json, &response);
             if (httpCode == HTTP_CODE_OK) {
-              String response = http.getString();
               Serial.println("\nKayıt başarılı: " + response);
             } else {
               Serial.println("\nKayıt başarısız! HTTP kodu: " + String(httpCode));
             }
-            http.end();
             break; // Kayıt sonrası ana menüye dön
           }
           break; // Kayıt sonrası ana menüye dön
         } else if (command.indexOf("ana menü") != -1) {
+#if LOCAL_COMMANDS_ENABLED
+          local_commands_print_stats();
+#endif
           break; // Ana menüye dön
         } else if (command.indexOf("giriş yap") != -1) {
           Serial.println("Lütfen isminizi sesli olarak söyleyin ve kaydı başlatmak için butona basın...");
@@ -122,14 +222,10 @@ void loop() {
             break;
           }
           // Sunucuda bu isim var mı kontrol et
-          WiFiClient client;
-          HTTPClient http;
-          http.begin(client, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/check_user");
-          http.addHeader("Content-Type", "application/json");
           String checkJson = String("{\"name\":\"") + name + "\"}";
-          int checkCode = http.POST(checkJson);
+          String checkResp;
+          int checkCode = server_call("check_user", checkJson, &checkResp);
           if (checkCode == HTTP_CODE_OK) {
-            String checkResp = http.getString();
             if (checkResp == "OK") {
               Serial.println("4 haneli şifrenizi girin (bitirmek için #):");
               int passwordAttempts = 0;  // Şifre deneme sayacı
@@ -137,7 +233,7 @@ void loop() {
               while (passwordAttempts < 3) {  // 3 deneme hakkı kontrolü
                 String password = "";
                 while (true) {
-                  char key = keypad.getKey();
+                  char key = nextKey();
                   if (key) {
                     if (key == '#') break;
                     if (key >= '0' && key <= '9' && password.length() < 4) {
@@ -155,83 +251,54 @@ void loop() {
                 }
                 
                 // Şifreyi ve ismi sunucuya gönder
-                WiFiClient loginClient;
-                HTTPClient loginHttp;
-                loginHttp.begin(loginClient, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/verify_user");
-                loginHttp.addHeader("Content-Type", "application/json");
                 String loginJson = String("{\"name\":\"") + name + "\",\"password\":\"" + password + "\"}";
-                int loginCode = loginHttp.POST(loginJson);
+                String response;
+                int loginCode = server_call("verify_user", loginJson, &response);
                 
-                // HTTP yanıtını al
-                String response = loginHttp.getString();
-                DynamicJsonDocument doc(256);
+                // Yanıtı çöz
+                PsramJsonDocument doc(256);
                 DeserializationError error = deserializeJson(doc, response);
                 
                 // Başarılı giriş veya şifre hatası durumlarını kontrol et
                 if (loginCode == HTTP_CODE_OK && !error && doc["status"] == "success") {
                   Serial.println("\nGiriş başarılı! Kapı açılıyor...");
-                  doorServo.write(180); // 180 derece döndür
-                  delay(2000);
-                  doorServo.write(SERVO_CLOSED);
-                  Serial.println("Kapı kapandı.");
+                  // Ani akım çekip WiFi'yi düşürmemesi için kapı yumuşak hareketle açılır
+                  // Açma, bekleme ve kapama zamanlayıcılarla sürer; döngü beklemez
+                  doorServo.moveTo(180, SERVO_MOVE_MS, onDoorOpened); // 180 derece döndür
+#if METRICS_ENABLED
+                  metrics_inc(METRIC_SERVO_CYCLES);
+#endif
                   // Welcome mesajı
                   String welcomeText = "Hoş geldiniz " + name;
-                  WiFiClient ttsClient;
-                  HTTPClient ttsHttp;
-                  ttsHttp.begin(ttsClient, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/upload");
-                  ttsHttp.addHeader("Content-Type", "application/json");
-                  String ttsJson = String("{\"text\":\"") + welcomeText + "\",\"lang\":\"tr\"}";
-                  int ttsCode = ttsHttp.POST(ttsJson);
-                  if (ttsCode == HTTP_CODE_OK) {
-                    String ttsUrl = ttsHttp.getString();
-                    if (ttsUrl.startsWith("http")) {
-                      play_wav_from_url(ttsUrl);
-                    }
+                  String ttsUrl = request_tts_url(welcomeText);
+                  if (ttsUrl.length() > 0) {
+                    play_interruptible(ttsUrl);
                   }
-                  ttsHttp.end();
-                  loginHttp.end();
                   break; // Başarılı girişte döngüden çık
                 } else {
                   // Şifre yanlış veya HTTP hatası durumu
                   passwordAttempts++;
                   
                   // Yanlış şifre sesli uyarısı
-                  WiFiClient wrongPassClient;
-                  HTTPClient wrongPassHttp;
-                  wrongPassHttp.begin(wrongPassClient, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/upload");
-                  wrongPassHttp.addHeader("Content-Type", "application/json");
-                  
                   String wrongPassText;
                   if (passwordAttempts >= 3) {
                     wrongPassText = "Hakkınız kalmadı. Ana menüye dönülüyor.";
-                    String wrongPassJson = String("{\"text\":\"") + wrongPassText + "\",\"lang\":\"tr\"}";
-                    int wrongPassCode = wrongPassHttp.POST(wrongPassJson);
-                    if (wrongPassCode == HTTP_CODE_OK) {
-                      String wrongPassUrl = wrongPassHttp.getString();
-                      if (wrongPassUrl.startsWith("http")) {
-                        play_wav_from_url(wrongPassUrl);
-                      }
+                    String wrongPassUrl = request_tts_url(wrongPassText);
+                    if (wrongPassUrl.length() > 0) {
+                      play_interruptible(wrongPassUrl);
                     }
-                    wrongPassHttp.end();
                     Serial.println("\nGiriş hakkınız kalmadı! Ana menüye dönülüyor.");
-                    loginHttp.end();
                     return; // Ana menüye dön
                   } else {
                     wrongPassText = "Şifre yanlış. Kalan hakkınız: " + String(3 - passwordAttempts);
-                    String wrongPassJson = String("{\"text\":\"") + wrongPassText + "\",\"lang\":\"tr\"}";
-                    int wrongPassCode = wrongPassHttp.POST(wrongPassJson);
-                    if (wrongPassCode == HTTP_CODE_OK) {
-                      String wrongPassUrl = wrongPassHttp.getString();
-                      if (wrongPassUrl.startsWith("http")) {
-                        play_wav_from_url(wrongPassUrl);
-                      }
+                    String wrongPassUrl = request_tts_url(wrongPassText);
+                    if (wrongPassUrl.length() > 0) {
+                      play_interruptible(wrongPassUrl);
                     }
-                    wrongPassHttp.end();
                     Serial.println("\nGiriş başarısız! Şifre yanlış. Kalan hak: " + String(3 - passwordAttempts));
                     Serial.println("4 haneli şifrenizi tekrar girin (bitirmek için #):");
                   }
                 }
-                loginHttp.end();
               }
             } else {
               Serial.println("Böyle bir kullanıcı bulunamadı. Ana menüye dönülüyor.");
@@ -239,18 +306,14 @@ void loop() {
           } else {
             Serial.println("Sunucuya erişilemedi. Ana menüye dönülüyor.");
           }
-          http.end();
           break;
         } else if (command.indexOf("en son kim girmiş") != -1) {
   // Sunucudan en son giriş yapanı al
-        WiFiClient client;
-        HTTPClient http;
-        http.begin(client, String("http://") + SERVER_IP + ":" + SERVER_PORT + "/last_login");
-        int httpCode = http.GET();
+        String response;
+        int httpCode = server_call("last_login", "", &response);
         if (httpCode == HTTP_CODE_OK) {
-          String response = http.getString();
     
-          DynamicJsonDocument doc(256);
+          PsramJsonDocument doc(256);
           DeserializationError err = deserializeJson(doc, response);
 
         if (!err && doc.containsKey("name")) {
@@ -261,8 +324,8 @@ void loop() {
           Serial.println("Son giriş yapan kişi: " + name);
 
           // Sesli olarak oynat
-            if (url.startsWith("http")) {
-            play_wav_from_url(url);
+            if (url.startsWith("http") || url.startsWith("ws:")) {
+            play_interruptible(url);
       }
         } else {
           Serial.println("Sunucudan geçerli veri alınamadı.");
@@ -271,7 +334,6 @@ void loop() {
         } else {
     Serial.println("Sunucudan bilgi alınamadı. HTTP kodu: " + String(httpCode));
   }
-  http.end();
   break;
 }
 
@@ -0,0 +1,131 @@
+// mem_policy.cpp
+#include "mem_policy.h"
+#include "esp_heap_caps.h"
+
+#define MEM_MAX_BLOCKS 16
+
+struct MemBlock {
+  void* ptr;
+  size_t size;
+  mem_pool_t pool;
+  const char* tag;
+};
+
+static MemBlock blocks[MEM_MAX_BLOCKS];
+static portMUX_TYPE blocks_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool psram = false;
+
+static const char* const pool_names[MEM_POOL_COUNT] = {"DMA", "dahili", "PSRAM"};
+
+static uint32_t pool_caps(mem_pool_t pool) {
+  switch (pool) {
+    case MEM_POOL_DMA:      return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    case MEM_POOL_INTERNAL: return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    default:                return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+  }
+}
+
+void mem_policy_init() {
+  psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+  if (psram) {
+    // Kütüphanelerin (MP3 çözücü, HTTP akışı) bu eşikten büyük malloc'ları da PSRAM'e gider
+    heap_caps_malloc_extmem_enable(MEM_EXTMEM_THRESHOLD);
+  } else {
+    Serial.println("⚠️ PSRAM bulunamadı, büyük tamponlar küçültülmüş olarak dahili RAM'de");
+  }
+}
+
+bool mem_psram_available() {
+  return psram;
+}
+
+void* mem_alloc(size_t size, mem_pool_t pool, const char* tag) {
+  mem_pool_t placed = pool;
+  if (pool == MEM_POOL_PSRAM && !psram) {
+    if (size > MEM_INTERNAL_FALLBACK_MAX) {
+      Serial.printf("❌ %s: %u bayt PSRAM olmadan ayrılmaz\n", tag, (unsigned)size);
+      return NULL;
+    }
+    placed = MEM_POOL_INTERNAL;
+  }
+
+  void* ptr = heap_caps_malloc(size, pool_caps(placed));
+  if (ptr == NULL) {
+    Serial.printf("❌ %s: %s havuzunda %u bayt ayrılamadı\n", tag, pool_names[placed], (unsigned)size);
+    return NULL;
+  }
+
+  portENTER_CRITICAL(&blocks_mux);
+  for (int i = 0; i < MEM_MAX_BLOCKS; i++) {
+    if (blocks[i].ptr == NULL) {
+      blocks[i] = {ptr, size, placed, tag};
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&blocks_mux);
+  return ptr;
+}
+
+void mem_free(void* ptr) {
+  if (ptr == NULL) return;
+  portENTER_CRITICAL(&blocks_mux);
+  for (int i = 0; i < MEM_MAX_BLOCKS; i++) {
+    if (blocks[i].ptr == ptr) {
+      blocks[i] = {};
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&blocks_mux);
+  heap_caps_free(ptr);
+}
+
+void mem_get_stats(mem_pool_t pool, MemPoolStats* out) {
+  uint32_t caps = pool_caps(pool);
+  *out = {};
+  if (pool == MEM_POOL_PSRAM && !psram) return;
+  out->total = heap_caps_get_total_size(caps);
+  out->free = heap_caps_get_free_size(caps);
+  out->min_free = heap_caps_get_minimum_free_size(caps);
+  out->largest_block = heap_caps_get_largest_free_block(caps);
+
+  portENTER_CRITICAL(&blocks_mux);
+  for (int i = 0; i < MEM_MAX_BLOCKS; i++) {
+    if (blocks[i].ptr != NULL && blocks[i].pool == pool) {
+      out->policy_bytes += blocks[i].size;
+      out->policy_blocks++;
+    }
+  }
+  portEXIT_CRITICAL(&blocks_mux);
+}
+
+void mem_print_report() {
+  for (int p = 0; p < MEM_POOL_COUNT; p++) {
+    MemPoolStats s;
+    mem_get_stats((mem_pool_t)p, &s);
+    if (s.total == 0) continue;
+    Serial.printf("🧠 %-6s: %u/%u KB boş (en düşük %u KB, en büyük blok %u KB), tamponlar %u KB / %u adet\n",
+                  pool_names[p],
+                  (unsigned)(s.free / 1024), (unsigned)(s.total / 1024),
+                  (unsigned)(s.min_free / 1024), (unsigned)(s.largest_block / 1024),
+                  (unsigned)(s.policy_bytes / 1024), s.policy_blocks);
+  }
+  for (int i = 0; i < MEM_MAX_BLOCKS; i++) {
+    if (blocks[i].ptr != NULL) {
+      Serial.printf("   %-16s %7u bayt  %s\n", blocks[i].tag, (unsigned)blocks[i].size, pool_names[blocks[i].pool]);
+    }
+  }
+}
+
+void* PsramJsonAllocator::allocate(size_t size) {
+  if (psram) return heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return malloc(size);
+}
+
+void PsramJsonAllocator::deallocate(void* ptr) {
+  heap_caps_free(ptr);
+}
+
+void* PsramJsonAllocator::reallocate(void* ptr, size_t new_size) {
+  if (psram) return heap_caps_realloc(ptr, new_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  return realloc(ptr, new_size);
+}
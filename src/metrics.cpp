@@ -0,0 +1,274 @@
+// metrics.cpp
+#include "metrics.h"
+#include "mem_policy.h"
+#include "audio_handler.h"
+#include "wifi_manager.h"
+#include "blackbox.h"
+#include "log.h"
+#include <stdarg.h>
+
+#define HIST_BUCKETS 11
+
+// Kova üst sınırları (ms) ve Prometheus'taki karşılıkları (s)
+static const uint32_t bucket_ms[HIST_BUCKETS] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000};
+static const char* const bucket_le[HIST_BUCKETS] = {"0.01", "0.025", "0.05", "0.1", "0.25", "0.5",
+                                                    "1", "2.5", "5", "10", "30"};
+
+static const char* const counter_names[METRIC_COUNTER_COUNT] = {
+  "door_keypad_events_total",
+  "door_servo_cycles_total",
+  "door_wifi_reconnects_total",
+  "door_ws_reconnects_total",
+};
+
+static const char* const endpoint_names[METRIC_EP_COUNT] = {
+  "upload", "capabilities", "register_user", "check_user", "verify_user", "last_login", "tts", "other",
+};
+
+// Yığın kullanımı izlenen görevler; o an çalışmayanlar (ör. playback) atlanır
+static const char* const task_names[] = {"loopTask", "mic_cap", "i2s_evt", "playback", "ws_session", "wifi_mgr", "metrics", "log", "blackbox"};
+
+struct HttpHist {
+  uint32_t buckets[HIST_BUCKETS + 1];   // birikimsiz; sonuncusu +Inf
+  uint32_t errors;
+  uint32_t sum_ms;
+};
+
+static uint32_t counters[METRIC_COUNTER_COUNT];
+static HttpHist http_hist[METRIC_EP_COUNT];
+static char* render_buf = NULL;         // PSRAM; yalnızca metrik görevi kullanır
+static TaskHandle_t metrics_task_handle = NULL;
+
+static inline void atomic_add(uint32_t* p, uint32_t v) {
+  __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t atomic_get(const uint32_t* p) {
+  return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+void metrics_inc(MetricCounter c) {
+  atomic_add(&counters[c], 1);
+}
+
+void metrics_observe_http(MetricEndpoint ep, uint32_t ms, int code) {
+  HttpHist* h = &http_hist[ep];
+  int b = 0;
+  while (b < HIST_BUCKETS && ms > bucket_ms[b]) b++;
+  atomic_add(&h->buckets[b], 1);
+  atomic_add(&h->sum_ms, ms);
+  if (code <= 0 || code >= 400) atomic_add(&h->errors, 1);
+}
+
+MetricEndpoint metrics_endpoint_for(const char* op) {
+  for (int i = METRIC_EP_CAPABILITIES; i < METRIC_EP_OTHER; i++) {
+    if (strcmp(op, endpoint_names[i]) == 0) return (MetricEndpoint)i;
+  }
+  return METRIC_EP_OTHER;
+}
+
+struct Out {
+  char* buf;
+  size_t len;
+  size_t pos;
+};
+
+// Sığmayan satır yazılmaz ve sonrası da kesilir; çıktı hep satır sınırında biter
+static void put(Out* o, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+static void put(Out* o, const char* fmt, ...) {
+  if (o->pos >= o->len) return;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(o->buf + o->pos, o->len - o->pos, fmt, ap);
+  va_end(ap);
+  if (n < 0 || o->pos + n >= o->len) {
+    o->buf[o->pos] = '\0';
+    o->len = o->pos;
+    return;
+  }
+  o->pos += n;
+}
+
+size_t metrics_render(char* buf, size_t len) {
+  if (len == 0) return 0;
+  Out o = {buf, len, 0};
+  buf[0] = '\0';
+
+  put(&o, "# TYPE door_uptime_seconds gauge\ndoor_uptime_seconds %llu\n",
+      (unsigned long long)(esp_timer_get_time() / 1000000));
+
+  // Aynı adın satırları bir arada olmalı: her değer için havuzlar ayrı dolaşılır
+  static const char* const pool_names[MEM_POOL_COUNT] = {"dma", "internal", "psram"};
+  static const char* const heap_names[3] = {"door_heap_free_bytes", "door_heap_min_free_bytes", "door_heap_largest_block_bytes"};
+  MemPoolStats pools[MEM_POOL_COUNT];
+  for (int p = 0; p < MEM_POOL_COUNT; p++) mem_get_stats((mem_pool_t)p, &pools[p]);
+  for (int k = 0; k < 3; k++) {
+    put(&o, "# TYPE %s gauge\n", heap_names[k]);
+    for (int p = 0; p < MEM_POOL_COUNT; p++) {
+      if (pools[p].total == 0) continue;
+      size_t v = k == 0 ? pools[p].free : k == 1 ? pools[p].min_free : pools[p].largest_block;
+      put(&o, "%s{pool=\"%s\"} %u\n", heap_names[k], pool_names[p], (unsigned)v);
+    }
+  }
+
+  put(&o, "# TYPE door_task_stack_free_bytes gauge\n");
+  for (size_t i = 0; i < sizeof(task_names) / sizeof(task_names[0]); i++) {
+    TaskHandle_t t = xTaskGetHandle(task_names[i]);
+    if (t == NULL) continue;
+    // ESP-IDF'de yığın birimi bayttır
+    put(&o, "door_task_stack_free_bytes{task=\"%s\"} %u\n", task_names[i], (unsigned)uxTaskGetStackHighWaterMark(t));
+  }
+
+  I2sStats i2s;
+  i2s_get_stats(&i2s);
+  put(&o, "# TYPE door_i2s_rx_overflow_total counter\ndoor_i2s_rx_overflow_total %u\n", i2s.rx_overflow);
+  put(&o, "# TYPE door_i2s_tx_underflow_total counter\ndoor_i2s_tx_underflow_total %u\n", i2s.tx_underflow);
+
+  put(&o, "# TYPE door_wifi_up gauge\ndoor_wifi_up %d\n", wifi_is_connected() ? 1 : 0);
+  if (wifi_is_connected()) put(&o, "# TYPE door_wifi_rssi_dbm gauge\ndoor_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+
+  for (int c = 0; c < METRIC_COUNTER_COUNT; c++) {
+    put(&o, "# TYPE %s counter\n%s %u\n", counter_names[c], counter_names[c], atomic_get(&counters[c]));
+  }
+
+  put(&o, "# TYPE door_http_request_duration_seconds histogram\n");
+  for (int e = 0; e < METRIC_EP_COUNT; e++) {
+    const HttpHist* h = &http_hist[e];
+    uint32_t cum = 0;
+    for (int b = 0; b <= HIST_BUCKETS; b++) {
+      cum += atomic_get(&h->buckets[b]);
+      put(&o, "door_http_request_duration_seconds_bucket{endpoint=\"%s\",le=\"%s\"} %u\n",
+          endpoint_names[e], b < HIST_BUCKETS ? bucket_le[b] : "+Inf", cum);
+    }
+    uint32_t sum = atomic_get(&h->sum_ms);
+    put(&o, "door_http_request_duration_seconds_sum{endpoint=\"%s\"} %u.%03u\n", endpoint_names[e], sum / 1000, sum % 1000);
+    put(&o, "door_http_request_duration_seconds_count{endpoint=\"%s\"} %u\n", endpoint_names[e], cum);
+  }
+  put(&o, "# TYPE door_http_errors_total counter\n");
+  for (int e = 0; e < METRIC_EP_COUNT; e++) {
+    put(&o, "door_http_errors_total{endpoint=\"%s\"} %u\n", endpoint_names[e], atomic_get(&http_hist[e].errors));
+  }
+  return o.pos;
+}
+
+size_t metrics_summary(char* buf, size_t len) {
+  MemPoolStats internal, psram;
+  mem_get_stats(MEM_POOL_INTERNAL, &internal);
+  mem_get_stats(MEM_POOL_PSRAM, &psram);
+  I2sStats i2s;
+  i2s_get_stats(&i2s);
+  uint32_t requests = 0, errors = 0;
+  for (int e = 0; e < METRIC_EP_COUNT; e++) {
+    for (int b = 0; b <= HIST_BUCKETS; b++) requests += atomic_get(&http_hist[e].buckets[b]);
+    errors += atomic_get(&http_hist[e].errors);
+  }
+  int n = snprintf(buf, len, "heap %u/%u psram %u/%u i2s %u/%u rssi %d wifi %u ws %u http %u/%u tuş %u servo %u",
+                   (unsigned)internal.free, (unsigned)internal.min_free, (unsigned)psram.free, (unsigned)psram.min_free,
+                   i2s.rx_overflow, i2s.tx_underflow, wifi_is_connected() ? (int)WiFi.RSSI() : 0,
+                   atomic_get(&counters[METRIC_WIFI_RECONNECTS]), atomic_get(&counters[METRIC_WS_RECONNECTS]),
+                   errors, requests, atomic_get(&counters[METRIC_KEYPAD_EVENTS]),
+                   atomic_get(&counters[METRIC_SERVO_CYCLES]));
+  if (n < 0) return 0;
+  return (size_t)n < len ? n : len - 1;
+}
+
+// İstek satırı okunur, başlıklar boş satıra kadar atlanır; GET /metrics ve /blackbox yanıtlanır
+static void serve(WiFiClient& client) {
+  char line[48];
+  size_t n = 0;
+  bool first_line = true;
+  uint32_t tail = 0;   // son dört bayt
+  uint32_t start = millis();
+  while (client.connected() && millis() - start < 1000) {
+    int c = client.read();
+    if (c < 0) {
+      delay(1);
+      continue;
+    }
+    if (c == '\n') first_line = false;
+    else if (first_line && c != '\r' && n < sizeof(line) - 1) line[n++] = (char)c;
+    tail = (tail << 8) | (uint8_t)c;
+    if (tail == 0x0D0A0D0A) break;
+  }
+  line[n] = '\0';
+
+  if (strncmp(line, "GET /metrics", 12) == 0 && (line[12] == ' ' || line[12] == '?')) {
+    size_t len = metrics_render(render_buf, METRICS_RENDER_BYTES);
+    client.printf("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                  "Content-Length: %u\r\nConnection: close\r\n\r\n", (unsigned)len);
+    client.write((const uint8_t*)render_buf, len);
+#if BLACKBOX_ENABLED
+  } else if (strncmp(line, "GET /blackbox", 13) == 0 && (line[13] == ' ' || line[13] == '?')) {
+    // Uzunluk baştan bilinmez; gövde bağlantı kapanınca biter
+    client.print("HTTP/1.1 200 OK\r\nContent-Type: text/plain; charset=utf-8\r\nConnection: close\r\n\r\n");
+    blackbox_dump(client);
+#endif
+  } else {
+    client.print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+  }
+  client.stop();
+}
+
+#if METRICS_PUSH_MS > 0
+// Sunucu gönderimleri bu kimlikle ayırır; NAT arkasındaki kapıların adresi aynı olabilir
+static String door_id() {
+  String mac = WiFi.macAddress();
+  mac.replace(":", "");
+  mac.toLowerCase();
+  return mac;
+}
+
+static void push() {
+  size_t len = metrics_render(render_buf, METRICS_RENDER_BYTES);
+  WiFiClient client;
+  HTTPClient http;
+  http.begin(client, METRICS_PUSH_URL);
+  http.setTimeout(3000);
+  http.addHeader("Content-Type", "text/plain; version=0.0.4");
+  http.addHeader("X-Door-ID", door_id());
+  if (METRICS_PUSH_TOKEN[0] != '\0') http.addHeader("Authorization", "Bearer " METRICS_PUSH_TOKEN);
+  int code = http.POST((uint8_t*)render_buf, len);
+  http.end();
+  if (code != HTTP_CODE_OK && code != HTTP_CODE_NO_CONTENT) LOG_W("⚠️ Metrikler gönderilemedi: %d", code);
+}
+#endif
+
+static void metrics_loop(void* arg) {
+  WiFiServer server(METRICS_HTTP_PORT);
+  bool listening = false;
+  uint32_t last_push = millis();
+  for (;;) {
+    if (!wifi_is_connected()) {
+      if (listening) server.end();
+      listening = false;
+      delay(500);
+      continue;
+    }
+    if (!listening) {
+      server.begin();
+      listening = true;
+      LOG_I("📈 Metrikler: http://%s:%d/metrics", WiFi.localIP().toString().c_str(), METRICS_HTTP_PORT);
+    }
+    WiFiClient client = server.available();
+    if (client) serve(client);
+#if METRICS_PUSH_MS > 0
+    if (millis() - last_push >= METRICS_PUSH_MS) {
+      last_push = millis();
+      push();
+    }
+#else
+    (void)last_push;
+#endif
+    delay(METRICS_POLL_MS);
+  }
+}
+
+void metrics_begin() {
+  if (metrics_task_handle != NULL) return;
+  render_buf = (char*)mem_alloc(METRICS_RENDER_BYTES, MEM_POOL_PSRAM, "metrics");
+  if (render_buf == NULL) {
+    LOG_E("❌ Metrik tamponu ayrılamadı, /metrics kapalı");
+    return;
+  }
+  xTaskCreate(metrics_loop, "metrics", 4096, nullptr, 1, &metrics_task_handle);
+}
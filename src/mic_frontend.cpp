@@ -0,0 +1,99 @@
+// mic_frontend.cpp
+#include "mic_frontend.h"
+#include "config.h"
+#include <math.h>
+
+// 24 bit tam ölçekten 16 bit tam ölçeğe birim kazanç
+#define UNITY_GAIN_Q16 (1 << 8)
+
+static inline int16_t sat16(int32_t v) {
+  if (v > 32767) return 32767;
+  if (v < -32768) return -32768;
+  return (int16_t)v;
+}
+
+void mic_frontend_init(MicFrontend* fe, int sample_rate) {
+  fe->dc_x1 = 0;
+  fe->dc_y1 = 0;
+  fe->dc_r_q15 = (int32_t)(0.995f * 32768.0f);
+
+  // RBJ yüksek geçiren, Q = 1/sqrt(2)
+  float w0 = 2.0f * (float)M_PI * (float)MIC_HPF_HZ / (float)sample_rate;
+  float alpha = sinf(w0) / (2.0f * 0.70710678f);
+  float c = cosf(w0);
+  float a0 = 1.0f + alpha;
+  fe->hpf_b0 = (1.0f + c) / 2.0f / a0;
+  fe->hpf_b1 = -(1.0f + c) / a0;
+  fe->hpf_b2 = (1.0f + c) / 2.0f / a0;
+  fe->hpf_a1 = -2.0f * c / a0;
+  fe->hpf_a2 = (1.0f - alpha) / a0;
+  fe->hpf_z1 = 0.0f;
+  fe->hpf_z2 = 0.0f;
+
+  fe->gain_q16 = UNITY_GAIN_Q16 * 8;  // sessiz mikrofon için +18 dB ile başla
+  fe->hold = false;
+}
+
+size_t mic_frontend_process(MicFrontend* fe, int32_t* raw, size_t samples) {
+  // 1. geçiş: DC engelleme ve yüksek geçiren, yerinde 24 bit; seviye ölçümü
+  int32_t x1 = fe->dc_x1, y1 = fe->dc_y1;
+  const int32_t r = fe->dc_r_q15;
+  float z1 = fe->hpf_z1, z2 = fe->hpf_z2;
+  float sum_sq = 0.0f;
+  int32_t peak = 0;
+  for (size_t i = 0; i < samples; i++) {
+    int32_t x = raw[i] >> 8;
+    int32_t y = x - x1 + (int32_t)(((int64_t)r * y1) >> 15);
+    x1 = x;
+    y1 = y;
+    float in = (float)y;
+    float out = fe->hpf_b0 * in + z1;
+    z1 = fe->hpf_b1 * in - fe->hpf_a1 * out + z2;
+    z2 = fe->hpf_b2 * in - fe->hpf_a2 * out;
+    int32_t v = (int32_t)lrintf(out);
+    raw[i] = v;
+    sum_sq += out * out;
+    int32_t a = v < 0 ? -v : v;
+    if (a > peak) peak = a;
+  }
+  fe->dc_x1 = x1;
+  fe->dc_y1 = y1;
+  fe->hpf_z1 = z1;
+  fe->hpf_z2 = z2;
+
+  // AGC: blok RMS'ini hedefe çek; hızlı düşür, yavaş yükselt
+  int32_t start_gain = fe->gain_q16;
+  int32_t target_gain = start_gain;
+  float rms24 = samples ? sqrtf(sum_sq / (float)samples) : 0.0f;
+  float rms16 = rms24 * (float)start_gain / 65536.0f;
+  // Sessizlikte kazanç sabit tutulur, yoksa gürültü tabanı yükseltilir
+  if (!fe->hold && rms16 > (float)MIC_AGC_NOISE_RMS) {
+    float ideal = (float)MIC_AGC_TARGET_RMS * 65536.0f / rms24;
+    float step = ideal < (float)start_gain ? 0.5f : 0.05f;
+    target_gain = (int32_t)((float)start_gain + step * (ideal - (float)start_gain));
+  }
+  if (target_gain > UNITY_GAIN_Q16 * MIC_AGC_MAX_GAIN) target_gain = UNITY_GAIN_Q16 * MIC_AGC_MAX_GAIN;
+  if (target_gain < UNITY_GAIN_Q16 / 4) target_gain = UNITY_GAIN_Q16 / 4;
+
+  // Sınırlayıcı: blokta uygulanacak en büyük kazanç tepeyi MIC_LIMIT_PEAK'in üstüne
+  // taşıyorsa sınır kazancı ilk örnekten uygulanır. Geçiş yalnızca yükselirken yapılır;
+  // yüksek bir başlangıç eski (yüksek) kazançla ramp boyunca kırpılmaz.
+  int32_t max_gain = target_gain > start_gain ? target_gain : start_gain;
+  if ((((int64_t)peak * max_gain) >> 16) > MIC_LIMIT_PEAK) {
+    int32_t limit_gain = (int32_t)(((int64_t)MIC_LIMIT_PEAK << 16) / peak);
+    if (limit_gain < target_gain) target_gain = limit_gain;
+    start_gain = target_gain;
+  }
+  fe->gain_q16 = target_gain;
+
+  // 2. geçiş: kazanç blok boyunca doğrusal geçişle uygulanır, 16 bit'e paketlenir.
+  // Çıkış i*2 baytına yazılır, giriş i*4 baytından okunur: yerinde güvenli.
+  int16_t* out = (int16_t*)raw;
+  int32_t gain_step = samples ? (target_gain - start_gain) / (int32_t)samples : 0;
+  int32_t gain = start_gain;
+  for (size_t i = 0; i < samples; i++) {
+    gain += gain_step;
+    out[i] = sat16((int32_t)(((int64_t)raw[i] * gain) >> 16));
+  }
+  return samples * sizeof(int16_t);
+}
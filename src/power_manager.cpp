@@ -0,0 +1,243 @@
+// power_manager.cpp
+#include "power_manager.h"
+#include "audio_capture.h"
+#include "wifi_manager.h"
+#include "log.h"
+#include "esp_sleep.h"
+#include "esp_pm.h"
+#include "esp_wifi.h"
+#include "driver/gpio.h"
+
+#define MAX_WAKE_PINS 8
+
+static byte wake_rows[MAX_WAKE_PINS];
+static byte wake_row_count = 0;
+static byte scan_cols[MAX_WAKE_PINS];
+static byte scan_col_count = 0;
+
+static PowerStats stats = {};
+static int64_t last_activity_us = 0;
+static int64_t state_since_us = 0;
+static bool idle_mode = false;
+static bool auto_sleep = false;   // boşta: esp_pm otomatik hafif uyku, WiFi bağlı
+static bool throttled = false;    // boşta: hafif uyku yok, WiFi modem uykusunda bağlı, CPU yavaş
+static bool wifi_off = false;     // boşta: POWER_RADIO_OFF_SLEEP, WiFi kapalı ve elle hafif uyku
+static bool pm_warned = false;
+static uint32_t cpu_max_mhz = 240;
+
+static void account(int64_t now) {
+  int64_t spent = now - state_since_us;
+  if (idle_mode) stats.idle_awake_us += spent;
+  else stats.active_us += spent;
+  state_since_us = now;
+}
+
+void power_init(const byte* row_pins, byte rows, const byte* col_pins, byte cols) {
+  wake_row_count = 0;
+  for (byte i = 0; i < rows && wake_row_count < MAX_WAKE_PINS; i++) {
+    wake_rows[wake_row_count++] = row_pins[i];
+  }
+  scan_col_count = 0;
+  for (byte i = 0; i < cols && scan_col_count < MAX_WAKE_PINS; i++) {
+    scan_cols[scan_col_count++] = col_pins[i];
+  }
+  cpu_max_mhz = getCpuFrequencyMhz();
+  last_activity_us = state_since_us = esp_timer_get_time();
+}
+
+// Otomatik hafif uykuda FreeRTOS boşta kaldığında CPU kendiliğinden uyur; WiFi
+// sürücüsü beacon pencerelerinde kilit tutar, bağlantı düşmez. Çekirdek
+// tickless idle olmadan derlendiyse ESP_ERR_NOT_SUPPORTED döner.
+static bool set_auto_light_sleep(bool enable) {
+  esp_pm_config_esp32s3_t pm = {};
+  pm.max_freq_mhz = cpu_max_mhz;
+  pm.min_freq_mhz = enable ? POWER_PM_MIN_MHZ : cpu_max_mhz;
+  pm.light_sleep_enable = enable;
+  return esp_pm_configure(&pm) == ESP_OK;
+}
+
+// Hafif uyku yokken: önce esp_pm frekans ölçekleme, o da yoksa sabit düşük
+// frekans. 80 MHz WiFi'nin desteklediği en düşük frekanstır.
+static void set_throttle(bool enable) {
+  esp_pm_config_esp32s3_t pm = {};
+  pm.max_freq_mhz = cpu_max_mhz;
+  pm.min_freq_mhz = enable ? POWER_PM_MIN_MHZ : cpu_max_mhz;
+  pm.light_sleep_enable = false;
+  if (esp_pm_configure(&pm) != ESP_OK) setCpuFrequencyMhz(enable ? POWER_PM_MIN_MHZ : cpu_max_mhz);
+}
+
+// AP'ye bir sonraki ilişkilendirmede bildirilir; değişmediyse yazılmaz
+static void set_listen_interval() {
+  wifi_config_t conf;
+  if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK) return;
+  if (conf.sta.listen_interval == POWER_WIFI_LISTEN_INTERVAL) return;
+  conf.sta.listen_interval = POWER_WIFI_LISTEN_INTERVAL;
+  esp_wifi_set_config(WIFI_IF_STA, &conf);
+}
+
+void power_note_activity() {
+  int64_t now = esp_timer_get_time();
+  last_activity_us = now;
+  if (idle_mode) {
+    account(now);
+    idle_mode = false;
+    if (auto_sleep) {
+      set_auto_light_sleep(false);
+      auto_sleep = false;
+    }
+    if (throttled) {
+      set_throttle(false);
+      throttled = false;
+    }
+    if (wifi_off) {
+      wifi_resume();  // bağlantı arka planda gelir, süresi istatistiğe eklenir
+      wifi_off = false;
+    }
+    WiFi.setSleep(WIFI_PS_NONE);  // yükleme gecikmesi için modem uykusundan çık
+    capture_resume();
+    power_print_stats();
+  }
+}
+
+static void enter_idle() {
+  account(esp_timer_get_time());
+  idle_mode = true;
+  // Boştayken mikrofon durur; uyanınca halka yeniden dolar
+  capture_pause();
+  auto_sleep = set_auto_light_sleep(true);
+  if (!auto_sleep && !pm_warned) {
+    pm_warned = true;
+    LOG_W("⚠️ esp_pm hafif uykuyu reddetti (CONFIG_PM_ENABLE / tickless idle yok); boşta yalnızca modem uykusu ve düşük CPU frekansı");
+  }
+  if (auto_sleep || !POWER_RADIO_OFF_SLEEP) {
+    // Modem uykusu: radyo yalnızca DTIM beacon'larında uyanır, bağlantı korunur;
+    // ws oturumu, :9100 metrikleri ve /blackbox erişilebilir kalır
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+    set_listen_interval();
+    if (!auto_sleep) {
+      throttled = true;
+      set_throttle(true);
+    }
+    LOG_I("💤 Boşta, %s", auto_sleep ? "otomatik hafif uykuya geçiliyor" : "modem uykusu, CPU yavaşlatıldı");
+  } else {
+    // Elle hafif uyku radyoyu da durdurur; bağlıyken beacon kaçar ve AP istasyonu
+    // düşürür. Bu yüzden WiFi boşta kaldıkça kapalı tutulur, uyanınca yeniden bağlanılır
+    wifi_off = true;
+    wifi_suspend();
+    LOG_I("💤 Boşta, WiFi kapatılıp hafif uykuya geçiliyor");
+  }
+  // Uykudan önce halkadaki kayıtlar da UART'a çıkar
+  log_flush(100);
+}
+
+// Tüm sütunlar LOW sürülür; herhangi bir tuş kendi satırını LOW'a çeker.
+// RECORD_BUTTON da bir satır hattı olduğu için aynı şekilde uyandırır.
+static void arm_wake_pins() {
+  for (byte i = 0; i < scan_col_count; i++) {
+    pinMode(scan_cols[i], OUTPUT);
+    digitalWrite(scan_cols[i], LOW);
+  }
+  for (byte i = 0; i < wake_row_count; i++) {
+    pinMode(wake_rows[i], INPUT_PULLUP);
+  }
+  pinMode(RECORD_BUTTON, INPUT_PULLUP);
+}
+
+// Keypad taramasının beklediği durum: sütunlar yüksek empedans
+static void release_wake_pins() {
+  for (byte i = 0; i < scan_col_count; i++) {
+    pinMode(scan_cols[i], INPUT);
+  }
+}
+
+static bool wake_pin_low() {
+  for (byte i = 0; i < wake_row_count; i++) {
+    if (digitalRead(wake_rows[i]) == LOW) return true;
+  }
+  return digitalRead(RECORD_BUTTON) == LOW;
+}
+
+static void end_slice(int64_t before, bool by_key, bool slept) {
+  int64_t after = esp_timer_get_time();
+  // esp_timer uyku süresini de sayar; uyanık geçen süreye eklenmesin
+  if (slept) {
+    stats.light_sleep_us += after - before;
+    state_since_us = after;
+    stats.sleep_count++;
+  }
+  if (by_key) {
+    stats.wake_by_gpio++;
+    power_note_activity();
+  } else if (slept) {
+    stats.wake_by_timer++;
+  }
+}
+
+// Görev yalnızca bekler, tuşlar POWER_POLL_MS'de bir okunur. Otomatik uykuda
+// aradaki boşlukta CPU uyur; yavaşlatılmış modda boşta görevinde bekler
+static void wait_slice() {
+  arm_wake_pins();
+  int64_t before = esp_timer_get_time();
+  bool pressed = false;
+  for (uint32_t waited = 0; waited < POWER_SLEEP_SLICE_MS && !pressed; waited += POWER_POLL_MS) {
+    vTaskDelay(pdMS_TO_TICKS(POWER_POLL_MS));
+    pressed = wake_pin_low();
+  }
+  release_wake_pins();
+  end_slice(before, pressed, auto_sleep);
+}
+
+// WiFi kapalıyken elle hafif uyku; tuş ya da dilim sonu uyandırır
+static void light_sleep_slice() {
+  arm_wake_pins();
+  for (byte i = 0; i < wake_row_count; i++) {
+    gpio_wakeup_enable((gpio_num_t)wake_rows[i], GPIO_INTR_LOW_LEVEL);
+  }
+  gpio_wakeup_enable((gpio_num_t)RECORD_BUTTON, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)POWER_SLEEP_SLICE_MS * 1000ULL);
+
+  int64_t before = esp_timer_get_time();
+  esp_light_sleep_start();
+
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  for (byte i = 0; i < wake_row_count; i++) {
+    gpio_wakeup_disable((gpio_num_t)wake_rows[i]);
+  }
+  gpio_wakeup_disable((gpio_num_t)RECORD_BUTTON);
+  release_wake_pins();
+  end_slice(before, cause == ESP_SLEEP_WAKEUP_GPIO, true);
+}
+
+void power_idle_poll() {
+  if (!idle_mode) {
+    if (esp_timer_get_time() - last_activity_us < (int64_t)POWER_IDLE_TIMEOUT_MS * 1000) {
+      delay(POWER_POLL_MS);
+      return;
+    }
+    enter_idle();
+  }
+  if (wifi_off) light_sleep_slice();
+  else wait_slice();
+}
+
+bool power_is_idle() {
+  return idle_mode;
+}
+
+void power_get_stats(PowerStats* out) {
+  account(esp_timer_get_time());
+  wifi_resume_stats(&stats.wifi_resumes, &stats.wifi_resume_ms);
+  *out = stats;
+}
+
+void power_print_stats() {
+  PowerStats s;
+  power_get_stats(&s);
+  LOG_I("🔋 Aktif: %llu s, boşta: %llu s, hafif uyku: %llu s (%u uyku, %u tuş/buton, %u zamanlayıcı uyanması)",
+        s.active_us / 1000000ULL, s.idle_awake_us / 1000000ULL, s.light_sleep_us / 1000000ULL,
+        s.sleep_count, s.wake_by_gpio, s.wake_by_timer);
+  if (s.wifi_resumes > 0) {
+    LOG_I("📶 Uyku sonrası %u yeniden bağlanma, ortalama %u ms", s.wifi_resumes, s.wifi_resume_ms / s.wifi_resumes);
+  }
+}
@@ -0,0 +1,243 @@
+// reply_cache.cpp
+#include "reply_cache.h"
+#include "mem_policy.h"
+#include "ws_session.h"
+#include "log.h"
+#include <LittleFS.h>
+#include "AudioFileSourceFS.h"
+
+#define CACHE_DIR  "/tts"
+#define KEY_LEN    32
+
+struct CacheEntry {
+  char key[KEY_LEN + 1];
+  char fmt[4];
+  uint32_t size;
+  uint32_t used;       // son çalınma sırası; en küçüğü ilk silinir
+};
+
+static CacheEntry entries[REPLY_CACHE_MAX_ENTRIES];
+static int entry_count = 0;
+static uint32_t total_bytes = 0;
+static uint32_t use_seq = 0;
+static SemaphoreHandle_t cache_mutex = NULL;   // çalma görevi yazar, ws görevi anahtarları okur
+static uint8_t* tee_buf = NULL;                // PSRAM, tek çalma için
+static bool tee_busy = false;
+static bool ready = false;
+
+// "…/tts-<32 onaltılık>.<mp3|wav>"; uygunsa anahtar ve format doldurulur
+static bool parse_url(const String& url, char* key, char* fmt) {
+  int slash = url.lastIndexOf('/');
+  String name = url.substring(slash + 1);
+  if (!name.startsWith("tts-") || name.length() != 4 + KEY_LEN + 4 || name.charAt(4 + KEY_LEN) != '.') return false;
+  for (int i = 0; i < KEY_LEN; i++) {
+    if (!isxdigit(name.charAt(4 + i))) return false;
+  }
+  String ext = name.substring(4 + KEY_LEN + 1);
+  if (ext != "mp3" && ext != "wav") return false;
+  memcpy(key, name.c_str() + 4, KEY_LEN);
+  key[KEY_LEN] = '\0';
+  strcpy(fmt, ext.c_str());
+  return true;
+}
+
+static String entry_path(const char* key, const char* fmt) {
+  return String(CACHE_DIR "/") + key + "." + fmt;
+}
+
+static int find_entry(const char* key) {
+  for (int i = 0; i < entry_count; i++) {
+    if (strcmp(entries[i].key, key) == 0) return i;
+  }
+  return -1;
+}
+
+static void remove_entry(int i) {
+  LittleFS.remove(entry_path(entries[i].key, entries[i].fmt));
+  total_bytes -= entries[i].size;
+  entries[i] = entries[--entry_count];
+}
+
+static int oldest_entry() {
+  int oldest = 0;
+  for (int i = 1; i < entry_count; i++) {
+    if (entries[i].used < entries[oldest].used) oldest = i;
+  }
+  return oldest;
+}
+
+void reply_cache_begin() {
+  if (ready) return;
+  // partitions.csv'deki "spiffs" bölümü; ilk açılışta biçimlendirilir
+  if (!LittleFS.begin(true)) {
+    LOG_E("❌ LittleFS açılamadı, yanıt önbelleği kapalı");
+    return;
+  }
+  tee_buf = (uint8_t*)mem_alloc(REPLY_CACHE_FILE_MAX, MEM_POOL_PSRAM, "reply_cache");
+  if (tee_buf == NULL) {
+    LOG_E("❌ Yanıt önbelleği tamponu ayrılamadı");
+    return;
+  }
+  cache_mutex = xSemaphoreCreateMutex();
+  if (!LittleFS.exists(CACHE_DIR)) LittleFS.mkdir(CACHE_DIR);
+
+  File dir = LittleFS.open(CACHE_DIR);
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    String name = f.name();
+    uint32_t size = f.size();
+    f.close();
+    char key[KEY_LEN + 1], fmt[4];
+    // Yarım kalmış yazımlar ve tanınmayan dosyalar silinir
+    if (!parse_url(String("tts-") + name, key, fmt) || entry_count >= REPLY_CACHE_MAX_ENTRIES ||
+        total_bytes + size > REPLY_CACHE_MAX_BYTES) {
+      LittleFS.remove(String(CACHE_DIR "/") + name);
+      continue;
+    }
+    CacheEntry& e = entries[entry_count++];
+    strcpy(e.key, key);
+    strcpy(e.fmt, fmt);
+    e.size = size;
+    e.used = 0;
+    total_bytes += size;
+  }
+  ready = true;
+  LOG_I("💾 Yanıt önbelleği: %d ses, %u / %u byte", entry_count, total_bytes, REPLY_CACHE_MAX_BYTES);
+}
+
+AudioFileSource* reply_cache_open(const String& url) {
+  char key[KEY_LEN + 1], fmt[4];
+  if (!ready || !parse_url(url, key, fmt)) return NULL;
+  xSemaphoreTake(cache_mutex, portMAX_DELAY);
+  int i = find_entry(key);
+  if (i >= 0) entries[i].used = ++use_seq;
+  xSemaphoreGive(cache_mutex);
+  if (i < 0) return NULL;
+  AudioFileSourceFS* src = new AudioFileSourceFS(LittleFS, entry_path(key, fmt).c_str());
+  if (!src->isOpen()) {
+    delete src;
+    return NULL;
+  }
+  LOG_I("💾 Yanıt önbellekten çalınıyor: %s.%s", key, fmt);
+  return src;
+}
+
+static void store(const char* key, const char* fmt, const uint8_t* data, uint32_t size) {
+  if (size > REPLY_CACHE_MAX_BYTES) return;
+  xSemaphoreTake(cache_mutex, portMAX_DELAY);
+  if (find_entry(key) >= 0) {
+    xSemaphoreGive(cache_mutex);
+    return;
+  }
+  while (entry_count > 0 && (entry_count >= REPLY_CACHE_MAX_ENTRIES || total_bytes + size > REPLY_CACHE_MAX_BYTES)) {
+    remove_entry(oldest_entry());
+  }
+  // Geçici addan taşınır; güç kesilirse yarım dosya açılışta silinir
+  String tmp = String(CACHE_DIR "/") + key + ".tmp";
+  File f = LittleFS.open(tmp, "w");
+  bool ok = f && f.write(data, size) == size;
+  if (f) f.close();
+  ok = ok && LittleFS.rename(tmp, entry_path(key, fmt));
+  if (ok) {
+    CacheEntry& e = entries[entry_count++];
+    strcpy(e.key, key);
+    strcpy(e.fmt, fmt);
+    e.size = size;
+    e.used = ++use_seq;
+    total_bytes += size;
+  } else {
+    LittleFS.remove(tmp);
+  }
+  xSemaphoreGive(cache_mutex);
+
+  if (!ok) {
+    LOG_W("⚠️ Yanıt önbelleğe yazılamadı");
+    return;
+  }
+  LOG_I("💾 Yanıt önbelleğe alındı: %s.%s (%u byte)", key, fmt, size);
+  if (ws_session_connected()) ws_session_send_text(reply_cache_announcement());
+}
+
+// Okunanları biriktirir; kapanırken yalnızca beklenen boy (HTTP Content-Length,
+// WS reply_start.bytes) biliniyorsa ve tam o kadar bayt okunduysa yazar. Çalma
+// kesilirse, bağlantı koparsa, WS halkası taşarsa ya da yanıt tampona sığmazsa
+// hiçbir şey yazılmaz. src'nin sahibi değildir.
+class AudioFileSourceCacheTee : public AudioFileSource {
+ public:
+  AudioFileSourceCacheTee(AudioFileSource* src, const String& url, const char* key, const char* fmt)
+      : src(src), url(url), got(0), overflow(false), open(true) {
+    strcpy(this->key, key);
+    strcpy(this->fmt, fmt);
+  }
+  ~AudioFileSourceCacheTee() override { close(); }
+
+  uint32_t read(void* data, uint32_t len) override {
+    uint32_t n = src->read(data, len);
+    if (got + n > REPLY_CACHE_FILE_MAX) {
+      overflow = true;
+    } else if (!overflow) {
+      memcpy(tee_buf + got, data, n);
+    }
+    got += n;
+    return n;
+  }
+
+  uint32_t readNonBlock(void* data, uint32_t len) override { return read(data, len); }
+
+  bool seek(int32_t pos, int dir) override {
+    // Akıştaki sıçrama kopyayı bozar
+    overflow = true;
+    return src->seek(pos, dir);
+  }
+
+  bool close() override {
+    if (!open) return true;
+    open = false;
+    // Boyu bilinmeyen akış (chunked HTTP'de -1) yarıda kesilmiş olabilir
+    uint32_t size = src->getSize();
+    bool intact = size > 0 && size != UINT32_MAX && got == size && !overflow;
+    if (intact && url.startsWith("ws:")) intact = ws_session_reply_intact(url);
+    if (intact) {
+      store(key, fmt, tee_buf, got);
+    } else if (got > 0) {
+      LOG_D("Yanıt önbelleğe alınmadı: %u / %u byte", got, size);
+    }
+    tee_busy = false;
+    return src->close();
+  }
+
+  bool isOpen() override { return open && src->isOpen(); }
+  uint32_t getSize() override { return src->getSize(); }
+  uint32_t getPos() override { return src->getPos(); }
+
+ private:
+  AudioFileSource* src;
+  String url;
+  char key[KEY_LEN + 1];
+  char fmt[4];
+  uint32_t got;
+  bool overflow;
+  bool open;
+};
+
+AudioFileSource* reply_cache_wrap(const String& url, AudioFileSource* src) {
+  char key[KEY_LEN + 1], fmt[4];
+  if (!ready || tee_busy || !parse_url(url, key, fmt)) return src;
+  tee_busy = true;
+  return new AudioFileSourceCacheTee(src, url, key, fmt);
+}
+
+String reply_cache_announcement() {
+  String msg = "{\"type\":\"cache\",\"keys\":[";
+  if (ready) {
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    for (int i = 0; i < entry_count; i++) {
+      if (i > 0) msg += ",";
+      msg += "\"";
+      msg += entries[i].key;
+      msg += "\"";
+    }
+    xSemaphoreGive(cache_mutex);
+  }
+  msg += "]}";
+  return msg;
+}
@@ -0,0 +1,128 @@
+// resampler.cpp
+#include "resampler.h"
+#include <math.h>
+#include <string.h>
+
+// Sıfırıncı dereceden Bessel, Kaiser penceresi için
+static double bessel_i0(double x) {
+  double sum = 1.0, term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) break;
+  }
+  return sum;
+}
+
+// Kaiser boyu (A - 8) / (2.285 * dw): geçiş 0.40 -> 0.50 * low, giriş örneği
+// başına 0.1 * low / in devir; oran 1'de 52 katsayı, 3:1'de 156
+static int taps_for(uint32_t in_rate, uint32_t low) {
+  uint32_t taps = (RESAMPLER_TAPS_PER_RATIO * in_rate + low - 1) / low;
+  return (int)((taps + 3) & ~3u);
+}
+
+// Satır p, en yeni girişten p/PHASES örnek geride bir çıkış için katsayılardır.
+// Her satırın toplamı tam 32768 yapılır; DC kazancı fazdan bağımsız 1 olur.
+// Katsayılar aşağı yuvarlanır, eksik kalan birimler kesir kısmı en büyük
+// olanlara dağıtılır: artığın tek katsayıya yüklenmesi durdurma bandını ~5 dB bozar.
+static void design(Resampler* rs) {
+  uint32_t low = rs->in_rate < rs->out_rate ? rs->in_rate : rs->out_rate;
+  double fc = 0.45 * low / rs->in_rate;   // geçiş ve durdurma kenarlarının ortası, giriş örneği başına devir
+  const int taps = rs->taps;
+  const int center = taps / 2 - 1;
+  double half = taps / 2.0;
+  double norm = bessel_i0(RESAMPLER_BETA);
+
+  for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+    double d = (double)p / RESAMPLER_PHASES;
+    double row[RESAMPLER_TAPS_MAX];
+    bool bumped[RESAMPLER_TAPS_MAX];
+    double sum = 0.0;
+    for (int j = 0; j < taps; j++) {
+      double a = j - d - center;
+      double r = a / half;
+      double w = r * r < 1.0 ? bessel_i0(RESAMPLER_BETA * sqrt(1.0 - r * r)) / norm : 0.0;
+      double s = a == 0.0 ? 1.0 : sin(M_PI * 2.0 * fc * a) / (M_PI * 2.0 * fc * a);
+      row[j] = 2.0 * fc * s * w;
+      sum += row[j];
+    }
+    int16_t* h = rs->h + p * taps;
+    int32_t total = 0;
+    for (int j = 0; j < taps; j++) {
+      row[j] = row[j] / sum * 32768.0;
+      h[j] = (int16_t)floor(row[j]);
+      row[j] -= h[j];
+      bumped[j] = false;
+      total += h[j];
+    }
+    for (; total < 32768; total++) {
+      int best = -1;
+      for (int j = 0; j < taps; j++) {
+        if (!bumped[j] && (best < 0 || row[j] > row[best])) best = j;
+      }
+      h[best]++;
+      bumped[best] = true;
+    }
+  }
+}
+
+bool resampler_init(Resampler* rs, uint32_t in_rate, uint32_t out_rate) {
+  if (in_rate == 0 || out_rate == 0 || out_rate > 8 * in_rate) return false;
+  int taps = taps_for(in_rate, in_rate < out_rate ? in_rate : out_rate);
+  if (taps > RESAMPLER_TAPS_MAX) return false;
+  rs->taps = taps;
+  rs->in_rate = in_rate;
+  rs->out_rate = out_rate;
+  design(rs);
+  resampler_reset(rs);
+  return true;
+}
+
+void resampler_reset(Resampler* rs) {
+  memset(rs->x, 0, sizeof(rs->x));
+  rs->pos = 0;
+  rs->next = (int32_t)rs->out_rate;
+}
+
+size_t resampler_max_out(const Resampler* rs, size_t n_in) {
+  return (size_t)(((uint64_t)n_in * rs->out_rate + rs->in_rate - 1) / rs->in_rate) + 1;
+}
+
+// Uzun süzgeçlerde katsayı toplamı |h| 2'yi biraz aşar (~2.1); çarpımlar bir
+// bit kaydırılarak Q29'da toplanır, 32 bit toplam taşmaz
+static inline int32_t dot(const int16_t* h, const int16_t* x, int taps) {
+  int32_t acc = 0;
+  for (int j = 0; j < taps; j++) {
+    acc += ((int32_t)h[j] * x[j]) >> 1;
+  }
+  return acc;
+}
+
+size_t resampler_process(Resampler* rs, const int16_t* in, size_t n_in, int16_t* out) {
+  size_t n_out = 0;
+  for (size_t i = 0; i < n_in; i++) {
+    // Geçmiş iki kez yazılır; pencere her zaman bitişik kalır
+    rs->pos = rs->pos == 0 ? rs->taps - 1 : rs->pos - 1;
+    rs->x[rs->pos] = in[i];
+    rs->x[rs->pos + rs->taps] = in[i];
+    const int16_t* xv = rs->x + rs->pos;
+
+    rs->next -= (int32_t)rs->out_rate;
+    while (rs->next <= 0) {
+      uint64_t ph = (uint64_t)(uint32_t)(-rs->next) * RESAMPLER_PHASES;
+      uint32_t p = (uint32_t)(ph / rs->out_rate);
+      uint32_t frac = (uint32_t)(((ph % rs->out_rate) << 16) / rs->out_rate);
+      int32_t acc = dot(rs->h + p * rs->taps, xv, rs->taps);
+      if (frac != 0) {
+        int32_t acc1 = dot(rs->h + (p + 1) * rs->taps, xv, rs->taps);
+        acc += (int32_t)((((int64_t)acc1 - acc) * frac) >> 16);
+      }
+      int32_t y = (acc + 8192) >> 14;
+      if (y > 32767) y = 32767;
+      if (y < -32768) y = -32768;
+      out[n_out++] = (int16_t)y;
+      rs->next += (int32_t)rs->in_rate;
+    }
+  }
+  return n_out;
+}
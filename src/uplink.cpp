@@ -0,0 +1,361 @@
+// uplink.cpp
+#include "uplink.h"
+#include "wifi_manager.h"
+#include "audio_codec.h"
+#include "ws_session.h"
+#include "mem_policy.h"
+#include "metrics.h"
+#include "log.h"
+#include <WiFiUdp.h>
+
+void uplink_session_init(UplinkSession* s, uint32_t sample_rate, bool wake_check) {
+  uint8_t raw[UPLINK_SESSION_ID_LEN / 2];
+  esp_fill_random(raw, sizeof(raw));
+  for (size_t i = 0; i < sizeof(raw); i++) {
+    snprintf(s->id + 2 * i, 3, "%02x", raw[i]);
+  }
+  s->short_id = (uint32_t)raw[0] << 24 | (uint32_t)raw[1] << 16 | (uint32_t)raw[2] << 8 | raw[3];
+  s->sample_rate = sample_rate;
+  s->wake_check = wake_check;
+}
+
+class HttpUplink : public Uplink {
+ public:
+  const char* name() const override { return "http"; }
+  size_t chunk_samples() const override { return CHUNK_SIZE / 2; }
+
+  bool begin(const UplinkSession& s) override {
+    session = s;
+    first = true;
+    done = false;
+    segment_end = false;
+    tail_speech = true;
+    response = "";
+    client.setTimeout(120000);
+    open();
+    return true;
+  }
+
+  bool send(const uint8_t* data, size_t len, size_t samples, uint32_t timestamp, bool last) override {
+    http.addHeader("X-First-Chunk", first ? "true" : "false");
+    http.addHeader("X-Last-Chunk", last ? "true" : "false");
+    http.addHeader("X-Segment-End", segment_end ? "true" : "false");
+    http.addHeader("X-Tail-Speech", tail_speech ? "true" : "false");
+#if METRICS_ENABLED
+    uint32_t start = millis();
+#endif
+    int code = http.POST((uint8_t*)data, len);
+#if METRICS_ENABLED
+    metrics_observe_http(METRIC_EP_UPLOAD, millis() - start, code);
+#endif
+    if (code == HTTP_CODE_OK) {
+      first = false;
+      done = last;
+      segment_end = false;
+      String body = http.getString();
+      if (body.length() > 0 && body != "OK") response = body;
+      return true;
+    }
+    LOG_W("Bağlantı hatası: %d", code);
+    if (!wifi_is_connected()) {
+      // Yeniden bağlanma arka planda sürer, kayıt bekletilmez
+      wifi_reconnect();
+      http.end();
+      open();
+    }
+    return false;
+  }
+
+  void end_segment() override { segment_end = true; }
+  void set_tail_speech(bool speech) override { tail_speech = speech; }
+  String finish() override { return response; }
+  void end() override {
+    http.end();
+    if (done || first) return;
+    // Son parça gitmedi: sunucu oturumu zaman aşımını beklemeden kapatır
+    http.begin(client, String(UPLOAD_URL) + "/" + session.id);
+    http.setTimeout(2000);
+    http.sendRequest("DELETE");
+    http.end();
+  }
+
+ private:
+  void open() {
+    http.begin(client, UPLOAD_URL);
+#if UPLINK_CODEC == CODEC_PCM
+    http.addHeader("Content-Type", "audio/wav");
+#else
+    http.addHeader("Content-Type", "application/octet-stream");
+#endif
+    http.addHeader("X-Audio-Codec", uplink_codec_name(UPLINK_CODEC));
+    http.addHeader("X-Session-ID", session.id);
+    http.addHeader("X-Sample-Rate", String(session.sample_rate));
+    http.addHeader("X-Reply-Format", REPLY_FORMAT);
+    if (session.wake_check) {
+      http.addHeader("X-Wake-Check", "true");
+    }
+    http.setTimeout(120000);
+  }
+
+  WiFiClient client;
+  HTTPClient http;
+  UplinkSession session;
+  bool first;
+  bool done;               // son parça sunucuya ulaştı
+  bool segment_end;
+  bool tail_speech;
+  String response;
+};
+
+// llm_server.py'deki UDP_HEADER ile aynı düzen (little endian)
+struct __attribute__((packed)) UdpAudioHeader {
+  char magic[2];         // "VA"
+  uint8_t version;
+  uint8_t type;          // udp_packet_t
+  uint8_t flags;
+  uint8_t codec;         // CODEC_PCM / CODEC_IMA_ADPCM
+  uint16_t seq;          // veri paketi sırası; FEC'te grubun ilk paketi, END'de toplam paket
+  uint32_t session;
+  uint32_t timestamp;    // ilk örneğin sırası; END'de toplam örnek
+  uint16_t rate;
+  uint8_t count;         // FEC: kapsanan paket sayısı
+  uint8_t reserved;
+};
+
+enum udp_packet_t { UDP_DATA, UDP_FEC, UDP_END, UDP_ACK, UDP_REPLY };
+
+#define UDP_VERSION    1
+#define UDP_FLAG_WAKE  0x01
+#define UDP_FLAG_MP3   0x02
+#define UDP_MAX_PAYLOAD 1400
+#define UDP_FEC_PREFIX 6       // eşlik yükünün başında uzunluk (u16) ve zaman damgası (u32) XOR'u
+
+class UdpUplink : public Uplink {
+ public:
+  const char* name() const override { return "udp"; }
+  size_t chunk_samples() const override { return SAMPLE_RATE * UDP_FRAME_MS / 1000; }
+
+  bool begin(const UplinkSession& s) override {
+    session = s;
+    seq = 0;
+    total_samples = 0;
+    failed = 0;
+    reset_parity();
+    return udp.begin(UDP_LOCAL_PORT);
+  }
+
+  bool send(const uint8_t* data, size_t len, size_t samples, uint32_t timestamp, bool last) override {
+    if (len > UDP_MAX_PAYLOAD - UDP_FEC_PREFIX) len = UDP_MAX_PAYLOAD - UDP_FEC_PREFIX;
+    bool ok = transmit(UDP_DATA, seq, timestamp, 0, data, len);
+    add_parity(data, len, timestamp);
+    seq++;
+    total_samples = timestamp + samples;
+    if (UDP_FEC_GROUP > 0 && (group_count == UDP_FEC_GROUP || last)) {
+      transmit(UDP_FEC, group_base, 0, group_count, parity, parity_len);
+      reset_parity();
+    }
+    // Kayıp tekrar gönderilmez; sunucu eşlikten kurtarır ya da sessizlikle doldurur
+    return ok;
+  }
+
+  String finish() override {
+    uint32_t start = millis();
+    uint32_t last_end = 0;
+    bool acked = false;
+    LOG_I("📡 UDP: %u paket, %u gönderilemedi", (unsigned)seq, failed);
+    while (millis() - start < UDP_REPLY_TIMEOUT_MS) {
+      // END kaybolabilir: onaylanana kadar sık, sonra yanıt kaybına karşı seyrek yinelenir
+      uint32_t interval = acked ? UDP_END_RETRY_MS * 20 : UDP_END_RETRY_MS;
+      if (last_end == 0 || millis() - last_end >= interval) {
+        transmit(UDP_END, seq, total_samples, 0, NULL, 0);
+        last_end = millis();
+      }
+      int size = udp.parsePacket();
+      if (size < (int)sizeof(UdpAudioHeader)) {
+        delay(5);
+        continue;
+      }
+      UdpAudioHeader h;
+      udp.read((uint8_t*)&h, sizeof(h));
+      if (h.magic[0] != 'V' || h.magic[1] != 'A' || h.session != session.short_id) continue;
+      if (h.type == UDP_ACK) {
+        acked = true;
+      } else if (h.type == UDP_REPLY) {
+        int n = size - (int)sizeof(h);
+        if (n > UDP_MAX_PAYLOAD) n = UDP_MAX_PAYLOAD;
+        udp.read(reply, n);
+        reply[n] = 0;
+        return String((const char*)reply);
+      }
+    }
+    LOG_E("❌ UDP: sunucu yanıt vermedi");
+    return "";
+  }
+
+  void end() override { udp.stop(); }
+
+ private:
+  bool transmit(uint8_t type, uint16_t pkt_seq, uint32_t ts, uint8_t count, const uint8_t* data, size_t len) {
+    UdpAudioHeader h = {};
+    h.magic[0] = 'V';
+    h.magic[1] = 'A';
+    h.version = UDP_VERSION;
+    h.type = type;
+    h.flags = (session.wake_check ? UDP_FLAG_WAKE : 0) | (strcmp(REPLY_FORMAT, "mp3") == 0 ? UDP_FLAG_MP3 : 0);
+    h.codec = UPLINK_CODEC;
+    h.seq = pkt_seq;
+    h.session = session.short_id;
+    h.timestamp = ts;
+    h.rate = (uint16_t)session.sample_rate;
+    h.count = count;
+    // lwIP tamponu doluysa (ön kayıt art arda gönderilirken) kısa beklenip yeniden denenir
+    for (int attempt = 0; attempt < 3; attempt++) {
+      udp.beginPacket(SERVER_IP, UDP_AUDIO_PORT);
+      udp.write((const uint8_t*)&h, sizeof(h));
+      if (len > 0) udp.write(data, len);
+      if (udp.endPacket()) return true;
+      delay(2);
+    }
+    if (type == UDP_DATA) failed++;
+    return false;
+  }
+
+  void reset_parity() {
+    memset(parity, 0, sizeof(parity));
+    parity_len = 0;
+    group_count = 0;
+    group_base = seq;
+  }
+
+  void add_parity(const uint8_t* data, size_t len, uint32_t ts) {
+    uint8_t prefix[UDP_FEC_PREFIX];
+    uint16_t len16 = (uint16_t)len;
+    memcpy(prefix, &len16, 2);
+    memcpy(prefix + 2, &ts, 4);
+    for (int i = 0; i < UDP_FEC_PREFIX; i++) parity[i] ^= prefix[i];
+    for (size_t i = 0; i < len; i++) parity[UDP_FEC_PREFIX + i] ^= data[i];
+    if (UDP_FEC_PREFIX + len > parity_len) parity_len = UDP_FEC_PREFIX + len;
+    group_count++;
+  }
+
+  WiFiUDP udp;
+  UplinkSession session;
+  uint16_t seq;
+  uint32_t total_samples;
+  uint32_t failed;
+  uint8_t parity[UDP_MAX_PAYLOAD];
+  size_t parity_len;
+  uint8_t group_count;
+  uint16_t group_base;
+  uint8_t reply[UDP_MAX_PAYLOAD + 1];
+};
+
+// Parçalar kalıcı oturumun ikili çerçeveleridir; sunucu metni yanıt hazırlanmadan
+// gönderir, yanıt sesi ayrı bir GET beklemeden aynı bağlantıdan akar (bkz. ws_session.h)
+class WsUplink : public Uplink {
+ public:
+  const char* name() const override { return "ws"; }
+  size_t chunk_samples() const override { return CHUNK_SIZE / 2; }
+
+  bool begin(const UplinkSession& s) override {
+    session = s;
+    session_hex = s.id;
+    total_samples = 0;
+    finished = false;
+    segment_end = false;
+    tail_speech = true;
+    ws_session_flush_messages();
+    String start = String("{\"type\":\"start\",\"session\":\"") + session_hex +
+                   "\",\"codec\":\"" + uplink_codec_name(UPLINK_CODEC) +
+                   "\",\"rate\":" + s.sample_rate +
+                   ",\"wake\":" + (s.wake_check ? "true" : "false") +
+                   ",\"format\":\"" REPLY_FORMAT "\"}";
+    return ws_session_send_text(start);
+  }
+
+  bool send(const uint8_t* data, size_t len, size_t samples, uint32_t timestamp, bool last) override {
+    total_samples = timestamp + samples;
+    if (!ws_session_send_binary(data, len)) return false;
+    if (segment_end) {
+      segment_end = false;
+      ws_session_send_text(String("{\"type\":\"segment\",\"session\":\"") + session_hex + "\"}");
+    }
+    return true;
+  }
+
+  void end_segment() override { segment_end = true; }
+  void set_tail_speech(bool speech) override { tail_speech = speech; }
+
+  // Kayıt sürerken sunucudan yalnızca bu oturumun ara metinleri gelir
+  bool poll_partial(String* text) override {
+    PsramJsonDocument doc(1024);
+    bool got = false;
+    while (ws_session_next_message(doc, 0)) {
+      if (session_hex != (doc["session"] | "") || strcmp(doc["type"] | "", "transcript") != 0) continue;
+      *text = doc["text"].as<String>();
+      got = true;
+    }
+    return got;
+  }
+
+  String finish() override {
+    String end = String("{\"type\":\"end\",\"session\":\"") + session_hex +
+                 "\",\"samples\":" + total_samples +
+                 ",\"tail\":" + (tail_speech ? "true" : "false") + "}";
+    if (!ws_session_send_text(end)) return "";
+    finished = true;
+    PsramJsonDocument doc(1024);
+    uint32_t start = millis();
+    while (millis() - start < WS_REPLY_TIMEOUT_MS && ws_session_connected()) {
+      if (!ws_session_next_message(doc, 100)) continue;
+      if (session_hex != (doc["session"] | "")) continue;
+      const char* type = doc["type"] | "";
+      if (strcmp(type, "transcript") == 0) {
+        String text = doc["text"].as<String>();
+        if (!(doc["final"] | false)) {
+          LOG_D("💬 %s", text.c_str());
+          continue;
+        }
+        if (session.wake_check) return text;
+        LOG_I("🗣️ Algılanan metin: %s", text.c_str());
+      } else if (strcmp(type, "reply_start") == 0) {
+        // Ses şimdiden halkaya akıyor (önbellekteyse hiç akmıyor); adres çalma görevine yanıtı gösterir
+        String name = doc["name"].isNull() ? String("reply.") + (doc["format"] | "wav") : doc["name"].as<String>();
+        return String("ws:") + doc["id"].as<int>() + "/" + name;
+      } else if (strcmp(type, "error") == 0) {
+        LOG_E("❌ WS: %s", doc["message"] | "");
+        return "";
+      }
+    }
+    LOG_E("❌ WS: sunucu yanıt vermedi");
+    return "";
+  }
+
+  void end() override {
+    if (!finished && ws_session_connected()) {
+      ws_session_send_text(String("{\"type\":\"abort\",\"session\":\"") + session_hex + "\"}");
+    }
+  }
+
+ private:
+  UplinkSession session;
+  String session_hex;
+  bool finished;           // end iletisi gitti
+  uint32_t total_samples;
+  bool segment_end;
+  bool tail_speech;
+};
+
+Uplink* uplink_get() {
+#if UPLINK_TRANSPORT == TRANSPORT_UDP
+  static UdpUplink uplink;
+#elif UPLINK_TRANSPORT == TRANSPORT_WS
+  static WsUplink uplink;
+  static HttpUplink fallback;
+  // Oturum kopuksa kayıt beklemez, parçalar HTTP ile gider
+  if (!ws_session_wait_connected(WS_CONNECT_WAIT_MS)) return &fallback;
+#else
+  static HttpUplink uplink;
+#endif
+  return &uplink;
+}
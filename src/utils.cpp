@@ -1,16 +1,106 @@
 #include "utils.h"
+#include "config.h"
+#include <sys/time.h>
+#include "esp_sntp.h"
+
+#define TIME_SNAPSHOT_MAGIC 0x54494d45  // "TIME"
+
+// Panik, watchdog ve yazılım resetlerinden sağ çıkar; güç kesilince geçersizdir
+struct TimeSnapshot {
+  uint32_t magic;
+  int64_t  epoch_us;
+  uint32_t check;
+};
+
+RTC_NOINIT_ATTR static TimeSnapshot rtc_snapshot;
+
+static portMUX_TYPE time_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t epoch_offset_us = 0;   // epoch_us = mono_us + epoch_offset_us
+static bool time_valid = false;
+static volatile bool time_synced = false;
+static esp_timer_handle_t persist_timer = nullptr;
+
+static uint32_t snapshot_check(const TimeSnapshot &s) {
+  return s.magic ^ (uint32_t)s.epoch_us ^ (uint32_t)(s.epoch_us >> 32) ^ 0xA5A5A5A5;
+}
+
+static void set_epoch_offset(int64_t offset_us) {
+  portENTER_CRITICAL(&time_mux);
+  epoch_offset_us = offset_us;
+  time_valid = true;
+  portEXIT_CRITICAL(&time_mux);
+}
+
+static void persist_time(void *arg) {
+  int64_t now = timeEpochMs(timeMonoUs());
+  if (now == 0) return;
+  rtc_snapshot.magic = TIME_SNAPSHOT_MAGIC;
+  rtc_snapshot.epoch_us = now * 1000;
+  rtc_snapshot.check = snapshot_check(rtc_snapshot);
+}
+
+// SNTP eşitlemesi lwIP görevinde tamamlanınca çağrılır
+static void on_time_sync(struct timeval *tv) {
+  int64_t epoch_us = (int64_t)tv->tv_sec * 1000000LL + tv->tv_usec;
+  set_epoch_offset(epoch_us - timeMonoUs());
+  time_synced = true;
+  persist_time(nullptr);
+}
 
 void initTime() {
-  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+  // Yeniden başlatmadan önceki saat; kapalı kalınan süre kadar geride olabilir,
+  // ilk SNTP eşitlemesi bunu düzeltir
+  if (rtc_snapshot.magic == TIME_SNAPSHOT_MAGIC && rtc_snapshot.check == snapshot_check(rtc_snapshot)) {
+    struct timeval tv;
+    tv.tv_sec = rtc_snapshot.epoch_us / 1000000LL;
+    tv.tv_usec = rtc_snapshot.epoch_us % 1000000LL;
+    settimeofday(&tv, nullptr);
+    set_epoch_offset(rtc_snapshot.epoch_us - timeMonoUs());
+    Serial.println("⏱️ Saat RTC belleğinden geri yüklendi");
+  }
+
+  sntp_set_time_sync_notification_cb(on_time_sync);
+  configTime(GMT_OFFSET_SEC, DAYLIGHT_OFFSET_SEC, NTP_SERVER);
+
+  esp_timer_create_args_t args = {};
+  args.callback = &persist_time;
+  args.name = "time_persist";
+  if (esp_timer_create(&args, &persist_timer) == ESP_OK) {
+    esp_timer_start_periodic(persist_timer, (uint64_t)TIME_PERSIST_SEC * 1000000ULL);
+  }
   Serial.println("✅ Zaman sunucusu ayarlandı");
 }
 
-String getCurrentTime() {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
+bool timeIsSynced() {
+  return time_synced;
+}
+
+bool timeIsValid() {
+  return time_valid;
+}
+
+int64_t timeEpochMs(int64_t mono_us) {
+  portENTER_CRITICAL(&time_mux);
+  bool valid = time_valid;
+  int64_t offset = epoch_offset_us;
+  portEXIT_CRITICAL(&time_mux);
+  if (!valid) return 0;
+  return (mono_us + offset) / 1000;
+}
+
+String formatTimestamp(int64_t epoch_ms) {
+  if (epoch_ms == 0) {
     return "Time Error";
   }
+  time_t seconds = epoch_ms / 1000;
+  struct tm timeinfo;
+  localtime_r(&seconds, &timeinfo);
   char timeString[20];
   strftime(timeString, sizeof(timeString), "%Y-%m-%d %H:%M:%S", &timeinfo);
   return String(timeString);
-}
\ No newline at end of file
+}
+
+// Hiçbir zaman bloklamaz; saat bilinmiyorsa "Time Error" döner
+String getCurrentTime() {
+  return formatTimestamp(timeEpochMs(timeMonoUs()));
+}
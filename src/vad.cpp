@@ -0,0 +1,66 @@
+// vad.cpp
+#include "vad.h"
+#include <string.h>
+
+void vad_init(VadState* st, uint32_t sample_rate) {
+  memset(st, 0, sizeof(*st));
+  st->frame_len = sample_rate * VAD_FRAME_MS / 1000;
+  st->hangover_frames = VAD_HANGOVER_MS / VAD_FRAME_MS;
+  st->max_segment_frames = VAD_MAX_SEGMENT_MS / VAD_FRAME_MS;
+}
+
+// Bir çerçevenin kararı; bölüt kapandıysa true
+static bool vad_frame(VadState* st, float energy) {
+  const float min_energy = (float)VAD_MIN_RMS * VAD_MIN_RMS;
+  if (!st->noise_valid) {
+    st->noise = energy;
+    st->noise_valid = true;
+  }
+  bool loud = energy > st->noise * VAD_SNR && energy > min_energy;
+
+  // Taban düşüşleri hemen, yükselişleri yavaş izler; konuşma tabanı şişirmez
+  if (!loud) {
+    if (energy < st->noise) {
+      st->noise = 0.5f * st->noise + 0.5f * energy;
+    } else {
+      st->noise += 0.02f * (energy - st->noise);
+    }
+  }
+
+  if (!st->speech) {
+    st->onset_run = loud ? st->onset_run + 1 : 0;
+    if (st->onset_run >= VAD_ONSET_FRAMES) {
+      st->speech = true;
+      st->speech_since_cut = true;
+      st->segment_frames = st->onset_run;
+      st->silence_frames = 0;
+    }
+    return false;
+  }
+
+  st->segment_frames++;
+  st->silence_frames = loud ? 0 : st->silence_frames + 1;
+  bool pause = st->silence_frames >= st->hangover_frames;
+  bool too_long = st->segment_frames >= st->max_segment_frames && !loud;
+  if (pause || too_long) {
+    st->speech = false;
+    st->speech_since_cut = false;
+    st->onset_run = 0;
+    st->segments++;
+    return true;
+  }
+  return false;
+}
+
+bool vad_process(VadState* st, const int16_t* x, size_t n) {
+  bool cut = false;
+  for (size_t i = 0; i < n; i++) {
+    st->acc += (int64_t)x[i] * x[i];
+    if (++st->fill == st->frame_len) {
+      if (vad_frame(st, (float)st->acc / (float)st->frame_len)) cut = true;
+      st->acc = 0;
+      st->fill = 0;
+    }
+  }
+  return cut;
+}
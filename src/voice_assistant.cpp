@@ -1,336 +1,350 @@
 #include "voice_assistant.h"
 #include "audio_handler.h"
+#include "audio_codec.h"
+#include "audio_capture.h"
+#include "barge_in.h"
+#include "resampler.h"
+#include "mem_policy.h"
+#include "uplink.h"
+#include "vad.h"
+#include "local_commands.h"
+#include "metrics.h"
+#include "log.h"
+
+// Bir kayıt/yükleme oturumunun sonucu
+struct CaptureResult {
+  String transcript;   // X-Wake-Check oturumlarında sunucunun döndürdüğü metin
+  String reply_url;    // asistan oturumlarında yanıt sesinin adresi
+  size_t pcm_bytes;    // yükleme hızındaki PCM
+  size_t sent_bytes;   // kodlamadan sonra gönderilen
+  int chunks;
+  int errors;
+  uint32_t overflows;  // oturum sırasında okunamadan kaybolan DMA tamponu
+  uint32_t dropped;    // oturum halkanın gerisinde kaldığı için atlanan örnek
+  uint32_t segments;   // VAD'ın kapattığı bölüt
+  bool early;          // ara metin beklenen ifadeyi içerdiği için kayıt erken bitti
+};
+
+static bool contains_phrase(String text, const char* const* phrases) {
+  text.toLowerCase();
+  for (; *phrases != NULL; phrases++) {
+    if (text.indexOf(*phrases) != -1) return true;
+  }
+  return false;
+}
+
+// Wake word pencereleri ve ardından gelen komut aynı okuyucuyla, boşluksuz okunur
+static CaptureReader session_reader;
+
+#if UPLINK_CODEC == CODEC_IMA_ADPCM
+static uint8_t encoded_buffer[ADPCM_BLOCK_BYTES(CHUNK_SIZE / 2)];
+#endif
+
+#if UPLINK_SAMPLE_RATE > SAMPLE_RATE
+#error "UPLINK_SAMPLE_RATE halkanın hızını (SAMPLE_RATE) aşamaz"
+#endif
+
+// Sunucuyla anlaşılan yükleme hızı; 0 ise henüz sorulmadı
+static uint32_t uplink_rate = 0;
+static Resampler uplink_rs;
+
+// Sunucu desteklediği hızları /capabilities'de listeler. Eski sunucular bu
+// adrese 404 döner; o durumda halkanın hızıyla (SAMPLE_RATE) yüklenir.
+static uint32_t negotiate_uplink_rate() {
+  uint32_t rate = SAMPLE_RATE;
+  WiFiClient client;
+  HTTPClient http;
+  http.begin(client, CAPS_URL);
+  http.setTimeout(3000);
+#if METRICS_ENABLED
+  uint32_t start = millis();
+#endif
+  int code = http.GET();
+#if METRICS_ENABLED
+  metrics_observe_http(METRIC_EP_CAPABILITIES, millis() - start, code);
+#endif
+  if (code == HTTP_CODE_OK) {
+    PsramJsonDocument doc(512);
+    if (!deserializeJson(doc, http.getString())) {
+      for (JsonVariant r : doc["upload_rates"].as<JsonArray>()) {
+        if (r.as<uint32_t>() == UPLINK_SAMPLE_RATE) rate = UPLINK_SAMPLE_RATE;
+      }
+    }
+  }
+  http.end();
+  if (rate != SAMPLE_RATE) resampler_init(&uplink_rs, SAMPLE_RATE, rate);
+  LOG_I("📶 Yükleme hızı: %u Hz", rate);
+  return rate;
+}
+
+// Halkadan duration_ms uzunluğunda sesi okur, her parçayı kodlayıp seçilen taşımayla gönderir.
+// Okuyucu oturumun nereden başlayacağını belirler; ağ beklerken gelen ses halkada birikir.
+// VAD'ın bulduğu duraklamalar bölüt sınırı olarak bildirilir; sunucu kapanan bölütleri
+// kayıt sürerken çözümler. stop_phrases verilirse ve ara metinde biri geçerse kayıt
+// süre dolmadan biter.
+static CaptureResult capture_and_upload(CaptureReader* reader, uint32_t duration_ms, bool wake_check, bool verbose,
+                                        const char* const* stop_phrases = NULL) {
+  CaptureResult res = {};
+  if (uplink_rate == 0) uplink_rate = negotiate_uplink_rate();
+  if (uplink_rate != SAMPLE_RATE) resampler_reset(&uplink_rs);
+
+  Uplink* uplink = uplink_get();
+  UplinkSession session;
+  uplink_session_init(&session, uplink_rate, wake_check);
+  if (!uplink->begin(session)) {
+    LOG_E("❌ %s taşıması başlatılamadı", uplink->name());
+    return res;
+  }
+
+  size_t total_samples = (size_t)SAMPLE_RATE * duration_ms / 1000;
+  create_wav_header(chunk_buffer, (size_t)uplink_rate * duration_ms / 1000 * 2, uplink_rate);
+  uint8_t* pcm = chunk_buffer + WAV_HEADER_SIZE;
+  size_t chunk = uplink->chunk_samples();
+
+#if UPLINK_CODEC == CODEC_IMA_ADPCM
+  AdpcmState adpcm;
+  adpcm_reset(&adpcm);
+  uint32_t encode_us = 0;
+#endif
+
+  I2sStats dma_start;
+  i2s_get_stats(&dma_start);
+  uint32_t dropped_start = reader->dropped;
+  size_t remaining = total_samples;
+  uint32_t timestamp = 0;
+  VadState vad;
+  vad_init(&vad, SAMPLE_RATE);
+  String partial;
+
+  while (remaining > 0) {
+    size_t want = remaining < chunk ? remaining : chunk;
+    size_t got = 0;
+    while (got < want) {
+      size_t n = capture_read(reader, (int16_t*)pcm + got, want - got, 1000);
+      if (n == 0) break;
+      got += n;
+    }
+    if (got == 0) {
+      LOG_E("Mikrofondan veri gelmiyor!");
+      break;
+    }
+    remaining -= got;
+    // Sınır parça ölçeğindedir (128 ms); duraklama VAD_HANGOVER_MS sürdüğünden kesim sessizliğe düşer
+    if (vad_process(&vad, (int16_t*)pcm, got)) uplink->end_segment();
+    // 8 kHz yüklemede parça yerinde indirilir
+    if (uplink_rate != SAMPLE_RATE) got = resampler_process(&uplink_rs, (int16_t*)pcm, got, (int16_t*)pcm);
+    size_t bytes_read = got * 2;
+    bool last_chunk = remaining == 0;
+    if (last_chunk) uplink->set_tail_speech(vad.speech_since_cut);
+
+    uint8_t* payload;
+    size_t payload_len;
+#if UPLINK_CODEC == CODEC_IMA_ADPCM
+    uint32_t t0 = micros();
+    payload_len = adpcm_encode_block(&adpcm, (const int16_t*)pcm, bytes_read / 2, encoded_buffer);
+    encode_us += micros() - t0;
+    payload = encoded_buffer;
+#else
+    // HTTP'de sunucu ilk parçadaki WAV başlığını dosyanın başı olarak saklar;
+    // UDP ve WebSocket'te başlığı sunucu kendisi ekler. WebSocket kopukken HTTP'ye düşülebilir.
+    bool with_header = timestamp == 0 && strcmp(uplink->name(), "http") == 0;
+    payload = with_header ? chunk_buffer : pcm;
+    payload_len = with_header ? bytes_read + WAV_HEADER_SIZE : bytes_read;
+#endif
+
+    if (uplink->send(payload, payload_len, got, timestamp, last_chunk)) {
+      res.chunks++;
+      res.pcm_bytes += bytes_read;
+      res.sent_bytes += payload_len;
+
+      // Taşımadan bağımsız olarak yaklaşık her 2 saniyede bir
+      if (verbose && res.chunks % (16 * (CHUNK_SIZE / 2) / chunk) == 0) {
+        LOG_D("Ses algılama devam ediyor: %u saniye, %u byte",
+              (unsigned)((total_samples - remaining) / SAMPLE_RATE),
+              res.pcm_bytes);
+      }
+    } else {
+      res.errors++;
+      if (res.errors > 5) {
+        LOG_E("Çok fazla hata oluştu, işlem durduruluyor!");
+        break;
+      }
+    }
+    timestamp += got;
+
+    if (stop_phrases != NULL && !last_chunk && uplink->poll_partial(&partial)) {
+      if (verbose) LOG_D("💬 Ara metin: %s", partial.c_str());
+      if (contains_phrase(partial, stop_phrases)) {
+        // Kalan ses beklenmez; sunucu metni kapanmış bölütlerden birleştirir
+        uplink->set_tail_speech(false);
+        res.early = true;
+        break;
+      }
+    }
+  }
+  res.segments = vad.segments;
+
+  String response = uplink->finish();
+  uplink->end();
+  if (response.startsWith("http") || response.startsWith("ws:")) {
+    res.reply_url = response;
+    if (verbose) LOG_I("Sunucu yanıtı alındı: %s", response.c_str());
+  } else if (response.length() > 0) {
+    res.transcript = response;
+  }
+
+  I2sStats dma_end;
+  i2s_get_stats(&dma_end);
+  res.overflows = dma_end.rx_overflow - dma_start.rx_overflow;
+  res.dropped = reader->dropped - dropped_start;
+
+  LOG_I("Ses algılama tamamlandı. Toplam %u byte (%d parça, %u bölüt)",
+        res.pcm_bytes + WAV_HEADER_SIZE,
+        res.chunks,
+        res.segments);
+  if (res.early) {
+    LOG_I("⏩ Komut ara metinden tanındı, kayıt %u ms erken bitti",
+          (unsigned)(remaining * 1000ULL / SAMPLE_RATE));
+  }
+  if (res.overflows > 0) {
+    // Her taşma bir DMA tamponu kadar sesin kaybolduğunu gösterir; I2S_RX_BUDGET_MS büyütülmeli
+    LOG_W("⚠️ %u DMA taşması: ~%u ms ses kayboldu",
+          res.overflows,
+          res.overflows * dma_end.rx_buf_frames * 1000 / MIC_I2S_RATE);
+  }
+  if (res.dropped > 0) {
+    LOG_W("⚠️ Oturum halkanın gerisinde kaldı: %u ms ses atlandı",
+          (unsigned)(res.dropped * 1000ULL / SAMPLE_RATE));
+  }
+#if UPLINK_CODEC == CODEC_IMA_ADPCM
+  if (res.chunks > 0) {
+    LOG_I("Kodlama (%s): %u us/parça, %u -> %u byte",
+          uplink_codec_name(UPLINK_CODEC),
+          encode_us / res.chunks,
+          res.pcm_bytes,
+          res.sent_bytes);
+  }
+#endif
+  return res;
+}
 
 void handleVoiceAssistant() {
   // Önce wake word kontrolü yap
   if (!checkWakeWord()) {
-    Serial.println("Wake word algılanamadı, sistem başlatılamıyor.");
+    LOG_W("Wake word algılanamadı, sistem başlatılamıyor.");
     return;
   }
   
-  Serial.println("Wake word doğrulandı, sistem başlatılıyor...");
-  delay(500);
+  LOG_I("Wake word doğrulandı, sistem başlatılıyor...");
+  // Komut son pencerenin sonundan ön kayıt kadar önce başlar; sunucu yanıtını
+  // beklerken söylenenler halkada durur
+  capture_rewind(&session_reader, CAPTURE_PREROLL_MS);
   
   if (!check_server_connection()) {
-    Serial.println("Sunucu bağlantısı kurulamadı! İşlem iptal ediliyor.");
+    LOG_E("Sunucu bağlantısı kurulamadı! İşlem iptal ediliyor.");
     return;
   }
   
-  i2s_driver_uninstall(I2S_NUM_0);
-  delay(100);
-  
-  i2s_record_init();
-  Serial.println("Ses algılama başlatıldı...");
+  LOG_I("Ses algılama başlatıldı...");
   
-  String session_id = String(random(0xFFFFFFFF), HEX);
-  
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi bağlantısı kesildi! Yeniden bağlanılıyor...");
-    wifi_connect();
+  if (!wifi_wait_connected(WIFI_CONNECT_TIMEOUT_MS)) {
+    LOG_E("WiFi bağlantısı yok! İşlem iptal ediliyor.");
+    return;
   }
   
-  WiFiClient client;
-  client.setTimeout(120000);
+  CaptureResult res = capture_and_upload(&session_reader, RECORD_TIME_SEC * 1000, false, true);
   
-  HTTPClient http;
-  http.begin(client, UPLOAD_URL);
-  http.addHeader("Content-Type", "audio/wav");
-  http.addHeader("X-Session-ID", session_id);
-  http.setTimeout(120000);
-  
-  size_t total_data_size = SAMPLE_RATE * RECORD_TIME_SEC * 2;
-  create_wav_header(chunk_buffer, total_data_size, SAMPLE_RATE);
-  
-  size_t total_bytes = 0;
-  unsigned long start_time = millis();
-  bool first_chunk = true;
-  String url = "";
-  int chunk_count = 0;
-  int http_errors = 0;
-  
-  while ((millis() - start_time) < RECORD_TIME_SEC * 1000) {
-    size_t bytes_read = 0;
-    
-    esp_err_t result = i2s_read(I2S_NUM_0, 
-                               first_chunk ? chunk_buffer + WAV_HEADER_SIZE : chunk_buffer, 
-                               CHUNK_SIZE, 
-                               &bytes_read, 
-                               portMAX_DELAY);
-    
-    if (result == ESP_OK && bytes_read > 0) {
-      http.addHeader("X-First-Chunk", first_chunk ? "true" : "false");
-      http.addHeader("X-Last-Chunk", (millis() - start_time) >= (RECORD_TIME_SEC * 1000 - 100) ? "true" : "false");
-      
-      int httpCode;
-      if (first_chunk) {
-        httpCode = http.POST(chunk_buffer, bytes_read + WAV_HEADER_SIZE);
-        first_chunk = false;
-      } else {
-        httpCode = http.POST(chunk_buffer, bytes_read);
-      }
-      
-      if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
-        if (response.length() > 10) {
-          url = response;
-          Serial.println("Sunucu yanıtı alındı: " + url);
-        }
-        chunk_count++;
-        total_bytes += bytes_read;
-        
-        if ((millis() - start_time) % 2000 < 100) {
-          Serial.printf("Ses algılama devam ediyor: %d saniye, %u byte\n", 
-                       (millis() - start_time) / 1000,
-                       total_bytes);
-        }
-      } else {
-        http_errors++;
-        Serial.printf("Bağlantı hatası (parça %d): %d\n", 
-                     chunk_count, 
-                     httpCode);
-        
-        if (http_errors > 5) {
-          Serial.println("Çok fazla hata oluştu, işlem durduruluyor!");
-          break;
-        }
-        
-        if (WiFi.status() != WL_CONNECTED) {
-          Serial.println("WiFi bağlantısı kesildi! Yeniden bağlanılıyor...");
-          wifi_connect();
-          http.end();
-          http.begin(client, UPLOAD_URL);
-          http.addHeader("Content-Type", "audio/wav");
-          http.addHeader("X-Session-ID", session_id);
-          http.setTimeout(120000);
-        }
-      }
-    }
+  if (res.errors > 0) {
+    LOG_W("Toplam %d bağlantı hatası oluştu", res.errors);
   }
   
-  i2s_stop(I2S_NUM_0);
-  i2s_driver_uninstall(I2S_NUM_0);
-  
-  Serial.printf("Ses algılama tamamlandı. Toplam %u byte (%d parça)\n", 
-                total_bytes + WAV_HEADER_SIZE,
-                chunk_count);
-  
-  if (http_errors > 0) {
-    Serial.printf("Toplam %d bağlantı hatası oluştu\n", http_errors);
+  if (res.reply_url.length() == 0) {
+    LOG_W("Sunucu yanıt vermedi");
+    return;
   }
   
-  http.end();
-  
-  if (url.length() > 0) {
-    Serial.println("Ses yanıtı çalınıyor: " + url);
-    play_wav_from_url(url);
-  } else {
-    Serial.println("Sunucu yanıt vermedi");
+  // Kullanıcı yanıtın üstüne konuşursa çalma kesilir ve konuşması yeni komut olarak gönderilir
+  while (res.reply_url.length() > 0) {
+    LOG_I("Ses yanıtı çalınıyor: %s", res.reply_url.c_str());
+    BargeInResult barge = play_interruptible(res.reply_url);
+    if (barge.reason != BARGE_IN_VOICE) break;
+    capture_seek(&session_reader, barge.onset);
+    res = capture_and_upload(&session_reader, RECORD_TIME_SEC * 1000, false, true);
   }
 }
 
 bool checkWakeWord() {
-  Serial.println("\nSes algılama bekleniyor...");
+  LOG_I("\nSes algılama bekleniyor...");
   
   if (!check_server_connection()) {
-    Serial.println("Sunucu bağlantısı kurulamadı!");
+    LOG_E("Sunucu bağlantısı kurulamadı!");
     return false;
   }
   
-  i2s_driver_uninstall(I2S_NUM_0);
-  delay(100);
-  i2s_record_init();
+  capture_open(&session_reader, CAPTURE_PREROLL_MS);
+  static const char* const wake_phrases[] = {WAKEWORD_PHRASE, NULL};
   
   bool wake_word_detected = false;
   int attempt = 1;
   
   while (!wake_word_detected) {
-    Serial.printf("\nDinleme denemesi #%d\n", attempt++);
-    
-    String session_id = String(random(0xFFFFFFFF), HEX);
-    
-    WiFiClient client;
-    client.setTimeout(120000);
+    LOG_I("\nDinleme denemesi #%d", attempt++);
+    LOG_I("Ses algılanıyor...");
     
-    HTTPClient http;
-    http.begin(client, UPLOAD_URL);
-    http.addHeader("Content-Type", "audio/wav");
-    http.addHeader("X-Session-ID", session_id);
-    http.addHeader("X-Wake-Check", "true");
-    http.setTimeout(120000);
-    
-    size_t total_data_size = SAMPLE_RATE * WAKEWORD_TIME_SEC * 2;
-    create_wav_header(chunk_buffer, total_data_size, SAMPLE_RATE);
-    
-    size_t total_bytes = 0;
-    unsigned long start_time = millis();
-    bool first_chunk = true;
-    String transcription = "";
-    int chunk_count = 0;
-    
-    Serial.println("Ses algılanıyor...");
-    
-    while ((millis() - start_time) < WAKEWORD_TIME_SEC * 1000) {
-      size_t bytes_read = 0;
-      
-      esp_err_t result = i2s_read(I2S_NUM_0, 
-                                 first_chunk ? chunk_buffer + WAV_HEADER_SIZE : chunk_buffer, 
-                                 CHUNK_SIZE, 
-                                 &bytes_read, 
-                                 portMAX_DELAY);
-      
-      if (result == ESP_OK && bytes_read > 0) {
-        http.addHeader("X-First-Chunk", first_chunk ? "true" : "false");
-        http.addHeader("X-Last-Chunk", (millis() - start_time) >= (WAKEWORD_TIME_SEC * 1000 - 100) ? "true" : "false");
-        
-        int httpCode;
-        if (first_chunk) {
-          httpCode = http.POST(chunk_buffer, bytes_read + WAV_HEADER_SIZE);
-          first_chunk = false;
-        } else {
-          httpCode = http.POST(chunk_buffer, bytes_read);
-        }
-        
-        if (httpCode == HTTP_CODE_OK) {
-          String response = http.getString();
-          if (response.length() > 0 && !response.startsWith("http")) {
-            transcription = response;
-          }
-          chunk_count++;
-          total_bytes += bytes_read;
-        } else {
-          Serial.printf("Bağlantı hatası: %d\n", httpCode);
-        }
-      }
-    }
-    
-    i2s_stop(I2S_NUM_0);
-    i2s_start(I2S_NUM_0);
-    
-    http.end();
-    
-    Serial.printf("Ses algılama tamamlandı. Toplam %u byte (%d parça)\n", 
-                  total_bytes + WAV_HEADER_SIZE,
-                  chunk_count);
+    // Pencereler halkadan art arda okunur, denemeler arasında ses kaybolmaz
+    CaptureResult res = capture_and_upload(&session_reader, WAKEWORD_TIME_SEC * 1000, true, false, wake_phrases);
     
+    String transcription = res.transcript;
     transcription.toLowerCase();
     transcription.trim();
     
-    Serial.printf("Algılanan ses: '%s'\n", transcription.c_str());
-    Serial.printf("Beklenen komut: '%s'\n", WAKEWORD_PHRASE);
+    LOG_I("Algılanan ses: '%s'", transcription.c_str());
+    LOG_I("Beklenen komut: '%s'", WAKEWORD_PHRASE);
     
     if (transcription.indexOf(WAKEWORD_PHRASE) != -1) {
-      Serial.println("Komut algılandı!");
+      LOG_I("Komut algılandı!");
       wake_word_detected = true;
     } else {
-      Serial.println("Komut algılanamadı, tekrar deneniyor...");
-      delay(100);
+      LOG_I("Komut algılanamadı, tekrar deneniyor...");
     }
   }
   
-  i2s_driver_uninstall(I2S_NUM_0);
   return true;
 }
 
 String getNameByVoice() {
-  Serial.println("Ses kaydı başlatılıyor...");
-  i2s_driver_uninstall(I2S_NUM_0);
-  delay(100);
-  i2s_record_init();
-  Serial.println("İsim için ses algılanıyor...");
-  String session_id = String(random(0xFFFFFFFF), HEX);
-  WiFiClient client;
-  client.setTimeout(120000);
-  HTTPClient http;
-  http.begin(client, UPLOAD_URL);
-  http.addHeader("Content-Type", "audio/wav");
-  http.addHeader("X-Session-ID", session_id);
-  http.addHeader("X-Wake-Check", "true");
-  http.setTimeout(120000);
-  size_t total_data_size = SAMPLE_RATE * 3 * 2;
-  create_wav_header(chunk_buffer, total_data_size, SAMPLE_RATE);
-  size_t total_bytes = 0;
-  unsigned long start_time = millis();
-  bool first_chunk = true;
-  String transcription = "";
-  int chunk_count = 0;
-  while ((millis() - start_time) < 3000) {
-    size_t bytes_read = 0;
-    esp_err_t result = i2s_read(I2S_NUM_0, first_chunk ? chunk_buffer + WAV_HEADER_SIZE : chunk_buffer, CHUNK_SIZE, &bytes_read, portMAX_DELAY);
-    if (result == ESP_OK && bytes_read > 0) {
-      http.addHeader("X-First-Chunk", first_chunk ? "true" : "false");
-      http.addHeader("X-Last-Chunk", (millis() - start_time) >= (3000 - 100) ? "true" : "false");
-      int httpCode;
-      if (first_chunk) {
-        httpCode = http.POST(chunk_buffer, bytes_read + WAV_HEADER_SIZE);
-        first_chunk = false;
-      } else {
-        httpCode = http.POST(chunk_buffer, bytes_read);
-      }
-      if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
-        if (response.length() > 0 && !response.startsWith("http")) {
-          transcription = response;
-        }
-        chunk_count++;
-        total_bytes += bytes_read;
-      }
-    }
-  }
-  i2s_stop(I2S_NUM_0);
-  i2s_driver_uninstall(I2S_NUM_0);
+  LOG_I("Ses kaydı başlatılıyor...");
+  CaptureReader reader;
+  capture_open(&reader, CAPTURE_PREROLL_MS);
+  LOG_I("İsim için ses algılanıyor...");
+  CaptureResult res = capture_and_upload(&reader, 3000, true, false);
+  String transcription = res.transcript;
   transcription.trim();
-  Serial.print("Algılanan isim: "); Serial.println(transcription);
+  LOG_I("Algılanan isim: %s", transcription.c_str());
   return transcription;
 }
 
-String getCommandByVoice() {
-  Serial.println("Komut için ses kaydı başlatılıyor...");
-  i2s_driver_uninstall(I2S_NUM_0);
-  delay(100);
-  i2s_record_init();
-  Serial.println("Komut için ses algılanıyor...");
-  String session_id = String(random(0xFFFFFFFF), HEX);
-  WiFiClient client;
-  client.setTimeout(120000);
-  HTTPClient http;
-  http.begin(client, UPLOAD_URL);
-  http.addHeader("Content-Type", "audio/wav");
-  http.addHeader("X-Session-ID", session_id);
-  http.addHeader("X-Wake-Check", "true");
-  http.setTimeout(120000);
-  size_t total_data_size = SAMPLE_RATE * 3 * 2;
-  create_wav_header(chunk_buffer, total_data_size, SAMPLE_RATE);
-  size_t total_bytes = 0;
-  unsigned long start_time = millis();
-  bool first_chunk = true;
-  String transcription = "";
-  int chunk_count = 0;
-  while ((millis() - start_time) < 3000) {
-    size_t bytes_read = 0;
-    esp_err_t result = i2s_read(I2S_NUM_0, first_chunk ? chunk_buffer + WAV_HEADER_SIZE : chunk_buffer, CHUNK_SIZE, &bytes_read, portMAX_DELAY);
-    if (result == ESP_OK && bytes_read > 0) {
-      http.addHeader("X-First-Chunk", first_chunk ? "true" : "false");
-      http.addHeader("X-Last-Chunk", (millis() - start_time) >= (3000 - 100) ? "true" : "false");
-      int httpCode;
-      if (first_chunk) {
-        httpCode = http.POST(chunk_buffer, bytes_read + WAV_HEADER_SIZE);
-        first_chunk = false;
-      } else {
-        httpCode = http.POST(chunk_buffer, bytes_read);
-      }
-      if (httpCode == HTTP_CODE_OK) {
-        String response = http.getString();
-        if (response.length() > 0 && !response.startsWith("http")) {
-          transcription = response;
-        }
-        chunk_count++;
-        total_bytes += bytes_read;
-      }
-    }
+String getCommandByVoice(const char* const* commands) {
+  LOG_I("Komut için ses kaydı başlatılıyor...");
+  CaptureReader reader;
+  capture_open(&reader, CAPTURE_PREROLL_MS);
+  LOG_I("Komut için ses algılanıyor...");
+#if LOCAL_COMMANDS_ENABLED
+  // Önce cihazda tanınır; emin olunmazsa aynı ses halkadan yeniden okunup sunucuya gider
+  uint32_t start = reader.pos;
+  LocalCommandResult local = {-1, false, 0, 0};
+  if (commands != NULL) {
+    local = local_command_listen(&reader, commands, LOCAL_COMMAND_LISTEN_MS);
+    if (local.index >= 0) return String(commands[local.index]);
+    capture_seek(&reader, start);
   }
-  i2s_stop(I2S_NUM_0);
-  i2s_driver_uninstall(I2S_NUM_0);
+#endif
+  CaptureResult res = capture_and_upload(&reader, 3000, true, false, commands);
+  String transcription = res.transcript;
   transcription.trim();
-  Serial.print("Algılanan komut: "); Serial.println(transcription);
+#if LOCAL_COMMANDS_ENABLED
+  if (local.heard) local_command_learn(commands, transcription);
+#endif
+  LOG_I("Algılanan komut: %s", transcription.c_str());
   return transcription;
-}
\ No newline at end of file
+}
@@ -1,20 +1,278 @@
 // wifi_manager.cpp
 #include "wifi_manager.h"
+#include "ws_session.h"
+#include "metrics.h"
+#include <Preferences.h>
+#include "esp_timer.h"
 
+#define WIFI_CACHE_MAGIC 0x57494631  // "WIF1"
+
+// Son başarılı bağlantı; RTC belleği derin uyku ve yazılım resetinden,
+// NVS kopyası güç kesintisinden sonra kullanılır
+struct WifiCache {
+  uint32_t magic;
+  uint8_t  bssid[6];
+  uint8_t  channel;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t netmask;
+  uint32_t dns;
+};
+
+RTC_DATA_ATTR static WifiCache rtc_cache;
+static WifiCache cache;
+
+static volatile wifi_link_state_t link_state = WIFI_LINK_DOWN;
+static volatile bool fast_attempt = false;
+static wifi_link_cb_t link_cb = nullptr;
+static TaskHandle_t wifi_task_handle = nullptr;
+static esp_timer_handle_t retry_timer = nullptr;
+static uint32_t retry_delay_ms = 0;
+static uint32_t attempt_started_ms = 0;
+static bool was_up = false;
+static bool ever_up = false;     // sonraki bağlantılar yeniden bağlanma sayılır
+static volatile bool suspended = false;
+static bool resume_pending = false;
+static uint32_t resume_started_ms = 0;
+static uint32_t resume_count = 0;
+static uint32_t resume_total_ms = 0;
+
+static void set_state(wifi_link_state_t state) {
+  if (link_state == state) return;
+  link_state = state;
+  if (link_cb) link_cb(state);
+}
+
+static void load_cache() {
+  if (rtc_cache.magic == WIFI_CACHE_MAGIC) {
+    cache = rtc_cache;
+    return;
+  }
+  Preferences prefs;
+  prefs.begin("wifi", true);
+  if (prefs.getBytes("cache", &cache, sizeof(cache)) != sizeof(cache) || cache.magic != WIFI_CACHE_MAGIC) {
+    memset(&cache, 0, sizeof(cache));
+  }
+  prefs.end();
+  rtc_cache = cache;
+}
+
+static void save_cache() {
+  WifiCache fresh = {};
+  fresh.magic = WIFI_CACHE_MAGIC;
+  memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+  fresh.channel = WiFi.channel();
+  fresh.ip      = (uint32_t)WiFi.localIP();
+  fresh.gateway = (uint32_t)WiFi.gatewayIP();
+  fresh.netmask = (uint32_t)WiFi.subnetMask();
+  fresh.dns     = (uint32_t)WiFi.dnsIP();
+  rtc_cache = fresh;
+  // Flash yıpranmasın diye NVS yalnızca değişiklikte yazılır
+  if (memcmp(&fresh, &cache, sizeof(fresh)) != 0) {
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putBytes("cache", &fresh, sizeof(fresh));
+    prefs.end();
+  }
+  cache = fresh;
+}
+
+static void invalidate_cache() {
+  memset(&cache, 0, sizeof(cache));
+  rtc_cache = cache;
+  Preferences prefs;
+  prefs.begin("wifi", false);
+  prefs.remove("cache");
+  prefs.end();
+}
+
+static void schedule_attempt(uint32_t delay_ms) {
+  esp_timer_stop(retry_timer);
+  if (delay_ms == 0) {
+    xTaskNotifyGive(wifi_task_handle);
+  } else {
+    esp_timer_start_once(retry_timer, (uint64_t)delay_ms * 1000ULL);
+  }
+}
+
+static void start_attempt() {
+  attempt_started_ms = millis();
+  set_state(WIFI_LINK_CONNECTING);
+#ifdef WIFI_STATIC_IP
+  IPAddress ip, gw, mask, dns;
+  ip.fromString(WIFI_STATIC_IP);
+  gw.fromString(WIFI_STATIC_GATEWAY);
+  mask.fromString(WIFI_STATIC_NETMASK);
+  dns.fromString(WIFI_STATIC_DNS);
+  WiFi.config(ip, gw, mask, dns);
+#endif
+  if (cache.magic == WIFI_CACHE_MAGIC) {
+    // Hızlı bağlantı: bilinen AP ve kanal, tarama yok
+    fast_attempt = true;
+#ifndef WIFI_STATIC_IP
+    if (WIFI_REUSE_LEASE && cache.ip != 0) {
+      WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.netmask), IPAddress(cache.dns));
+    } else {
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
+    }
+#endif
+    WiFi.begin(WIFI_SSID, WIFI_PASS, cache.channel, cache.bssid, true);
+    esp_timer_start_once(retry_timer, (uint64_t)WIFI_FAST_CONNECT_TIMEOUT_MS * 1000ULL);
+  } else {
+    fast_attempt = false;
+#ifndef WIFI_STATIC_IP
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
+#endif
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+    esp_timer_start_once(retry_timer, (uint64_t)WIFI_CONNECT_TIMEOUT_MS * 1000ULL);
+  }
+}
+
+// Zaman aşımı: hızlı bağlantı başarısızsa önbellek silinir, ardından yeniden denenir
+static void retry_timer_cb(void *arg) {
+  if (link_state == WIFI_LINK_UP || suspended) return;
+  if (fast_attempt) {
+    fast_attempt = false;
+    invalidate_cache();
+  }
+  xTaskNotifyGive(wifi_task_handle);
+}
+
+static void wifi_task(void *arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (link_state == WIFI_LINK_UP || suspended) continue;
+    start_attempt();
+  }
+}
+
+static void on_wifi_event(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      esp_timer_stop(retry_timer);
+      save_cache();
+      retry_delay_ms = 0;
+      if (resume_pending) {
+        resume_pending = false;
+        resume_count++;
+        resume_total_ms += millis() - resume_started_ms;
+      }
+      Serial.printf("\n✅ WiFi bağlandı: %s (%s, %lu ms)\n",
+                    WiFi.localIP().toString().c_str(),
+                    fast_attempt ? "hızlı" : "tam tarama",
+                    millis() - attempt_started_ms);
+      fast_attempt = false;
+#if METRICS_ENABLED
+      if (ever_up) metrics_inc(METRIC_WIFI_RECONNECTS);
+#endif
+      was_up = true;
+      ever_up = true;
+      set_state(WIFI_LINK_UP);
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      // Kendi WiFi.begin() çağrımızın ürettiği ayrılma olayı
+      if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+      if (suspended) break;
+      set_state(WIFI_LINK_DOWN);
+      if (fast_attempt) {
+        // AP değişmiş olabilir: tam taramaya dön
+        fast_attempt = false;
+        invalidate_cache();
+        schedule_attempt(0);
+      } else if (was_up) {
+        was_up = false;
+        Serial.println("⚠️ WiFi bağlantısı koptu, arka planda yeniden bağlanılıyor");
+        schedule_attempt(0);
+      } else {
+        retry_delay_ms = retry_delay_ms == 0 ? 500 : min<uint32_t>(retry_delay_ms * 2, WIFI_RETRY_MAX_MS);
+        schedule_attempt(retry_delay_ms);
+      }
+      break;
+    default:
+      break;
+  }
+}
 
 void wifi_connect() {
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(300);
-    Serial.print(".");
+  if (wifi_task_handle == nullptr) {
+    WiFi.persistent(false);        // kimlik bilgileri her begin() çağrısında flash'a yazılmasın
+    WiFi.setAutoReconnect(false);  // yeniden bağlanmayı bu modül yönetir
+    WiFi.mode(WIFI_STA);
+    WiFi.onEvent(on_wifi_event);
+    esp_timer_create_args_t args = {};
+    args.callback = &retry_timer_cb;
+    args.name = "wifi_retry";
+    esp_timer_create(&args, &retry_timer);
+    xTaskCreate(wifi_task, "wifi_mgr", 4096, nullptr, 2, &wifi_task_handle);
+    load_cache();
   }
-  Serial.println("\n✅ WiFi bağlandı: " + WiFi.localIP().toString());
+  schedule_attempt(0);
+}
+
+void wifi_reconnect() {
+  if (link_state == WIFI_LINK_DOWN) schedule_attempt(0);
+}
+
+bool wifi_wait_connected(uint32_t timeout_ms) {
+  uint32_t start = millis();
+  while (link_state != WIFI_LINK_UP) {
+    if (millis() - start >= timeout_ms) return false;
+    delay(10);
+  }
+  return true;
+}
+
+bool wifi_is_connected() {
+  return link_state == WIFI_LINK_UP;
+}
+
+wifi_link_state_t wifi_link_state() {
+  return link_state;
+}
+
+void wifi_on_link_change(wifi_link_cb_t cb) {
+  link_cb = cb;
+}
+
+void wifi_suspend() {
+  if (wifi_task_handle == nullptr || suspended) return;
+  suspended = true;
+  esp_timer_stop(retry_timer);
+  resume_pending = false;
+  was_up = false;
+  WiFi.disconnect(true);  // STA kapanır, radyo uyanmaz
+  set_state(WIFI_LINK_DOWN);
+}
+
+void wifi_resume() {
+  if (!suspended) return;
+  suspended = false;
+  WiFi.mode(WIFI_STA);
+  resume_started_ms = millis();
+  resume_pending = true;
+  retry_delay_ms = 0;
+  schedule_attempt(0);
+}
+
+void wifi_resume_stats(uint32_t* count, uint32_t* total_ms) {
+  *count = resume_count;
+  *total_ms = resume_total_ms;
 }
 
 bool check_server_connection() {
   WiFiClient client;
   HTTPClient http;
   
+  if (!wifi_wait_connected(WIFI_CONNECT_TIMEOUT_MS)) {
+    Serial.println("❌ WiFi bağlantısı yok!");
+    return false;
+  }
+  
+#if UPLINK_TRANSPORT == TRANSPORT_WS
+  // Açık oturum sunucunun ayakta olduğunu zaten gösterir; ek istek yapılmaz
+  if (ws_session_connected()) return true;
+#endif
+
   Serial.println("🔍 Sunucu bağlantısı kontrol ediliyor...");
   Serial.println("URL: " SERVER_URL);
   
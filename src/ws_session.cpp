@@ -0,0 +1,346 @@
+// ws_session.cpp
+#include "ws_session.h"
+#include "wifi_manager.h"
+#include "mem_policy.h"
+#include "reply_cache.h"
+#include "metrics.h"
+#include "log.h"
+#include <WebSocketsClient.h>
+#include "freertos/stream_buffer.h"
+
+#define WS_MSG_QUEUE_LEN 8
+
+static WebSocketsClient ws;
+static SemaphoreHandle_t ws_mutex = NULL;    // WebSocketsClient iş parçacığı güvenli değil
+static QueueHandle_t msg_queue = NULL;       // String*, JSON kontrol iletileri
+static TaskHandle_t ws_task = NULL;
+static volatile bool connected = false;
+static bool ever_connected = false;
+static int call_seq = 0;
+
+// Yanıt sesi halkası: tek yazar (ws görevi), tek okuyucu (çalma görevi).
+// Halka hiç sıfırlanmaz: yazar yanıtın başladığı bayt konumunu kaydeder,
+// okuyucu önceki yanıttan kalanları bu konuma kadar kendisi atar.
+static StreamBufferHandle_t downlink = NULL;
+static StaticStreamBuffer_t downlink_sb;
+static volatile uint32_t ring_written = 0;     // yazılan toplam bayt; yalnız ws görevi artırır
+static volatile uint32_t reply_start_at = 0;   // reply_id'nin ilk baytının ring_written konumu
+static uint32_t ring_read = 0;                 // okunan toplam bayt; yalnız okuyucu artırır
+static volatile int32_t reply_id = 0;          // halkaya yazılan yanıt; 0: yok
+static volatile uint32_t reply_size = 0;
+static volatile bool reply_done = false;       // reply_end geldi ya da bağlantı koptu
+static volatile bool reply_ended = false;      // yalnızca reply_end'de
+static volatile bool reply_dropped = false;    // kalan çerçeveler atılır
+static volatile uint32_t reply_last_read = 0;
+static uint32_t downlink_lost = 0;
+
+static void send_cancel(int32_t id) {
+  ws_session_send_text(String("{\"type\":\"cancel\",\"id\":") + id + "}");
+}
+
+static void drop_reply(const char* why) {
+  reply_dropped = true;
+  LOG_W("⚠️ WS yanıtı %d bırakıldı: %s", (int)reply_id, why);
+  send_cancel(reply_id);
+}
+
+// ws.loop() içinden çağrılır; okuyucuyu beklemez. Önceki yanıtın okuyucusu
+// yeni kimliği görünce çıkar, yenisi reply_start_at'e kadar olan baytları atar.
+static void on_reply_start(int32_t id, uint32_t size) {
+  reply_id = 0;
+  reply_size = size;
+  reply_done = false;
+  reply_ended = false;
+  reply_dropped = false;
+  reply_last_read = millis();
+  reply_start_at = ring_written;
+  reply_id = id;
+}
+
+static void on_text(uint8_t* payload, size_t length) {
+  PsramJsonDocument doc(1024);
+  if (deserializeJson(doc, (const char*)payload, length)) return;
+  const char* type = doc["type"] | "";
+  if (strcmp(type, "reply_start") == 0) {
+    on_reply_start(doc["id"].as<int32_t>(), doc["bytes"].as<uint32_t>());
+  } else if (strcmp(type, "reply_end") == 0) {
+    if (doc["id"].as<int32_t>() == reply_id) {
+      reply_ended = true;
+      reply_done = true;
+    }
+    return;
+  }
+  // Kuyruk doluysa en eski ileti atılır
+  String* msg = new String((const char*)payload);
+  if (xQueueSend(msg_queue, &msg, 0) != pdTRUE) {
+    String* old = NULL;
+    if (xQueueReceive(msg_queue, &old, 0) == pdTRUE) delete old;
+    if (xQueueSend(msg_queue, &msg, 0) != pdTRUE) delete msg;
+  }
+}
+
+static void on_audio(uint8_t* payload, size_t length) {
+  if (reply_id == 0 || reply_dropped) return;
+  size_t n = xStreamBufferSend(downlink, payload, length, 0);
+  ring_written += n;
+  downlink_lost += length - n;
+}
+
+static void on_event(WStype_t type, uint8_t* payload, size_t length) {
+  switch (type) {
+    case WStype_CONNECTED:
+      connected = true;
+#if METRICS_ENABLED
+      if (ever_connected) metrics_inc(METRIC_WS_RECONNECTS);
+#endif
+      ever_connected = true;
+      LOG_I("🔌 WebSocket oturumu açıldı: " SERVER_URL WS_PATH);
+#if REPLY_CACHE_ENABLED
+      // Sunucu cihazda olan yanıtları akıtmaz
+      ws_session_send_text(reply_cache_announcement());
+#endif
+      break;
+    case WStype_DISCONNECTED:
+      if (connected) LOG_W("🔌 WebSocket oturumu koptu");
+      connected = false;
+      // Yarım kalan yanıt okuyucuya bitmiş gibi görünür
+      reply_done = true;
+      break;
+    case WStype_TEXT:
+      on_text(payload, length);
+      break;
+    case WStype_BIN:
+      on_audio(payload, length);
+      break;
+    default:
+      break;
+  }
+}
+
+static void ws_loop(void* arg) {
+  for (;;) {
+    if (!wifi_is_connected()) {
+      connected = false;
+      delay(100);
+      continue;
+    }
+    // Halkada bir çerçevelik yer yoksa soket okunmaz; TCP penceresi sunucuyu yavaşlatır
+    if (reply_id != 0 && !reply_dropped && xStreamBufferSpacesAvailable(downlink) < WS_DOWNLINK_FRAME) {
+      if (millis() - reply_last_read < WS_DOWNLINK_STALL_MS) {
+        delay(5);
+        continue;
+      }
+      drop_reply("okunmadı");
+    }
+    xSemaphoreTakeRecursive(ws_mutex, portMAX_DELAY);
+    ws.loop();
+    xSemaphoreGiveRecursive(ws_mutex);
+    delay(2);
+  }
+}
+
+void ws_session_begin() {
+  if (ws_task != NULL) return;
+  // Halka PSRAM'de; yoksa oturum açılmaz ve tüm istekler HTTP ile gider
+  uint8_t* storage = (uint8_t*)mem_alloc(WS_DOWNLINK_BYTES + 1, MEM_POOL_PSRAM, "ws_downlink");
+  if (storage == NULL) {
+    LOG_E("❌ WS yanıt halkası ayrılamadı, HTTP kullanılacak");
+    return;
+  }
+  downlink = xStreamBufferCreateStatic(WS_DOWNLINK_BYTES, 1, storage, &downlink_sb);
+  ws_mutex = xSemaphoreCreateRecursiveMutex();
+  msg_queue = xQueueCreate(WS_MSG_QUEUE_LEN, sizeof(String*));
+
+  ws.begin(SERVER_IP, atoi(SERVER_PORT), WS_PATH, "");
+  ws.onEvent(on_event);
+  ws.setReconnectInterval(WS_RECONNECT_MS);
+  xTaskCreate(ws_loop, "ws_session", 6144, nullptr, 3, &ws_task);
+}
+
+bool ws_session_connected() {
+  return connected;
+}
+
+bool ws_session_wait_connected(uint32_t timeout_ms) {
+  if (ws_task == NULL) return false;
+  uint32_t start = millis();
+  while (!connected && millis() - start < timeout_ms) {
+    delay(10);
+  }
+  return connected;
+}
+
+bool ws_session_send_text(const String& msg) {
+  if (!connected) return false;
+  xSemaphoreTakeRecursive(ws_mutex, portMAX_DELAY);
+  bool ok = ws.sendTXT((const uint8_t*)msg.c_str(), msg.length());
+  xSemaphoreGiveRecursive(ws_mutex);
+  return ok;
+}
+
+bool ws_session_send_binary(const uint8_t* data, size_t len) {
+  if (!connected) return false;
+  xSemaphoreTakeRecursive(ws_mutex, portMAX_DELAY);
+  bool ok = ws.sendBIN(data, len);
+  xSemaphoreGiveRecursive(ws_mutex);
+  return ok;
+}
+
+void ws_session_flush_messages() {
+  if (msg_queue == NULL) return;
+  String* msg = NULL;
+  while (xQueueReceive(msg_queue, &msg, 0) == pdTRUE) {
+    delete msg;
+  }
+}
+
+bool ws_session_next_message(JsonDocument& doc, uint32_t timeout_ms) {
+  if (msg_queue == NULL) return false;
+  String* msg = NULL;
+  if (xQueueReceive(msg_queue, &msg, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) return false;
+  DeserializationError err = deserializeJson(doc, *msg);
+  delete msg;
+  return !err;
+}
+
+static int server_call_once(const char* op, const String& args_json, String* body) {
+  *body = "";
+#if UPLINK_TRANSPORT == TRANSPORT_WS
+  if (connected) {
+    int id = ++call_seq;
+    ws_session_flush_messages();
+    // Sunucu yanıt sesini istenen formatta üretir; HTTP'deki ?format= karşılığı
+    String args = args_json.length() > 0 ? args_json : String("{\"format\":\"" REPLY_FORMAT "\"}");
+    String msg = String("{\"type\":\"call\",\"id\":") + id + ",\"op\":\"" + op + "\",\"args\":" + args + "}";
+    if (ws_session_send_text(msg)) {
+      PsramJsonDocument doc(1024);
+      uint32_t start = millis();
+      while (millis() - start < WS_CALL_TIMEOUT_MS) {
+        if (!ws_session_next_message(doc, 100)) continue;
+        if (strcmp(doc["type"] | "", "result") != 0 || doc["id"].as<int>() != id) continue;
+        JsonVariant b = doc["body"];
+        if (b.is<const char*>()) {
+          *body = b.as<String>();
+        } else {
+          serializeJson(b, *body);
+        }
+        return doc["code"] | 0;
+      }
+      LOG_E("❌ WS: '%s' yanıtsız kaldı", op);
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+  }
+#endif
+  // Metinden sese dönüştürme HTTP'de /upload'a JSON olarak gider
+  String url = strcmp(op, "tts") == 0 ? String(UPLOAD_URL) : String(SERVER_URL "/") + op;
+  WiFiClient client;
+  HTTPClient http;
+  int code;
+  if (args_json.length() == 0) {
+    http.begin(client, url + "?format=" REPLY_FORMAT);
+    code = http.GET();
+  } else {
+    http.begin(client, url);
+    http.addHeader("Content-Type", "application/json");
+    code = http.POST(args_json);
+  }
+  if (code > 0) *body = http.getString();
+  http.end();
+  return code;
+}
+
+int server_call(const char* op, const String& args_json, String* body) {
+#if METRICS_ENABLED
+  uint32_t start = millis();
+  int code = server_call_once(op, args_json, body);
+  metrics_observe_http(metrics_endpoint_for(op), millis() - start, code);
+  return code;
+#else
+  return server_call_once(op, args_json, body);
+#endif
+}
+
+// Halkadan okur; yanıt başlamadıysa başlamasını bekler. Çalma kesilirse
+// sunucuya kalan sesi göndermemesi söylenir.
+class AudioFileSourceWs : public AudioFileSource {
+ public:
+  explicit AudioFileSourceWs(int32_t id) : id(id), pos(0), open(true) {
+    reply_last_read = millis();
+  }
+  ~AudioFileSourceWs() override { close(); }
+
+  uint32_t read(void* data, uint32_t len) override {
+    uint32_t got = 0;
+    uint32_t waited = millis();
+    while (open && got == 0) {
+      if (reply_id != id) {
+        // Yanıtın başlangıcı henüz gelmedi (işlem sonucundan sonra akar) ya da yerini yenisi aldı
+        if ((reply_id > id && reply_id != 0) || millis() - waited > WS_DOWNLINK_STALL_MS) break;
+        delay(10);
+        continue;
+      }
+      if (reply_dropped) break;
+      if (ring_read != reply_start_at) {
+        // Önceki yanıtın okunmamış kuyruğu; yazar zaten yazdığı için beklemeden gelir
+        uint8_t stale[128];
+        uint32_t left = reply_start_at - ring_read;
+        size_t n = xStreamBufferReceive(downlink, stale, left < sizeof(stale) ? left : sizeof(stale), pdMS_TO_TICKS(20));
+        ring_read += n;
+        if (n > 0) reply_last_read = millis();
+        else if (millis() - waited > WS_DOWNLINK_STALL_MS) break;
+        continue;
+      }
+      got = xStreamBufferReceive(downlink, data, len, pdMS_TO_TICKS(20));
+      ring_read += got;
+      if (got == 0) {
+        if (reply_done && xStreamBufferIsEmpty(downlink)) break;
+        if (millis() - waited > WS_DOWNLINK_STALL_MS) break;
+      }
+    }
+    if (got > 0) reply_last_read = millis();
+    pos += got;
+    return got;
+  }
+
+  bool seek(int32_t to, int dir) override { return false; }
+
+  bool close() override {
+    if (!open) return true;
+    open = false;
+    if (reply_id == id && !reply_done && !reply_dropped) {
+      reply_dropped = true;
+      send_cancel(id);
+    }
+    if (downlink_lost > 0) {
+      LOG_W("⚠️ WS yanıt halkası taştı: %u byte kayıp", downlink_lost);
+      downlink_lost = 0;
+    }
+    return true;
+  }
+
+  bool isOpen() override { return open; }
+  uint32_t getSize() override { return reply_id == id ? reply_size : 0; }
+  uint32_t getPos() override { return pos; }
+
+ private:
+  int32_t id;
+  uint32_t pos;
+  bool open;
+};
+
+void ws_session_cancel_reply(const String& url) {
+  int32_t id = url.substring(3).toInt();
+  if (url.startsWith("ws:") && id > 0) send_cancel(id);
+}
+
+bool ws_session_reply_intact(const String& url) {
+  int32_t id = url.substring(3).toInt();
+  return url.startsWith("ws:") && id > 0 && reply_id == id && reply_ended && !reply_dropped && downlink_lost == 0;
+}
+
+AudioFileSource* ws_session_open_reply(const String& url) {
+  if (downlink == NULL || !url.startsWith("ws:")) return NULL;
+  int32_t id = url.substring(3).toInt();
+  if (id <= 0) return NULL;
+  return new AudioFileSourceWs(id);
+}
@@ -0,0 +1,122 @@
+// check.h
+// Masaüstü testleri için en küçük denetim düzeni: başarısız denetim yazılır,
+// test sonunda CHECK_DONE() başarısızlık varsa sıfırdan farklı döner.
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int check_failures = 0;
+
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      fprintf(stderr, "%s:%d: CHECK(%s) başarısız\n", __FILE__, __LINE__, #cond); \
+      check_failures++;                                                  \
+    }                                                                    \
+  } while (0)
+
+// Ölçülen değer de yazılır; eşiğe ne kadar uzak kalındığı görülsün
+#define CHECK_GE(val, floor)                                             \
+  do {                                                                   \
+    double v_ = (val), f_ = (floor);                                     \
+    if (!(v_ >= f_)) {                                                   \
+      fprintf(stderr, "%s:%d: %s = %.3f, en az %.3f olmalı\n", __FILE__, __LINE__, #val, v_, f_); \
+      check_failures++;                                                  \
+    }                                                                    \
+  } while (0)
+
+#define CHECK_LE(val, ceil)                                              \
+  do {                                                                   \
+    double v_ = (val), c_ = (ceil);                                      \
+    if (!(v_ <= c_)) {                                                   \
+      fprintf(stderr, "%s:%d: %s = %.3f, en çok %.3f olmalı\n", __FILE__, __LINE__, #val, v_, c_); \
+      check_failures++;                                                  \
+    }                                                                    \
+  } while (0)
+
+#define CHECK_DONE()                                                     \
+  do {                                                                   \
+    if (check_failures) fprintf(stderr, "%d denetim başarısız\n", check_failures); \
+    return check_failures ? 1 : 0;                                       \
+  } while (0)
+
+// Tekrarlanabilir sentetik girdiler (xorshift32, sabit tohum)
+struct TestRng {
+  uint32_t s;
+  explicit TestRng(uint32_t seed) : s(seed ? seed : 1) {}
+  uint32_t next() {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+  }
+  // [-1, 1)
+  float uniform() { return (float)((int32_t)next()) / 2147483648.0f; }
+  // Yaklaşık Gauss: 4 tekdüze toplamı, birim varyans
+  float gauss() { return (uniform() + uniform() + uniform() + uniform()) * 0.8660254f; }
+};
+
+static inline int16_t to_i16(float x) {
+  float v = x * 32767.0f;
+  if (v > 32767.0f) v = 32767.0f;
+  if (v < -32768.0f) v = -32768.0f;
+  return (int16_t)lrintf(v);
+}
+
+// Konuşmaya benzer sinyal: iki formantlı rezonatörden geçen gürültü ve perde
+// darbesi, hece zarfıyla; tepe düzeyi peak_dbfs'e ölçeklenir
+static inline void make_speech_like(int16_t* out, size_t n, float rate, float peak_dbfs, uint32_t seed) {
+  TestRng rng(seed);
+  float y1[2] = {0, 0}, y2[2] = {0, 0};
+  const float formant[2] = {700.0f, 1800.0f};
+  const float bw[2] = {130.0f, 200.0f};
+  float a1[2], a2[2];
+  for (int k = 0; k < 2; k++) {
+    float r = expf(-(float)M_PI * bw[k] / rate);
+    a1[k] = 2.0f * r * cosf(2.0f * (float)M_PI * formant[k] / rate);
+    a2[k] = -r * r;
+  }
+  float* tmp = (float*)malloc(n * sizeof(float));
+  float peak = 0;
+  int period = (int)(rate / 140.0f);
+  for (size_t i = 0; i < n; i++) {
+    float excite = (i % period == 0 ? 4.0f : 0.0f) + 0.3f * rng.gauss();
+    float acc = 0;
+    for (int k = 0; k < 2; k++) {
+      float y = excite + a1[k] * y1[k] + a2[k] * y2[k];
+      y2[k] = y1[k];
+      y1[k] = y;
+      acc += y;
+    }
+    // ~4 hece/s, aralarda kısa sessizlik
+    float env = sinf((float)M_PI * fmodf((float)i / rate * 4.0f, 1.0f));
+    tmp[i] = acc * env * env;
+    if (fabsf(tmp[i]) > peak) peak = fabsf(tmp[i]);
+  }
+  float gain = powf(10.0f, peak_dbfs / 20.0f) / (peak > 0 ? peak : 1.0f);
+  for (size_t i = 0; i < n; i++) out[i] = to_i16(tmp[i] * gain);
+  free(tmp);
+}
+
+static inline void make_sine(int16_t* out, size_t n, float rate, float freq, float dbfs) {
+  float amp = powf(10.0f, dbfs / 20.0f);
+  for (size_t i = 0; i < n; i++) out[i] = to_i16(amp * sinf(2.0f * (float)M_PI * freq * (float)i / rate));
+}
+
+// ref'e göre hata gücü oranı (dB)
+static inline double snr_db(const int16_t* ref, const int16_t* got, size_t n) {
+  double sig = 0, err = 0;
+  for (size_t i = 0; i < n; i++) {
+    double d = (double)got[i] - (double)ref[i];
+    sig += (double)ref[i] * ref[i];
+    err += d * d;
+  }
+  if (err == 0) return 200.0;
+  return 10.0 * log10(sig / err);
+}
+
+#endif
@@ -0,0 +1,32 @@
+// Preferences.h (masaüstü yerine geçen)
+// Tek ad alanlı NVS: anahtarlar host_nvs'te, yeniden açılışlar arasında korunur.
+#ifndef PREFERENCES_SHIM_H
+#define PREFERENCES_SHIM_H
+
+#include <stdint.h>
+#include <map>
+#include <string>
+
+inline std::map<std::string, uint32_t> host_nvs;
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool = false) {
+    ns = name;
+    return true;
+  }
+  void end() {}
+  uint32_t getUInt(const char* key, uint32_t def = 0) {
+    auto it = host_nvs.find(ns + "/" + key);
+    return it == host_nvs.end() ? def : it->second;
+  }
+  size_t putUInt(const char* key, uint32_t value) {
+    host_nvs[ns + "/" + key] = value;
+    return sizeof(value);
+  }
+
+ private:
+  std::string ns;
+};
+
+#endif
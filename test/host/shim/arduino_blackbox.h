@@ -0,0 +1,49 @@
+// arduino_blackbox.h (masaüstü yerine geçen)
+// blackbox.cpp için arduino_log.h'ye ek FreeRTOS ve ESP-IDF parçaları. Tek
+// görevli: kritik bölüm boştur, blackbox görevi kurulmaz, test onun bir turunu
+// kendisi çağırır. flash_mutex'in tutulup tutulmadığı host_mutex_depth'te izlenir.
+#ifndef ARDUINO_BLACKBOX_SHIM_H
+#define ARDUINO_BLACKBOX_SHIM_H
+
+#include "arduino_log.h"
+
+#define RTC_NOINIT_ATTR
+#define portMAX_DELAY 0xffffffffu
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+typedef void* SemaphoreHandle_t;
+inline int host_mutex_depth = 0;
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)&host_mutex_depth; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) {
+  host_mutex_depth++;
+  return pdTRUE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) {
+  host_mutex_depth--;
+  return pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline void xTaskNotifyGive(TaskHandle_t) {}
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t host_reset_reason = ESP_RST_POWERON;
+inline esp_reset_reason_t esp_reset_reason() { return host_reset_reason; }
+
+#endif
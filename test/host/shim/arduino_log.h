@@ -0,0 +1,61 @@
+// arduino_log.h (masaüstü yerine geçen)
+// log.cpp'yi masaüstünde derlemek için gereken Arduino ve FreeRTOS parçaları;
+// -include ile log.h'den önce gelir. Serial'e yazılan her şey Serial.out'ta
+// birikir. Günlük halkası kurulmaz, kayıtlar log_detail::push'tan doğrudan yazılır.
+#ifndef ARDUINO_LOG_SHIM_H
+#define ARDUINO_LOG_SHIM_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef uint8_t byte;
+
+inline uint32_t host_ms = 0;
+inline uint32_t millis() { return host_ms; }
+inline void delay(uint32_t ms) { host_ms += ms; }
+
+inline BaseType_t xTaskCreate(void (*)(void*), const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*) { return pdFALSE; }
+
+struct Print {
+  virtual size_t write(const uint8_t* buf, size_t len) = 0;
+  virtual ~Print() {}
+};
+
+struct HostSerial : Print {
+  std::string out;
+  size_t write(const uint8_t* buf, size_t len) override {
+    out.append((const char*)buf, len);
+    return len;
+  }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return write((const uint8_t*)buf, n < 0 ? 0 : (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+  size_t println(const char* s) {
+    out += s;
+    out += '\n';
+    return strlen(s) + 1;
+  }
+  void flush() {}
+};
+inline HostSerial Serial;
+
+// mem_policy.h'deki typedef için; belge hiç kurulmaz
+template <typename Allocator> struct BasicJsonDocument {};
+
+#endif
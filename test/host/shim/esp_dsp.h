@@ -0,0 +1,70 @@
+// esp_dsp.h (masaüstü yerine geçen)
+// dsp_kernels.cpp'nin esp-dsp yolunu masaüstünde derleyip ref ile karşılaştırmak
+// için kullandığı işlevlerin esp-dsp ANSI sürümleriyle aynı anlamlı karşılıkları.
+// FFT çıktısı esp-dsp'deki gibi bit ters sıradadır; dsps_bit_rev_fc32 düzeltir.
+#ifndef ESP_DSP_SHIM_H
+#define ESP_DSP_SHIM_H
+
+#include <math.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+static inline esp_err_t dsps_dotprod_f32(const float* a, const float* b, float* dest, int len) {
+  float acc = 0;
+  for (int i = 0; i < len; i++) acc += a[i] * b[i];
+  *dest = acc;
+  return ESP_OK;
+}
+
+static inline esp_err_t dsps_mulc_f32(const float* in, float* out, int len, float c, int step_in, int step_out) {
+  for (int i = 0; i < len; i++) out[i * step_out] = in[i * step_in] * c;
+  return ESP_OK;
+}
+
+static inline esp_err_t dsps_fft2r_init_fc32(float* table, int max_n) {
+  (void)table;
+  return (max_n & (max_n - 1)) == 0 ? ESP_OK : -1;
+}
+
+// Frekansta seyreltmeli radix-2: doğal sıra girer, bit ters sıra çıkar
+static inline esp_err_t dsps_fft2r_fc32(float* z, int n) {
+  for (int len = n; len >= 2; len >>= 1) {
+    int half = len >> 1;
+    for (int k = 0; k < half; k++) {
+      double a = -2.0 * M_PI * k / len;
+      float wr = (float)cos(a), wi = (float)sin(a);
+      for (int i = k; i < n; i += len) {
+        float* p = z + 2 * i;
+        float* q = z + 2 * (i + half);
+        float dr = p[0] - q[0], di = p[1] - q[1];
+        p[0] += q[0];
+        p[1] += q[1];
+        q[0] = dr * wr - di * wi;
+        q[1] = dr * wi + di * wr;
+      }
+    }
+  }
+  return ESP_OK;
+}
+
+static inline esp_err_t dsps_bit_rev_fc32(float* z, int n) {
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      float tr = z[2 * i], ti = z[2 * i + 1];
+      z[2 * i] = z[2 * j];
+      z[2 * i + 1] = z[2 * j + 1];
+      z[2 * j] = tr;
+      z[2 * j + 1] = ti;
+    }
+  }
+  return ESP_OK;
+}
+
+#endif
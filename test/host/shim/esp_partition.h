@@ -0,0 +1,67 @@
+// esp_partition.h (masaüstü yerine geçen)
+// Bellekte NOR flash bölümü: silme sektörü 0xFF'e çeker, yazım yalnızca bitleri
+// sıfırlar (AND). Sektör başına silme sayılır; host_flash_fail_after baytı
+// yazıldıktan sonra yazım yarıda kesilir (güç kesintisinde yırtık yazım).
+#ifndef ESP_PARTITION_SHIM_H
+#define ESP_PARTITION_SHIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum { ESP_PARTITION_TYPE_DATA = 1 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+  const char* label;
+} esp_partition_t;
+
+#define HOST_FLASH_SECTOR 4096
+
+inline std::vector<uint8_t> host_flash;
+inline std::vector<uint32_t> host_erase_count;
+inline long host_flash_fail_after = -1;   // < 0: kesilmez
+inline esp_partition_t host_partition = {0, 0, "blackbox"};
+
+// Yeni yonga: her bayt 0xFF
+inline void host_flash_init(int sectors) {
+  host_flash.assign((size_t)sectors * HOST_FLASH_SECTOR, 0xFF);
+  host_erase_count.assign(sectors, 0);
+  host_partition.size = (uint32_t)host_flash.size();
+}
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char* label) {
+  return host_flash.empty() || strcmp(label, host_partition.label) != 0 ? NULL : &host_partition;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t*, size_t addr, void* dst, size_t n) {
+  if (addr + n > host_flash.size()) return ESP_FAIL;
+  memcpy(dst, host_flash.data() + addr, n);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t*, size_t addr, const void* src, size_t n) {
+  if (addr + n > host_flash.size()) return ESP_FAIL;
+  for (size_t i = 0; i < n; i++) {
+    if (host_flash_fail_after == 0) return ESP_FAIL;
+    if (host_flash_fail_after > 0) host_flash_fail_after--;
+    host_flash[addr + i] &= ((const uint8_t*)src)[i];
+  }
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t*, size_t addr, size_t n) {
+  if (addr % HOST_FLASH_SECTOR || n % HOST_FLASH_SECTOR || addr + n > host_flash.size()) return ESP_FAIL;
+  memset(host_flash.data() + addr, 0xFF, n);
+  for (size_t s = addr / HOST_FLASH_SECTOR; s < (addr + n) / HOST_FLASH_SECTOR; s++) host_erase_count[s]++;
+  return ESP_OK;
+}
+
+#endif
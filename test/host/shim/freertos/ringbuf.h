@@ -0,0 +1,22 @@
+// freertos/ringbuf.h (masaüstü yerine geçen)
+// Yalnızca log.cpp'nin derlenmesi için; halka hiç oluşturulmaz.
+#ifndef RINGBUF_SHIM_H
+#define RINGBUF_SHIM_H
+
+#include <stddef.h>
+
+typedef void* RingbufHandle_t;
+typedef struct {
+  int unused;
+} StaticRingbuffer_t;
+typedef enum { RINGBUF_TYPE_NOSPLIT } RingbufferType_t;
+
+inline RingbufHandle_t xRingbufferCreateStatic(size_t, RingbufferType_t, uint8_t*, StaticRingbuffer_t*) { return NULL; }
+inline BaseType_t xRingbufferSend(RingbufHandle_t, const void*, size_t, TickType_t) { return pdFALSE; }
+inline void* xRingbufferReceive(RingbufHandle_t, size_t*, TickType_t) { return NULL; }
+inline void vRingbufferReturnItem(RingbufHandle_t, void*) {}
+inline void vRingbufferGetInfo(RingbufHandle_t, UBaseType_t*, UBaseType_t*, UBaseType_t*, UBaseType_t*, UBaseType_t* waiting) {
+  if (waiting != NULL) *waiting = 0;
+}
+
+#endif
@@ -0,0 +1,113 @@
+// test_adpcm.cpp
+// IMA-ADPCM kodlayıcısının (src/audio_codec.cpp) sunucunun çözücüsüyle gidiş-dönüş
+// testi. Çözücü llm_server.py'deki ima_adpcm_decode_block'un birebir karşılığıdır;
+// cihaz ve sunucu aynı öngörüde kalmazsa SNR düşer ve blok sonu denetimi tutmaz.
+
+#include "audio_codec.h"
+#include "config.h"
+#include "check.h"
+#include <string.h>
+#include <vector>
+
+static const int16_t step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+static const int8_t index_table[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+// Blok başlığından başlar; samples kadar örnek çözer
+static void decode_block(const uint8_t* block, size_t samples, int16_t* out) {
+  int predictor = (int16_t)(block[0] | (block[1] << 8));
+  int index = block[2] > 88 ? 88 : block[2];
+  const uint8_t* p = block + ADPCM_BLOCK_HEADER;
+  for (size_t i = 0; i < samples; i++) {
+    uint8_t code = (i & 1) ? (p[i / 2] >> 4) : (p[i / 2] & 0x0F);
+    int step = step_table[index];
+    int delta = step >> 3;
+    if (code & 4) delta += step;
+    if (code & 2) delta += step >> 1;
+    if (code & 1) delta += step >> 2;
+    predictor += (code & 8) ? -delta : delta;
+    if (predictor > 32767) predictor = 32767;
+    if (predictor < -32768) predictor = -32768;
+    index += index_table[code];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    out[i] = (int16_t)predictor;
+  }
+}
+
+// Cihazdaki gibi ardışık bloklar halinde kodlar, her bloğu bağımsız çözer
+static double round_trip(const int16_t* in, size_t n, size_t block_samples, int* state_mismatch) {
+  std::vector<uint8_t> block(ADPCM_BLOCK_BYTES(block_samples));
+  std::vector<int16_t> out(n);
+  AdpcmState st;
+  adpcm_reset(&st);
+  *state_mismatch = 0;
+  for (size_t off = 0; off < n; off += block_samples) {
+    size_t count = n - off < block_samples ? n - off : block_samples;
+    size_t len = adpcm_encode_block(&st, in + off, count, block.data());
+    if (len != ADPCM_BLOCK_BYTES(count)) (*state_mismatch)++;
+    decode_block(block.data(), count, out.data() + off);
+    // Sonraki bloğun başlığı kodlayıcının durumudur; çözücü aynı yere varmalı
+    if (out[off + count - 1] != st.predictor) (*state_mismatch)++;
+  }
+  return snr_db(in, out.data(), n);
+}
+
+int main() {
+  const size_t block = CHUNK_SIZE / 2;   // voice_assistant.cpp'deki yükleme parçası
+  const size_t n = SAMPLE_RATE * 4;
+  std::vector<int16_t> sig(n);
+  int mismatch;
+
+  // Konuşma benzeri sinyal, yüksek ve düşük kayıt düzeyinde
+  make_speech_like(sig.data(), n, SAMPLE_RATE, -3.0f, 7);
+  double speech_loud = round_trip(sig.data(), n, block, &mismatch);
+  CHECK(mismatch == 0);
+  make_speech_like(sig.data(), n, SAMPLE_RATE, -30.0f, 7);
+  double speech_quiet = round_trip(sig.data(), n, block, &mismatch);
+  CHECK(mismatch == 0);
+
+  // Tonlar: dar bantta öngörü iyi izler, yüksek frekansta adım sınırına yaklaşır
+  make_sine(sig.data(), n, SAMPLE_RATE, 440.0f, -6.0f);
+  double sine_440 = round_trip(sig.data(), n, block, &mismatch);
+  CHECK(mismatch == 0);
+  make_sine(sig.data(), n, SAMPLE_RATE, 3000.0f, -6.0f);
+  double sine_3k = round_trip(sig.data(), n, block, &mismatch);
+  CHECK(mismatch == 0);
+
+  // Tek sayıda örnekli son blok: son nibble tek başına yazılır
+  double odd = round_trip(sig.data(), block + 1, block, &mismatch);
+  CHECK(mismatch == 0);
+
+  printf("adpcm SNR: konuşma -3 dBFS %.1f dB, -30 dBFS %.1f dB, 440 Hz %.1f dB, 3 kHz %.1f dB, tek blok %.1f dB\n",
+         speech_loud, speech_quiet, sine_440, sine_3k, odd);
+
+  // Eşikler ölçülen değerlerin ~3 dB altında (18.0 / 18.3 / 35.0 / 17.2 / 16.4 dB);
+  // öngörü kayarsa ya da nibble sırası bozulursa SNR 0 dB civarına iner
+  CHECK_GE(speech_loud, 15.0);
+  CHECK_GE(speech_quiet, 15.0);
+  CHECK_GE(sine_440, 32.0);
+  CHECK_GE(sine_3k, 14.0);
+  CHECK_GE(odd, 13.0);
+
+  // Sessizlik sessiz kalır
+  memset(sig.data(), 0, n * sizeof(int16_t));
+  std::vector<uint8_t> buf(ADPCM_BLOCK_BYTES(block));
+  std::vector<int16_t> out(block);
+  AdpcmState st;
+  adpcm_reset(&st);
+  adpcm_encode_block(&st, sig.data(), block, buf.data());
+  decode_block(buf.data(), block, out.data());
+  int peak = 0;
+  for (size_t i = 0; i < block; i++) peak = abs(out[i]) > peak ? abs(out[i]) : peak;
+  CHECK_LE(peak, 8);
+
+  CHECK_DONE();
+}
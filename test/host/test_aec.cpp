@@ -0,0 +1,203 @@
+// test_aec.cpp
+// Yankı gidericinin (src/aec.cpp) ERLE ölçümü, depodaki kayıtlarla:
+//   uzak uç:  audios/ altındaki ilk AEC_FIXTURES adet *_reply.wav (sunucunun TTS yanıtları)
+//   yakın uç: input_audio_udp.pcm (cihazdan yüklenmiş konuşma, 16 kHz 16 bit)
+// Uzak uç sentetik bir oda yolundan (2.5 ms gecikme, ~12 ms'de sönen
+// yansımalar, -6 dB) geçip mikrofona yankı olarak girer; mikrofonda -60 dBFS
+// gürültü ve her dosyanın ikinci yarısında yakın uç konuşması vardır.
+// Denetlenenler: yalnız yankıda ERLE, çift konuşmada yankı bastırma ve
+// yakın uç SDR kazancı, algılayıcının yanlış alarm oranı. Kayıttaki yakın uç
+// yankının ~15 dB altındadır; mutlak SDR değil, girişe göre kazanç denetlenir.
+
+#include "aec.h"
+#include "config.h"
+#include "check.h"
+#include <dirent.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define RATE 16000
+#define BLOCK (RATE * I2S_DMA_BUF_MS / 1000)   // audio_capture.cpp'deki blok
+#define AEC_FIXTURES 12
+
+#ifndef FIXTURE_DIR
+#define FIXTURE_DIR ".."
+#endif
+
+static bool read_file(const std::string& path, std::vector<uint8_t>* out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static std::vector<int16_t> to_pcm(const uint8_t* p, size_t bytes) {
+  std::vector<int16_t> s(bytes / 2);
+  for (size_t i = 0; i < s.size(); i++) s[i] = (int16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+  return s;
+}
+
+// Yalnızca 16 kHz, 16 bit, mono PCM WAV; "data" parçası aranır
+static bool read_wav(const std::string& path, std::vector<int16_t>* pcm) {
+  std::vector<uint8_t> b;
+  if (!read_file(path, &b) || b.size() < 12 || memcmp(b.data(), "RIFF", 4) != 0) return false;
+  size_t off = 12;
+  bool fmt_ok = false;
+  while (off + 8 <= b.size()) {
+    uint32_t len = b[off + 4] | (b[off + 5] << 8) | (b[off + 6] << 16) | ((uint32_t)b[off + 7] << 24);
+    const uint8_t* body = b.data() + off + 8;
+    if (memcmp(b.data() + off, "fmt ", 4) == 0 && len >= 16) {
+      uint16_t channels = body[2] | (body[3] << 8);
+      uint32_t rate = body[4] | (body[5] << 8) | (body[6] << 16) | ((uint32_t)body[7] << 24);
+      uint16_t bits = body[14] | (body[15] << 8);
+      fmt_ok = channels == 1 && rate == RATE && bits == 16;
+    } else if (memcmp(b.data() + off, "data", 4) == 0) {
+      if (!fmt_ok) return false;
+      size_t n = std::min<size_t>(len, b.size() - off - 8);
+      *pcm = to_pcm(body, n);
+      return true;
+    }
+    off += 8 + len + (len & 1);
+  }
+  return false;
+}
+
+static std::vector<std::string> reply_files() {
+  std::vector<std::string> names;
+  DIR* d = opendir(FIXTURE_DIR "/audios");
+  if (d == NULL) return names;
+  while (struct dirent* e = readdir(d)) {
+    std::string n = e->d_name;
+    if (n.size() > 10 && n.compare(n.size() - 10, 10, "_reply.wav") == 0) names.push_back(n);
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  if (names.size() > AEC_FIXTURES) names.resize(AEC_FIXTURES);
+  return names;
+}
+
+static std::vector<float> room_ir(TestRng& rng) {
+  std::vector<float> h(RATE * 15 / 1000, 0.0f);   // 15 ms, AEC_TAPS (16 ms) içinde
+  const size_t direct = RATE * 25 / 10000;          // 2.5 ms
+  h[direct] = 1.0f;
+  for (size_t i = direct + 1; i < h.size(); i++) {
+    h[i] = 0.4f * rng.gauss() * expf(-(float)(i - direct) / (RATE * 0.012f / 6.9f));   // 12 ms'de -60 dB
+  }
+  float norm = 0;
+  for (float v : h) norm += v * v;
+  for (float& v : h) v *= 0.5f / sqrtf(norm);   // -6 dB
+  return h;
+}
+
+static double sum_sq(const int16_t* x, size_t n) {
+  double acc = 0;
+  for (size_t i = 0; i < n; i++) acc += (double)x[i] * x[i];
+  return acc;
+}
+
+static double db(double num, double den) {
+  return 10.0 * log10((num + 1e-9) / (den + 1e-9));
+}
+
+int main() {
+  std::vector<std::string> files = reply_files();
+  std::vector<uint8_t> near_raw;
+  CHECK(files.size() == AEC_FIXTURES);
+  CHECK(read_file(FIXTURE_DIR "/input_audio_udp.pcm", &near_raw));
+  if (files.size() != AEC_FIXTURES || near_raw.empty()) CHECK_DONE();
+  std::vector<int16_t> near_all = to_pcm(near_raw.data(), near_raw.size());
+
+  TestRng rng(39);
+  std::vector<float> h = room_ir(rng);
+  static AecState aec;
+  aec_init(&aec, AEC_MU);
+
+  // Tüm dosyalar boyunca toplamlar; katsayılar cihazdaki gibi yanıtlar arasında korunur
+  double echo_only_d = 0, echo_only_e = 0;      // yalnız yankı: yankı ve çıkış
+  double dt_echo = 0, dt_resid_echo = 0;        // çift konuşma: yankı ve çıkıştaki yankı kalıntısı
+  double dt_near = 0, dt_in_dist = 0, dt_dist = 0;   // çift konuşma: yakın uç, girişte ve çıkışta ondan sapma
+  uint64_t dt_flag_in = 0, dt_len = 0, dt_flag_out = 0, out_len = 0;
+  size_t near_pos = 0;
+  double worst_erle = 1e9;
+
+  for (const std::string& name : files) {
+    std::vector<int16_t> far;
+    CHECK(read_wav(std::string(FIXTURE_DIR "/audios/") + name, &far));
+    size_t n = far.size() - far.size() % BLOCK;
+    if (n < 2 * BLOCK) continue;
+    size_t half = (n / 2) - (n / 2) % BLOCK;
+
+    // Mikrofon = yankı + yakın uç + gürültü; bileşenler ayrı tutulur, çıkıştan
+    // yakın uç ve gürültü çıkarılınca kalan yankı kalıntısıdır
+    std::vector<int16_t> echo(n), near(n, 0), noise(n), mic(n);
+    for (size_t i = half; i < n; i++) near[i] = near_all[near_pos++ % near_all.size()];
+    for (size_t i = 0; i < n; i++) {
+      float acc = 0;
+      for (size_t k = 0; k < h.size() && k <= i; k++) acc += h[k] * far[i - k];
+      echo[i] = to_i16(acc / 32768.0f);
+      noise[i] = to_i16(0.001f * rng.gauss());
+      mic[i] = (int16_t)std::max(-32768, std::min(32767, echo[i] + near[i] + noise[i]));
+    }
+
+    aec_clear_history(&aec);
+    std::vector<int16_t> out = mic;
+    std::vector<int16_t> resid(BLOCK);
+    double file_d = 0, file_e = 0;
+    for (size_t off = 0; off < n; off += BLOCK) {
+      uint32_t dt_before = aec.dt_samples;
+      aec_process(&aec, out.data() + off, far.data() + off, BLOCK);
+      uint32_t flagged = aec.dt_samples - dt_before;
+      for (size_t i = 0; i < BLOCK; i++) resid[i] = (int16_t)(out[off + i] - near[off + i] - noise[off + i]);
+      double d2 = sum_sq(echo.data() + off, BLOCK);
+      double e2 = sum_sq(resid.data(), BLOCK);
+      if (off < half) {
+        if (off >= BLOCK * 8) {   // ilk 128 ms'yi yakınsama payı say
+          echo_only_d += d2;
+          echo_only_e += e2;
+          file_d += d2;
+          file_e += e2;
+        }
+        dt_flag_out += flagged;
+        out_len += BLOCK;
+      } else {
+        dt_echo += d2;
+        dt_resid_echo += e2;
+        dt_flag_in += flagged;
+        dt_len += BLOCK;
+        // Yakın uçtan sapma: yankı kalıntısı ve gürültü dahil her şey
+        for (size_t i = off; i < off + BLOCK; i++) {
+          double in_dist = (double)mic[i] - near[i];
+          double dist = (double)out[i] - near[i];
+          dt_near += (double)near[i] * near[i];
+          dt_in_dist += in_dist * in_dist;
+          dt_dist += dist * dist;
+        }
+      }
+    }
+    if (file_d > 0) worst_erle = std::min(worst_erle, db(file_d, file_e));
+  }
+
+  double erle = db(echo_only_d, echo_only_e);
+  double dt_supp = db(dt_echo, dt_resid_echo);
+  double sdr_in = db(dt_near, dt_in_dist);
+  double sdr_out = db(dt_near, dt_dist);
+  double flag_in = (double)dt_flag_in / (dt_len ? dt_len : 1);
+  double flag_out = (double)dt_flag_out / (out_len ? out_len : 1);
+  printf("aec: %zu yanıt, ERLE yalnız yankı %.1f dB (en kötü dosya %.1f dB), çift konuşmada yankı bastırma %.1f dB, "
+         "yakın uç SDR %.1f -> %.1f dB, çift konuşma işareti %%%.0f içinde / %%%.1f dışında\n",
+         files.size(), erle, worst_erle, dt_supp, sdr_in, sdr_out, flag_in * 100, flag_out * 100);
+
+  // Eşikler ölçülen değerlerin ~3 dB altında (29.3 / 21.8 / 17.2 / 17.1 dB, %7.9);
+  // çift konuşmada süzgeç ıraksarsa bastırma ve SDR kazancı birlikte düşer
+  CHECK_GE(erle, 26.0);
+  CHECK_GE(worst_erle, 18.0);
+  CHECK_GE(dt_supp, 14.0);
+  CHECK_GE(sdr_out - sdr_in, 14.0);
+  CHECK_LE(flag_out, 0.12);
+  CHECK_DONE();
+}
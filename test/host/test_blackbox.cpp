@@ -0,0 +1,257 @@
+// test_blackbox.cpp
+// Kara kutunun (src/blackbox.cpp) masaüstünde doğrulaması: bellekte NOR flash
+// bölümü (host/shim/esp_partition.h) ve korunan ya da rastgele bırakılan RTC
+// halkasıyla açılışlar. Denetlenenler: ham günlük kaydının RTC'den ve flash'tan
+// aynı metne çözülmesi, panik sonrası RTC'de kalanların flash'a geçmesi, imaj
+// değişince ve güç kesilince RTC halkasının atılması, başlığı yarım yazılmış
+// sektörün bırakılıp yazımın sonrakinde sürmesi, sektör halkasının dönmesi
+// ve silmelerin sektörlere eşit dağılması, dökümün istemciye yazarken
+// flash_mutex'i tutmaması ve arada ilerleyen yazıcıya rağmen kaydı iki kez
+// ya da sırasız vermemesi.
+//
+// Kaynak dosya doğrudan içerilir: yeniden açılış için statik durum sıfırlanır,
+// blackbox görevinin bir turu testten çağrılır.
+
+#include "../../src/blackbox.cpp"
+#include "mem_policy.h"
+#include "check.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+#define SECTORS 8
+
+size_t metrics_summary(char* buf, size_t len) {
+  return snprintf(buf, len, "metrik özeti");
+}
+
+bool power_is_idle() {
+  return true;
+}
+
+void* mem_alloc(size_t size, mem_pool_t, const char*) {
+  return malloc(size);
+}
+
+// Yeniden açılış; keep_rtc false ise güç kesilmiştir ve RTC içeriği rastgeledir
+static void reboot(esp_reset_reason_t reason, bool keep_rtc) {
+  if (!keep_rtc) memset(&rtc, 0xA5, sizeof(rtc));
+  ready = false;
+  host_reset_reason = reason;
+  host_ms = 0;
+  Serial.out.clear();
+  blackbox_begin();
+}
+
+// blackbox_loop'un bir turu, metrik özeti olmadan
+static void task_tick(bool idle) {
+  xSemaphoreTake(flash_mutex, portMAX_DELAY);
+  flush_pending(idle);
+  if (idle && !next_ready) prepare_next();
+  xSemaphoreGive(flash_mutex);
+}
+
+struct DumpPrint : Print {
+  std::string text;
+  int locked_writes = 0;            // flash_mutex tutulurken yazılan
+  std::function<void()> on_write;   // ilk yazımda bir kez; dökümün ortasında yazıcı
+  size_t write(const uint8_t* buf, size_t len) override {
+    if (host_mutex_depth != 0) locked_writes++;
+    text.append((const char*)buf, len);
+    if (on_write) {
+      std::function<void()> f = on_write;
+      on_write = nullptr;
+      f();
+    }
+    return len;
+  }
+};
+
+static std::vector<std::string> split_lines(const std::string& text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t nl = text.find('\n', start);
+    if (nl == std::string::npos) nl = text.size();
+    lines.push_back(text.substr(start, nl - start));
+    start = nl + 1;
+  }
+  return lines;
+}
+
+static std::vector<std::string> dump_lines() {
+  DumpPrint p;
+  size_t n = blackbox_dump(p);
+  CHECK(n == p.text.size() && p.locked_writes == 0);
+  return split_lines(p.text);
+}
+
+static int count_lines(const std::vector<std::string>& lines, const std::string& needle) {
+  int n = 0;
+  for (const std::string& l : lines) n += l.find(needle) != std::string::npos;
+  return n;
+}
+
+// "#<açılış> <s>.<ms> <etiket> <metin>" biçiminde ve 0xFF (silinmiş flash) içermiyor
+static bool lines_well_formed(const std::vector<std::string>& lines) {
+  for (const std::string& l : lines) {
+    unsigned boot, s, ms;
+    char tag;
+    if (sscanf(l.c_str(), "#%u %u.%u %c ", &boot, &s, &ms, &tag) != 4) return false;
+    if (l.find('\xff') != std::string::npos) return false;
+  }
+  return true;
+}
+
+// "<önek> <n>" satırlarındaki sayılar, dökümdeki sırayla
+static std::vector<int> numbers(const std::vector<std::string>& lines, const std::string& prefix) {
+  std::vector<int> out;
+  for (const std::string& l : lines) {
+    size_t p = l.find(" " + prefix + " ");
+    if (p != std::string::npos) out.push_back(atoi(l.c_str() + p + prefix.size() + 2));
+  }
+  return out;
+}
+
+static void test_raw_records() {
+  host_flash_init(SECTORS);
+  reboot(ESP_RST_POWERON, false);
+  CHECK(ready && boot_id == 1);
+
+  // Biçimlendirilmeden RTC'de bekleyen kayıt dökümde metne çevrilir; son
+  // argümanın sıfırı dolgu sanılıp atılmamalı
+  LOG_I("ham %d son sıfır %u", 7, 0u);
+  LOG_W("dizge %s", "abc");
+  std::vector<std::string> lines = dump_lines();
+  CHECK(count_lines(lines, "B açılış, önceki reset: güç verildi") == 1);
+  CHECK(count_lines(lines, " I ham 7 son sıfır 0") == 1);
+  CHECK(count_lines(lines, " W dizge abc") == 1);
+
+  // Flash'a geçtikten sonra aynı metin, bir kez
+  task_tick(true);
+  CHECK(rtc.head == rtc.flushed);
+  lines = dump_lines();
+  CHECK(count_lines(lines, "#1 0.000 I ham 7 son sıfır 0") == 1);
+  CHECK(count_lines(lines, " W dizge abc") == 1);
+  CHECK(lines_well_formed(lines));
+}
+
+static void test_reboots() {
+  // Panik: RTC korunur, flash'a geçmemiş son satır açılışta aktarılır
+  host_ms = 1234;
+  LOG_E("çökmeden hemen önce %d", 0);
+  CHECK(rtc.head != rtc.flushed);
+  reboot(ESP_RST_PANIC, true);
+  CHECK(boot_id == 2);
+  CHECK(Serial.out.find("Önceki çalışma panik ile bitti") != std::string::npos);
+  std::vector<std::string> lines = dump_lines();
+  CHECK(count_lines(lines, "#1 1.234 E çökmeden hemen önce 0") == 1);
+  CHECK(count_lines(lines, "#2 0.000 B açılış, önceki reset: panik") == 1);
+
+  // Yeni yazılım: eski imajın ham kayıtlarındaki biçim adresleri geçersiz, halka atılır
+  LOG_I("eski imaj %d", 1);
+  host_app_desc.app_elf_sha256[0] ^= 0xFF;
+  reboot(ESP_RST_SW, true);
+  lines = dump_lines();
+  CHECK(count_lines(lines, "eski imaj") == 0);
+  CHECK(count_lines(lines, "çökmeden hemen önce") == 1);
+
+  // Güç kesintisi: RTC'dekiler kaybolur, flash'takiler kalır
+  LOG_I("flash'a geçmemiş %d", 2);
+  reboot(ESP_RST_POWERON, false);
+  lines = dump_lines();
+  CHECK(count_lines(lines, "flash'a geçmemiş") == 0);
+  CHECK(count_lines(lines, "ham 7 son sıfır 0") == 1);
+  CHECK(rtc.lost == 0);
+  CHECK(lines_well_formed(lines));
+}
+
+static void test_torn_write() {
+  task_tick(true);
+  int torn_sector = cur_sector;
+  for (int i = 0; i < 3; i++) LOG_I("yırtık %d", i);
+  // İlk kaydın başlığında kesilir: uzunluk yazıldı, tür 0xFF kaldı
+  host_flash_fail_after = 2;
+  task_tick(true);
+  host_flash_fail_after = -1;
+  CHECK(rtc.head != rtc.flushed);
+
+  // Brownout: RTC korunur; yarım sektör bırakılır, kayıtlar sonrakine yazılır
+  reboot(ESP_RST_BROWNOUT, true);
+  CHECK(cur_sector == (torn_sector + 1) % SECTORS);
+  for (int i = 0; i < 3; i++) LOG_I("sonra %d", i);
+  task_tick(true);
+  std::vector<std::string> lines = dump_lines();
+  for (int i = 0; i < 3; i++) {
+    CHECK(count_lines(lines, "I yırtık " + std::to_string(i)) == 1);
+    CHECK(count_lines(lines, "I sonra " + std::to_string(i)) == 1);
+  }
+  CHECK(count_lines(lines, "ham 7 son sıfır 0") == 1);
+  CHECK(lines_well_formed(lines));
+}
+
+static void test_ring_and_wear() {
+  // Birkaç tur: en eski sektörler bütün olarak düşer, kalanlar aralıksız ve sıralı
+  const int total = 3000;
+  for (int i = 0; i < total; i++) {
+    LOG_I("tur %d: flash halkasını döndüren uzunca bir günlük satırı", i);
+    if (i % 8 == 7) task_tick(true);
+  }
+  task_tick(true);
+  CHECK(rtc.lost == 0);
+  std::vector<std::string> lines = dump_lines();
+  std::vector<int> seen = numbers(lines, "tur");
+  CHECK(!seen.empty() && seen.back() == total - 1);
+  CHECK(!seen.empty() && seen.front() > 0);
+  bool contiguous = true;
+  for (size_t i = 1; i < seen.size(); i++) contiguous &= seen[i] == seen[i - 1] + 1;
+  CHECK(contiguous);
+  // Yedi sektör dolu, biri silinmiş bekliyor: en az altı sektörlük satır kalmalı
+  CHECK_GE((double)seen.size() * 90, 6.0 * BB_SECTOR);
+  CHECK(lines_well_formed(lines));
+
+  uint32_t lo = host_erase_count[0], hi = host_erase_count[0];
+  for (uint32_t c : host_erase_count) {
+    lo = c < lo ? c : lo;
+    hi = c > hi ? c : hi;
+  }
+  printf("blackbox: %zu satır dökümde (%d..%d), sektör silme %u..%u\n", seen.size(), seen.empty() ? -1 : seen.front(),
+         seen.empty() ? -1 : seen.back(), lo, hi);
+  CHECK_GE(lo, 5);
+  CHECK_LE(hi - lo, 1);
+}
+
+static void test_dump_while_writing() {
+  // Döküm ilk parçayı istemciye yazarken yazıcı bütün halkayı bir tur döndürür:
+  // okunmakta olan sektör silinip yeniden kullanılır
+  int next = 0;
+  DumpPrint p;
+  p.on_write = [&next] {
+    for (int i = 0; i < 600; i++) {
+      LOG_I("eş %d: döküm sürerken yazılan uzunca bir günlük satırı", next++);
+      if (i % 8 == 7) task_tick(true);
+    }
+    // Son birkaçı RTC'de kalır
+    task_tick(true);
+    for (int i = 0; i < 3; i++) LOG_I("eş %d: döküm sürerken yazılan uzunca bir günlük satırı", next++);
+  };
+  blackbox_dump(p);
+  CHECK(p.locked_writes == 0);
+  std::vector<std::string> lines = split_lines(p.text);
+  std::vector<int> seen = numbers(lines, "eş");
+  bool increasing = true;
+  for (size_t i = 1; i < seen.size(); i++) increasing &= seen[i] > seen[i - 1];
+  CHECK(increasing);
+  CHECK(!seen.empty() && seen.back() == next - 1);
+  CHECK(lines_well_formed(lines));
+  CHECK(host_mutex_depth == 0);
+}
+
+int main() {
+  test_raw_records();
+  test_reboots();
+  test_torn_write();
+  test_ring_and_wear();
+  test_dump_while_writing();
+  CHECK_DONE();
+}
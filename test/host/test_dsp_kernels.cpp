@@ -0,0 +1,140 @@
+// test_dsp_kernels.cpp
+// Her çekirdeğin hızlı yolu *_ref karşılığıyla karşılaştırılır: tamsayı çekirdekleri
+// ve dönüşümler bit bit aynı olmalı, float toplamalar toplama sırası kadar farklı
+// olabilir. Makefile bu dosyayı iki kez derler: taşınabilir yol ve
+// test/host/shim/esp_dsp.h ile DSP_HAS_ESP_DSP=1 (cihazdaki esp-dsp yolu).
+
+#include "dsp_kernels.h"
+#include "check.h"
+#include <string.h>
+#include <vector>
+
+static const size_t lengths[] = {0, 1, 3, 4, 5, 7, 8, 63, 64, 65, 160, 1024};
+
+static void fill(int16_t* x, size_t n, TestRng& rng) {
+  for (size_t i = 0; i < n; i++) x[i] = (int16_t)(rng.next() >> 16);
+  // Uç değerler doyma ve işaret yollarını zorlar
+  if (n > 0) x[0] = -32768;
+  if (n > 1) x[n - 1] = 32767;
+}
+
+static void test_gain_clip(TestRng& rng) {
+  static const int32_t gains[] = {0, 1, 2048, 4095, 4096, 4097, 3 * 4096, 65535};
+  std::vector<int16_t> a(1024), b(1024);
+  for (size_t n : lengths) {
+    for (int32_t g : gains) {
+      fill(a.data(), n, rng);
+      memcpy(b.data(), a.data(), n * sizeof(int16_t));
+      dsp_gain_clip_s16_ref(a.data(), n, g);
+      dsp_gain_clip_s16(b.data(), n, g);
+      CHECK(memcmp(a.data(), b.data(), n * sizeof(int16_t)) == 0);
+    }
+  }
+}
+
+static void test_energy(TestRng& rng) {
+  std::vector<int16_t> x(1024);
+  for (size_t n : lengths) {
+    fill(x.data(), n, rng);
+    CHECK(dsp_energy_s16(x.data(), n) == dsp_energy_s16_ref(x.data(), n));
+  }
+  // Tam ölçek: 32 bitlik ara toplamların taşmadığı sınır
+  for (size_t i = 0; i < 1024; i++) x[i] = -32768;
+  CHECK(dsp_energy_s16(x.data(), 1024) == 1024ULL * 32768ULL * 32768ULL);
+  CHECK_LE(fabs(dsp_rms_s16(x.data(), 1024) - 32768.0), 0.5);
+}
+
+static void test_convert(TestRng& rng) {
+  std::vector<int16_t> s(1024), s_ref(1024);
+  std::vector<float> f(1024), f_ref(1024);
+  for (size_t n : lengths) {
+    fill(s.data(), n, rng);
+    dsp_s16_to_f32_ref(s.data(), f_ref.data(), n);
+    dsp_s16_to_f32(s.data(), f.data(), n);
+    CHECK(memcmp(f.data(), f_ref.data(), n * sizeof(float)) == 0);
+
+    // Aralık dışı ve yarım LSB sınırındaki değerler
+    for (size_t i = 0; i < n; i++) {
+      switch (i % 4) {
+        case 0: f[i] = rng.uniform() * 1.5f; break;
+        case 1: f[i] = ((float)(int16_t)(rng.next() >> 16) + 0.5f) / 32768.0f; break;
+        default: f[i] = rng.uniform(); break;
+      }
+    }
+    dsp_f32_to_s16_ref(f.data(), s_ref.data(), n);
+    dsp_f32_to_s16(f.data(), s.data(), n);
+    CHECK(memcmp(s.data(), s_ref.data(), n * sizeof(int16_t)) == 0);
+  }
+}
+
+static void test_rms_f32(TestRng& rng) {
+  std::vector<float> x(1024);
+  for (size_t n : lengths) {
+    for (size_t i = 0; i < n; i++) x[i] = rng.uniform();
+    float a = dsp_rms_f32_ref(x.data(), n);
+    float b = dsp_rms_f32(x.data(), n);
+    CHECK_LE(fabsf(a - b), 1e-5f * (a > 1e-3f ? a : 1e-3f));
+  }
+}
+
+static void test_dc_block(TestRng& rng) {
+  // Sabit giriş sönümlenir; blok sınırı sonucu değiştirmez
+  std::vector<int16_t> a(4096), b(4096);
+  for (size_t i = 0; i < a.size(); i++) a[i] = (int16_t)(8000 + (int16_t)(rng.next() >> 24));
+  memcpy(b.data(), a.data(), a.size() * sizeof(int16_t));
+  DspDcBlock s1, s2;
+  dsp_dc_block_init(&s1, 0.995f);
+  dsp_dc_block_init(&s2, 0.995f);
+  dsp_dc_block_s16(&s1, a.data(), a.size());
+  dsp_dc_block_s16(&s2, b.data(), 1000);
+  dsp_dc_block_s16(&s2, b.data() + 1000, b.size() - 1000);
+  CHECK(memcmp(a.data(), b.data(), a.size() * sizeof(int16_t)) == 0);
+  double mean = 0;
+  for (size_t i = 3072; i < 4096; i++) mean += a[i];
+  mean /= 1024;
+  CHECK_LE(fabs(mean), 8.0);
+}
+
+// Çift duyarlıklı doğrudan DFT ile karşılaştırma
+static void test_rfft(TestRng& rng) {
+  for (size_t n = 4; n <= DSP_FFT_MAX; n <<= 1) {
+    CHECK(dsp_rfft_init(n));
+    std::vector<float> x(n), a(n), b(n);
+    for (size_t i = 0; i < n; i++) x[i] = rng.uniform();
+    memcpy(a.data(), x.data(), n * sizeof(float));
+    memcpy(b.data(), x.data(), n * sizeof(float));
+    dsp_rfft_f32_ref(a.data(), n);
+    dsp_rfft_f32(b.data(), n);
+    double max_err_ref = 0, max_err_opt = 0;
+    for (size_t k = 0; k <= n / 2; k++) {
+      double re = 0, im = 0;
+      for (size_t i = 0; i < n; i++) {
+        double w = -2.0 * M_PI * (double)(k * i % n) / (double)n;
+        re += x[i] * cos(w);
+        im += x[i] * sin(w);
+      }
+      double ar, ai, br, bi;
+      if (k == 0) { ar = a[0]; ai = 0; br = b[0]; bi = 0; }
+      else if (k == n / 2) { ar = a[1]; ai = 0; br = b[1]; bi = 0; }
+      else { ar = a[2 * k]; ai = a[2 * k + 1]; br = b[2 * k]; bi = b[2 * k + 1]; }
+      max_err_ref = fmax(max_err_ref, hypot(ar - re, ai - im));
+      max_err_opt = fmax(max_err_opt, hypot(br - re, bi - im));
+    }
+    // Giriş birim genlikli; hata sqrt(n) ölçeğinde büyür
+    CHECK_LE(max_err_ref, 1e-5 * sqrt((double)n) * 10);
+    CHECK_LE(max_err_opt, 1e-5 * sqrt((double)n) * 10);
+  }
+}
+
+int main() {
+  TestRng rng(33);
+  test_gain_clip(rng);
+  test_energy(rng);
+  test_convert(rng);
+  test_rms_f32(rng);
+  test_dc_block(rng);
+  test_rfft(rng);
+  printf("dsp_kernels (%s yolu): %s\n", DSP_HAS_ESP_DSP ? "esp-dsp" : "taşınabilir",
+         check_failures ? "HATA" : "ref ile uyumlu");
+  CHECK_DONE();
+}
@@ -0,0 +1,159 @@
+// test_log_format.cpp
+// Günlük cephesinin (src/log.cpp) masaüstünde doğrulaması: LOG_* ile yazılan
+// satır aynı biçim ve argümanlarla snprintf'in ürettiğiyle aynı olmalı.
+// Uzunluk belirteçleri (l, ll, z, h) atılıp değer 64 bit biçimlendirildiği
+// için sonuç printf'ten farklılaşmamalı. Ayrıca: kısa tamponda kesme, eksik
+// ya da kayda sığmayan argüman yerine "?", uzun %s'in LOG_STR_MAX'ta, satırın
+// LOG_LINE_MAX'ta kesilmesi ve BLACKBOX_LEVEL'e kadarki kayıtların ham olarak
+// kara kutuya verilmesi. Satırlar shim/arduino_log.h'deki Serial.out'ta toplanır.
+
+#include "log.h"
+#include "mem_policy.h"
+#include "blackbox.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+static std::vector<std::vector<uint8_t>> blackbox_records;
+
+void blackbox_append_record(const uint8_t* rec, size_t len) {
+  blackbox_records.emplace_back(rec, rec + len);
+}
+
+void* mem_alloc(size_t size, mem_pool_t, const char*) {
+  return malloc(size);
+}
+
+// Son yazılan satır, satır sonu olmadan
+static std::string last_line() {
+  std::string out = Serial.out;
+  Serial.out.clear();
+  if (!out.empty() && out.back() == '\n') out.pop_back();
+  return out;
+}
+
+static std::string format_record(const std::vector<uint8_t>& rec, size_t out_len) {
+  std::vector<char> buf(out_len + 1, 'X');
+  size_t n = log_format(rec.data(), rec.size(), buf.data(), out_len);
+  return std::string(buf.data(), n);
+}
+
+static int parity_checks = 0;
+
+#define CHECK_PRINTF(fmt, ...)                                                         \
+  do {                                                                                 \
+    char want_[LOG_LINE_MAX];                                                          \
+    snprintf(want_, sizeof(want_), fmt, ##__VA_ARGS__);                                \
+    LOG_I(fmt, ##__VA_ARGS__);                                                         \
+    std::string got_ = last_line();                                                    \
+    parity_checks++;                                                                   \
+    if (got_ != want_) {                                                               \
+      fprintf(stderr, "%s:%d: \"%s\" -> \"%s\", printf \"%s\"\n", __FILE__, __LINE__,  \
+              fmt, got_.c_str(), want_);                                               \
+      check_failures++;                                                                \
+    }                                                                                  \
+  } while (0)
+
+static void test_printf_parity() {
+  int neg = -42;
+  unsigned big = 4000000000u;
+  long lg = -1234567890123L;
+  unsigned long long ull = 18446744073709551615ULL;
+  size_t sz = 123456789;
+  long long ll = -9000000000LL;
+  float f = 3.14159f;
+  double d = -2.5e-7;
+  const char* null_str = NULL;
+
+  CHECK_PRINTF("düz metin, argümansız");
+  CHECK_PRINTF("%d %i %d", neg, 7, INT32_MIN);
+  CHECK_PRINTF("%u %u", big, 0u);
+  CHECK_PRINTF("%x %X %08x %#x", 0xdeadbeefu, 0xabcu, 0x1fu, 255);
+  CHECK_PRINTF("%x %o", (unsigned)neg, 8);
+  CHECK_PRINTF("%ld %lu", lg, (unsigned long)big);
+  CHECK_PRINTF("%lld %llu", ll, ull);
+  CHECK_PRINTF("%zu bayt", sz);
+  CHECK_PRINTF("%hd %hhu", (short)-3, (unsigned char)200);
+  CHECK_PRINTF("%f %.2f %8.3f %-8.1f|", f, f, d * 1e7, 1.25);
+  CHECK_PRINTF("%e %g %G", d, d, 1e20);
+  CHECK_PRINTF("%g %g", 0.0001, 123456789.0);
+  CHECK_PRINTF("'%s' '%10s' '%-6s' '%.3s'", "abc", "sağ", "sol", "kesilir");
+  CHECK_PRINTF("%c%c%c", 'a', 'Z', '0');
+  CHECK_PRINTF("%d%% tamam, %%s değil", 100);
+  CHECK_PRINTF("%+d % d %05d", 5, 5, -5);
+  CHECK_PRINTF("🔋 Aktif: %llu s, boşta: %llu s (%u uyku)", 12345ULL, 67ULL, 8u);
+
+  // glibc ile aynı; printf'e NULL vermek derleyici uyarısı olduğundan elle
+  LOG_I("'%s'", null_str);
+  CHECK(last_line() == "'(null)'");
+}
+
+static void test_missing_and_overflow() {
+  // Biçimde olup verilmeyen argümanlar (LOG_* derlemede reddeder, kayıt yine çözülmeli)
+  log_detail::write(LOG_LEVEL_INFO, "%d %s %u", 1);
+  CHECK(last_line() == "1 ? ?");
+
+  // Kayda sığmayan argümanlar atılır; sığanlar yazılır, kalanların yerinde "?"
+  LOG_I("%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+        0LL, 1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL, 8LL, 9LL, 10LL, 11LL, 12LL, 13LL, 14LL, 15LL, 16LL, 17LL, 18LL, 19LL);
+  std::string line = last_line();
+  CHECK(line.compare(0, 8, "0 1 2 3 ") == 0);
+  CHECK(line.size() >= 2 && line.compare(line.size() - 2, 2, " ?") == 0);
+
+  // %s kayıt anında LOG_STR_MAX bayta kadar kopyalanır
+  std::string long_str(200, 'a');
+  LOG_I("[%s]", long_str.c_str());
+  CHECK(last_line() == "[" + std::string(LOG_STR_MAX, 'a') + "]");
+}
+
+static void test_truncation() {
+  // Biçim metni kayda girmez; uzun biçim satırı LOG_LINE_MAX - 2 karakter
+  // ve satır sonunda kesilir
+  std::string long_fmt(LOG_LINE_MAX + 50, 'x');
+  log_detail::write(LOG_LEVEL_INFO, long_fmt.c_str());
+  CHECK(Serial.out == std::string(LOG_LINE_MAX - 2, 'x') + "\n");
+  Serial.out.clear();
+
+  // Her tampon boyunda çıktı tam satırın başı olmalı, taşmamalı
+  LOG_I("ölçüm %d: %s = %.3f dB (%x)", 12, "erle", 29.314, 0xbeefu);
+  std::string want = last_line();
+  const std::vector<uint8_t>& rec = blackbox_records.back();
+  bool prefix_ok = true;
+  for (size_t n = 1; n <= want.size() + 2; n++) {
+    std::string got = format_record(rec, n);
+    std::string exp = want.substr(0, n - 1);
+    if (got != exp) {
+      fprintf(stderr, "log_format(%zu): \"%s\", beklenen \"%s\"\n", n, got.c_str(), exp.c_str());
+      prefix_ok = false;
+    }
+  }
+  CHECK(prefix_ok);
+  char one = 'X';
+  CHECK(log_format(rec.data(), rec.size(), &one, 0) == 0 && one == 'X');
+  CHECK(log_format(rec.data(), 3, &one, 1) == 0);   // başlıktan kısa kayıt
+}
+
+static void test_blackbox_feed() {
+  blackbox_records.clear();
+  host_ms = 4321;
+  LOG_W("uyarı %d", 1);
+  LOG_E("hata %s", "x");
+  LOG_I("bilgi");
+  CHECK(blackbox_records.size() == (LOG_LEVEL_INFO <= BLACKBOX_LEVEL ? 3 : 2));
+  if (blackbox_records.size() < 2) return;
+  log_detail::RecordHeader h;
+  memcpy(&h, blackbox_records[0].data(), sizeof(h));
+  CHECK(h.level == LOG_LEVEL_WARN && h.ms == 4321 && h.nargs == 1);
+  // Kara kutunun sonradan çözdüğü metin Serial'e yazılanla aynı
+  CHECK(format_record(blackbox_records[1], LOG_LINE_MAX) == "hata x");
+  Serial.out.clear();
+}
+
+int main() {
+  test_printf_parity();
+  test_missing_and_overflow();
+  test_truncation();
+  test_blackbox_feed();
+  printf("log_format: %d biçim printf ile karşılaştırıldı, %s\n", parity_checks, check_failures ? "HATA" : "aynı");
+  CHECK_DONE();
+}
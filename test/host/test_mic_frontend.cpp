@@ -0,0 +1,167 @@
+// test_mic_frontend.cpp
+// Mikrofon ön ucunun (src/mic_frontend.cpp) çevrimdışı doğrulaması: sessiz
+// konuşmada AGC kazancı yükselir, ardından gelen yüksek bir başlangıç
+// (kapı çarpması, yakından bağırma) sınırlayıcıyı ilk örnekten tetiklemeli;
+// hiçbir çıkış örneği MIC_LIMIT_PEAK'i aşmamalı. Sürekli bir tonda seviye
+// MIC_AGC_TARGET_RMS'e yakınsamalı. Gerçek kayıtta (input_audio_udp.pcm,
+// 16 kHz, MIC_I2S_RATE'e doğrusal aradeğerlemeyle çıkarılır) 12 dB kısılmış
+// ve büyük bir DC kaymasıyla: DC çıkıştan atılmalı, konuşma hedefe
+// yaklaşmalı, sessizlikte kazanç pompalanmamalı, doyma olmamalı.
+
+#include "mic_frontend.h"
+#include "config.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+#define BLOCK (MIC_I2S_RATE * I2S_DMA_BUF_MS / 1000)   // audio_capture.cpp'deki okuma bloğu
+#define REC_RATE 16000                                  // input_audio_udp.pcm
+
+#ifndef FIXTURE_DIR
+#define FIXTURE_DIR ".."
+#endif
+
+// 24 bit örneği INMP441'in 32 bit yuvasına yerleştirir
+static int32_t slot(float x) {
+  float v = x * 8388607.0f;
+  if (v > 8388607.0f) v = 8388607.0f;
+  if (v < -8388608.0f) v = -8388608.0f;
+  return (int32_t)lrintf(v) * 256;
+}
+
+struct Run {
+  int peak_out = 0;
+  int clipped = 0;       // int16 doymasına ulaşan örnekler
+  int over_limit = 0;    // MIC_LIMIT_PEAK'i aşanlar
+  double last_rms = 0;   // son saniyenin çıkış RMS'i
+  std::vector<int16_t> out;
+};
+
+static bool read_file(const std::string& path, std::vector<uint8_t>* out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+// Çıkışın [from, to) saniyesi
+static void window_stats(const Run& r, double from, double to, double* mean, double* rms) {
+  size_t a = (size_t)(from * MIC_I2S_RATE), b = (size_t)(to * MIC_I2S_RATE);
+  if (b > r.out.size()) b = r.out.size();
+  double sum = 0, sq = 0;
+  for (size_t i = a; i < b; i++) {
+    sum += r.out[i];
+    sq += (double)r.out[i] * r.out[i];
+  }
+  *mean = b > a ? sum / (b - a) : 0;
+  *rms = b > a ? sqrt(sq / (b - a)) : 0;
+}
+
+static void process(MicFrontend* fe, const std::vector<float>& in, Run* r) {
+  std::vector<int32_t> raw(BLOCK);
+  std::vector<double> sq;
+  for (size_t off = 0; off + BLOCK <= in.size(); off += BLOCK) {
+    for (size_t i = 0; i < BLOCK; i++) raw[i] = slot(in[off + i]);
+    size_t bytes = mic_frontend_process(fe, raw.data(), BLOCK);
+    CHECK(bytes == BLOCK * sizeof(int16_t));
+    const int16_t* out = (const int16_t*)raw.data();
+    for (size_t i = 0; i < BLOCK; i++) {
+      int a = abs(out[i]);
+      if (a > r->peak_out) r->peak_out = a;
+      if (a >= 32767) r->clipped++;
+      if (a > MIC_LIMIT_PEAK) r->over_limit++;
+      sq.push_back((double)out[i] * out[i]);
+      r->out.push_back(out[i]);
+    }
+  }
+  size_t tail = MIC_I2S_RATE < sq.size() ? MIC_I2S_RATE : sq.size();
+  double acc = 0;
+  for (size_t i = sq.size() - tail; i < sq.size(); i++) acc += sq[i];
+  r->last_rms = tail ? sqrt(acc / tail) : 0;
+}
+
+int main() {
+  const float rate = MIC_I2S_RATE;
+  TestRng rng(34);
+
+  // 1) 2 s sessiz konuşma (-45 dBFS tepe): AGC kazancı yükselir.
+  //    Ardından 1 s, tepesi tam ölçeğin yarısı olan ani ses
+  {
+    MicFrontend fe;
+    mic_frontend_init(&fe, MIC_I2S_RATE);
+    std::vector<int16_t> pcm((size_t)rate * 2);
+    make_speech_like(pcm.data(), pcm.size(), rate, -45.0f, 1);
+    std::vector<float> quiet(pcm.size());
+    for (size_t i = 0; i < pcm.size(); i++) quiet[i] = pcm[i] / 32768.0f;
+    Run warm;
+    process(&fe, quiet, &warm);
+    int32_t gain_before = fe.gain_q16;
+    // Ani başlangıç: 1 kHz ve gürültü, ilk örnekten tam genlik
+    std::vector<float> loud((size_t)rate);
+    for (size_t i = 0; i < loud.size(); i++) {
+      loud[i] = 0.45f * sinf(2.0f * (float)M_PI * 1000.0f * i / rate) + 0.05f * rng.gauss();
+    }
+    Run onset;
+    process(&fe, loud, &onset);
+    printf("mic_frontend: ısınma kazancı %.1f dB, ani seste tepe %d, %d örnek sınır üstü, %d doyma\n",
+           20.0 * log10(gain_before / 256.0), onset.peak_out, onset.over_limit, onset.clipped);
+    CHECK_GE(gain_before, 256 * 8);   // ısınma gerçekten kazancı yükseltmiş olmalı
+    CHECK(onset.over_limit == 0);
+    CHECK(onset.clipped == 0);
+  }
+
+  // 2) Sürekli ton: seviye hedefe yakınsar, sınırlayıcı bunu bozmaz
+  for (float dbfs : {-50.0f, -30.0f, -10.0f}) {
+    MicFrontend fe;
+    mic_frontend_init(&fe, MIC_I2S_RATE);
+    std::vector<float> tone((size_t)rate * 4);
+    float amp = powf(10.0f, dbfs / 20.0f);
+    for (size_t i = 0; i < tone.size(); i++) tone[i] = amp * sinf(2.0f * (float)M_PI * 440.0f * i / rate);
+    Run r;
+    process(&fe, tone, &r);
+    double err_db = 20.0 * log10(r.last_rms / MIC_AGC_TARGET_RMS);
+    printf("mic_frontend: %g dBFS ton, son saniye RMS %.0f (hedefe %+.1f dB), tepe %d\n", dbfs, r.last_rms, err_db, r.peak_out);
+    CHECK_LE(fabs(err_db), 1.0);
+    CHECK(r.over_limit == 0);
+  }
+
+  // 3) Kayıt: ~0.2-6.0 s konuşma, 6.4 s'den sonra oda gürültüsü. Mikrofonun
+  //    DC kayması konuşmanın ~17 dB üstünde, tam ölçeğin %2'si
+  {
+    std::vector<uint8_t> bytes;
+    CHECK(read_file(FIXTURE_DIR "/input_audio_udp.pcm", &bytes));
+    size_t n = bytes.size() / 2;
+    const int up = MIC_I2S_RATE / REC_RATE;
+    const float atten = powf(10.0f, -12.0f / 20.0f), dc = 0.02f;
+    std::vector<float> in(n * up);
+    for (size_t i = 0; i < n; i++) {
+      float a = (int16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8)) / 32768.0f;
+      float b = i + 1 < n ? (int16_t)(bytes[2 * i + 2] | (bytes[2 * i + 3] << 8)) / 32768.0f : a;
+      for (int k = 0; k < up; k++) in[i * up + k] = dc + atten * (a + (b - a) * k / up);
+    }
+    MicFrontend fe;
+    mic_frontend_init(&fe, MIC_I2S_RATE);
+    Run r;
+    process(&fe, in, &r);
+    double speech_mean, speech_rms, quiet_mean, quiet_rms;
+    window_stats(r, 2.0, 6.0, &speech_mean, &speech_rms);
+    window_stats(r, 7.0, 9.5, &quiet_mean, &quiet_rms);
+    double err_db = 20.0 * log10(speech_rms / MIC_AGC_TARGET_RMS);
+    printf("mic_frontend: kayıt -12 dB, DC %.0f, konuşma RMS %.0f (hedefe %+.1f dB) ortalama %+.1f, "
+           "sessizlik RMS %.0f ortalama %+.1f, kazanç %.1f dB, tepe %d, %d doyma\n",
+           dc * 32768, speech_rms, err_db, speech_mean, quiet_rms, quiet_mean, 20.0 * log10(fe.gain_q16 / 256.0),
+           r.peak_out, r.clipped);
+    CHECK(!bytes.empty());
+    CHECK_LE(fabs(speech_mean), 10.0);
+    CHECK_LE(fabs(quiet_mean), 5.0);
+    CHECK_LE(fabs(err_db), 3.0);
+    CHECK_GE(fe.gain_q16, 256 * 8);
+    CHECK_LE(quiet_rms, speech_rms / 8);
+    CHECK(r.clipped == 0 && r.over_limit == 0);
+  }
+
+  CHECK_DONE();
+}
@@ -0,0 +1,105 @@
+// test_resampler.cpp
+// Örnekleme hızı dönüştürücünün (src/resampler.cpp) cihazdaki oranlarda
+// ölçümü: geçiş bandında (düşük tarafın 0.40'ına kadar) THD+N ve kazanç,
+// hız düşürülürken çıkış Nyquist'inin üstündeki girişlerden kalan örtüşme.
+// Giriş, cihazdaki gibi 10 ms'lik bloklar halinde verilir.
+
+#include "resampler.h"
+#include "check.h"
+#include <vector>
+
+struct Pair {
+  uint32_t in, out;
+};
+
+// Mikrofon 48k, TTS yanıtları 44.1k / 24k / 22.05k, yükleme 8k, 8 kHz yanıtın referansı
+static const Pair pairs[] = {
+  {48000, 16000}, {44100, 16000}, {24000, 16000}, {22050, 16000}, {16000, 8000}, {8000, 16000},
+};
+
+// make_sine float fazla ~-55 dB'de kalır; burada ölçülen taban daha aşağıda
+static std::vector<int16_t> run(Resampler* rs, float freq, float dbfs, size_t n_in) {
+  std::vector<int16_t> in(n_in);
+  double amp = 32767.0 * pow(10.0, dbfs / 20.0);
+  for (size_t i = 0; i < n_in; i++) in[i] = (int16_t)lrint(amp * sin(2.0 * M_PI * freq * (double)i / rs->in_rate));
+  std::vector<int16_t> out(resampler_max_out(rs, n_in));
+  resampler_reset(rs);
+  size_t n_out = 0, block = rs->in_rate / 100;
+  for (size_t off = 0; off < n_in; off += block) {
+    size_t len = n_in - off < block ? n_in - off : block;
+    n_out += resampler_process(rs, in.data() + off, len, out.data() + n_out);
+  }
+  out.resize(n_out);
+  return out;
+}
+
+// Çıkışa en küçük kareler ile freq'te bir sinüs oturtulur; kalan her şey
+// (harmonik, örtüşme, yuvarlama) gürültü sayılır. Baştaki süzgeç dolumu atlanır.
+static void fit(const std::vector<int16_t>& y, size_t skip, float rate, float freq, double* amp, double* resid_rms) {
+  double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+  for (size_t i = skip; i < y.size(); i++) {
+    double w = 2.0 * M_PI * freq * (double)i / rate;
+    double s = sin(w), c = cos(w);
+    ss += s * s; cc += c * c; sc += s * c; ys += y[i] * s; yc += y[i] * c;
+  }
+  double det = ss * cc - sc * sc;
+  double a = (ys * cc - yc * sc) / det;
+  double b = (yc * ss - ys * sc) / det;
+  double err = 0;
+  for (size_t i = skip; i < y.size(); i++) {
+    double w = 2.0 * M_PI * freq * (double)i / rate;
+    double e = y[i] - a * sin(w) - b * cos(w);
+    err += e * e;
+  }
+  *amp = sqrt(a * a + b * b);
+  *resid_rms = sqrt(err / (double)(y.size() - skip));
+}
+
+int main() {
+  static Resampler rs;
+  double worst_thdn = -200, worst_alias = -200, worst_gain = 0;
+  for (const Pair& p : pairs) {
+    CHECK(resampler_init(&rs, p.in, p.out));
+    uint32_t low = p.in < p.out ? p.in : p.out;
+    size_t skip = (size_t)p.out / 50;   // 20 ms, en uzun süzgecin gecikmesinden fazla
+    const float amp_in = 32767.0f * powf(10.0f, -6.0f / 20.0f);
+
+    // Geçiş bandı: -6 dBFS sinüs, 100 Hz'den geçiş bandı kenarına
+    double pair_thdn = -200, pair_gain = 0;
+    for (float f : {100.0f, 1000.0f, 0.25f * low, 0.40f * low}) {
+      std::vector<int16_t> y = run(&rs, f, -6.0f, p.in / 2);
+      double amp, resid;
+      fit(y, skip, (float)p.out, f, &amp, &resid);
+      double thdn = 20.0 * log10(resid * sqrt(2.0) / amp);
+      double gain = 20.0 * log10(amp / amp_in);
+      pair_thdn = fmax(pair_thdn, thdn);
+      if (fabs(gain) > fabs(pair_gain)) pair_gain = gain;
+    }
+
+    // Örtüşme: çıkış Nyquist'inden giriş Nyquist'ine kadar, çıkışta kalan güç
+    double pair_alias = -200;
+    if (p.in > p.out) {
+      for (float f = 0.5f * low; f < 0.49f * p.in; f += low / 40.0f) {
+        std::vector<int16_t> y = run(&rs, f, -6.0f, p.in / 4);
+        double acc = 0;
+        for (size_t i = skip; i < y.size(); i++) acc += (double)y[i] * y[i];
+        double rms = sqrt(acc / (double)(y.size() - skip));
+        pair_alias = fmax(pair_alias, 20.0 * log10((rms + 1e-3) * sqrt(2.0) / amp_in));
+      }
+    }
+
+    printf("resampler %5u -> %5u (%3d kat.): THD+N en kötü %.1f dB, kazanç %+.3f dB, örtüşme en kötü %.1f dB\n",
+           p.in, p.out, rs.taps, pair_thdn, pair_gain, p.in > p.out ? pair_alias : 0.0);
+    worst_thdn = fmax(worst_thdn, pair_thdn);
+    worst_alias = fmax(worst_alias, pair_alias);
+    if (fabs(pair_gain) > fabs(worst_gain)) worst_gain = pair_gain;
+  }
+
+  // Eşikler ölçülen en kötü değerlerin ~3 dB üstünde (THD+N -76.2 dB 22.05k'da,
+  // örtüşme -70.4 dB 48k'da: Q15 katsayı tabanı). Eski 32 katsayılı sabit
+  // süzgeç 44.1k'da -8.8 dB örtüşme, 48k'da -2.8 dB geçiş bandı kaybı veriyordu.
+  CHECK_LE(worst_thdn, -73.0);
+  CHECK_LE(worst_alias, -67.0);
+  CHECK_LE(fabs(worst_gain), 0.01);
+  CHECK_DONE();
+}
@@ -0,0 +1,212 @@
+// test_vad.cpp
+// Konuşma algılayıcının (src/vad.cpp) bölüt sınırları. Sentetik girdi -60 dBFS
+// gürültü üstünde tonlar ve konuşmaya benzer patlamalardır; gerçek kayıt
+// input_audio_udp.pcm'dir (cihazdan yüklenmiş ~6 s sessiz konuşma, ardından oda gürültüsü),
+// voice_assistant.cpp'deki gibi 128 ms'lik parçalarla verilir.
+// Denetlenenler: başlangıcın VAD_ONSET_FRAMES'inci çerçevede olması ve kısa
+// tıklamaların konuşma sayılmaması, sınırın VAD_HANGOVER_MS sessizlikte
+// konması ve hece aralarının bölütü bölmemesi, VAD_MAX_SEGMENT_MS'i aşan
+// konuşmanın ilk sessiz çerçevede kesilmesi, kayıt sonunun (speech_since_cut)
+// kesimden sonra konuşma varsa işaretlenmesi.
+
+#include "vad.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+#define RATE 16000
+#define FRAME (RATE * VAD_FRAME_MS / 1000)
+#define CHUNK 2048   // voice_assistant.cpp: 128 ms'lik yükleme parçası
+
+#ifndef FIXTURE_DIR
+#define FIXTURE_DIR ".."
+#endif
+
+static bool read_file(const std::string& path, std::vector<uint8_t>* out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static std::vector<int16_t> to_pcm(const uint8_t* p, size_t bytes) {
+  std::vector<int16_t> s(bytes / 2);
+  for (size_t i = 0; i < s.size(); i++) s[i] = (int16_t)(p[2 * i] | (p[2 * i + 1] << 8));
+  return s;
+}
+
+// Olaylar çerçeve numarasıyla: blok sonunda konuşma başladıysa ya da bölüt kapandıysa
+struct VadRun {
+  std::vector<size_t> onsets;
+  std::vector<size_t> cuts;
+};
+
+static VadRun run(VadState* st, const int16_t* x, size_t n, size_t block) {
+  VadRun r;
+  for (size_t off = 0; off < n; off += block) {
+    size_t len = n - off < block ? n - off : block;
+    bool was = vad_in_speech(st);
+    uint32_t seg = st->segments;
+    bool cut = vad_process(st, x + off, len);
+    size_t frame = (off + len) / FRAME - 1;
+    CHECK(cut == (st->segments != seg));
+    if (cut) r.cuts.push_back(frame);
+    // Aynı blokta kapanıp yeniden açılabilir; yalnızca çerçeve çerçeve verilince kesin
+    if (vad_in_speech(st) && (!was || cut)) r.onsets.push_back(frame);
+  }
+  return r;
+}
+
+// -60 dBFS gürültü; [start, end) çerçevelerinde dbfs düzeyinde ton
+static std::vector<int16_t> noise_with_tone(size_t frames, size_t start, size_t end, float dbfs, uint32_t seed) {
+  std::vector<int16_t> x(frames * FRAME);
+  TestRng rng(seed);
+  float amp = powf(10.0f, dbfs / 20.0f);
+  for (size_t i = 0; i < x.size(); i++) {
+    size_t f = i / FRAME;
+    float tone = f >= start && f < end ? amp * sinf(2.0f * (float)M_PI * 440.0f * (float)i / RATE) : 0.0f;
+    x[i] = to_i16(tone + 0.001f * rng.gauss());
+  }
+  return x;
+}
+
+static void test_onset_and_hangover() {
+  // 1 s sessizlik, 1 s ton, 1 s sessizlik: başlangıç ve sınır çerçevesi tam olarak bilinir
+  const size_t start = 50, end = 100;
+  std::vector<int16_t> x = noise_with_tone(150, start, end, -20.0f, 1);
+  VadState st;
+  vad_init(&st, RATE);
+  VadRun r = run(&st, x.data(), x.size(), FRAME);
+  CHECK(r.onsets.size() == 1 && r.cuts.size() == 1);
+  if (r.onsets.size() == 1) CHECK(r.onsets[0] == start + VAD_ONSET_FRAMES - 1);
+  if (r.cuts.size() == 1) CHECK(r.cuts[0] == end + VAD_HANGOVER_MS / VAD_FRAME_MS - 1);
+  CHECK(st.segments == 1 && !vad_in_speech(&st) && !st.speech_since_cut);
+
+  // Başlangıçtan kısa tıklama konuşma sayılmaz
+  std::vector<int16_t> click = noise_with_tone(100, 50, 50 + VAD_ONSET_FRAMES - 1, -10.0f, 2);
+  vad_init(&st, RATE);
+  r = run(&st, click.data(), click.size(), FRAME);
+  CHECK(r.onsets.empty() && st.segments == 0);
+
+  // VAD_MIN_RMS altı, sessiz odada da gürültü tabanının çok üstünde olsa bile sessizlik
+  std::vector<int16_t> faint = noise_with_tone(100, 20, 80, 20.0f * log10f(0.7f * VAD_MIN_RMS / 32767.0f), 3);
+  vad_init(&st, RATE);
+  r = run(&st, faint.data(), faint.size(), FRAME);
+  CHECK(r.onsets.empty());
+}
+
+static void test_speech_bursts() {
+  // Üç konuşma patlaması, aralarında hangover'dan uzun ve kısa sessizlik:
+  // 0.6 s'lik ara sınır, 0.2 s'lik ara ve hece araları sınır değil
+  const size_t burst = RATE * 3 / 2;
+  std::vector<int16_t> x;
+  TestRng rng(4);
+  auto silence = [&](size_t n) {
+    for (size_t i = 0; i < n; i++) x.push_back(to_i16(0.001f * rng.gauss()));
+  };
+  auto speech = [&](uint32_t seed) {
+    std::vector<int16_t> s(burst);
+    make_speech_like(s.data(), s.size(), RATE, -12.0f, seed);
+    for (size_t i = 0; i < burst; i++) s[i] = to_i16((s[i] / 32768.0f) + 0.001f * rng.gauss());
+    x.insert(x.end(), s.begin(), s.end());
+  };
+  silence(RATE / 2);
+  speech(10);
+  silence(RATE * 6 / 10);
+  speech(11);
+  silence(RATE / 5);
+  speech(12);
+  silence(RATE);
+
+  VadState st;
+  vad_init(&st, RATE);
+  VadRun r = run(&st, x.data(), x.size(), FRAME);
+  printf("vad: sentetik, %zu başlangıç, sınırlar", r.onsets.size());
+  for (size_t c : r.cuts) printf(" %.2f s", (c + 1) * VAD_FRAME_MS / 1000.0);
+  printf("\n");
+  CHECK(r.cuts.size() == 2 && st.segments == 2);
+  // Sınırlar sessizlik içinde: birinci aradan ve son patlamadan sonra
+  size_t gap1 = (RATE / 2 + burst) / FRAME, gap1_end = gap1 + RATE * 6 / 10 / FRAME;
+  size_t last_end = (x.size() - RATE) / FRAME;
+  if (r.cuts.size() == 2) {
+    CHECK(r.cuts[0] > gap1 && r.cuts[0] < gap1_end);
+    CHECK(r.cuts[1] > last_end && r.cuts[1] < last_end + 2 * VAD_HANGOVER_MS / VAD_FRAME_MS);
+  }
+  CHECK(!st.speech_since_cut);
+
+  // Parça ölçeğinde (128 ms) aynı sınırlar, en çok bir parça gecikmeyle
+  vad_init(&st, RATE);
+  VadRun chunked = run(&st, x.data(), x.size(), CHUNK);
+  CHECK(chunked.cuts.size() == r.cuts.size());
+  for (size_t i = 0; i < chunked.cuts.size() && i < r.cuts.size(); i++) {
+    CHECK(chunked.cuts[i] >= r.cuts[i] && chunked.cuts[i] < r.cuts[i] + CHUNK / FRAME + 1);
+  }
+}
+
+static void test_max_segment_and_tail() {
+  // Kesintisiz 10 s konuşma: VAD_MAX_SEGMENT_MS'ten sonraki ilk sessiz çerçevede
+  // kesilir, konuşma sürdüğü için yeni bölüt hemen açılır ve kayıt sonu işaretlidir
+  std::vector<int16_t> x(RATE * 10);
+  make_speech_like(x.data(), x.size(), RATE, -12.0f, 20);
+  VadState st;
+  vad_init(&st, RATE);
+  VadRun r = run(&st, x.data(), x.size(), FRAME);
+  const size_t max_frames = VAD_MAX_SEGMENT_MS / VAD_FRAME_MS;
+  CHECK(!r.onsets.empty() && !r.cuts.empty());
+  if (!r.onsets.empty() && !r.cuts.empty()) {
+    size_t len = r.cuts[0] - r.onsets[0] + VAD_ONSET_FRAMES;
+    printf("vad: kesintisiz konuşma, ilk bölüt %.2f s\n", len * VAD_FRAME_MS / 1000.0);
+    // Hece zarfı 250 ms'de bir sessizliğe iner
+    CHECK(len >= max_frames && len < max_frames + 250 / VAD_FRAME_MS);
+  }
+  CHECK(r.cuts.size() == 1 && r.onsets.size() == 2);
+  CHECK(vad_in_speech(&st) && st.speech_since_cut);
+
+  // Konuşma ortasında biten kayıt, sonra hangover'dan kısa sessizlik: son hâlâ konuşma
+  std::vector<int16_t> tail = noise_with_tone(80, 20, 70, -20.0f, 21);
+  vad_init(&st, RATE);
+  run(&st, tail.data(), tail.size(), CHUNK);
+  CHECK(st.segments == 0 && st.speech_since_cut);
+  // Hangover dolunca kesilir, son işaretsiz
+  std::vector<int16_t> quiet = noise_with_tone(VAD_HANGOVER_MS / VAD_FRAME_MS, 0, 0, -20.0f, 22);
+  run(&st, quiet.data(), quiet.size(), CHUNK);
+  CHECK(st.segments == 1 && !st.speech_since_cut);
+}
+
+static void test_recording() {
+  std::vector<uint8_t> raw;
+  CHECK(read_file(FIXTURE_DIR "/input_audio_udp.pcm", &raw));
+  if (raw.empty()) return;
+  std::vector<int16_t> x = to_pcm(raw.data(), raw.size());
+  // Kayıtta konuşma ~0.2 s'de başlar; ~6.0 s'den sonra düzey VAD_MIN_RMS'in
+  // altında kalır, 6.4 s'den sonrası oda gürültüsü
+  const size_t speech_start = 200 / VAD_FRAME_MS, speech_end = 6000 / VAD_FRAME_MS;
+
+  VadState st;
+  vad_init(&st, RATE);
+  VadRun r = run(&st, x.data(), x.size(), CHUNK);
+  printf("vad: input_audio_udp.pcm %.1f s, %u bölüt, başlangıçlar", x.size() / (double)RATE, st.segments);
+  for (size_t o : r.onsets) printf(" %.2f", (o + 1) * VAD_FRAME_MS / 1000.0);
+  printf(" s, sınırlar");
+  for (size_t c : r.cuts) printf(" %.2f", (c + 1) * VAD_FRAME_MS / 1000.0);
+  printf(" s\n");
+
+  CHECK(!r.onsets.empty() && !r.cuts.empty());
+  if (r.onsets.empty() || r.cuts.empty()) return;
+  CHECK(r.onsets[0] >= speech_start && r.onsets[0] < speech_start + 1000 / VAD_FRAME_MS);
+  // Son sınır konuşmanın bitişinden hangover ve bir parça içinde; sonrasında başlangıç yok
+  CHECK(r.cuts.back() >= speech_end && r.cuts.back() < speech_end + (VAD_HANGOVER_MS + 300) / VAD_FRAME_MS);
+  CHECK(r.onsets.back() < speech_end);
+  CHECK(!vad_in_speech(&st) && !st.speech_since_cut);
+}
+
+int main() {
+  test_onset_and_hangover();
+  test_speech_bursts();
+  test_max_segment_and_tail();
+  test_recording();
+  CHECK_DONE();
+}
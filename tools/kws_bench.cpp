@@ -0,0 +1,233 @@
+// kws_bench.cpp
+// Yerel komut tanıyıcının (src/kws.cpp) kayıtlı klipler üzerinde doğruluk ve
+// gecikme ölçümü. Klipler "<komut>_<n>.wav" adlı, 16 bit mono WAV dosyalarıdır
+// (ör. ana_menu_01.wav); hız 16 kHz değilse cihazdaki dönüştürücüyle çevrilir.
+// Her komutun adına göre ilk --templates klibi şablon, kalanlar sorgudur; cihaz
+// da şablonlarını kullanıcının ilk onaylanan komutlarından öğrenir.
+//
+// Masaüstünde derleme:
+//   g++ -O2 -std=gnu++17 -Iinclude tools/kws_bench.cpp src/kws.cpp
+//     src/dsp_kernels.cpp src/resampler.cpp -o kws_bench
+//   ./kws_bench klipler/ --templates 2 -v
+//
+// "emin" sonuçlar cihazda sunucuya gitmeden kabul edilir; "yedek" oranı Whisper'a
+// düşen sorguların payıdır. Süreler masaüstü içindir; cihazdaki karşılığı
+// dsp_run_benchmark() yazar.
+
+#include "kws.h"
+#include "resampler.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#define BENCH_RATE 16000
+
+struct Clip {
+  std::string name;
+  std::string label;
+  std::vector<int16_t> pcm;
+};
+
+static uint32_t rd32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+static bool load_wav(const std::string& path, std::vector<int16_t>* out) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (f == NULL) return false;
+  std::vector<uint8_t> buf;
+  uint8_t tmp[4096];
+  size_t n;
+  while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0) buf.insert(buf.end(), tmp, tmp + n);
+  fclose(f);
+  if (buf.size() < 12 || memcmp(buf.data(), "RIFF", 4) != 0 || memcmp(buf.data() + 8, "WAVE", 4) != 0) return false;
+
+  uint32_t rate = 0;
+  uint16_t channels = 0, bits = 0;
+  size_t at = 12;
+  while (at + 8 <= buf.size()) {
+    uint32_t len = rd32(buf.data() + at + 4);
+    const uint8_t* body = buf.data() + at + 8;
+    if (memcmp(buf.data() + at, "fmt ", 4) == 0 && len >= 16) {
+      channels = rd16(body + 2);
+      rate = rd32(body + 4);
+      bits = rd16(body + 14);
+    } else if (memcmp(buf.data() + at, "data", 4) == 0) {
+      if (channels != 1 || bits != 16) return false;
+      len = std::min<size_t>(len, buf.size() - at - 8);
+      std::vector<int16_t> pcm(len / 2);
+      memcpy(pcm.data(), body, pcm.size() * 2);
+      if (rate == BENCH_RATE) {
+        *out = pcm;
+        return true;
+      }
+      static Resampler rs;
+      if (!resampler_init(&rs, rate, BENCH_RATE)) return false;
+      out->resize(resampler_max_out(&rs, pcm.size()));
+      out->resize(resampler_process(&rs, pcm.data(), pcm.size(), out->data()));
+      return true;
+    }
+    at += 8 + len + (len & 1);
+  }
+  return false;
+}
+
+static double now_us() {
+  using namespace std::chrono;
+  return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv) {
+  const char* dir = NULL;
+  size_t per_label = 2;
+  bool verbose = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--templates") == 0 && i + 1 < argc) {
+      per_label = (size_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else {
+      dir = argv[i];
+    }
+  }
+  if (dir == NULL || per_label == 0) {
+    fprintf(stderr, "kullanım: %s <klip dizini> [--templates N] [-v]\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<Clip> clips;
+  DIR* d = opendir(dir);
+  if (d == NULL) {
+    perror(dir);
+    return 1;
+  }
+  while (struct dirent* e = readdir(d)) {
+    std::string name = e->d_name;
+    size_t us = name.rfind('_');
+    if (name.size() < 5 || name.compare(name.size() - 4, 4, ".wav") != 0 || us == std::string::npos) continue;
+    Clip c;
+    c.name = name;
+    c.label = name.substr(0, us);
+    if (!load_wav(std::string(dir) + "/" + name, &c.pcm)) {
+      fprintf(stderr, "atlandı (16 bit mono WAV değil): %s\n", name.c_str());
+      continue;
+    }
+    clips.push_back(std::move(c));
+  }
+  closedir(d);
+  std::sort(clips.begin(), clips.end(), [](const Clip& a, const Clip& b) { return a.name < b.name; });
+
+  if (!kws_init(BENCH_RATE)) {
+    fprintf(stderr, "kws_init başarısız\n");
+    return 1;
+  }
+
+  std::vector<std::string> labels;
+  std::map<std::string, size_t> seen;
+  std::vector<KwsFeatures*> feats;
+  std::vector<KwsTemplate> templates;
+  std::vector<const Clip*> queries;
+  std::vector<KwsFeatures*> query_feats;
+  double extract_us = 0.0, extract_max = 0.0;
+  size_t extract_n = 0, rejected = 0;
+
+  for (const Clip& c : clips) {
+    KwsFeatures* f = new KwsFeatures;
+    double t0 = now_us();
+    bool ok = kws_extract(c.pcm.data(), c.pcm.size(), f);
+    double dt = now_us() - t0;
+    extract_us += dt;
+    extract_max = std::max(extract_max, dt);
+    extract_n++;
+    if (!ok) {
+      // Cihazda bu durumda da sunucuya düşülür
+      if (verbose) printf("%-28s konuşma bulunamadı\n", c.name.c_str());
+      rejected++;
+      delete f;
+      continue;
+    }
+    auto it = std::find(labels.begin(), labels.end(), c.label);
+    int label = (int)(it - labels.begin());
+    if (it == labels.end()) labels.push_back(c.label);
+    if (seen[c.label]++ < per_label) {
+      templates.push_back({label, f});
+      feats.push_back(f);
+    } else {
+      queries.push_back(&c);
+      query_feats.push_back(f);
+    }
+  }
+
+  size_t nl = labels.size();
+  std::vector<std::vector<int>> confusion(nl, std::vector<int>(nl + 1, 0));
+  size_t top1 = 0, confident = 0, confident_ok = 0;
+  double match_us = 0.0, match_max = 0.0;
+  std::vector<float> d_ok, d_bad;
+
+  for (size_t q = 0; q < queries.size(); q++) {
+    int truth = (int)(std::find(labels.begin(), labels.end(), queries[q]->label) - labels.begin());
+    double t0 = now_us();
+    KwsResult r = kws_match(query_feats[q], templates.data(), templates.size());
+    double dt = now_us() - t0;
+    match_us += dt;
+    match_max = std::max(match_max, dt);
+
+    confusion[truth][r.label < 0 ? nl : (size_t)r.label]++;
+    if (r.label == truth) {
+      top1++;
+      d_ok.push_back(r.best);
+    } else {
+      d_bad.push_back(r.best);
+    }
+    if (r.confident) {
+      confident++;
+      if (r.label == truth) confident_ok++;
+    }
+    if (verbose) {
+      printf("%-28s -> %-16s best %6.2f second %6.2f %s%s\n",
+             queries[q]->name.c_str(),
+             r.label < 0 ? "-" : labels[r.label].c_str(),
+             r.best, r.second,
+             r.confident ? "emin" : "yedek",
+             r.label == truth ? "" : "  YANLIŞ");
+    }
+  }
+
+  size_t nq = queries.size();
+  printf("\n%zu klip, %zu komut, %zu şablon, %zu sorgu, %zu konuşmasız\n",
+         clips.size(), nl, templates.size(), nq, rejected);
+  if (nq == 0) return 0;
+  printf("en yakın komut doğru:  %5.1f%%\n", 100.0 * top1 / nq);
+  printf("emin sonuçlar:         %5.1f%% (doğruluk %5.1f%%)\n",
+         100.0 * confident / nq, confident ? 100.0 * confident_ok / confident : 0.0);
+  printf("sunucuya düşen:        %5.1f%%\n", 100.0 * (nq - confident) / nq);
+  printf("yanlış kabul:          %zu\n", confident - confident_ok);
+  printf("öznitelik çıkarma:     %.0f us ort., %.0f us en çok\n", extract_us / extract_n, extract_max);
+  printf("eşleme (%zu şablon):   %.0f us ort., %.0f us en çok\n", templates.size(), match_us / nq, match_max);
+
+  // KWS_ACCEPT_DIST ayarı için doğru ve yanlış en yakın uzaklıklar
+  auto pct = [](std::vector<float> v, double p) {
+    if (v.empty()) return 0.0f;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p * (v.size() - 1))];
+  };
+  printf("doğru uzaklık  p50 %.2f p90 %.2f | yanlış uzaklık p10 %.2f p50 %.2f\n",
+         pct(d_ok, 0.5), pct(d_ok, 0.9), pct(d_bad, 0.1), pct(d_bad, 0.5));
+
+  printf("\nkarışıklık (satır: gerçek, sütun: en yakın)\n%-16s", "");
+  for (size_t j = 0; j < nl; j++) printf(" %6zu", j);
+  printf("      -\n");
+  for (size_t i = 0; i < nl; i++) {
+    printf("%2zu %-13s", i, labels[i].c_str());
+    for (size_t j = 0; j <= nl; j++) printf(" %6d", confusion[i][j]);
+    printf("\n");
+  }
+  for (KwsFeatures* f : feats) delete f;
+  for (KwsFeatures* f : query_feats) delete f;
+  return 0;
+}
@@ -0,0 +1,236 @@
+"""Birden çok kapının aynı sunucuya bindirdiği yükü taklit eder; kırılma noktasını bulur.
+
+Her kapı cihazdaki kayıt döngüsünü (src/voice_assistant.cpp capture_and_upload,
+src/uplink.cpp, src/audio_handler.cpp play_stream) masaüstünden yürütür: 128 bitlik
+oturum açar, sesi gerçek zamanda parçalar halinde yollar, yanıt adresini alır ve yanıt
+sesini sonuna kadar indirir; ardından --think-ms bekleyip yeniden konuşur. Her kapı
+kendi HTTP bağlantısını ya da kalıcı WebSocket oturumunu kullanır.
+
+Sunucu taklit modda çalışmalıdır; Whisper, LLM ve gTTS yerine sabit gecikmeler kullanılır,
+taşıma, oturum tablosu ve yanıt önbelleği gerçek koddur:
+    LLM_SERVER_MOCK=1 MOCK_ASR_MS=300 MOCK_LLM_MS=500 MOCK_TTS_MS=400 python llm_server.py
+--spawn verilirse araç sunucuyu geçici bir dizinde bu ortamla kendisi başlatır.
+
+--doors listesindeki her eşzamanlılık düzeyi --duration saniye sürer. Her düzey için
+tamamlanan oturum/s, oturum gecikmesi yüzdelikleri ve hata oranı yazılır. Oturum
+gecikmesi son ses örneğinin "kaydedildiği" andan yanıt sesinin son baytına kadardır;
+cihazda kullanıcının sustuğu andan yanıtın çalınabildiği ana karşılık gelir.
+"""
+import argparse
+import collections
+import json
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import uuid
+
+import requests
+
+from uplink_bench import CHUNK_SIZE, load_pcm, paced, wav_header
+
+
+class SessionError(Exception):
+    pass
+
+
+def http_session(args, http, pcm, rate):
+    """(yanıt adresi gecikmesi, yanıt sesi gecikmesi) döner."""
+    url = f"http://{args.host}:{args.port}/upload"
+    session = uuid.uuid4().hex
+    chunks = [pcm[i:i + CHUNK_SIZE] for i in range(0, len(pcm), CHUNK_SIZE)]
+    headers = {"X-Session-ID": session, "X-Audio-Codec": "pcm", "X-Sample-Rate": str(rate),
+               "X-Reply-Format": "wav", "Content-Type": "audio/wav"}
+    sent = False
+    try:
+        for i, chunk in enumerate(paced(chunks, rate, True)):
+            last = i == len(chunks) - 1
+            h = dict(headers)
+            h["X-First-Chunk"] = "true" if i == 0 else "false"
+            h["X-Last-Chunk"] = "true" if last else "false"
+            if last:
+                t_end = time.monotonic()
+            r = http.post(url, data=wav_header(len(pcm), rate) + chunk if i == 0 else chunk,
+                          headers=h, timeout=args.timeout)
+            if r.status_code != 200:
+                raise SessionError(f"http {r.status_code}")
+        sent = True
+    finally:
+        # Cihaz gibi: son parça gitmediyse oturum açıkça kapatılır
+        if not sent:
+            try:
+                http.delete(f"{url}/{session}", timeout=2)
+            except requests.RequestException:
+                pass
+    reply = r.text
+    if not reply.startswith("http"):
+        raise SessionError("yanıt adresi yok")
+    t_reply = time.monotonic()
+    audio = http.get(reply, timeout=args.timeout)
+    if audio.status_code != 200 or not audio.content:
+        raise SessionError(f"ses {audio.status_code}")
+    return t_reply - t_end, time.monotonic() - t_end
+
+
+def ws_session(args, conn, pcm, rate):
+    session = uuid.uuid4().hex
+    conn.send(json.dumps({"type": "start", "session": session, "codec": "pcm", "rate": rate,
+                          "wake": False, "format": "wav"}))
+    for chunk in paced([pcm[i:i + CHUNK_SIZE] for i in range(0, len(pcm), CHUNK_SIZE)], rate, True):
+        conn.send_binary(chunk)
+    t_end = time.monotonic()
+    conn.send(json.dumps({"type": "end", "session": session, "samples": len(pcm) // 2, "tail": True}))
+    reply_id, t_reply, got = None, None, 0
+    while True:
+        msg = conn.recv()
+        if isinstance(msg, bytes):
+            got += len(msg)
+            continue
+        msg = json.loads(msg)
+        kind = msg.get("type")
+        if kind == "error" and msg.get("session") == session:
+            raise SessionError(f"ws {msg.get('message')}")
+        if kind == "reply_start" and msg.get("session") == session:
+            reply_id, t_reply, got = msg["id"], time.monotonic(), 0
+        elif kind == "reply_end" and msg.get("id") == reply_id:
+            if got == 0:
+                raise SessionError("ses yok")
+            return t_reply - t_end, time.monotonic() - t_end
+
+
+def door(args, pcm, rate, deadline, results, errors):
+    conn = http = None
+    try:
+        if args.transport == "ws":
+            import websocket
+            conn = websocket.create_connection(f"ws://{args.host}:{args.port}/ws", timeout=args.timeout)
+        else:
+            http = requests.Session()
+        while time.monotonic() < deadline:
+            try:
+                if conn is not None:
+                    results.append(ws_session(args, conn, pcm, rate))
+                else:
+                    results.append(http_session(args, http, pcm, rate))
+            except SessionError as e:
+                errors[str(e)] += 1
+            except requests.Timeout:
+                errors["zaman aşımı"] += 1
+            except requests.RequestException:
+                errors["bağlantı"] += 1
+            time.sleep(args.think_ms / 1000)
+    except Exception as e:
+        # WebSocket kopması kapıyı bu düzeyin sonuna kadar susturur
+        errors[f"kapı: {type(e).__name__}"] += 1
+    finally:
+        if conn is not None:
+            conn.close()
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100 * len(values)))]
+
+
+def run_level(args, pcm, rate, doors):
+    results, errors = [], collections.Counter()
+    deadline = time.monotonic() + args.duration
+    threads = []
+    for i in range(doors):
+        t = threading.Thread(target=door, args=(args, pcm, rate, deadline, results, errors), daemon=True)
+        t.start()
+        threads.append(t)
+        # Kapılar aynı anda konuşmaya başlamaz
+        time.sleep(min(args.think_ms / 1000, 1.0) / doors)
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - deadline + args.duration
+    return results, errors, elapsed
+
+
+def wait_for_server(args, proc):
+    for _ in range(100):
+        if proc.poll() is not None:
+            sys.exit("❌ Sunucu başlamadı")
+        try:
+            requests.get(f"http://{args.host}:{args.port}/capabilities", timeout=1)
+            return
+        except requests.RequestException:
+            time.sleep(0.2)
+    sys.exit("❌ Sunucu yanıt vermedi")
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--port", type=int, default=5000)
+    p.add_argument("--audio", default="input_audio_udp.pcm", help="16 kHz ham PCM ya da mono WAV")
+    p.add_argument("--seconds", type=float, default=3.0, help="her konuşmada gönderilecek ses")
+    p.add_argument("--doors", default="1,2,4,8,16,32", help="eşzamanlı kapı sayıları")
+    p.add_argument("--duration", type=float, default=30.0, help="her düzeyin süresi (s)")
+    p.add_argument("--think-ms", type=int, default=1000, help="kapının iki konuşması arası")
+    p.add_argument("--timeout", type=float, default=30.0)
+    p.add_argument("--transport", choices=("http", "ws"), default="ws")
+    p.add_argument("--spawn", action="store_true", help="llm_server.py'yi taklit modda başlat")
+    p.add_argument("--csv", help="sonuçları bu dosyaya da yaz")
+    args = p.parse_args()
+
+    pcm, rate = load_pcm(args.audio)
+    pcm = pcm[:int(args.seconds * rate) * 2]
+
+    proc = None
+    if args.spawn:
+        # Portta başka bir sunucu varsa başlatılan süreç hemen çıkar ve ölçüm o sunucuya gider
+        try:
+            requests.get(f"http://{args.host}:{args.port}/capabilities", timeout=1)
+            sys.exit(f"❌ {args.host}:{args.port} kullanımda; --spawn boş bir port ister")
+        except requests.RequestException:
+            pass
+        server = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "llm_server.py")
+        env = dict(os.environ, LLM_SERVER_MOCK="1")
+        # audios/ ve kayıt dosyaları depoya değil geçici dizine yazılır
+        proc = subprocess.Popen([sys.executable, os.path.abspath(server)], cwd=tempfile.mkdtemp(prefix="load_bench_"),
+                                env=env, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                                start_new_session=True)
+        wait_for_server(args, proc)
+
+    rows = []
+    print(f"{args.transport}, {len(pcm) / 2 / rate:.1f} s ses, {args.duration:.0f} s/düzey, düşünme {args.think_ms} ms")
+    print(" kapı  oturum   oturum/s  hata%   p50 ms   p90 ms   p99 ms  adres p50  hatalar")
+    try:
+        for doors in [int(x) for x in args.doors.split(",")]:
+            results, errors, elapsed = run_level(args, pcm, rate, doors)
+            done = [r[1] * 1000 for r in results]
+            first = [r[0] * 1000 for r in results]
+            failed = sum(errors.values())
+            total = len(results) + failed
+            row = {
+                "doors": doors, "sessions": total, "throughput": len(results) / elapsed,
+                "error_pct": 100 * failed / total if total else 0.0,
+                "p50": percentile(done, 50), "p90": percentile(done, 90), "p99": percentile(done, 99),
+                "reply_p50": percentile(first, 50),
+            }
+            rows.append(row)
+            print(f"{doors:5} {total:7} {row['throughput']:10.2f} {row['error_pct']:6.1f} "
+                  f"{row['p50']:8.0f} {row['p90']:8.0f} {row['p99']:8.0f} {row['reply_p50']:10.0f}  "
+                  f"{dict(errors) if errors else ''}")
+    finally:
+        if proc is not None:
+            # Hata ayıklama modunda yeniden yükleyicinin alt süreci de kapanmalı
+            os.killpg(proc.pid, signal.SIGTERM)
+            proc.wait()
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write(",".join(rows[0]) + "\n")
+            for row in rows:
+                f.write(",".join(f"{v:.2f}" if isinstance(v, float) else str(v) for v in row.values()) + "\n")
+
+
+if __name__ == "__main__":
+    main()
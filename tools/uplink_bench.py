@@ -0,0 +1,196 @@
+"""HTTP parça POST'ları, UDP ve WebSocket taşımalarını aynı ses üzerinde karşılaştırır.
+
+Cihazın yükleme yollarını (src/uplink.cpp) masaüstünden taklit eder. Sunucu
+X-Dry-Run / UDP_FLAG_DRY / "dry" ile ASR'ı atlar ve yalnızca aldığı örnek, kayıp ve
+kurtarılan paket sayısını döner; böylece ölçülen şey yalnızca taşımadır.
+WebSocket ölçümü websocket-client paketini ister (pip install websocket-client);
+bağlantı cihazdaki gibi bir kez kurulur ve tekrarlar arasında açık kalır.
+
+Kayıplı bir erişim noktasını Linux'ta netem ile canlandırın (her iki yol da etkilenir):
+    sudo tc qdisc add dev lo root netem loss 5% delay 20ms 10ms
+    python tools/uplink_bench.py --runs 20
+    sudo tc qdisc del dev lo root
+netem yoksa --drop yalnızca UDP gönderiminde rastgele paket atar; --late ise
+paketlerin bir kısmını END'in arkasına bırakır (titreşimle sıra değişmesi).
+
+Gecikme, sesin son örneğinin "kaydedildiği" andan yanıtın geldiği ana kadardır;
+--realtime ile parçalar cihazdaki gibi ses hızında gönderilir.
+"""
+import argparse
+import json
+import random
+import socket
+import statistics
+import struct
+import time
+import uuid
+import wave
+
+import requests
+
+UDP_HEADER = struct.Struct("<2sBBBBHIIHBB")
+UDP_DATA, UDP_FEC, UDP_END, UDP_ACK, UDP_REPLY = range(5)
+UDP_FLAG_DRY = 0x04
+CHUNK_SIZE = 4096          # config.h: HTTP parçası (bayt, 16 bit PCM)
+UDP_FRAME_MS = 20
+UDP_FEC_GROUP = 4
+UDP_END_RETRY_MS = 100
+
+
+def load_pcm(path):
+    if path.endswith(".wav"):
+        with wave.open(path, "rb") as wf:
+            return wf.readframes(wf.getnframes()), wf.getframerate()
+    with open(path, "rb") as f:
+        return f.read(), 16000
+
+
+def wav_header(pcm_len, rate):
+    return (b"RIFF" + struct.pack("<I", pcm_len + 36) + b"WAVEfmt " +
+            struct.pack("<IHHIIHH", 16, 1, 1, rate, rate * 2, 2, 16) +
+            b"data" + struct.pack("<I", pcm_len))
+
+
+def paced(chunks, rate, realtime):
+    """Parçaları cihazın halkadan okuyacağı hızda verir; son örneğin zamanını döner."""
+    start = time.monotonic()
+    sent = 0
+    for chunk in chunks:
+        sent += len(chunk) // 2
+        if realtime:
+            delay = start + sent / rate - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+        yield chunk
+
+
+def run_http(args, pcm, rate):
+    session = uuid.uuid4().hex
+    chunks = [pcm[i:i + CHUNK_SIZE] for i in range(0, len(pcm), CHUNK_SIZE)]
+    http = requests.Session()
+    headers = {"X-Session-ID": session, "X-Audio-Codec": "pcm", "X-Sample-Rate": str(rate),
+               "X-Dry-Run": "true", "Content-Type": "audio/wav"}
+    reply = ""
+    for i, chunk in enumerate(paced(chunks, rate, args.realtime)):
+        h = dict(headers)
+        h["X-First-Chunk"] = "true" if i == 0 else "false"
+        h["X-Last-Chunk"] = "true" if i == len(chunks) - 1 else "false"
+        body = wav_header(len(pcm), rate) + chunk if i == 0 else chunk
+        if i == len(chunks) - 1:
+            t_end = time.monotonic()
+        reply = http.post(f"http://{args.host}:{args.port}/upload", data=body, headers=h, timeout=30).text
+    return time.monotonic() - t_end, reply
+
+
+def run_udp(args, pcm, rate):
+    session = random.getrandbits(32)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(UDP_END_RETRY_MS / 1000)
+    addr = (args.host, args.udp_port)
+    frame = rate * UDP_FRAME_MS // 1000 * 2
+    chunks = [pcm[i:i + frame] for i in range(0, len(pcm), frame)]
+
+    held = []
+
+    def send(kind, seq, ts, payload=b"", count=0):
+        packet = UDP_HEADER.pack(b"VA", 1, kind, UDP_FLAG_DRY, 0, seq, session, ts, rate, count, 0) + payload
+        if kind in (UDP_DATA, UDP_FEC):
+            if random.random() < args.drop:
+                return
+            if random.random() < args.late:
+                held.append(packet)
+                return
+        sock.sendto(packet, addr)
+
+    parity, group, base, ts = b"", 0, 0, 0
+    for seq, chunk in enumerate(paced(chunks, rate, args.realtime)):
+        send(UDP_DATA, seq, ts, chunk)
+        block = struct.pack("<HI", len(chunk), ts) + chunk
+        n = max(len(parity), len(block))
+        parity = bytes(a ^ b for a, b in zip(parity.ljust(n, b"\0"), block.ljust(n, b"\0")))
+        group += 1
+        ts += len(chunk) // 2
+        if UDP_FEC_GROUP and (group == UDP_FEC_GROUP or seq == len(chunks) - 1):
+            send(UDP_FEC, base, 0, parity, group)
+            parity, group, base = b"", 0, seq + 1
+    t_end = time.monotonic()
+    deadline = t_end + 30
+    while time.monotonic() < deadline:
+        send(UDP_END, len(chunks), ts)
+        for packet in held:
+            sock.sendto(packet, addr)
+        held.clear()
+        try:
+            data, _ = sock.recvfrom(2048)
+        except socket.timeout:
+            continue
+        fields = UDP_HEADER.unpack_from(data)
+        if fields[6] == session and fields[2] == UDP_REPLY:
+            return time.monotonic() - t_end, data[UDP_HEADER.size:].decode()
+    return float("nan"), ""
+
+
+def run_ws(args, pcm, rate):
+    import websocket
+    global ws_conn
+    if ws_conn is None:
+        ws_conn = websocket.create_connection(f"ws://{args.host}:{args.port}/ws", timeout=30)
+    session = uuid.uuid4().hex
+    ws_conn.send(json.dumps({"type": "start", "session": session, "codec": "pcm", "rate": rate,
+                             "wake": True, "dry": True}))
+    for chunk in paced([pcm[i:i + CHUNK_SIZE] for i in range(0, len(pcm), CHUNK_SIZE)], rate, args.realtime):
+        ws_conn.send_binary(chunk)
+    t_end = time.monotonic()
+    ws_conn.send(json.dumps({"type": "end", "session": session}))
+    while True:
+        msg = ws_conn.recv()
+        if isinstance(msg, bytes):
+            continue
+        msg = json.loads(msg)
+        if msg.get("session") == session and msg.get("type") == "transcript" and msg.get("final"):
+            return time.monotonic() - t_end, msg["text"]
+        if msg.get("session") == session and msg.get("type") == "error":
+            return float("nan"), ""
+
+
+ws_conn = None
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--port", type=int, default=5000)
+    p.add_argument("--udp-port", type=int, default=5005)
+    p.add_argument("--audio", default="input_audio_udp.pcm", help="16 kHz ham PCM ya da mono WAV")
+    p.add_argument("--runs", type=int, default=10)
+    p.add_argument("--drop", type=float, default=0.0, help="UDP'de taklit edilen paket kaybı (0-1)")
+    p.add_argument("--late", type=float, default=0.0, help="UDP'de END'den sonra gönderilen paket oranı (0-1)")
+    p.add_argument("--realtime", action="store_true")
+    p.add_argument("--transport", choices=("http", "udp", "ws", "all"), default="all")
+    args = p.parse_args()
+
+    pcm, rate = load_pcm(args.audio)
+    runners = {"http": run_http, "udp": run_udp, "ws": run_ws}
+    for name in (tuple(runners) if args.transport == "all" else (args.transport,)):
+        if name == "ws":
+            try:
+                import websocket  # noqa: F401
+            except ImportError:
+                print("ws  : atlandı, websocket-client kurulu değil (pip install -r requirements.txt)")
+                continue
+        latencies, lost_packets, recovered = [], 0, 0
+        for _ in range(args.runs):
+            latency, reply = runners[name](args, pcm, rate)
+            latencies.append(latency * 1000)
+            parts = reply.split()
+            if len(parts) == 4 and parts[0] == "DRY":
+                # Kurtarılamayan paketlerin yerini sunucu sessizlikle doldurur
+                lost_packets += int(parts[2])
+                recovered += int(parts[3])
+        print(f"{name:4}: gecikme ort {statistics.mean(latencies):7.1f} ms, "
+              f"p95 {sorted(latencies)[int(0.95 * (len(latencies) - 1))]:7.1f} ms, "
+              f"kayıp paket {lost_packets}, kurtarılan {recovered} ({args.runs} tekrar)")
+
+
+if __name__ == "__main__":
+    main()